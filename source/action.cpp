@@ -22,6 +22,12 @@
 #include "map.h"
 #include "editor.h"
 #include "gui.h"
+#include "iomap_otbm.h"
+#include "filehandle.h"
+#include "selection_move.h"
+
+#include <chrono>
+#include <numeric>
 
 // Add necessary includes for exception handling and file operations
 #include <exception>
@@ -61,6 +67,13 @@ Change* Change::Create(Waypoint* wp, const Position& where) {
 	return c;
 }
 
+Change* Change::Create(SelectionMove* move) {
+	Change* c = newd Change();
+	c->type = CHANGE_MOVE_SELECTION;
+	c->data = move;
+	return c;
+}
+
 Change::~Change() {
 	clear();
 }
@@ -79,6 +92,11 @@ void Change::clear() {
 			ASSERT(data);
 			delete reinterpret_cast<std::pair<std::string, Position>*>(data);
 			break;
+		case CHANGE_MOVE_SELECTION:
+			ASSERT(data);
+			delete reinterpret_cast<SelectionMove*>(data);
+			break;
+		case CHANGE_SPILLED_TILE:
 		case CHANGE_NONE:
 			break;
 		default:
@@ -100,6 +118,10 @@ uint32_t Change::memsize() const {
 			ASSERT(data);
 			mem += reinterpret_cast<Tile*>(data)->memsize();
 			break;
+		case CHANGE_MOVE_SELECTION:
+			ASSERT(data);
+			mem += reinterpret_cast<SelectionMove*>(data)->memsize();
+			break;
 		default:
 			break;
 	}
@@ -109,10 +131,16 @@ uint32_t Change::memsize() const {
 Action::Action(Editor& editor, ActionIdentifier ident) :
 	commited(false),
 	editor(editor),
-	type(ident) {
+	type(ident),
+	spilled_count(0),
+	spill_file(nullptr) {
 }
 
 Action::~Action() {
+	if (spilled_count > 0) {
+		spill_file->release(spill_record);
+	}
+
 	ChangeList::const_reverse_iterator it = changes.rbegin();
 	while (it != changes.rend()) {
 		delete *it;
@@ -122,7 +150,17 @@ Action::~Action() {
 
 size_t Action::approx_memsize() const {
 	uint32_t mem = sizeof(*this);
-	mem += changes.size() * (sizeof(Change) + sizeof(Tile) + sizeof(Item) + 6 /* approx overhead*/);
+	mem += changes.size() * sizeof(Change);
+	// A selection move is a single change that can hold a whole selection
+	size_t moves = 0;
+	for (const Change* change : changes) {
+		if (change->type == CHANGE_MOVE_SELECTION) {
+			mem += reinterpret_cast<SelectionMove*>(change->data)->memsize();
+			++moves;
+		}
+	}
+	// Spilled tiles only leave their change behind
+	mem += (changes.size() - spilled_count - moves) * (sizeof(Tile) + sizeof(Item) + 6 /* approx overhead*/);
 	return mem;
 }
 
@@ -139,6 +177,12 @@ size_t Action::memsize() const {
 				break;
 			}
 
+			case CHANGE_MOVE_SELECTION: {
+				ASSERT(c->data);
+				mem += reinterpret_cast<SelectionMove*>(c->data)->memsize();
+				break;
+			}
+
 			default:
 				break;
 		}
@@ -147,6 +191,73 @@ size_t Action::memsize() const {
 	return mem;
 }
 
+bool Action::spill(UndoSpillFile& file) {
+	if (spilled_count > 0) {
+		return false;
+	}
+
+	IOMapOTBM iomap(editor.map.getVersion());
+	MemoryNodeFileWriteHandle writer;
+	writer.addNode(0);
+	size_t count = 0;
+	for (Change* c : changes) {
+		if (c->type == CHANGE_TILE && UndoSpillFile::canSpill(reinterpret_cast<Tile*>(c->data))) {
+			UndoSpillFile::writeTile(writer, iomap, reinterpret_cast<Tile*>(c->data));
+			++count;
+		}
+	}
+	writer.endNode();
+
+	if (count == 0 || !file.write(writer.getMemory(), writer.getSize(), spill_record)) {
+		return false;
+	}
+
+	// Changes stay in place so the order is kept when the tiles come back
+	for (Change* c : changes) {
+		if (c->type == CHANGE_TILE && UndoSpillFile::canSpill(reinterpret_cast<Tile*>(c->data))) {
+			delete reinterpret_cast<Tile*>(c->data);
+			c->data = nullptr;
+			c->type = CHANGE_SPILLED_TILE;
+		}
+	}
+	spilled_count = count;
+	spill_file = &file;
+	return true;
+}
+
+bool Action::reload() {
+	if (spilled_count == 0) {
+		return true;
+	}
+
+	std::string data;
+	if (!spill_file->read(spill_record, data)) {
+		return false;
+	}
+
+	IOMapOTBM iomap(editor.map.getVersion());
+	MemoryNodeFileReadHandle reader(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+	BinaryNode* node = reader.getRootNode()->getChild();
+	for (Change* c : changes) {
+		if (c->type != CHANGE_SPILLED_TILE) {
+			continue;
+		}
+
+		Tile* tile = node ? UndoSpillFile::readTile(node, iomap, editor.map) : nullptr;
+		if (!tile) {
+			return false;
+		}
+		c->data = tile;
+		c->type = CHANGE_TILE;
+		--spilled_count;
+		node = node->advance();
+	}
+
+	spill_file->release(spill_record);
+	spill_file = nullptr;
+	return true;
+}
+
 void Action::commit(DirtyList* dirty_list) {
 	editor.selection.start(Selection::INTERNAL);
 	ChangeList::const_iterator it = changes.begin();
@@ -282,6 +393,12 @@ void Action::commit(DirtyList* dirty_list) {
 				break;
 			}
 
+			case CHANGE_MOVE_SELECTION: {
+				ASSERT(c->data);
+				reinterpret_cast<SelectionMove*>(c->data)->commit(editor, dirty_list);
+				break;
+			}
+
 			default:
 				break;
 		}
@@ -411,6 +528,12 @@ void Action::undo(DirtyList* dirty_list) {
 				break;
 			}
 
+			case CHANGE_MOVE_SELECTION: {
+				ASSERT(c->data);
+				reinterpret_cast<SelectionMove*>(c->data)->undo(editor, dirty_list);
+				break;
+			}
+
 			default:
 				break;
 		}
@@ -494,6 +617,34 @@ void BatchAction::addAndCommitAction(Action* action) {
 	timestamp = time(nullptr);
 }
 
+bool BatchAction::spill(UndoSpillFile& file) {
+	bool spilled = false;
+	for (Action* action : batch) {
+		if (action->spill(file)) {
+			spilled = true;
+		}
+	}
+	return spilled;
+}
+
+bool BatchAction::reload() {
+	for (Action* action : batch) {
+		if (!action->reload()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool BatchAction::isSpilled() const {
+	for (Action* action : batch) {
+		if (action->isSpilled()) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void BatchAction::commit() {
 	for (Action* action : batch) {
 		if (!action->isCommited()) {
@@ -520,7 +671,13 @@ void BatchAction::merge(BatchAction* other) {
 }
 
 ActionQueue::ActionQueue(Editor& editor) :
-	current(0), memory_size(0), editor(editor) {
+	current(0),
+	memory_size(0),
+	editor(editor),
+	spill_file(nullptr),
+	reload_count(0),
+	last_reload_time(0.0),
+	total_reload_time(0.0) {
 	////
 }
 
@@ -528,6 +685,7 @@ ActionQueue::~ActionQueue() {
 	for (auto it = actions.begin(); it != actions.end(); it = actions.erase(it)) {
 		delete *it;
 	}
+	delete spill_file;
 }
 
 Action* ActionQueue::createAction(ActionIdentifier ident) {
@@ -635,15 +793,6 @@ void ActionQueue::addBatch(BatchAction* batch, int stacking_delay) {
 
 		// Safely manage memory
 		try {
-			while (memory_size > size_t(1024 * 1024 * g_settings.getInteger(Config::UNDO_MEM_SIZE)) && !actions.empty()) {
-				memory_size -= actions.front()->memsize();
-				delete actions.front();
-				actions.pop_front();
-				if (current > 0) {
-					current--;
-				}
-			}
-
 			if (actions.size() > size_t(g_settings.getInteger(Config::UNDO_SIZE)) && !actions.empty()) {
 				memory_size -= actions.front()->memsize();
 				BatchAction* todelete = actions.front();
@@ -672,6 +821,8 @@ void ActionQueue::addBatch(BatchAction* batch, int stacking_delay) {
 				batch->timestamp = time(nullptr);
 				current++;
 			} while (false);
+
+			trim();
 		} catch (const std::exception& e) {
 			// Log error but don't crash
 			std::ofstream logFile((wxStandardPaths::Get().GetUserDataDir() + wxFileName::GetPathSeparator() + "action_error.log").ToStdString(), std::ios::app);
@@ -693,18 +844,26 @@ void ActionQueue::addBatch(BatchAction* batch, int stacking_delay) {
 }
 
 void ActionQueue::undo() {
-	if (current > 0) {
+	if (current > 0 && editor.CanEdit()) {
+		BatchAction* batch = actions[current - 1];
+		if (!reload(batch)) {
+			return;
+		}
 		current--;
-		BatchAction* batch = actions[current];
 		batch->undo();
+		trim();
 	}
 }
 
 void ActionQueue::redo() {
-	if (current < actions.size()) {
+	if (current < actions.size() && editor.CanEdit()) {
 		BatchAction* batch = actions[current];
+		if (!reload(batch)) {
+			return;
+		}
 		batch->redo();
 		current++;
+		trim();
 	}
 }
 
@@ -714,6 +873,89 @@ void ActionQueue::clear() {
 		it = actions.erase(it);
 	}
 	current = 0;
+	memory_size = 0;
+}
+
+size_t ActionQueue::getSpilledBatchCount() const {
+	size_t count = 0;
+	for (BatchAction* batch : actions) {
+		if (batch->isSpilled()) {
+			++count;
+		}
+	}
+	return count;
+}
+
+bool ActionQueue::reload(BatchAction* batch) {
+	if (!batch->isSpilled()) {
+		return true;
+	}
+
+	auto started = std::chrono::steady_clock::now();
+	size_t previous_size = batch->memsize();
+	bool success = batch->reload();
+	memory_size -= previous_size;
+	memory_size += batch->memsize(true);
+
+	last_reload_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	total_reload_time += last_reload_time;
+	++reload_count;
+
+	if (!success) {
+		clear();
+		g_gui.PopupDialog("Error", "The undo history could not be read back from disk and has been cleared.", wxOK);
+	}
+	return success;
+}
+
+void ActionQueue::trim() {
+	const size_t memory_budget = size_t(1024 * 1024) * g_settings.getInteger(Config::UNDO_MEM_SIZE);
+	const uint64_t disk_budget = uint64_t(1024 * 1024) * g_settings.getInteger(Config::UNDO_DISK_SIZE);
+
+	if (memory_size > memory_budget && disk_budget > 0) {
+		if (!spill_file) {
+			spill_file = newd UndoSpillFile();
+		}
+
+		if (spill_file->isOpen()) {
+			auto distance = [this](size_t index) {
+				return index < current ? current - 1 - index : index - current;
+			};
+
+			std::vector<size_t> order(actions.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&distance](size_t a, size_t b) {
+				return distance(a) > distance(b);
+			});
+
+			for (size_t index : order) {
+				if (memory_size <= memory_budget || spill_file->getLiveSize() >= disk_budget) {
+					break;
+				}
+				// The next batches to undo and redo stay in memory
+				if (distance(index) == 0) {
+					continue;
+				}
+
+				BatchAction* batch = actions[index];
+				size_t previous_size = batch->memsize();
+				if (batch->spill(*spill_file)) {
+					memory_size -= previous_size;
+					memory_size += batch->memsize(true);
+				}
+			}
+		}
+	}
+
+	// Whatever could not be spilled is dropped, oldest first
+	while (actions.size() > 1 && (memory_size > memory_budget || (spill_file && spill_file->getLiveSize() > disk_budget))) {
+		memory_size -= actions.front()->memsize();
+		delete actions.front();
+		actions.pop_front();
+		if (current > 0) {
+			current--;
+		}
+	}
 }
 
 DirtyList::DirtyList() :
@@ -19,6 +19,7 @@
 #define RME_ACTION_H_
 
 #include "position.h"
+#include "undo_spill.h"
 
 #include <deque>
 
@@ -30,12 +31,15 @@ class Change;
 class Action;
 class BatchAction;
 class ActionQueue;
+class SelectionMove;
 
 enum ChangeType {
 	CHANGE_NONE,
 	CHANGE_TILE,
 	CHANGE_MOVE_HOUSE_EXIT,
 	CHANGE_MOVE_WAYPOINT,
+	CHANGE_SPILLED_TILE, // Tile kept in the undo spill file until the action is needed again
+	CHANGE_MOVE_SELECTION,
 };
 
 class Change {
@@ -49,6 +53,7 @@ public:
 	Change(Tile* tile);
 	static Change* Create(House* house, const Position& where);
 	static Change* Create(Waypoint* wp, const Position& where);
+	static Change* Create(SelectionMove* move);
 	~Change();
 	void clear();
 
@@ -146,6 +151,14 @@ public:
 		commit(dirty_list);
 	}
 
+	// Moves the tiles of this action to the spill file, returns false if
+	// none of them could be moved
+	bool spill(UndoSpillFile& file);
+	bool reload();
+	bool isSpilled() const {
+		return spilled_count > 0;
+	}
+
 protected:
 	Action(Editor& editor, ActionIdentifier ident);
 
@@ -154,6 +167,10 @@ protected:
 	Editor& editor;
 	ActionIdentifier type;
 
+	size_t spilled_count;
+	UndoSpillFile* spill_file;
+	UndoSpillFile::Record spill_record;
+
 	friend class ActionQueue;
 };
 
@@ -179,6 +196,10 @@ public:
 	virtual void addAction(Action* action);
 	virtual void addAndCommitAction(Action* action);
 
+	bool spill(UndoSpillFile& file);
+	bool reload();
+	bool isSpilled() const;
+
 protected:
 	BatchAction(Editor& editor, ActionIdentifier ident);
 
@@ -224,11 +245,47 @@ public:
 		return current < actions.size();
 	}
 
+	// Undo history diagnostics
+	size_t getMemorySize() const {
+		return memory_size;
+	}
+	size_t getBatchCount() const {
+		return actions.size();
+	}
+	// Batches before the current position, the ones undo can reach
+	size_t getUndoCount() const {
+		return current;
+	}
+	size_t getSpilledBatchCount() const;
+	const UndoSpillFile* getSpillFile() const {
+		return spill_file;
+	}
+	uint32_t getReloadCount() const {
+		return reload_count;
+	}
+	double getLastReloadTime() const {
+		return last_reload_time;
+	}
+	double getTotalReloadTime() const {
+		return total_reload_time;
+	}
+
 protected:
+	// Brings a spilled batch back into memory before it is undone or redone
+	bool reload(BatchAction* batch);
+	// Keeps the queue within the memory and disk budgets, batches far from
+	// the current position are spilled first and the oldest are dropped last
+	void trim();
+
 	size_t current;
 	size_t memory_size;
 	Editor& editor;
 	ActionList actions;
+
+	UndoSpillFile* spill_file;
+	uint32_t reload_count;
+	double last_reload_time;
+	double total_reload_time;
 };
 
 #endif
@@ -35,6 +35,7 @@
 #include "map.h"
 #include "complexitem.h"
 #include "creature.h"
+#include "live_log.h"
 
 // Add exception handling includes
 #include <exception>
@@ -95,7 +96,20 @@ EVT_SET_FOCUS(MapScrollBar::OnFocus)
 EVT_MOUSEWHEEL(MapScrollBar::OnWheel)
 END_EVENT_TABLE()
 
+#ifdef __WINDOWS__
 wxIMPLEMENT_APP(Application);
+#else
+wxIMPLEMENT_APP_NO_MAIN(Application);
+
+int main(int argc, char** argv) {
+	// Batch runs must work on machines without a display, so they never
+	// start the GUI toolkit
+	if (argc >= 2 && MapBatch::isBatchArgument(argv[1])) {
+		return MapBatch::main(argc, argv);
+	}
+	return wxEntry(argc, argv);
+}
+#endif
 
 Application::~Application() {
 	// Destroy
@@ -117,6 +131,25 @@ bool Application::OnInit() {
 	wxHandleFatalExceptions(true);
 #endif
 
+	m_run_live_benchmark = false;
+	m_live_benchmark = nullptr;
+	m_batch_exit_code = -1;
+
+	// Only reached on Windows, elsewhere main() runs batches without the GUI toolkit
+	if (argc >= 2 && MapBatch::isBatchArgument(argv[1])) {
+		wxArrayString arguments;
+		for (int i = 2; i < argc; ++i) {
+			arguments.Add(argv[i]);
+		}
+#ifdef _USE_PROCESS_COM
+		m_proc_server = nullptr;
+		m_single_instance_checker = nullptr;
+#endif
+		MapBatch batch;
+		m_batch_exit_code = batch.run(arguments);
+		return true;
+	}
+
 	// Discover data directory
 	g_gui.discoverDataDirectory("clients.xml");
 
@@ -146,7 +179,8 @@ bool Application::OnInit() {
 	m_file_to_open = wxEmptyString;
 	ParseCommandLineMap(m_file_to_open);
 	
-	if (g_settings.getInteger(Config::ONLY_ONE_INSTANCE) && m_single_instance_checker->IsAnotherRunning()) {
+	// A benchmark run always gets its own instance
+	if (!m_run_live_benchmark && g_settings.getInteger(Config::ONLY_ONE_INSTANCE) && m_single_instance_checker->IsAnotherRunning()) {
 		RMEProcessClient client;
 		wxConnectionBase* connection = client.MakeConnection("localhost", "rme_host", "rme_talk");
 		if (connection) {
@@ -228,7 +262,7 @@ bool Application::OnInit() {
 	}
 
 	// Show welcome dialog with color-shifted bitmap
-	if (g_settings.getInteger(Config::WELCOME_DIALOG) == 1 && m_file_to_open == wxEmptyString) {
+	if (g_settings.getInteger(Config::WELCOME_DIALOG) == 1 && m_file_to_open == wxEmptyString && !m_run_live_benchmark) {
 		g_gui.ShowWelcomeDialog(iconBitmap);
 	} else {
 		g_gui.root->Show();
@@ -280,6 +314,10 @@ void Application::OnEventLoopEnter(wxEventLoopBase* loop) {
 
 	// Don't try to create a map if we didn't load the client map.
 	if (ClientVersion::getLatestVersion() == nullptr) {
+		if (m_run_live_benchmark) {
+			std::cout << "Live benchmark failed: no client version available." << std::endl;
+			loop->Exit(1);
+		}
 		return;
 	}
 
@@ -291,6 +329,21 @@ void Application::OnEventLoopEnter(wxEventLoopBase* loop) {
 		g_gui.GetCurrentEditor()->map.clearChanges();
 	}
 
+	// Host the loaded map to scripted clients and exit when done
+	if (m_run_live_benchmark) {
+		Editor* editor = g_gui.GetCurrentEditor();
+		wxString error = "No map to host.";
+		if (editor) {
+			m_live_benchmark = newd LiveBenchmark(*editor, m_live_benchmark_options);
+			if (m_live_benchmark->start(error)) {
+				return;
+			}
+		}
+		std::cout << "Live benchmark failed: " << error << std::endl;
+		loop->Exit(1);
+		return;
+	}
+
 	// Check when the URLs were last opened
 	time_t currentTime = time(nullptr);
 	time_t lastOpenTime = static_cast<time_t>(g_settings.getInteger(Config::LAST_WEBSITES_OPEN_TIME));
@@ -349,7 +402,16 @@ void Application::Unload() {
 	g_gui.root = nullptr;
 }
 
+int Application::OnRun() {
+	if (m_batch_exit_code != -1) {
+		return m_batch_exit_code;
+	}
+	return wxApp::OnRun();
+}
+
 int Application::OnExit() {
+	wxDELETE(m_live_benchmark);
+	g_live_log.stop();
 #ifdef _USE_PROCESS_COM
 	wxDELETE(m_proc_server);
 	wxDELETE(m_single_instance_checker);
@@ -388,6 +450,12 @@ void Application::OnFatalException() {
 }
 
 bool Application::ParseCommandLineMap(wxString& fileName) {
+	if (ParseCommandLineBenchmark()) {
+		// The benchmark hosts the map given with map=<file>
+		fileName = m_live_benchmark_options.mapFile;
+		return !fileName.empty();
+	}
+
 	if (argc == 2) {
 		// Check if it's a special command to force multiple instances
 		if (wxString(argv[1]) == "-force-multi-instance") {
@@ -407,6 +475,24 @@ bool Application::ParseCommandLineMap(wxString& fileName) {
 	return false;
 }
 
+bool Application::ParseCommandLineBenchmark() {
+	// -live-benchmark [map=file] [clients=N] [seconds=N] [view=N] [rate=N] [port=N] [replay=file] [report=file]
+	// -live-record <file>
+	if (argc >= 2 && wxString(argv[1]) == "-live-benchmark") {
+		m_run_live_benchmark = true;
+		for (int i = 2; i < argc; ++i) {
+			if (!m_live_benchmark_options.parse(wxString(argv[i]))) {
+				std::cout << "Ignoring unknown benchmark option: " << wxString(argv[i]) << std::endl;
+			}
+		}
+		return true;
+	} else if (argc == 3 && wxString(argv[1]) == "-live-record") {
+		LiveChangeRecorder::defaultPath = wxString(argv[2]);
+		return true;
+	}
+	return false;
+}
+
 MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& size) :
 	wxFrame((wxFrame*)nullptr, -1, title, pos, size, wxDEFAULT_FRAME_STYLE) {
 	// Receive idle events
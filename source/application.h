@@ -26,6 +26,8 @@
 #include "process_com.h"
 #include "map_display.h"
 #include "welcome_dialog.h"
+#include "live_benchmark.h"
+#include "map_batch.h"
 
 class Item;
 class Creature;
@@ -39,6 +41,7 @@ class Application : public wxApp {
 public:
 	~Application();
 	virtual bool OnInit();
+	virtual int OnRun();
 	virtual void OnEventLoopEnter(wxEventLoopBase* loop);
 	virtual void MacOpenFiles(const wxArrayString& fileNames);
 	virtual int OnExit();
@@ -50,6 +53,14 @@ private:
 	wxString m_file_to_open;
 	void FixVersionDiscrapencies();
 	bool ParseCommandLineMap(wxString& fileName);
+	bool ParseCommandLineBenchmark();
+
+	bool m_run_live_benchmark;
+	LiveBenchmarkOptions m_live_benchmark_options;
+	LiveBenchmark* m_live_benchmark;
+
+	// Exit code of a -batch run, -1 when running the editor
+	int m_batch_exit_code;
 
 	virtual void OnFatalException();
 
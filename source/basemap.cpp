@@ -20,9 +20,15 @@
 #include "tile.h"
 #include "basemap.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 BaseMap::BaseMap() :
 	allocator(),
 	tilecount(0),
+	revision(0),
+	touched_all(0),
 	root(*this) {
 	////
 }
@@ -42,10 +48,6 @@ void BaseMap::clear(bool del) {
 	}
 }
 
-void BaseMap::clearVisible(uint32_t mask) {
-	root.clearVisible(mask);
-}
-
 Tile* BaseMap::createTile(int x, int y, int z) {
 	ASSERT(z < MAP_LAYERS);
 	QTreeNode* leaf = root.getLeafForce(x, y);
@@ -132,6 +134,110 @@ Tile* BaseMap::swapTile(int x, int y, int z, Tile* newtile) {
 	return leaf->setTile(x, y, z, newtile);
 }
 
+void BaseMap::touchTile(int x, int y, int z) {
+	QTreeNode* leaf = root.getLeaf(x, y);
+	Floor* floor = leaf ? leaf->getFloor(z) : nullptr;
+	if (floor) {
+		floor->revision = ++revision;
+	}
+}
+
+void BaseMap::forEachTileParallel(const std::function<void(Tile*)>& function, const std::function<void(uint64_t)>& progress) {
+	forEachTileByWorker([&function](Tile* tile, size_t) { function(tile); }, [&progress](uint64_t done) {
+		if (progress) {
+			progress(done);
+		}
+		return true;
+	});
+}
+
+size_t BaseMap::getWorkerCount() {
+	return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+bool BaseMap::forEachTileByWorker(const std::function<void(Tile*, size_t)>& function, const std::function<bool(uint64_t)>& progress) {
+	size_t thread_count = getWorkerCount();
+
+	// Split the tree until there are a few subtrees for every thread, maps
+	// tend to sit in one corner so the top levels alone are not enough
+	std::vector<QTreeNode*> subtrees(1, &root);
+	while (subtrees.size() < thread_count * 8) {
+		std::vector<QTreeNode*> children;
+		bool split = false;
+		for (QTreeNode* node : subtrees) {
+			if (node->isLeaf) {
+				children.push_back(node);
+				continue;
+			}
+			split = true;
+			for (QTreeNode* child : node->child) {
+				if (child) {
+					children.push_back(child);
+				}
+			}
+		}
+		subtrees.swap(children);
+		if (!split) {
+			break;
+		}
+	}
+
+	std::atomic<size_t> next(0);
+	std::atomic<size_t> finished(0);
+	std::atomic<uint64_t> done(0);
+	std::atomic<bool> stopped(false);
+
+	thread_count = std::min(thread_count, subtrees.size());
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < thread_count; ++i) {
+		threads.emplace_back([&, i]() {
+			const std::function<void(Tile*)> worker = [&function, i](Tile* tile) { function(tile, i); };
+			size_t index;
+			while (!stopped && (index = next++) < subtrees.size()) {
+				done += forEachTile(subtrees[index], worker);
+			}
+			++finished;
+		});
+	}
+
+	while (finished < thread_count) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		if (progress && !progress(done)) {
+			stopped = true;
+		}
+	}
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	return !stopped;
+}
+
+uint64_t BaseMap::forEachTile(QTreeNode* node, const std::function<void(Tile*)>& function) {
+	uint64_t count = 0;
+	if (node->isLeaf) {
+		for (Floor* floor : node->array) {
+			if (!floor) {
+				continue;
+			}
+			for (TileLocation& location : floor->locs) {
+				if (Tile* tile = location.get()) {
+					function(tile);
+					++count;
+				}
+			}
+		}
+		return count;
+	}
+
+	for (QTreeNode* child : node->child) {
+		if (child) {
+			count += forEachTile(child, function);
+		}
+	}
+	return count;
+}
+
 // Iterators
 
 MapIterator::MapIterator(BaseMap* _map) :
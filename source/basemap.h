@@ -24,6 +24,8 @@
 #include "map_allocator.h"
 #include "tile.h"
 
+#include <functional>
+
 // Class declarations
 class QTreeNode;
 class BaseMap;
@@ -96,6 +98,17 @@ public:
 		return tilecount;
 	}
 
+	// Number of spawns whose radius covers the position, only maps that keep
+	// a spawn index know about them
+	virtual size_t getSpawnCount(const Position& position) const {
+		return 0;
+	}
+	// A tile with zones was placed or removed, only maps that label their
+	// zones care
+	virtual void zonesChanged(int x, int y, int z) {
+		////
+	}
+
 	// these functions take a position and returns a tile on the map
 	Tile* createTile(int x, int y, int z);
 	Tile* getTile(int x, int y, int z);
@@ -126,28 +139,62 @@ public:
 	void setTile(Tile* newtile, bool remove = false) {
 		setTile(newtile->getX(), newtile->getY(), newtile->getZ(), newtile, remove);
 	}
+	// Calls the function for every tile from several threads, each thread owns
+	// whole subtrees so a tile is only ever touched by one of them. Progress is
+	// called on the calling thread with the number of tiles done.
+	void forEachTileParallel(const std::function<void(Tile*)>& function, const std::function<void(uint64_t)>& progress = nullptr);
+	// Same, the function also gets the index of the calling worker, below
+	// getWorkerCount(), so it can fill per worker results without locking.
+	// Returning false from progress stops the workers after their current
+	// subtree, the call then returns false.
+	bool forEachTileByWorker(const std::function<void(Tile*, size_t)>& function, const std::function<bool(uint64_t)>& progress = nullptr);
+	static size_t getWorkerCount();
+
 	// Replaces a tile and returns the old one
 	Tile* swapTile(int _x, int _y, int _z, Tile* newtile);
 	Tile* swapTile(const Position& pos, Tile* newtile) {
 		return swapTile(pos.x, pos.y, pos.z, newtile);
 	}
 
-	// Clears the visiblity according to the mask passed
-	void clearVisible(uint32_t mask);
+	// Bumps the revision of a tile that was changed in place, for caches
+	// that would otherwise only notice a replaced tile
+	void touchTile(int x, int y, int z);
+	void touchTile(const Position& pos) {
+		touchTile(pos.x, pos.y, pos.z);
+	}
+
+	// Marks every tile as changed, for operations editing tiles all over the
+	// map in place
+	void touchAllTiles() {
+		touched_all = ++revision;
+	}
+	// Map revision of the last touchAllTiles
+	uint64_t getTouchAllRevision() const {
+		return touched_all;
+	}
 
 	uint64_t getTileCount() const {
 		return tilecount;
 	}
+	// Increases with every tile placed or removed
+	uint64_t getRevision() const {
+		return revision;
+	}
 
 public:
 	MapAllocator allocator;
 
 protected:
+	static uint64_t forEachTile(QTreeNode* node, const std::function<void(Tile*)>& function);
+
 	uint64_t tilecount;
+	uint64_t revision;
+	uint64_t touched_all;
 
 	QTreeNode root; // The Quad Tree root
 
 	friend class QTreeNode;
+	friend class MinimapExporter;
 };
 
 inline Tile* BaseMap::getTile(int x, int y, int z) {
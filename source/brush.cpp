@@ -53,6 +53,9 @@ Brushes::~Brushes() {
 }
 
 void Brushes::clear() {
+	GroundBrush::clearBorderTable();
+	border_items.clear();
+
 	for (auto brushEntry : brushes) {
 		delete brushEntry.second;
 	}
@@ -90,6 +93,32 @@ void Brushes::init() {
 	WallBrush::init();
 	TableBrush::init();
 	CarpetBrush::init();
+
+	// Materials are loaded by now, index them for the border solver
+	indexBorderItems();
+	GroundBrush::buildBorderTable();
+}
+
+void Brushes::indexBorderItems() {
+	border_items.clear();
+	for (const auto& borderEntry : borders) {
+		AutoBorder* border = borderEntry.second;
+		if (!border) {
+			continue;
+		}
+
+		for (uint32_t itemId : border->tiles) {
+			if (itemId == 0 || itemId > 0xFFFF) {
+				continue;
+			}
+			if (itemId >= border_items.size()) {
+				border_items.resize(itemId + 1, nullptr);
+			}
+			if (!border_items[itemId]) {
+				border_items[itemId] = border;
+			}
+		}
+	}
 }
 
 bool Brushes::unserializeBrush(pugi::xml_node node, wxArrayString& warnings) {
@@ -77,10 +77,18 @@ public:
 		return brushes;
 	}
 
+	// First border (by id) using the item, nullptr for items in no border
+	AutoBorder* getBorderByItem(uint16_t id) const {
+		return id < border_items.size() ? border_items[id] : nullptr;
+	}
+
 protected:
+	void indexBorderItems();
+
 	typedef std::map<uint32_t, AutoBorder*> BorderMap;
 	BrushMap brushes;
 	BorderMap borders;
+	std::vector<AutoBorder*> border_items;
 
 	friend class AutoBorder;
 	friend class GroundBrush;
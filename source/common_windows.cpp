@@ -533,6 +533,17 @@ ExportMiniMapWindow::ExportMiniMapWindow(wxWindow* parent, Editor& editor) :
 	tmpsizer->Add(floor_number, 0, wxALL, 5);
 	sizer->Add(tmpsizer, 0, wxLEFT | wxRIGHT | wxBOTTOM | wxEXPAND, 5);
 
+	// Image format, the selected area is always exported as PNG
+	wxArrayString formats;
+	formats.Add("BMP");
+	formats.Add("PNG");
+
+	tmpsizer = newd wxStaticBoxSizer(wxHORIZONTAL, this, "Format");
+	format_options = newd wxChoice(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, formats);
+	format_options->SetSelection(g_settings.getString(Config::MINIMAP_EXPORT_FORMAT) == "png" ? 1 : 0);
+	tmpsizer->Add(format_options, 1, wxALL, 5);
+	sizer->Add(tmpsizer, 0, wxLEFT | wxRIGHT | wxBOTTOM | wxEXPAND, 5);
+
 	// OK/Cancel buttons
 	tmpsizer = newd wxBoxSizer(wxHORIZONTAL);
 	tmpsizer->Add(ok_button = newd wxButton(this, wxID_OK, "OK"), wxSizerFlags(1).Center());
@@ -548,7 +559,9 @@ ExportMiniMapWindow::ExportMiniMapWindow(wxWindow* parent, Editor& editor) :
 ExportMiniMapWindow::~ExportMiniMapWindow() = default;
 
 void ExportMiniMapWindow::OnExportTypeChange(wxCommandEvent& event) {
-	floor_number->Enable(event.GetSelection() == 2);
+	if (event.GetEventObject() == floor_options) {
+		floor_number->Enable(event.GetSelection() == 2);
+	}
 }
 
 void ExportMiniMapWindow::OnClickBrowse(wxCommandEvent& WXUNUSED(event)) {
@@ -577,11 +590,15 @@ void ExportMiniMapWindow::OnClickOK(wxCommandEvent& WXUNUSED(event)) {
 		FileName directory(directory_text_field->GetValue());
 		g_settings.setString(Config::MINIMAP_EXPORT_DIR, directory_text_field->GetValue().ToStdString());
 
+		const std::string format = format_options->GetSelection() == 1 ? "png" : "bmp";
+		g_settings.setString(Config::MINIMAP_EXPORT_FORMAT, format);
+		const wxString extension = "." + wxString(format);
+
 		switch (floor_options->GetSelection()) {
 			case 0: { // All floors
 				for (int floor = 0; floor < MAP_LAYERS; ++floor) {
 					g_gui.SetLoadScale(int(floor * (100.f / 16.f)), int((floor + 1) * (100.f / 16.f)));
-					FileName file(file_name_text_field->GetValue() + "_" + i2ws(floor) + ".bmp");
+					FileName file(file_name_text_field->GetValue() + "_" + i2ws(floor) + extension);
 					file.Normalize(wxPATH_NORM_ALL, directory.GetFullPath());
 					editor.exportMiniMap(file, floor, true);
 				}
@@ -589,7 +606,7 @@ void ExportMiniMapWindow::OnClickOK(wxCommandEvent& WXUNUSED(event)) {
 			}
 
 			case 1: { // Ground floor
-				FileName file(file_name_text_field->GetValue() + "_" + i2ws(GROUND_LAYER) + ".bmp");
+				FileName file(file_name_text_field->GetValue() + "_" + i2ws(GROUND_LAYER) + extension);
 				file.Normalize(wxPATH_NORM_ALL, directory.GetFullPath());
 				editor.exportMiniMap(file, GROUND_LAYER, true);
 				break;
@@ -597,7 +614,7 @@ void ExportMiniMapWindow::OnClickOK(wxCommandEvent& WXUNUSED(event)) {
 
 			case 2: { // Specific floors
 				int floor = floor_number->GetValue();
-				FileName file(file_name_text_field->GetValue() + "_" + i2ws(floor) + ".bmp");
+				FileName file(file_name_text_field->GetValue() + "_" + i2ws(floor) + extension);
 				file.Normalize(wxPATH_NORM_ALL, directory.GetFullPath());
 				editor.exportMiniMap(file, floor, true);
 				break;
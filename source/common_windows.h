@@ -128,6 +128,7 @@ protected:
 	wxTextCtrl* file_name_text_field;
 	wxChoice* floor_options;
 	wxSpinCtrl* floor_number;
+	wxChoice* format_options;
 	wxButton* ok_button;
 
 	DECLARE_EVENT_TABLE();
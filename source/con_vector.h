@@ -41,7 +41,7 @@ public:
 		memset(start + old_size, 0, sizeof(T) * (new_size - old_size));
 		sz = new_size;
 	}
-	size_t size() {
+	size_t size() const {
 		return sz;
 	}
 
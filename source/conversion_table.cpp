@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "conversion_table.h"
+
+ConversionTable::ConversionTable(const ConversionMap& map) :
+	longestKey(0) {
+	for (const auto& entry : map.stm) {
+		if (entry.first >= single.size()) {
+			single.resize(entry.first + 1, nullptr);
+		}
+		single[entry.first] = &entry.second;
+	}
+
+	for (const MultiEntry& entry : map.mtm) {
+		const std::vector<uint16_t>& key = entry.first;
+		if (key.empty()) {
+			continue;
+		}
+
+		uint64_t hash = HASH_SEED;
+		for (uint16_t id : key) {
+			hash = hashStep(hash, id);
+			if (id >= keyIds.size()) {
+				keyIds.resize(id + 1, false);
+			}
+			keyIds[id] = true;
+		}
+		multi.emplace(hash, &entry);
+		longestKey = std::max(longestKey, key.size());
+	}
+}
+
+const ConversionTable::MultiEntry* ConversionTable::match(const std::vector<uint16_t>& ids) const {
+	size_t length = std::min(ids.size(), longestKey);
+	for (size_t i = 0; i < length; ++i) {
+		if (ids[i] >= keyIds.size() || !keyIds[ids[i]]) {
+			length = i;
+			break;
+		}
+	}
+	if (length == 0) {
+		return nullptr;
+	}
+
+	uint64_t hashes[16];
+	std::vector<uint64_t> longHashes;
+	uint64_t* prefixHashes = hashes;
+	if (length > 16) {
+		longHashes.resize(length);
+		prefixHashes = longHashes.data();
+	}
+
+	uint64_t hash = HASH_SEED;
+	for (size_t i = 0; i < length; ++i) {
+		hash = hashStep(hash, ids[i]);
+		prefixHashes[i] = hash;
+	}
+
+	for (size_t count = length; count > 0; --count) {
+		auto range = multi.equal_range(prefixHashes[count - 1]);
+		for (auto it = range.first; it != range.second; ++it) {
+			const std::vector<uint16_t>& key = it->second->first;
+			if (key.size() == count && std::equal(key.begin(), key.end(), ids.begin())) {
+				return it->second;
+			}
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_CONVERSION_TABLE_H_
+#define RME_CONVERSION_TABLE_H_
+
+#include "templates.h"
+
+#include <unordered_map>
+
+// A ConversionMap compiled for lookups from several threads. Single item
+// replacements are a flat table indexed by item id, and multi item keys are
+// hashed by their contents. The ConversionMap must outlive the table.
+class ConversionTable {
+public:
+	typedef ConversionMap::MTM::value_type MultiEntry;
+
+	explicit ConversionTable(const ConversionMap& map);
+
+	// Items replacing a single item, nullptr when the item is kept
+	const std::vector<uint16_t>* getReplacement(uint16_t id) const {
+		return id < single.size() ? single[id] : nullptr;
+	}
+
+	// Longest key that equals a prefix of the sorted ids, the same entry
+	// ConversionMap::mtm finds when popping ids from the back until it matches
+	const MultiEntry* match(const std::vector<uint16_t>& ids) const;
+
+private:
+	static uint64_t hashStep(uint64_t hash, uint16_t id) {
+		// FNV-1a over whole ids
+		return (hash ^ id) * 0x100000001B3ULL;
+	}
+	static const uint64_t HASH_SEED = 0xCBF29CE484222325ULL;
+
+	std::vector<const std::vector<uint16_t>*> single;
+	// Ids found in any multi item key, a prefix can not reach past one that is not
+	std::vector<bool> keyIds;
+	std::unordered_multimap<uint64_t, const MultiEntry*> multi;
+	size_t longestKey;
+};
+
+#endif
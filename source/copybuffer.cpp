@@ -23,13 +23,37 @@
 #include "creature.h"
 #include "minimap_window.h"
 
+#include <bitset>
+
+// How often a held back copy checks for another instance to publish to
+static const int PUBLISH_POLL_INTERVAL = 500;
+
+namespace {
+	class PublishTimer : public wxTimer {
+	public:
+		PublishTimer(CopyBuffer& buffer) :
+			buffer(buffer) { }
+
+		void Notify() override {
+			buffer.publishPending();
+		}
+
+	private:
+		CopyBuffer& buffer;
+	};
+}
+
 CopyBuffer::CopyBuffer() :
-	tiles(newd BaseMap()) {
+	tiles(newd BaseMap()),
+	sharedTiles(0),
+	unpublished(false),
+	pendingGeneration(0),
+	publishTimer(newd PublishTimer(*this)) {
 	;
 }
 
 size_t CopyBuffer::GetTileCount() {
-	return tiles ? (size_t)tiles->size() : 0;
+	return (tiles ? (size_t)tiles->size() : 0) + sharedTiles;
 }
 
 BaseMap& CopyBuffer::getBufferMap() {
@@ -38,6 +62,7 @@ BaseMap& CopyBuffer::getBufferMap() {
 }
 
 CopyBuffer::~CopyBuffer() {
+	publishTimer->Stop();
 	clear();
 }
 
@@ -49,6 +74,100 @@ Position CopyBuffer::getPosition() const {
 void CopyBuffer::clear() {
 	delete tiles;
 	tiles = nullptr;
+	sharedSectors.clear();
+	sharedTiles = 0;
+	unpublished = false;
+	shared.releaseSnapshot();
+}
+
+void CopyBuffer::setTiles(BaseMap* map, const Position& position) {
+	clear();
+	tiles = map;
+	copyPos = position;
+}
+
+void CopyBuffer::update(Editor& editor) {
+	if (!shared.hasNewer()) {
+		return;
+	}
+
+	// Only the serialized copy is taken over, its sectors are parsed when
+	// the paste preview draws them or on paste
+	Position position;
+	wxString error;
+	if (shared.fetch(editor.map.getVersion(), position, error)) {
+		delete tiles;
+		tiles = newd BaseMap();
+		copyPos = position;
+		sharedSectors.assign(shared.getSectorCount(), 1);
+		sharedTiles = shared.getTileCount();
+		unpublished = false;
+		publishTimer->Stop();
+	} else if (!error.empty()) {
+		g_gui.SetStatusText(error);
+	}
+}
+
+void CopyBuffer::publish(const MapVersion& version) {
+	// Serializing a large copy is wasted work while nobody could paste it
+	if (!shared.hasOtherInstances()) {
+		unpublished = true;
+		pendingVersion = version;
+		pendingGeneration = shared.getGeneration();
+		publishTimer->Start(PUBLISH_POLL_INTERVAL);
+		return;
+	}
+	unpublished = false;
+	publishTimer->Stop();
+	shared.publish(*tiles, copyPos, version);
+}
+
+void CopyBuffer::publishPending() {
+	if (!unpublished || !tiles) {
+		publishTimer->Stop();
+		return;
+	}
+	// Another instance copied something after us, that copy stays current
+	if (shared.getGeneration() != pendingGeneration) {
+		unpublished = false;
+		publishTimer->Stop();
+		return;
+	}
+	if (shared.hasOtherInstances()) {
+		publish(pendingVersion);
+	}
+}
+
+void CopyBuffer::prepare(int start_x, int start_y, int end_x, int end_y, int z) {
+	for (size_t index = 0; index < sharedSectors.size(); ++index) {
+		if (!sharedSectors[index]) {
+			continue;
+		}
+
+		Position corner;
+		uint32_t count;
+		shared.getSector(index, corner, count);
+		if (corner.z != z || corner.x > end_x || corner.y > end_y || corner.x + SharedClipboard::SECTOR_SIZE <= start_x || corner.y + SharedClipboard::SECTOR_SIZE <= start_y) {
+			continue;
+		}
+		shared.readSector(index, *tiles);
+		sharedSectors[index] = 0;
+	}
+}
+
+void CopyBuffer::prepareAll() {
+	for (size_t index = 0; index < sharedSectors.size(); ++index) {
+		if (sharedSectors[index]) {
+			shared.readSector(index, *tiles);
+			sharedSectors[index] = 0;
+		}
+	}
+}
+
+void CopyBuffer::resetShared() {
+	// The map itself stays, the paste preview holds on to it
+	tiles->clear();
+	std::fill(sharedSectors.begin(), sharedSectors.end(), 1);
 }
 
 void CopyBuffer::copy(Editor& editor, int floor) {
@@ -105,6 +224,8 @@ void CopyBuffer::copy(Editor& editor, int floor) {
 	std::ostringstream ss;
 	ss << "Copied " << tile_count << " tile" << (tile_count > 1 ? "s" : "") << " (" << item_count << " item" << (item_count > 1 ? "s" : "") << ")";
 	g_gui.SetStatusText(wxstr(ss.str()));
+
+	publish(editor.map.getVersion());
 }
 
 void CopyBuffer::cut(Editor& editor, int floor) {
@@ -211,6 +332,34 @@ void CopyBuffer::cut(Editor& editor, int floor) {
 	std::stringstream ss;
 	ss << "Cut out " << tile_count << " tile" << (tile_count > 1 ? "s" : "") << " (" << item_count << " item" << (item_count > 1 ? "s" : "") << ")";
 	g_gui.SetStatusText(wxstr(ss.str()));
+
+	publish(editor.map.getVersion());
+}
+
+// Pastes are copied one 64x64 sector at a time, the tiles that need new
+// borders are tracked as a bitmap per sector instead of a position list.
+static const int PASTE_SECTOR_BITS = 6;
+static const int PASTE_SECTOR_SIZE = 1 << PASTE_SECTOR_BITS;
+// Buffers smaller than this are pasted without a progress bar
+static const size_t PASTE_PROGRESS_TILES = 20000;
+
+static uint64_t getPasteSectorKey(int x, int y, int z) {
+	return (uint64_t(z) << 40) | (uint64_t(y >> PASTE_SECTOR_BITS) << 20) | uint64_t(x >> PASTE_SECTOR_BITS);
+}
+
+typedef std::bitset<PASTE_SECTOR_SIZE * PASTE_SECTOR_SIZE> PasteSectorMask;
+
+static void markPasteFringe(std::map<uint64_t, PasteSectorMask>& dirty, const Position& pos) {
+	for (int dy = -1; dy <= 1; ++dy) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			const int x = pos.x + dx;
+			const int y = pos.y + dy;
+			if (x < 0 || y < 0 || x > MAP_MAX_WIDTH || y > MAP_MAX_HEIGHT) {
+				continue;
+			}
+			dirty[getPasteSectorKey(x, y, pos.z)].set(((y & (PASTE_SECTOR_SIZE - 1)) << PASTE_SECTOR_BITS) | (x & (PASTE_SECTOR_SIZE - 1)));
+		}
+	}
 }
 
 void CopyBuffer::paste(Editor& editor, const Position& toPosition) {
@@ -218,87 +367,126 @@ void CopyBuffer::paste(Editor& editor, const Position& toPosition) {
 		return;
 	}
 
-	BatchAction* batchAction = editor.actionQueue->createBatch(ACTION_PASTE_TILES);
-	Action* action = editor.actionQueue->createAction(batchAction);
-	
-	// Track modified positions for minimap update
-	PositionVector modifiedPositions;
-	
-	// Original paste logic
+	// A shared copy is parsed in full once per paste and its tiles are
+	// moved into the map rather than copied
+	const bool fromShared = !sharedSectors.empty();
+	if (fromShared) {
+		prepareAll();
+	}
+
+	// Group the buffer by destination sector so each chunk is spatially close
+	std::map<uint64_t, std::vector<Tile*>> sectors;
+	size_t total = 0;
 	for (MapIterator it = tiles->begin(); it != tiles->end(); ++it) {
 		Tile* buffer_tile = (*it)->get();
 		Position pos = buffer_tile->getPosition() - copyPos + toPosition;
-		
 		if (!pos.isValid()) {
 			continue;
 		}
-		
-		// Add position for minimap update
-		modifiedPositions.push_back(pos);
-		
-		// Add surrounding positions for border updates
-		for(int dx = -1; dx <= 1; dx++) {
-			for(int dy = -1; dy <= 1; dy++) {
-				Position borderPos(pos.x + dx, pos.y + dy, pos.z);
-				if(borderPos.isValid()) {
-					modifiedPositions.push_back(borderPos);
-				}
-			}
-		}
+		sectors[getPasteSectorKey(pos.x, pos.y, pos.z)].push_back(buffer_tile);
+		++total;
+	}
+
+	const bool show_progress = total >= PASTE_PROGRESS_TILES;
+	if (show_progress) {
+		g_gui.CreateLoadBar("Pasting tiles...", true);
+	}
+
+	BatchAction* batchAction = editor.actionQueue->createBatch(ACTION_PASTE_TILES);
+	Action* action = editor.actionQueue->createAction(batchAction);
+
+	const bool merge = g_settings.getInteger(Config::MERGE_PASTE);
+	std::map<uint64_t, PasteSectorMask> dirty;
+	size_t done = 0;
+
+	for (const auto& sector : sectors) {
+		for (Tile* buffer_tile : sector.second) {
+			Position pos = buffer_tile->getPosition() - copyPos + toPosition;
+			markPasteFringe(dirty, pos);
 
-		TileLocation* location = editor.map.createTileL(pos);
-		Tile* copy_tile = buffer_tile->deepCopy(editor.map);
-		Tile* old_dest_tile = location->get();
-		Tile* new_dest_tile = nullptr;
-		copy_tile->setLocation(location);
+			TileLocation* location = editor.map.createTileL(pos);
+			Tile* copy_tile = fromShared ? tiles->swapTile(buffer_tile->getPosition(), nullptr) : buffer_tile->deepCopy(editor.map);
+			Tile* old_dest_tile = location->get();
+			Tile* new_dest_tile = nullptr;
+			copy_tile->setLocation(location);
 
-		if (g_settings.getInteger(Config::MERGE_PASTE) || !copy_tile->ground) {
-			if (old_dest_tile) {
-				new_dest_tile = old_dest_tile->deepCopy(editor.map);
+			if (merge || !copy_tile->ground) {
+				if (old_dest_tile) {
+					new_dest_tile = old_dest_tile->deepCopy(editor.map);
+				} else {
+					new_dest_tile = editor.map.allocator(location);
+				}
+				new_dest_tile->merge(copy_tile);
+				delete copy_tile;
 			} else {
-				new_dest_tile = editor.map.allocator(location);
+				new_dest_tile = copy_tile;
 			}
-			new_dest_tile->merge(copy_tile);
-			delete copy_tile;
-		} else {
-			new_dest_tile = copy_tile;
+
+			action->addChange(newd Change(new_dest_tile));
 		}
 
-		action->addChange(newd Change(new_dest_tile));
+		done += sector.second.size();
+		if (show_progress) {
+			g_gui.SetLoadDone(static_cast<int32_t>(done * 100 / total));
+			if (g_gui.IsLoadCancelled()) {
+				// Nothing has touched the map yet
+				delete action;
+				delete batchAction;
+				g_gui.DestroyLoadBar();
+				g_gui.SetStatusText("Paste cancelled.");
+				if (fromShared) {
+					resetShared();
+				}
+				return;
+			}
+		}
 	}
-	
-	batchAction->addAndCommitAction(action);
 
-	if (g_settings.getInteger(Config::USE_AUTOMAGIC) && g_settings.getInteger(Config::BORDERIZE_PASTE)) {
-		action = editor.actionQueue->createAction(batchAction);
-		TileList borderize_tiles;
-		Map& map = editor.map;
+	batchAction->addAndCommitAction(action);
+	if (fromShared) {
+		resetShared();
+	}
 
-		for (const Position& pos : modifiedPositions) {
-			Tile* tile = map.getTile(pos);
-			if (tile) {
-				borderize_tiles.push_back(tile);
+	// Every pasted position and its neighbours, in sector order
+	PositionVector modifiedPositions;
+	for (const auto& sector : dirty) {
+		const int z = static_cast<int>(sector.first >> 40);
+		const int base_y = static_cast<int>((sector.first >> 20) & 0xFFFFF) << PASTE_SECTOR_BITS;
+		const int base_x = static_cast<int>(sector.first & 0xFFFFF) << PASTE_SECTOR_BITS;
+		const PasteSectorMask& mask = sector.second;
+		for (size_t bit = 0; bit < mask.size(); ++bit) {
+			if (mask.test(bit)) {
+				modifiedPositions.emplace_back(base_x + static_cast<int>(bit & (PASTE_SECTOR_SIZE - 1)), base_y + static_cast<int>(bit >> PASTE_SECTOR_BITS), z);
 			}
 		}
+	}
+	dirty.clear();
 
-		// Remove duplicates
-		borderize_tiles.sort();
-		borderize_tiles.unique();
-
-		for (Tile* tile : borderize_tiles) {
-			if (tile) {
-				Tile* newTile = tile->deepCopy(editor.map);
-				newTile->borderize(&map);
-				newTile->wallize(&map);
-				action->addChange(newd Change(newTile));
-			}
+	if (g_settings.getInteger(Config::USE_AUTOMAGIC) && g_settings.getInteger(Config::BORDERIZE_PASTE)) {
+		if (show_progress) {
+			g_gui.SetLoadDone(99, "Borderizing pasted tiles...");
 		}
 
+		action = editor.actionQueue->createAction(batchAction);
+		Map& map = editor.map;
+		editor.reborderPositions(action, modifiedPositions, false, [&map](Tile* tile, TileLocation*) -> Tile* {
+			if (!tile) {
+				return nullptr;
+			}
+			Tile* newTile = tile->deepCopy(map);
+			newTile->borderize(&map);
+			newTile->wallize(&map);
+			return newTile;
+		});
 		batchAction->addAndCommitAction(action);
 	}
 
 	editor.addBatch(batchAction);
 
+	if (show_progress) {
+		g_gui.DestroyLoadBar();
+	}
+
 	// Update minimap with modified positions
 	if (g_gui.minimap) {
 		g_gui.minimap->UpdateDrawnTiles(modifiedPositions);
@@ -306,5 +494,5 @@ void CopyBuffer::paste(Editor& editor, const Position& toPosition) {
 }
 
 bool CopyBuffer::canPaste() const {
-	return tiles && tiles->size() != 0;
+	return (tiles && tiles->size() != 0) || sharedTiles != 0 || shared.hasNewer();
 }
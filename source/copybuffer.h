@@ -22,8 +22,12 @@
 
 #include "position.h"
 #include "basemap.h"
+#include "shared_clipboard.h"
+
+#include <memory>
 
 class Editor;
+class wxTimer;
 
 class CopyBuffer {
 public:
@@ -40,6 +44,15 @@ public:
 
 	// Clears the copybuffer (eg. resets it)
 	void clear();
+	// Replaces the contents with tiles built elsewhere, takes ownership of map
+	void setTiles(BaseMap* map, const Position& position);
+	// Takes over what another editor instance copied, if it is newer
+	void update(Editor& editor);
+	// Publishes a copy held back while no other instance was running
+	void publishPending();
+	// Parses the sectors of a shared copy that overlap the area, so the paste
+	// preview only materializes what it draws
+	void prepare(int start_x, int start_y, int end_x, int end_y, int z);
 
 	size_t GetTileCount();
 
@@ -47,8 +60,22 @@ public:
 
 private:
 	void collectModifiedPositions(const Position& toPosition, PositionVector& positions);
+	void publish(const MapVersion& version);
+	void prepareAll();
+	// Puts a shared copy back into its unparsed state
+	void resetShared();
+
 	Position copyPos;
 	BaseMap* tiles;
+	SharedClipboard shared;
+	// Sectors of a fetched shared copy, 1 while not parsed into tiles
+	std::vector<uint8_t> sharedSectors;
+	size_t sharedTiles;
+	// Our copy is only published once another instance can paste it
+	bool unpublished;
+	MapVersion pendingVersion;
+	uint64_t pendingGeneration;
+	std::unique_ptr<wxTimer> publishTimer;
 };
 
 #endif
@@ -53,7 +53,7 @@ std::string CreatureBrush::getName() const {
 bool CreatureBrush::canDraw(BaseMap* map, const Position& position) const {
 	Tile* tile = map->getTile(position);
 	if (creature_type && tile && !tile->isBlocking()) {
-		if (tile->getLocation()->getSpawnCount() != 0 || g_settings.getInteger(Config::AUTO_CREATE_SPAWN)) {
+		if (map->getSpawnCount(position) != 0 || g_settings.getInteger(Config::AUTO_CREATE_SPAWN)) {
 			if (tile->isPZ()) {
 				if (creature_type->isNpc) {
 					return true;
@@ -81,7 +81,7 @@ void CreatureBrush::draw_creature(BaseMap* map, Tile* tile) {
 	if (canDraw(map, tile->getPosition())) {
 		undraw(map, tile);
 		if (creature_type) {
-			if (tile->spawn == nullptr && tile->getLocation()->getSpawnCount() == 0) {
+			if (tile->spawn == nullptr && map->getSpawnCount(tile->getPosition()) == 0) {
 				// manually place spawn on location
 				tile->spawn = newd Spawn(1);
 			}
@@ -0,0 +1,624 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "data_cache.h"
+#include "items.h"
+#include "gui.h"
+
+#include <wx/dir.h>
+
+#include <type_traits>
+
+namespace {
+	const char CACHE_MAGIC[4] = { 'R', 'M', 'E', 'C' };
+	const uint64_t MISSING_SIZE = ~uint64_t(0);
+
+	uint64_t hashBytes(uint64_t hash, const char* bytes, size_t size) {
+		// FNV-1a
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ uint8_t(bytes[i])) * 0x100000001B3ULL;
+		}
+		return hash;
+	}
+	const uint64_t HASH_SEED = 0xCBF29CE484222325ULL;
+
+	class CacheWriter {
+	public:
+		template <typename T>
+		void put(T value) {
+			data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		}
+		void putString(const std::string& value) {
+			put<uint32_t>(value.size());
+			data.append(value);
+		}
+
+		std::string data;
+	};
+
+	class CacheReader {
+	public:
+		CacheReader(const std::string& data) :
+			data(data), offset(0), ok(true) { }
+
+		template <typename T>
+		T get() {
+			T value = T();
+			if (!ok || offset + sizeof(value) > data.size()) {
+				ok = false;
+				return value;
+			}
+			memcpy(&value, data.data() + offset, sizeof(value));
+			offset += sizeof(value);
+			return value;
+		}
+		std::string getString() {
+			const uint32_t size = get<uint32_t>();
+			if (!ok || offset + size > data.size()) {
+				ok = false;
+				return std::string();
+			}
+			std::string value = data.substr(offset, size);
+			offset += size;
+			return value;
+		}
+
+		const std::string& data;
+		size_t offset;
+		bool ok;
+	};
+
+	// Every field items.otb and items.xml fill in. Brush pointers and the
+	// tileset flags are set by the materials, which are loaded after this.
+	template <typename Function>
+	void forEachField(ItemType& type, Function&& field) {
+		field("id", type.id);
+		field("clientID", type.clientID);
+		field("is_metaitem", type.is_metaitem);
+		field("group", type.group);
+		field("type", type.type);
+		field("volume", type.volume);
+		field("maxTextLen", type.maxTextLen);
+		field("slot_position", type.slot_position);
+		field("weapon_type", type.weapon_type);
+		field("classification", type.classification);
+		field("ground_equivalent", type.ground_equivalent);
+		field("border_group", type.border_group);
+		field("has_equivalent", type.has_equivalent);
+		field("wall_hate_me", type.wall_hate_me);
+		field("name", type.name);
+		field("editorsuffix", type.editorsuffix);
+		field("description", type.description);
+		field("weight", type.weight);
+		field("attack", type.attack);
+		field("defense", type.defense);
+		field("armor", type.armor);
+		field("charges", type.charges);
+		field("client_chargeable", type.client_chargeable);
+		field("extra_chargeable", type.extra_chargeable);
+		field("ignoreLook", type.ignoreLook);
+		field("isHangable", type.isHangable);
+		field("hookEast", type.hookEast);
+		field("hookSouth", type.hookSouth);
+		field("canReadText", type.canReadText);
+		field("canWriteText", type.canWriteText);
+		field("allowDistRead", type.allowDistRead);
+		field("replaceable", type.replaceable);
+		field("decays", type.decays);
+		field("stackable", type.stackable);
+		field("moveable", type.moveable);
+		field("alwaysOnBottom", type.alwaysOnBottom);
+		field("pickupable", type.pickupable);
+		field("rotable", type.rotable);
+		field("isBorder", type.isBorder);
+		field("isOptionalBorder", type.isOptionalBorder);
+		field("isWall", type.isWall);
+		field("isBrushDoor", type.isBrushDoor);
+		field("isOpen", type.isOpen);
+		field("isLocked", type.isLocked);
+		field("isTable", type.isTable);
+		field("isCarpet", type.isCarpet);
+		field("floorChangeDown", type.floorChangeDown);
+		field("floorChangeNorth", type.floorChangeNorth);
+		field("floorChangeSouth", type.floorChangeSouth);
+		field("floorChangeEast", type.floorChangeEast);
+		field("floorChangeWest", type.floorChangeWest);
+		field("floorChange", type.floorChange);
+		field("unpassable", type.unpassable);
+		field("blockPickupable", type.blockPickupable);
+		field("blockMissiles", type.blockMissiles);
+		field("blockPathfinder", type.blockPathfinder);
+		field("hasElevation", type.hasElevation);
+		field("alwaysOnTopOrder", type.alwaysOnTopOrder);
+		field("rotateTo", type.rotateTo);
+		field("border_alignment", type.border_alignment);
+		field("hasLight", type.hasLight);
+	}
+
+	template <typename T>
+	void writeField(CacheWriter& writer, const T& value) {
+		if constexpr (std::is_enum<T>::value) {
+			writer.put<int32_t>(static_cast<int32_t>(value));
+		} else {
+			writer.put<T>(value);
+		}
+	}
+	void writeField(CacheWriter& writer, const std::string& value) {
+		writer.putString(value);
+	}
+
+	template <typename T>
+	void readField(CacheReader& reader, T& value) {
+		if constexpr (std::is_enum<T>::value) {
+			value = static_cast<T>(reader.get<int32_t>());
+		} else {
+			value = reader.get<T>();
+		}
+	}
+	void readField(CacheReader& reader, std::string& value) {
+		value = reader.getString();
+	}
+
+	template <typename T>
+	std::string fieldText(const T& value) {
+		std::ostringstream text;
+		if constexpr (std::is_enum<T>::value || std::is_same<T, uint8_t>::value) {
+			text << static_cast<int32_t>(value);
+		} else {
+			text << std::setprecision(9) << value;
+		}
+		return text.str();
+	}
+	std::string fieldText(const std::string& value) {
+		return "\"" + value + "\"";
+	}
+
+	void writeItems(CacheWriter& writer, const ItemDatabase& database) {
+		writer.put<uint32_t>(database.MajorVersion);
+		writer.put<uint32_t>(database.MinorVersion);
+		writer.put<uint32_t>(database.BuildNumber);
+
+		uint32_t count = 0;
+		for (uint32_t id = 0; id < database.items.size(); ++id) {
+			if (database.items[id]) {
+				++count;
+			}
+		}
+		writer.put<uint32_t>(count);
+
+		for (uint32_t id = 0; id < database.items.size(); ++id) {
+			ItemType* type = database.items[id];
+			if (!type) {
+				continue;
+			}
+			writer.put<uint8_t>(type->sprite ? 1 : 0);
+			forEachField(*type, [&writer](const char*, const auto& value) {
+				writeField(writer, value);
+			});
+		}
+	}
+
+	// Documents only keep elements, attributes and text
+	void writeNode(CacheWriter& writer, pugi::xml_node node) {
+		writer.put<uint8_t>(node.type());
+		if (node.type() != pugi::node_element) {
+			writer.putString(node.value());
+			return;
+		}
+
+		writer.putString(node.name());
+		uint32_t attributes = 0;
+		for (pugi::xml_attribute attribute = node.first_attribute(); attribute; attribute = attribute.next_attribute()) {
+			++attributes;
+		}
+		writer.put<uint32_t>(attributes);
+		for (pugi::xml_attribute attribute = node.first_attribute(); attribute; attribute = attribute.next_attribute()) {
+			writer.putString(attribute.name());
+			writer.putString(attribute.value());
+		}
+
+		std::vector<pugi::xml_node> children;
+		for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling()) {
+			if (child.type() == pugi::node_element || child.type() == pugi::node_pcdata || child.type() == pugi::node_cdata) {
+				children.push_back(child);
+			}
+		}
+		writer.put<uint32_t>(children.size());
+		for (pugi::xml_node child : children) {
+			writeNode(writer, child);
+		}
+	}
+
+	bool readNode(CacheReader& reader, pugi::xml_node parent) {
+		const pugi::xml_node_type type = static_cast<pugi::xml_node_type>(reader.get<uint8_t>());
+		if (type != pugi::node_element) {
+			parent.append_child(type).set_value(reader.getString().c_str());
+			return reader.ok;
+		}
+
+		pugi::xml_node node = parent.append_child(reader.getString().c_str());
+		const uint32_t attributes = reader.get<uint32_t>();
+		for (uint32_t i = 0; i < attributes && reader.ok; ++i) {
+			const std::string name = reader.getString();
+			node.append_attribute(name.c_str()).set_value(reader.getString().c_str());
+		}
+
+		const uint32_t children = reader.get<uint32_t>();
+		for (uint32_t i = 0; i < children && reader.ok; ++i) {
+			readNode(reader, node);
+		}
+		return reader.ok;
+	}
+
+	std::string serializeDocument(const pugi::xml_document& doc) {
+		CacheWriter writer;
+		std::vector<pugi::xml_node> roots;
+		for (pugi::xml_node child = doc.first_child(); child; child = child.next_sibling()) {
+			if (child.type() == pugi::node_element) {
+				roots.push_back(child);
+			}
+		}
+		writer.put<uint32_t>(roots.size());
+		for (pugi::xml_node root : roots) {
+			writeNode(writer, root);
+		}
+		return writer.data;
+	}
+
+	std::string getPath(const FileName& file) {
+		return nstr(file.GetFullPath());
+	}
+}
+
+DataCache::DataCache() :
+	fileSize(0),
+	loaded(false) {
+	////
+}
+
+DataCache::~DataCache() {
+	////
+}
+
+FileName DataCache::getFileName() {
+	FileName path = g_gui.GetCurrentVersion().getLocalDataPath();
+	path.SetFullName("data.cache");
+	return path;
+}
+
+bool DataCache::stampSource(Source& source) {
+	const wxString path = wxstr(source.path);
+	if (source.directory) {
+		// A directory is only hashed by its listing, there is no cheap stamp
+		source.size = 0;
+		source.modified = 0;
+		return wxDirExists(path);
+	}
+
+	wxFileName file(path);
+	if (!file.FileExists()) {
+		return false;
+	}
+	source.size = file.GetSize().GetValue();
+	source.modified = file.GetModificationTime().GetValue().GetValue();
+	return true;
+}
+
+bool DataCache::hashSource(const Source& source, uint64_t& hash) {
+	hash = HASH_SEED;
+	if (source.directory) {
+		wxDir dir(wxstr(source.path));
+		if (!dir.IsOpened()) {
+			return false;
+		}
+
+		std::vector<std::string> names;
+		wxString name;
+		for (bool found = dir.GetFirst(&name, "*.xml", wxDIR_FILES); found; found = dir.GetNext(&name)) {
+			names.push_back(nstr(name));
+		}
+		std::sort(names.begin(), names.end());
+		for (const std::string& entry : names) {
+			hash = hashBytes(hash, entry.c_str(), entry.size() + 1);
+		}
+		return true;
+	}
+
+	FileReadHandle file(source.path);
+	std::string contents;
+	if (!file.isOk() || !file.getRAW(contents, file.size())) {
+		return false;
+	}
+	hash = hashBytes(hash, contents.data(), contents.size());
+	return true;
+}
+
+bool DataCache::isCurrent(const Source& source) {
+	Source current = source;
+	const bool exists = stampSource(current);
+	if (!exists || source.size == MISSING_SIZE) {
+		return !exists && source.size == MISSING_SIZE;
+	}
+	if (!source.directory && current.size == source.size && current.modified == source.modified) {
+		return true;
+	}
+
+	uint64_t hash;
+	return hashSource(current, hash) && hash == source.hash;
+}
+
+void DataCache::addSource(const std::string& path, bool directory) {
+	for (const Source& source : sources) {
+		if (source.path == path) {
+			return;
+		}
+	}
+
+	Source source;
+	source.path = path;
+	source.directory = directory;
+	source.hash = 0;
+	if (!stampSource(source)) {
+		// Creating the file later has to outdate the cache as well
+		source.size = MISSING_SIZE;
+		source.modified = 0;
+	} else if (!hashSource(source, source.hash)) {
+		return;
+	}
+	sources.push_back(source);
+}
+
+void DataCache::reset() {
+	loaded = false;
+	sources.clear();
+	documents.clear();
+	items.clear();
+	otbPath.clear();
+	xmlPath.clear();
+}
+
+bool DataCache::load(const FileName& path) {
+	reset();
+
+	// The whole cache in a single read
+	FileReadHandle file(getPath(path));
+	std::string buffer;
+	if (!file.isOk() || !file.getRAW(buffer, file.size())) {
+		return false;
+	}
+	fileSize = buffer.size();
+
+	CacheReader reader(buffer);
+	char magic[4];
+	for (char& c : magic) {
+		c = reader.get<char>();
+	}
+	if (memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || reader.get<uint32_t>() != FORMAT_VERSION) {
+		return false;
+	}
+	if (reader.get<uint32_t>() != static_cast<uint32_t>(g_gui.GetCurrentVersionID())) {
+		return false;
+	}
+
+	const uint32_t source_count = reader.get<uint32_t>();
+	for (uint32_t i = 0; i < source_count && reader.ok; ++i) {
+		Source source;
+		source.path = reader.getString();
+		source.directory = reader.get<uint8_t>() != 0;
+		source.size = reader.get<uint64_t>();
+		source.modified = reader.get<int64_t>();
+		source.hash = reader.get<uint64_t>();
+		if (!reader.ok || !isCurrent(source)) {
+			return false;
+		}
+		sources.push_back(source);
+	}
+
+	otbPath = reader.getString();
+	xmlPath = reader.getString();
+	items = reader.getString();
+
+	const uint32_t document_count = reader.get<uint32_t>();
+	for (uint32_t i = 0; i < document_count && reader.ok; ++i) {
+		std::string source = reader.getString();
+		documents[source] = reader.getString();
+	}
+
+	loaded = reader.ok && !items.empty();
+	return loaded;
+}
+
+bool DataCache::save(const FileName& path) {
+	CacheWriter writer;
+	writer.data.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	writer.put<uint32_t>(FORMAT_VERSION);
+	writer.put<uint32_t>(static_cast<uint32_t>(g_gui.GetCurrentVersionID()));
+
+	writer.put<uint32_t>(sources.size());
+	for (const Source& source : sources) {
+		writer.putString(source.path);
+		writer.put<uint8_t>(source.directory ? 1 : 0);
+		writer.put<uint64_t>(source.size);
+		writer.put<int64_t>(source.modified);
+		writer.put<uint64_t>(source.hash);
+	}
+
+	writer.putString(otbPath);
+	writer.putString(xmlPath);
+	writer.putString(items);
+
+	writer.put<uint32_t>(documents.size());
+	for (const auto& document : documents) {
+		writer.putString(document.first);
+		writer.putString(document.second);
+	}
+
+	// Written aside and renamed, a crash never leaves half a cache behind
+	const std::string target = getPath(path);
+	const std::string temporary = target + ".tmp";
+	{
+		FileWriteHandle file(temporary);
+		if (!file.isOpen() || !file.addRAW(writer.data) || !file.isOk()) {
+			return false;
+		}
+	}
+	if (!wxRenameFile(wxstr(temporary), wxstr(target), true)) {
+		wxRemoveFile(wxstr(temporary));
+		return false;
+	}
+	fileSize = writer.data.size();
+	return true;
+}
+
+void DataCache::setItems(const ItemDatabase& database, const FileName& otb, const FileName& xml) {
+	otbPath = getPath(otb);
+	xmlPath = getPath(xml);
+	addSource(otbPath, false);
+	addSource(xmlPath, false);
+
+	CacheWriter writer;
+	writeItems(writer, database);
+	items = writer.data;
+}
+
+bool DataCache::getItems(ItemDatabase& database, wxString& error) const {
+	CacheReader reader(items);
+	database.MajorVersion = reader.get<uint32_t>();
+	database.MinorVersion = reader.get<uint32_t>();
+	database.BuildNumber = reader.get<uint32_t>();
+
+	const uint32_t count = reader.get<uint32_t>();
+	for (uint32_t i = 0; i < count && reader.ok; ++i) {
+		const bool has_sprite = reader.get<uint8_t>() != 0;
+		ItemType* type = newd ItemType();
+		forEachField(*type, [&reader](const char*, auto& value) {
+			readField(reader, value);
+		});
+		if (!reader.ok) {
+			delete type;
+			break;
+		}
+
+		if (has_sprite) {
+			type->sprite = static_cast<GameSprite*>(g_gui.gfx.getSprite(type->clientID));
+		}
+		if (database.max_item_id < type->id) {
+			database.max_item_id = type->id;
+		}
+		delete database.items[type->id];
+		database.items.set(type->id, type);
+	}
+
+	if (!reader.ok) {
+		error = "The data cache is damaged.";
+		return false;
+	}
+	return true;
+}
+
+void DataCache::addDocument(const FileName& source, const pugi::xml_document& doc) {
+	const std::string path = getPath(source);
+	addSource(path, false);
+	documents[path] = serializeDocument(doc);
+}
+
+void DataCache::addDirectory(const FileName& directory) {
+	addSource(nstr(directory.GetPath()), true);
+}
+
+bool DataCache::getDocument(const FileName& source, pugi::xml_document& doc) const {
+	auto it = documents.find(getPath(source));
+	if (it == documents.end()) {
+		return false;
+	}
+
+	doc.reset();
+	CacheReader reader(it->second);
+	const uint32_t roots = reader.get<uint32_t>();
+	for (uint32_t i = 0; i < roots && reader.ok; ++i) {
+		readNode(reader, doc);
+	}
+	return reader.ok;
+}
+
+bool DataCache::validate(wxArrayString& differences) const {
+	for (const Source& source : sources) {
+		if (!isCurrent(source)) {
+			differences.push_back("Source changed: " + wxstr(source.path));
+		}
+	}
+
+	// Item types of a fresh parse against the cached ones
+	ItemDatabase fresh;
+	wxString error;
+	wxArrayString warnings;
+	if (!fresh.loadFromOtb(wxstr(otbPath), error, warnings)) {
+		differences.push_back("Could not parse " + wxstr(otbPath) + ": " + error);
+	} else {
+		fresh.loadFromGameXml(wxstr(xmlPath), error, warnings);
+	}
+
+	ItemDatabase cached;
+	if (!getItems(cached, error)) {
+		differences.push_back(error);
+	}
+
+	if (fresh.MajorVersion != cached.MajorVersion || fresh.MinorVersion != cached.MinorVersion || fresh.BuildNumber != cached.BuildNumber) {
+		differences.push_back("items.otb version differs");
+	}
+
+	const uint32_t last_id = std::max<uint32_t>(fresh.items.size(), cached.items.size());
+	for (uint32_t id = 0; id < last_id; ++id) {
+		ItemType* fresh_type = id < fresh.items.size() ? fresh.items[id] : nullptr;
+		ItemType* cached_type = id < cached.items.size() ? cached.items[id] : nullptr;
+		if (!fresh_type || !cached_type) {
+			if (fresh_type || cached_type) {
+				differences.push_back(wxString::Format("Item %u: only in the %s", id, fresh_type ? "fresh parse" : "cache"));
+			}
+			continue;
+		}
+
+		std::vector<std::pair<const char*, std::string>> fields;
+		forEachField(*fresh_type, [&fields](const char* name, const auto& value) {
+			fields.emplace_back(name, fieldText(value));
+		});
+		size_t index = 0;
+		forEachField(*cached_type, [&](const char* name, const auto& value) {
+			const std::string text = fieldText(value);
+			if (text != fields[index].second) {
+				differences.push_back(wxString::Format("Item %u: %s is %s, cached %s", id, name, wxstr(fields[index].second), wxstr(text)));
+			}
+			++index;
+		});
+		if ((fresh_type->sprite != nullptr) != (cached_type->sprite != nullptr)) {
+			differences.push_back(wxString::Format("Item %u: sprite differs", id));
+		}
+	}
+
+	// Documents are compared in their serialized form
+	for (const auto& document : documents) {
+		pugi::xml_document doc;
+		if (!doc.load_file(document.first.c_str())) {
+			differences.push_back("Could not parse " + wxstr(document.first));
+		} else if (serializeDocument(doc) != document.second) {
+			differences.push_back("Document differs: " + wxstr(document.first));
+		}
+	}
+	return differences.empty();
+}
@@ -0,0 +1,97 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_DATA_CACHE_H_
+#define RME_DATA_CACHE_H_
+
+class ItemDatabase;
+
+// Binary copy of the data files read on every start: the item types as they
+// are after items.otb and items.xml, and every materials document as a node
+// tree. A warm start reads the cache in one go and parses no XML.
+//
+// The cache is keyed by the content hash of each file it was built from.
+// Size and modification time are stored next to the hash so unchanged files
+// don't have to be hashed again, a file is only hashed when they differ.
+class DataCache {
+public:
+	DataCache();
+	~DataCache();
+
+	// Reads the cache, false when it is missing, was written by another
+	// format or client version, or one of its source files changed
+	bool load(const FileName& path);
+	bool isLoaded() const {
+		return loaded;
+	}
+	// Drops everything so the cache can be rebuilt from the files
+	void reset();
+
+	// Warm start, fills an empty database with the cached item types
+	bool getItems(ItemDatabase& database, wxString& error) const;
+	// False when the document of that file is not in the cache
+	bool getDocument(const FileName& source, pugi::xml_document& doc) const;
+
+	// Cold start, the loaders hand over what they read
+	void setItems(const ItemDatabase& database, const FileName& otb, const FileName& xml);
+	void addDocument(const FileName& source, const pugi::xml_document& doc);
+	// Files added to or removed from the directory outdate the cache
+	void addDirectory(const FileName& directory);
+	bool save(const FileName& path);
+
+	// Compares the cache with a fresh parse of its sources, false and one
+	// line per difference when they don't match
+	bool validate(wxArrayString& differences) const;
+
+	// Cache of the loaded client version
+	static FileName getFileName();
+
+	// Bytes read by load or written by save
+	size_t getSize() const {
+		return fileSize;
+	}
+
+	// Bumped whenever ItemType or the layout of the cache changes
+	static const uint32_t FORMAT_VERSION = 1;
+
+protected:
+	struct Source {
+		std::string path;
+		uint64_t size;
+		int64_t modified;
+		uint64_t hash;
+		bool directory;
+	};
+
+	// Size and modification time, false when the source doesn't exist
+	static bool stampSource(Source& source);
+	static bool hashSource(const Source& source, uint64_t& hash);
+	static bool isCurrent(const Source& source);
+	void addSource(const std::string& path, bool directory);
+
+	std::vector<Source> sources;
+	std::string otbPath;
+	std::string xmlPath;
+	std::string items;
+	// Serialized node tree of each document by source path
+	std::map<std::string, std::string> documents;
+
+	size_t fileSize;
+	bool loaded;
+};
+
+#endif
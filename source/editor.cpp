@@ -40,12 +40,17 @@
 #include "live_client.h"
 #include "live_action.h"
 #include "minimap_window.h"
+#include "minimap_export.h"
 #include "borderize_window.h"
+#include "selection_move.h"
+#include "map_statistics.h"
+
+#include <thread>
 
 Editor::Editor(CopyBuffer& copybuffer) :
 	live_server(nullptr),
 	live_client(nullptr),
-
+	edit_blocks(0),
 	actionQueue(newd ActionQueue(*this)),
 	selection(*this),
 	copybuffer(copybuffer),
@@ -97,6 +102,7 @@ Editor::Editor(CopyBuffer& copybuffer) :
 Editor::Editor(CopyBuffer& copybuffer, const FileName& fn) :
 	live_server(nullptr),
 	live_client(nullptr),
+	edit_blocks(0),
 	actionQueue(newd ActionQueue(*this)),
 	selection(*this),
 	copybuffer(copybuffer),
@@ -152,6 +158,7 @@ Editor::Editor(CopyBuffer& copybuffer, const FileName& fn) :
 Editor::Editor(CopyBuffer& copybuffer, LiveClient* client) :
 	live_server(nullptr),
 	live_client(client),
+	edit_blocks(0),
 	actionQueue(newd NetworkedActionQueue(*this)),
 	selection(*this),
 	copybuffer(copybuffer),
@@ -160,6 +167,9 @@ Editor::Editor(CopyBuffer& copybuffer, LiveClient* client) :
 }
 
 Editor::~Editor() {
+	// Stops the statistics workers before the map goes away
+	statistics.reset();
+
 	if (IsLive()) {
 		CloseLiveServer();
 	}
@@ -422,65 +432,22 @@ bool Editor::exportSelectionAsMiniMap(FileName directory, wxString fileName) {
 		}
 	}
 
-	int numtiles = (max_x - min_x) * (max_y - min_y);
-	int minimap_width = max_x - min_x + 1;
-	int minimap_height = max_y - min_y + 1;
-
-	if (numtiles == 0) {
-		return false;
-	}
-
-	if (minimap_width > 2048 || minimap_height > 2048) {
-		g_gui.PopupDialog("Error", "Minimap size greater than 2048px.", wxOK);
+	if (tiles.empty() || max_x < min_x || max_y < min_y) {
 		return false;
 	}
 
-	int tiles_iterated = 0;
+	MinimapExporter exporter(map, MINIMAP_EXPORT_PNG);
+	exporter.setSelectedOnly(true);
+	exporter.setArea(min_x, min_y, max_x, max_y);
 
 	for (int z = min_z; z <= max_z; z++) {
-		uint8_t* pixels = newd uint8_t[minimap_width * minimap_height * 3]; // 3 bytes per pixel
-		memset(pixels, 0, minimap_width * minimap_height * 3);
-
-		for (Tile* tile : tiles) {
-			if (tile->getZ() != z) {
-				continue;
-			}
-
-			++tiles_iterated;
-			if (tiles_iterated % 8192 == 0) {
-				g_gui.SetLoadDone(int(tiles_iterated / double(tiles.size()) * 90.0));
-			}
-
-			if (tile->empty()) {
-				continue;
-			}
-
-			uint8_t color = 0;
-
-			for (Item* item : tile->items) {
-				if (item->getMiniMapColor() != 0) {
-					color = item->getMiniMapColor();
-					break;
-				}
-			}
-
-			if (color == 0 && tile->hasGround()) {
-				color = tile->ground->getMiniMapColor();
-			}
-
-			uint32_t index = ((tile->getY() - min_y) * minimap_width + (tile->getX() - min_x)) * 3;
-
-			pixels[index] = (uint8_t)(int(color / 36) % 6 * 51); // red
-			pixels[index + 1] = (uint8_t)(int(color / 6) % 6 * 51); // green
-			pixels[index + 2] = (uint8_t)(color % 6 * 51); // blue
-		}
+		g_gui.SetLoadDone(int((z - min_z) * 100.0 / (max_z - min_z + 1)));
 
 		FileName file(fileName + "_" + i2ws(z) + ".png");
 		file.Normalize(wxPATH_NORM_ALL, directory.GetFullPath());
-		wxImage* image = newd wxImage(minimap_width, minimap_height, pixels, true);
-		image->SaveFile(file.GetFullPath(), wxBITMAP_TYPE_PNG);
-		image->Destroy();
-		delete[] pixels;
+		if (!exporter.exportFloor(file, z)) {
+			return false;
+		}
 	}
 
 	return true;
@@ -802,7 +769,7 @@ bool Editor::importMap(FileName filename, int import_x_offset, int import_y_offs
 			tile = map.allocator(location);
 			map.setTile(pos, tile);
 		} else if (tile->spawn) {
-			map.removeSpawnInternal(tile);
+			map.removeSpawn(tile);
 			delete tile->spawn;
 		}
 		tile->spawn = spawn_iter->second;
@@ -996,6 +963,46 @@ void Editor::clearModifiedTileState(bool showdialog) {
 }
 
 void Editor::moveSelection(Position offset) {
+	// Live clients send whole tiles to the server, so they keep copying them
+	SelectionMove* move = IsLiveClient() ? nullptr : SelectionMove::create(*this, offset);
+	if (!move) {
+		moveSelectionByCopy(offset);
+		return;
+	}
+
+	BatchAction* batchAction = actionQueue->createBatch(ACTION_MOVE);
+	Action* action = actionQueue->createAction(batchAction);
+	action->addChange(Change::Create(move));
+	batchAction->addAndCommitAction(action);
+
+	// Only the tiles around the edges of the moved area need new borders
+	if (g_settings.getInteger(Config::USE_AUTOMAGIC) && g_settings.getInteger(Config::BORDERIZE_DRAG)) {
+		TileList borderize_tiles;
+		move->getFringe(map, borderize_tiles);
+		if (borderize_tiles.size() < size_t(g_settings.getInteger(Config::BORDERIZE_DRAG_THRESHOLD))) {
+			action = actionQueue->createAction(batchAction);
+			for (Tile* tile : borderize_tiles) {
+				Tile* new_tile = tile->deepCopy(map);
+				if (move->movesGround()) {
+					new_tile->borderize(&map);
+				}
+				new_tile->wallize(&map);
+				new_tile->tableize(&map);
+				new_tile->carpetize(&map);
+				if (tile->ground && tile->ground->isSelected()) {
+					new_tile->selectGround();
+				}
+				action->addChange(newd Change(new_tile));
+			}
+			batchAction->addAndCommitAction(action);
+		}
+	}
+
+	addBatch(batchAction);
+	selection.updateSelectionCount();
+}
+
+void Editor::moveSelectionByCopy(Position offset) {
 	BatchAction* batchAction = actionQueue->createBatch(ACTION_MOVE); // Our saved action batch, for undo!
 	Action* action;
 
@@ -1636,8 +1643,61 @@ void Editor::drawInternal(const PositionVector& tilestodraw, bool alt, bool dodr
 	}
 }
 
+// Strokes smaller than this are rebordered on the calling thread
+static const size_t PARALLEL_REBORDER_TILES = 512;
+
+// Recomputes the tiles around a stroke once per position, however many times
+// it was queued. Every result only reads the map as the draw action left it
+// and writes to its own copy, so large strokes are split between threads.
+void Editor::reborderPositions(Action* action, PositionVector positions, bool create, const std::function<Tile*(Tile*, TileLocation*)>& rebuild) {
+	std::sort(positions.begin(), positions.end());
+	positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+	// Creating locations modifies the tree, do it before going wide
+	std::vector<TileLocation*> locations;
+	locations.reserve(positions.size());
+	for (const Position& position : positions) {
+		TileLocation* location = create ? map.createTileL(position) : map.getTileL(position);
+		if (location) {
+			locations.push_back(location);
+		}
+	}
+
+	std::vector<Tile*> tiles(locations.size(), nullptr);
+	auto work = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; ++i) {
+			tiles[i] = rebuild(locations[i]->get(), locations[i]);
+		}
+	};
+
+	size_t thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+	thread_count = std::min(thread_count, locations.size() / PARALLEL_REBORDER_TILES);
+	if (thread_count <= 1) {
+		work(0, locations.size());
+	} else {
+		size_t chunk = (locations.size() + thread_count - 1) / thread_count;
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < thread_count; ++i) {
+			threads.emplace_back(work, std::min(locations.size(), i * chunk), std::min(locations.size(), (i + 1) * chunk));
+		}
+		work(0, chunk);
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	for (Tile* tile : tiles) {
+		if (tile) {
+			action->addChange(newd Change(tile));
+		}
+	}
+}
+
 void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& tilestoborder, bool alt, bool dodraw) {
-	Brush* brush = g_gui.GetCurrentBrush();
+	drawInternal(g_gui.GetCurrentBrush(), tilestodraw, tilestoborder, alt, dodraw);
+}
+
+void Editor::drawInternal(Brush* brush, const PositionVector& tilestodraw, PositionVector& tilestoborder, bool alt, bool dodraw) {
 	if (!brush) {
 		return;
 	}
@@ -1667,12 +1727,12 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 							param.first = true;
 							param.second = nullptr;
 						}
-						g_gui.GetCurrentBrush()->draw(&map, new_tile, &param);
+						brush->draw(&map, new_tile, &param);
 					} else {
-						g_gui.GetCurrentBrush()->draw(&map, new_tile, nullptr);
+						brush->draw(&map, new_tile, nullptr);
 					}
 				} else {
-					g_gui.GetCurrentBrush()->undraw(&map, new_tile);
+					brush->undraw(&map, new_tile);
 					tilestoborder.push_back(*it);
 				}
 				action->addChange(newd Change(new_tile));
@@ -1687,9 +1747,9 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 						param.first = true;
 						param.second = nullptr;
 					}
-					g_gui.GetCurrentBrush()->draw(&map, new_tile, &param);
+					brush->draw(&map, new_tile, &param);
 				} else {
-					g_gui.GetCurrentBrush()->draw(&map, new_tile, nullptr);
+					brush->draw(&map, new_tile, nullptr);
 				}
 				action->addChange(newd Change(new_tile));
 			}
@@ -1701,9 +1761,7 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 		if (g_settings.getInteger(Config::USE_AUTOMAGIC)) {
 			// Do borders!
 			action = actionQueue->createAction(batch);
-			for (PositionVector::const_iterator it = tilestoborder.begin(); it != tilestoborder.end(); ++it) {
-				TileLocation* location = map.createTileL(*it);
-				Tile* tile = location->get();
+			reborderPositions(action, tilestoborder, true, [this, brush](Tile* tile, TileLocation* location) -> Tile* {
 				if (tile) {
 					Tile* new_tile = tile->deepCopy(map);
 					if (brush->isEraser()) {
@@ -1712,23 +1770,18 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 						new_tile->carpetize(&map);
 					}
 					new_tile->borderize(&map);
-					action->addChange(newd Change(new_tile));
-				} else {
-					Tile* new_tile = map.allocator(location);
-					if (brush->isEraser()) {
-						// There are no carpets/tables/walls on empty tiles...
-						// new_tile->wallize(map);
-						// new_tile->tableize(map);
-						// new_tile->carpetize(map);
-					}
-					new_tile->borderize(&map);
-					if (new_tile->size() > 0) {
-						action->addChange(newd Change(new_tile));
-					} else {
-						delete new_tile;
-					}
+					return new_tile;
 				}
-			}
+
+				// There are no carpets/tables/walls on empty tiles...
+				Tile* new_tile = map.allocator(location);
+				new_tile->borderize(&map);
+				if (new_tile->size() > 0) {
+					return new_tile;
+				}
+				delete new_tile;
+				return nullptr;
+			});
 			batch->addAndCommitAction(action);
 		}
 
@@ -1743,14 +1796,14 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 			if (tile) {
 				Tile* new_tile = tile->deepCopy(map);
 				if (dodraw) {
-					g_gui.GetCurrentBrush()->draw(&map, new_tile, nullptr);
+					brush->draw(&map, new_tile, nullptr);
 				} else {
-					g_gui.GetCurrentBrush()->undraw(&map, new_tile);
+					brush->undraw(&map, new_tile);
 				}
 				action->addChange(newd Change(new_tile));
 			} else if (dodraw) {
 				Tile* new_tile = map.allocator(location);
-				g_gui.GetCurrentBrush()->draw(&map, new_tile, nullptr);
+				brush->draw(&map, new_tile, nullptr);
 				action->addChange(newd Change(new_tile));
 			}
 		}
@@ -1760,22 +1813,22 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 
 		// Do borders!
 		action = actionQueue->createAction(batch);
-		for (PositionVector::const_iterator it = tilestoborder.begin(); it != tilestoborder.end(); ++it) {
-			Tile* tile = map.getTile(*it);
+		reborderPositions(action, tilestoborder, false, [this, brush](Tile* tile, TileLocation*) -> Tile* {
 			if (brush->isTable()) {
 				if (tile && tile->hasTable()) {
 					Tile* new_tile = tile->deepCopy(map);
 					new_tile->tableize(&map);
-					action->addChange(newd Change(new_tile));
+					return new_tile;
 				}
 			} else if (brush->isCarpet()) {
 				if (tile && tile->hasCarpet()) {
 					Tile* new_tile = tile->deepCopy(map);
 					new_tile->carpetize(&map);
-					action->addChange(newd Change(new_tile));
+					return new_tile;
 				}
 			}
-		}
+			return nullptr;
+		});
 		batch->addAndCommitAction(action);
 
 		addBatch(batch, 2);
@@ -1794,11 +1847,11 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 				if (tile) {
 					Tile* new_tile = tile->deepCopy(map);
 					new_tile->cleanWalls(brush->isWall());
-					g_gui.GetCurrentBrush()->draw(draw_map, new_tile);
+					brush->draw(draw_map, new_tile);
 					draw_map->setTile(*it, new_tile, true);
 				} else if (dodraw) {
 					Tile* new_tile = map.allocator(location);
-					g_gui.GetCurrentBrush()->draw(draw_map, new_tile);
+					brush->draw(draw_map, new_tile);
 					draw_map->setTile(*it, new_tile, true);
 				}
 			}
@@ -1822,14 +1875,14 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 					// Wall cleaning is exempt from automagic
 					new_tile->cleanWalls(brush->isWall());
 					if (dodraw) {
-						g_gui.GetCurrentBrush()->draw(&map, new_tile);
+						brush->draw(&map, new_tile);
 					} else {
-						g_gui.GetCurrentBrush()->undraw(&map, new_tile);
+						brush->undraw(&map, new_tile);
 					}
 					action->addChange(newd Change(new_tile));
 				} else if (dodraw) {
 					Tile* new_tile = map.allocator(location);
-					g_gui.GetCurrentBrush()->draw(&map, new_tile);
+					brush->draw(&map, new_tile);
 					action->addChange(newd Change(new_tile));
 				}
 			}
@@ -1840,15 +1893,14 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 			if (g_settings.getInteger(Config::USE_AUTOMAGIC)) {
 				// Do borders!
 				action = actionQueue->createAction(batch);
-				for (PositionVector::const_iterator it = tilestoborder.begin(); it != tilestoborder.end(); ++it) {
-					Tile* tile = map.getTile(*it);
-					if (tile) {
-						Tile* new_tile = tile->deepCopy(map);
-						new_tile->wallize(&map);
-						// if(*tile == *new_tile) delete new_tile;
-						action->addChange(newd Change(new_tile));
+				reborderPositions(action, tilestoborder, false, [this](Tile* tile, TileLocation*) -> Tile* {
+					if (!tile) {
+						return nullptr;
 					}
-				}
+					Tile* new_tile = tile->deepCopy(map);
+					new_tile->wallize(&map);
+					return new_tile;
+				});
 				batch->addAndCommitAction(action);
 			}
 		}
@@ -1888,15 +1940,14 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 		if (g_settings.getInteger(Config::USE_AUTOMAGIC)) {
 			// Do borders!
 			action = actionQueue->createAction(batch);
-			for (PositionVector::const_iterator it = tilestoborder.begin(); it != tilestoborder.end(); ++it) {
-				Tile* tile = map.getTile(*it);
-				if (tile) {
-					Tile* new_tile = tile->deepCopy(map);
-					new_tile->wallize(&map);
-					// if(*tile == *new_tile) delete new_tile;
-					action->addChange(newd Change(new_tile));
+			reborderPositions(action, tilestoborder, false, [this](Tile* tile, TileLocation*) -> Tile* {
+				if (!tile) {
+					return nullptr;
 				}
-			}
+				Tile* new_tile = tile->deepCopy(map);
+				new_tile->wallize(&map);
+				return new_tile;
+			});
 			batch->addAndCommitAction(action);
 		}
 
@@ -1909,14 +1960,14 @@ void Editor::drawInternal(const PositionVector& tilestodraw, PositionVector& til
 			if (tile) {
 				Tile* new_tile = tile->deepCopy(map);
 				if (dodraw) {
-					g_gui.GetCurrentBrush()->draw(&map, new_tile);
+					brush->draw(&map, new_tile);
 				} else {
-					g_gui.GetCurrentBrush()->undraw(&map, new_tile);
+					brush->undraw(&map, new_tile);
 				}
 				action->addChange(newd Change(new_tile));
 			} else if (dodraw) {
 				Tile* new_tile = map.allocator(location);
-				g_gui.GetCurrentBrush()->draw(&map, new_tile);
+				brush->draw(&map, new_tile);
 				action->addChange(newd Change(new_tile));
 			}
 		}
@@ -2030,6 +2081,12 @@ void Editor::QueryNode(int ndx, int ndy, bool underground) {
 	live_client->queryNode(ndx, ndy, underground);
 }
 
+void Editor::PrefetchNodes(int start_x, int start_y, int end_x, int end_y, int floor, double zoom) {
+	if (live_client) {
+		live_client->updateViewport(start_x, start_y, end_x, end_y, floor, zoom);
+	}
+}
+
 void Editor::SendNodeRequests() {
 	if (live_client) {
 		live_client->sendNodeRequests();
@@ -2215,6 +2272,7 @@ uint32_t Editor::removeDuplicateGrounds() {
                 [](Item* item) { return item && item->isGroundTile(); });
             
             tile->items.erase(it, tile->items.end());
+            map.touchTile(tile->getPosition());
             
             changes += groundTiles.size() - 1;
         }
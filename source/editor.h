@@ -27,11 +27,15 @@
 #include "selection.h"
 #include "minimap_window.h"
 
+#include <functional>
+#include <memory>
+
 class BaseMap;
 class CopyBuffer;
 class LiveClient;
 class LiveServer;
 class LiveSocket;
+class MapStatisticsTask;
 
 class Editor {
 public:
@@ -44,6 +48,8 @@ protected:
 	// Live Server
 	LiveServer* live_server;
 	LiveClient* live_client;
+	// Map-wide readers running on other threads
+	int edit_blocks;
 
 public:
 	// Public members
@@ -52,6 +58,8 @@ public:
 	CopyBuffer& copybuffer;
 	GroundBrush* replace_brush;
 	Map map; // The map that is being edited
+	// Statistics collected on a worker, edits are blocked while it runs
+	std::unique_ptr<MapStatisticsTask> statistics;
 
 public: // Functions
 	// Live Server handling
@@ -59,7 +67,13 @@ public: // Functions
 	LiveServer* GetLiveServer() const;
 	LiveSocket& GetLive() const;
 	bool CanEdit() const {
-		return true;
+		return edit_blocks == 0;
+	}
+	void BlockEdits() {
+		++edit_blocks;
+	}
+	void UnblockEdits() {
+		--edit_blocks;
 	}
 	bool IsLocal() const;
 	bool IsLive() const;
@@ -73,6 +87,7 @@ public: // Functions
 
 	// Client side
 	void QueryNode(int ndx, int ndy, bool underground);
+	void PrefetchNodes(int start_x, int start_y, int end_x, int end_y, int floor, double zoom);
 	void SendNodeRequests();
 
 	// Map handling
@@ -113,6 +128,9 @@ public: // Functions
 	// Some simple actions that work on the map (these will work through the undo queue)
 	// Moves the selected area by the offset
 	void moveSelection(Position offset);
+	// Same, by replacing every selected tile with a changed copy. Used for
+	// selections the in-place move can't record and on live clients.
+	void moveSelectionByCopy(Position offset);
 	// Deletes all selected items
 	void destroySelection();
 	// Borderizes the selected region
@@ -128,6 +146,11 @@ public: // Functions
 	void clearInvalidHouseTiles(bool showdialog);
 	void clearModifiedTileState(bool showdialog);
 
+	// Adds rebuild(tile, location) of every position to the action, once per
+	// position and split between threads for large sets. rebuild returns the
+	// new tile or nullptr to leave it, it may only read the map.
+	void reborderPositions(Action* action, PositionVector positions, bool create, const std::function<Tile*(Tile*, TileLocation*)>& rebuild);
+
 	// Draw using the current brush to the target position
 	// alt is whether the ALT key is pressed
 	void draw(const Position& offset, bool alt);
@@ -136,6 +159,8 @@ public: // Functions
 	void draw(const PositionVector& todraw, PositionVector& toborder, bool alt);
 	void undraw(const PositionVector& posvec, bool alt);
 	void undraw(const PositionVector& todraw, PositionVector& toborder, bool alt);
+	// Same, with a brush other than the one selected in the palette
+	void draw(Brush* brush, const PositionVector& todraw, PositionVector& toborder, bool alt);
 
 	// Minimap update helpers
 	void updateMinimap(const Position& pos);
@@ -152,6 +177,7 @@ protected:
 	void drawInternal(const Position offset, bool alt, bool dodraw);
 	void drawInternal(const PositionVector& posvec, bool alt, bool dodraw);
 	void drawInternal(const PositionVector& todraw, PositionVector& toborder, bool alt, bool dodraw);
+	void drawInternal(Brush* brush, const PositionVector& todraw, PositionVector& toborder, bool alt, bool dodraw);
 
 	Editor(const Editor&);
 	Editor& operator=(const Editor&);
@@ -175,6 +201,9 @@ inline void Editor::undraw(const PositionVector& posvec, bool alt) {
 inline void Editor::undraw(const PositionVector& todraw, PositionVector& toborder, bool alt) {
 	drawInternal(todraw, toborder, alt, false);
 }
+inline void Editor::draw(Brush* brush, const PositionVector& todraw, PositionVector& toborder, bool alt) {
+	drawInternal(brush, todraw, toborder, alt, true);
+}
 
 
 
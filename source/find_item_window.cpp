@@ -22,6 +22,7 @@
 #include "items.h"
 #include "brush.h"
 #include "raw_brush.h"
+#include "item_search_index.h"
 #include <algorithm>    // For std::all_of
 #include <cctype>       // For std::isdigit
 #include <sstream>      // For std::istringstream
@@ -523,322 +524,78 @@ void FindItemDialog::RefreshContentsInternal() {
 	bool found_search_results = false;
 	
 	// Parse ignored IDs if the checkbox is checked
+	IdRangeSet ignored;
 	if (ignore_ids_checkbox->GetValue()) {
 		ParseIgnoredIDs();
+		for (uint16_t id : ignored_ids) {
+			ignored.add(id, id);
+		}
+		ignored.add(ignored_ranges);
 	}
-	
+
+	const ItemSearchIndex& index = g_items.getSearchIndex();
+	const size_t max_results = size_t(replace_size_spin->GetValue());
+	std::vector<uint16_t> results;
+
 	SearchMode selection = (SearchMode)options_radio_box->GetSelection();
-	if(selection == SearchMode::ServerIDs) {
-		if(use_range->GetValue()) {
-			// Parse the range string into pairs
-			auto ranges = ParseRangeString(range_input->GetValue());
-			OutputDebugStringA(wxString::Format("RANGE SEARCH: Found %zu ranges to search\n", ranges.size()).c_str());
-			
-			// Iterate through each range instead of all IDs
-			for(const auto& range : ranges) {
-				for(uint16_t id = range.first; id <= range.second; ++id) {
-					if(items_list->GetItemCount() >= size_t(replace_size_spin->GetValue())) {
-						OutputDebugStringA("REACHED MAX RESULTS LIMIT!\n");
-						break;
-					}
-					
-					OutputDebugStringA(wxString::Format("Checking ID %d in range %d-%d\n", 
-						id, range.first, range.second).c_str());
-
-					// Check if ID is ignored
-					bool is_ignored = false;
-					if (ignore_ids_checkbox->GetValue()) {
-						// Check individual ignored IDs
-						if (std::find(ignored_ids.begin(), ignored_ids.end(), id) != ignored_ids.end()) {
-							OutputDebugStringA(wxString::Format("ID %d is in ignored individual IDs list\n", id).c_str());
-							is_ignored = true;
-						}
-						// Check ignored ranges
-						for (const auto& ignored_range : ignored_ranges) {
-							if (id >= ignored_range.first && id <= ignored_range.second) {
-								OutputDebugStringA(wxString::Format("ID %d is in ignored range %d-%d\n", 
-									id, ignored_range.first, ignored_range.second).c_str());
-								is_ignored = true;
-								break;
-							}
-						}
-					}
-					
-					if (is_ignored) {
-						OutputDebugStringA(wxString::Format("Skipping ignored ID %d\n", id).c_str());
-						continue;
-					}
-					
-					ItemType& item = g_items.getItemType(id);
-					if(item.id == 0) {
-						OutputDebugStringA(wxString::Format("ID %d has no item type\n", id).c_str());
-						continue;
-					}
-					
-					RAWBrush* raw_brush = item.raw_brush;
-					if(!raw_brush) {
-						OutputDebugStringA(wxString::Format("ID %d has no raw brush\n", id).c_str());
-						continue;
-					}
-					
-					if(only_pickupables && !item.pickupable) {
-						OutputDebugStringA(wxString::Format("ID %d is not pickupable\n", id).c_str());
-						continue;
-					}
-					
-					OutputDebugStringA(wxString::Format("Adding ID %d to results\n", id).c_str());
-					found_search_results = true;
-					items_list->AddBrush(raw_brush);
-				}
-			}
-			
-			OutputDebugStringA(wxString::Format("RANGE SEARCH COMPLETE: Found %d items\n", 
-				items_list->GetItemCount()).c_str());
+	if (selection == SearchMode::ServerIDs) {
+		IdRangeSet ranges;
+		if (use_range->GetValue()) {
+			ranges.add(ParseRangeString(range_input->GetValue()));
+			index.findServerIds(ranges, ignored, only_pickupables, max_results, results);
 		} else {
 			result_id = std::min(server_id_spin->GetValue(), 0xFFFF);
-			uint16_t serverID = static_cast<uint16_t>(result_id);
-			if(serverID <= g_items.getMaxID()) {
-				// Check if ID is ignored
-				bool is_ignored = false;
-				if (ignore_ids_checkbox->GetValue()) {
-					if (std::find(ignored_ids.begin(), ignored_ids.end(), serverID) != ignored_ids.end()) {
-						is_ignored = true;
-					}
-					for (const auto& range : ignored_ranges) {
-						if (serverID >= range.first && serverID <= range.second) {
-							is_ignored = true;
-							break;
-						}
-					}
-				}
-				if (!is_ignored) {
-					ItemType& item = g_items.getItemType(serverID);
-					RAWBrush* raw_brush = item.raw_brush;
-					if(raw_brush) {
-						if(only_pickupables) {
-							if(item.pickupable) {
-								found_search_results = true;
-								items_list->AddBrush(raw_brush);
-							}
-						} else {
-							found_search_results = true;
-							items_list->AddBrush(raw_brush);
-						}
-					}
-				}
-			}
-			
+			ranges.add(result_id, result_id);
+			index.findServerIds(ranges, ignored, only_pickupables, std::numeric_limits<size_t>::max(), results);
+
 			if (invalid_item->GetValue()) {
 				found_search_results = true;
 			}
 		}
 	} else if (selection == SearchMode::ClientIDs) {
+		IdRangeSet ranges;
 		if (use_range->GetValue()) {
-			// Parse the range string into pairs
-			auto ranges = ParseRangeString(range_input->GetValue());
-			
-			for (int id = 100; id <= g_items.getMaxID(); ++id) {
-				if(items_list->GetItemCount() >= size_t(replace_size_spin->GetValue())) {
-					break;
-				}
-
-				ItemType& item = g_items.getItemType(id);
-				if (item.id == 0) continue;
-
-				// Check if clientID is in any of the specified ranges
-				if (!IsInRanges(item.clientID, ranges)) {
-					continue;
-				}
-
-				// Check if clientID is ignored
-				bool is_ignored = false;
-				if (ignore_ids_checkbox->GetValue()) {
-					if (std::find(ignored_ids.begin(), ignored_ids.end(), item.clientID) != ignored_ids.end()) {
-						is_ignored = true;
-					}
-					for (const auto& range : ignored_ranges) {
-						if (item.clientID >= range.first && item.clientID <= range.second) {
-							is_ignored = true;
-							break;
-						}
-					}
-				}
-				if (is_ignored) continue;
-
-				RAWBrush* raw_brush = item.raw_brush;
-				if (!raw_brush) continue;
-
-				if (only_pickupables && !item.pickupable) continue;
-
-				found_search_results = true;
-				items_list->AddBrush(raw_brush);
-			}
+			ranges.add(ParseRangeString(range_input->GetValue()));
+			index.findClientIds(ranges, ignored, only_pickupables, max_results, results);
 		} else {
 			uint16_t clientID = (uint16_t)client_id_spin->GetValue();
-			
-			// Check if clientID is ignored
-			bool is_ignored = false;
-			if (ignore_ids_checkbox->GetValue()) {
-				if (std::find(ignored_ids.begin(), ignored_ids.end(), clientID) != ignored_ids.end()) {
-					is_ignored = true;
-				}
-				for (const auto& range : ignored_ranges) {
-					if (clientID >= range.first && clientID <= range.second) {
-						is_ignored = true;
-						break;
-					}
-				}
-			}
-			if (!is_ignored) {
-				for (int id = 100; id <= g_items.getMaxID(); ++id) {
-					ItemType& item = g_items.getItemType(id);
-					if (item.id == 0 || item.clientID != clientID) {
-						continue;
-					}
-
-					RAWBrush* raw_brush = item.raw_brush;
-					if (!raw_brush) {
-						continue;
-					}
-
-					if (only_pickupables && !item.pickupable) {
-						continue;
-					}
-
-					found_search_results = true;
-					items_list->AddBrush(raw_brush);
-				}
-			}
+			ranges.add(clientID, clientID);
+			index.findClientIds(ranges, ignored, only_pickupables, std::numeric_limits<size_t>::max(), results);
 		}
 	} else if (selection == SearchMode::Names) {
-		std::string search_string = as_lower_str(nstr(name_text_input->GetValue()));
-		if (search_string.size() >= 2) {
-			for (int id = 100; id <= g_items.getMaxID(); ++id) {
-				ItemType& item = g_items.getItemType(id);
-				if (item.id == 0) {
-					continue;
-				}
-
-				RAWBrush* raw_brush = item.raw_brush;
-				if (!raw_brush) {
-					continue;
-				}
-
-				if (only_pickupables && !item.pickupable) {
-					continue;
-				}
-
-				if (as_lower_str(raw_brush->getName()).find(search_string) == std::string::npos) {
-					continue;
-				}
-
-				found_search_results = true;
-				items_list->AddBrush(raw_brush);
-			}
-		}
+		index.findName(as_lower_str(nstr(name_text_input->GetValue())), only_pickupables, results);
 	} else if (selection == SearchMode::Types) {
-		for (int id = 100; id <= g_items.getMaxID(); ++id) {
-			ItemType& item = g_items.getItemType(id);
-			if (item.id == 0) {
-				continue;
-			}
-
-			RAWBrush* raw_brush = item.raw_brush;
-			if (!raw_brush) {
-				continue;
-			}
-
-			if (only_pickupables && !item.pickupable) {
-				continue;
-			}
-
-			SearchItemType selection = (SearchItemType)types_radio_box->GetSelection();
-			if ((selection == SearchItemType::Depot && !item.isDepot()) || (selection == SearchItemType::Mailbox && !item.isMailbox()) || (selection == SearchItemType::TrashHolder && !item.isTrashHolder()) || (selection == SearchItemType::Container && !item.isContainer()) || (selection == SearchItemType::Door && !item.isDoor()) || (selection == SearchItemType::MagicField && !item.isMagicField()) || (selection == SearchItemType::Teleport && !item.isTeleport()) || (selection == SearchItemType::Bed && !item.isBed()) || (selection == SearchItemType::Key && !item.isKey()) || (selection == SearchItemType::Podium && !item.isPodium())) {
-				continue;
-			}
-
-			found_search_results = true;
-			items_list->AddBrush(raw_brush);
-		}
+		index.findType((ItemSearchIndex::Type)types_radio_box->GetSelection(), only_pickupables, results);
 	} else if (selection == SearchMode::Properties) {
-		bool has_selected = false;
-		// Check if any checkbox is not in unchecked state
-		for(wxCheckBox* checkbox : {unpassable, unmovable, block_missiles, block_pathfinder, readable, writeable, 
-			pickupable, stackable, rotatable, hangable, hook_east, hook_south, has_elevation, ignore_look, 
-			floor_change, has_light, slot_head, slot_necklace, slot_backpack, slot_armor, slot_legs, 
-			slot_feet, slot_ring, slot_ammo}) {
-			if(checkbox->Get3StateValue() != wxCHK_UNCHECKED) {
-				has_selected = true;
-				break;
+		// Same order as ItemSearchIndex::Property
+		wxCheckBox* property_boxes[ItemSearchIndex::PROPERTY_COUNT] = { unpassable, unmovable, block_missiles, block_pathfinder,
+			readable, writeable, pickupable, stackable, rotatable, hangable, hook_east, hook_south, has_elevation, ignore_look,
+			floor_change, has_light, slot_head, slot_necklace, slot_backpack, slot_armor, slot_legs,
+			slot_feet, slot_ring, slot_ammo };
+
+		// Checked boxes are required, undetermined ones must not be there
+		uint32_t required = 0;
+		uint32_t excluded = 0;
+		for (int property = 0; property < ItemSearchIndex::PROPERTY_COUNT; ++property) {
+			wxCheckBoxState state = property_boxes[property]->Get3StateValue();
+			if (state == wxCHK_CHECKED) {
+				required |= 1 << property;
+			} else if (state == wxCHK_UNDETERMINED) {
+				excluded |= 1 << property;
 			}
 		}
 
-		if (has_selected) {
-			for (int id = 100; id <= g_items.getMaxID(); ++id) {
-				ItemType& item = g_items.getItemType(id);
-				if (item.id == 0) continue;
-
-				RAWBrush* raw_brush = item.raw_brush;
-				if (!raw_brush) continue;
-
-				// Check each property considering all three states
-				if ((unpassable->Get3StateValue() == wxCHK_CHECKED && !item.unpassable) ||
-					(unpassable->Get3StateValue() == wxCHK_UNDETERMINED && item.unpassable) ||
-					(unmovable->Get3StateValue() == wxCHK_CHECKED && item.moveable) ||
-					(unmovable->Get3StateValue() == wxCHK_UNDETERMINED && !item.moveable) ||
-					(block_missiles->Get3StateValue() == wxCHK_CHECKED && !item.blockMissiles) ||
-					(block_missiles->Get3StateValue() == wxCHK_UNDETERMINED && item.blockMissiles) ||
-					(block_pathfinder->Get3StateValue() == wxCHK_CHECKED && !item.blockPathfinder) ||
-					(block_pathfinder->Get3StateValue() == wxCHK_UNDETERMINED && item.blockPathfinder) ||
-					(readable->Get3StateValue() == wxCHK_CHECKED && !item.canReadText) ||
-					(readable->Get3StateValue() == wxCHK_UNDETERMINED && item.canReadText) ||
-					(writeable->Get3StateValue() == wxCHK_CHECKED && !item.canWriteText) ||
-					(writeable->Get3StateValue() == wxCHK_UNDETERMINED && item.canWriteText) ||
-					(pickupable->Get3StateValue() == wxCHK_CHECKED && !item.pickupable) ||
-					(pickupable->Get3StateValue() == wxCHK_UNDETERMINED && item.pickupable) ||
-					(stackable->Get3StateValue() == wxCHK_CHECKED && !item.stackable) ||
-					(stackable->Get3StateValue() == wxCHK_UNDETERMINED && item.stackable) ||
-					(rotatable->Get3StateValue() == wxCHK_CHECKED && !item.rotable) ||
-					(rotatable->Get3StateValue() == wxCHK_UNDETERMINED && item.rotable) ||
-					(hangable->Get3StateValue() == wxCHK_CHECKED && !item.isHangable) ||
-					(hangable->Get3StateValue() == wxCHK_UNDETERMINED && item.isHangable) ||
-					(hook_east->Get3StateValue() == wxCHK_CHECKED && !item.hookEast) ||
-					(hook_east->Get3StateValue() == wxCHK_UNDETERMINED && item.hookEast) ||
-					(hook_south->Get3StateValue() == wxCHK_CHECKED && !item.hookSouth) ||
-					(hook_south->Get3StateValue() == wxCHK_UNDETERMINED && item.hookSouth) ||
-					(has_elevation->Get3StateValue() == wxCHK_CHECKED && !item.hasElevation) ||
-					(has_elevation->Get3StateValue() == wxCHK_UNDETERMINED && item.hasElevation) ||
-					(ignore_look->Get3StateValue() == wxCHK_CHECKED && !item.ignoreLook) ||
-					(ignore_look->Get3StateValue() == wxCHK_UNDETERMINED && item.ignoreLook) ||
-					(floor_change->Get3StateValue() == wxCHK_CHECKED && !item.floorChangeDown && !item.floorChangeNorth && !item.floorChangeSouth && !item.floorChangeEast && !item.floorChangeWest) ||
-					(floor_change->Get3StateValue() == wxCHK_UNDETERMINED && (item.floorChangeDown || item.floorChangeNorth || item.floorChangeSouth || item.floorChangeEast || item.floorChangeWest)) ||
-					(has_light->Get3StateValue() == wxCHK_CHECKED && !item.sprite->hasLight()) ||
-					(has_light->Get3StateValue() == wxCHK_UNDETERMINED && item.sprite->hasLight()) ||
-					(slot_head->Get3StateValue() == wxCHK_CHECKED && !(item.slot_position & SLOTP_HEAD)) ||
-					(slot_head->Get3StateValue() == wxCHK_UNDETERMINED && (item.slot_position & SLOTP_HEAD)) ||
-					(slot_necklace->Get3StateValue() == wxCHK_CHECKED && !(item.slot_position & SLOTP_NECKLACE)) ||
-					(slot_necklace->Get3StateValue() == wxCHK_UNDETERMINED && (item.slot_position & SLOTP_NECKLACE)) ||
-					(slot_backpack->Get3StateValue() == wxCHK_CHECKED && !(item.slot_position & SLOTP_BACKPACK)) ||
-					(slot_backpack->Get3StateValue() == wxCHK_UNDETERMINED && (item.slot_position & SLOTP_BACKPACK)) ||
-					(slot_armor->Get3StateValue() == wxCHK_CHECKED && !(item.slot_position & SLOTP_ARMOR)) ||
-					(slot_armor->Get3StateValue() == wxCHK_UNDETERMINED && (item.slot_position & SLOTP_ARMOR)) ||
-					(slot_legs->Get3StateValue() == wxCHK_CHECKED && !(item.slot_position & SLOTP_LEGS)) ||
-					(slot_legs->Get3StateValue() == wxCHK_UNDETERMINED && (item.slot_position & SLOTP_LEGS)) ||
-					(slot_feet->Get3StateValue() == wxCHK_CHECKED && !(item.slot_position & SLOTP_FEET)) ||
-					(slot_feet->Get3StateValue() == wxCHK_UNDETERMINED && (item.slot_position & SLOTP_FEET)) ||
-					(slot_ring->Get3StateValue() == wxCHK_CHECKED && !(item.slot_position & SLOTP_RING)) ||
-					(slot_ring->Get3StateValue() == wxCHK_UNDETERMINED && (item.slot_position & SLOTP_RING)) ||
-					(slot_ammo->Get3StateValue() == wxCHK_CHECKED && !(item.slot_position & SLOTP_AMMO)) ||
-					(slot_ammo->Get3StateValue() == wxCHK_UNDETERMINED && (item.slot_position & SLOTP_AMMO))) {
-					continue;
-				}
-
-				found_search_results = true;
-				items_list->AddBrush(raw_brush);
-			}
+		// Only the pickupable box limits a property search, as it always did
+		if (required || excluded) {
+			index.findProperties(required, excluded, false, results);
 		}
 	}
 
+	for (uint16_t id : results) {
+		found_search_results = true;
+		items_list->AddBrush(g_items.getItemType(id).raw_brush);
+	}
+
 	if (found_search_results) {
 		items_list->SetSelection(0);
 		ok_button->Enable(true);
@@ -1018,18 +775,6 @@ std::vector<std::pair<uint16_t, uint16_t>> FindItemDialog::ParseRangeString(cons
     return ranges;
 }
 
-bool FindItemDialog::IsInRanges(uint16_t id, const std::vector<std::pair<uint16_t, uint16_t>>& ranges) {
-    for(const auto& range : ranges) {
-        if(id >= range.first && id <= range.second) {
-            OutputDebugStringA(wxString::Format("ID %d is in range %d-%d\n", 
-                id, range.first, range.second).c_str());
-            return true;
-        }
-    }
-    OutputDebugStringA(wxString::Format("ID %d is not in any range\n", id).c_str());
-    return false;
-}
-
 void FindItemDialog::OnPropertyRightClick(wxMouseEvent& event) {
     wxCheckBox* checkbox = dynamic_cast<wxCheckBox*>(event.GetEventObject());
     if (!checkbox) return;
@@ -152,9 +152,6 @@ protected:
 
 	wxTextCtrl* range_input;
 
-	bool IsInRanges(uint16_t id, const std::vector<std::pair<uint16_t, uint16_t>>& ranges);
-
-
 
 	DECLARE_EVENT_TABLE()
 };
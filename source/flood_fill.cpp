@@ -0,0 +1,248 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "flood_fill.h"
+#include "basemap.h"
+
+FloodFill::FloodFill(BaseMap& map, int floor, const Predicate& fillable) :
+	map(map),
+	floor(floor),
+	fillable(fillable),
+	emptyFillable(fillable(nullptr)),
+	diagonal(false),
+	leaked(false),
+	min_x(0),
+	min_y(0),
+	max_x(0xFFFF),
+	max_y(0xFFFF),
+	cachedBlock(nullptr),
+	cachedBlockKey(0),
+	cachedFloor(nullptr),
+	cachedLeafX(-1),
+	cachedLeafY(-1) {
+	////
+}
+
+void FloodFill::setBounds(int min_x, int min_y, int max_x, int max_y) {
+	this->min_x = std::max(min_x, 0);
+	this->min_y = std::max(min_y, 0);
+	this->max_x = std::min(max_x, 0xFFFF);
+	this->max_y = std::min(max_y, 0xFFFF);
+}
+
+bool FloodFill::run(const Position& start) {
+	positions.clear();
+	blocks.clear();
+	uniformLeaves.clear();
+	cachedBlock = nullptr;
+	leaked = false;
+
+	std::vector<std::pair<int, int>> stack;
+	stack.emplace_back(start.x, start.y);
+	while (!stack.empty() && !leaked) {
+		int x = stack.back().first;
+		int y = stack.back().second;
+		stack.pop_back();
+		if (!test(x, y)) {
+			continue;
+		}
+		if (isUniform(x, y)) {
+			fillLeaf(x, y, stack);
+			continue;
+		}
+
+		// Runs stop at uniform leaves, those are queued to be filled whole
+		int left = x;
+		while (!isUniform(left - 1, y) && test(left - 1, y)) {
+			--left;
+		}
+		if (test(left - 1, y)) {
+			stack.emplace_back(left - 1, y);
+		}
+		int right = x;
+		while (!isUniform(right + 1, y) && test(right + 1, y)) {
+			++right;
+		}
+		if (test(right + 1, y)) {
+			stack.emplace_back(right + 1, y);
+		}
+
+		for (int i = left; i <= right; ++i) {
+			mark(i, y);
+			positions.emplace_back(i, y, floor);
+		}
+
+		// Queue one seed for every run of fillable tiles above and below
+		int from = diagonal ? left - 1 : left;
+		int to = diagonal ? right + 1 : right;
+		for (int row : { y - 1, y + 1 }) {
+			bool inRun = false;
+			for (int i = from; i <= to; ++i) {
+				if (test(i, row)) {
+					if (!inRun) {
+						stack.emplace_back(i, row);
+						inRun = true;
+					}
+				} else {
+					inRun = false;
+				}
+			}
+		}
+	}
+	return !leaked;
+}
+
+bool FloodFill::isFilled(int x, int y) const {
+	if (x < 0 || y < 0 || x > 0xFFFF || y > 0xFFFF) {
+		return false;
+	}
+	auto it = blocks.find(getBlockKey(x, y));
+	return it != blocks.end() && (it->second[y & 63] >> (x & 63) & 1) != 0;
+}
+
+PositionVector FloodFill::getEdgePositions() const {
+	PositionVector edges;
+	for (const Position& position : positions) {
+		bool edge = false;
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if ((dx != 0 || dy != 0) && !isFilled(position.x + dx, position.y + dy)) {
+					edges.emplace_back(position.x + dx, position.y + dy, floor);
+					edge = true;
+				}
+			}
+		}
+		if (edge) {
+			edges.push_back(position);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	return edges;
+}
+
+bool FloodFill::test(int x, int y) {
+	if (x < min_x || x > max_x || y < min_y || y > max_y) {
+		if (x >= 0 && y >= 0 && x <= 0xFFFF && y <= 0xFFFF) {
+			const Tile* tile = lookup(x, y);
+			if (tile ? fillable(tile) : emptyFillable) {
+				leaked = true;
+			}
+		}
+		return false;
+	}
+
+	uint32_t key = getBlockKey(x, y);
+	if (!cachedBlock || cachedBlockKey != key) {
+		auto it = blocks.find(key);
+		cachedBlock = it != blocks.end() ? &it->second : nullptr;
+		cachedBlockKey = key;
+	}
+	if (cachedBlock && ((*cachedBlock)[y & 63] >> (x & 63) & 1) != 0) {
+		return false;
+	}
+
+	const Tile* tile = lookup(x, y);
+	return tile ? fillable(tile) : emptyFillable;
+}
+
+FloodFill::Block& FloodFill::getBlock(int x, int y) {
+	uint32_t key = getBlockKey(x, y);
+	if (!cachedBlock || cachedBlockKey != key) {
+		auto result = blocks.emplace(key, Block());
+		if (result.second) {
+			result.first->second.fill(0);
+		}
+		cachedBlock = &result.first->second;
+		cachedBlockKey = key;
+	}
+	return *cachedBlock;
+}
+
+void FloodFill::mark(int x, int y) {
+	getBlock(x, y)[y & 63] |= uint64_t(1) << (x & 63);
+}
+
+const Tile* FloodFill::lookup(int x, int y) {
+	if ((x >> 2) != cachedLeafX || (y >> 2) != cachedLeafY) {
+		cachedLeafX = x >> 2;
+		cachedLeafY = y >> 2;
+		QTreeNode* leaf = map.getLeaf(x, y);
+		cachedFloor = leaf ? leaf->getFloor(floor) : nullptr;
+	}
+	// Leaves without this floor are uniformly empty
+	if (!cachedFloor) {
+		return nullptr;
+	}
+	return cachedFloor->locs[(x & 3) * 4 + (y & 3)].get();
+}
+
+bool FloodFill::isUniform(int x, int y) {
+	const int leaf_x = x & ~3;
+	const int leaf_y = y & ~3;
+	if (leaf_x < min_x || leaf_x + 3 > max_x || leaf_y < min_y || leaf_y + 3 > max_y) {
+		return false;
+	}
+
+	const uint32_t key = (uint32_t(leaf_x) >> 2) | ((uint32_t(leaf_y) >> 2) << 14);
+	auto it = uniformLeaves.find(key);
+	if (it != uniformLeaves.end()) {
+		return it->second;
+	}
+
+	bool uniform = true;
+	for (int i = 0; uniform && i < 16; ++i) {
+		const Tile* tile = lookup(leaf_x + (i >> 2), leaf_y + (i & 3));
+		uniform = tile ? fillable(tile) : emptyFillable;
+	}
+	uniformLeaves.emplace(key, uniform);
+	return uniform;
+}
+
+void FloodFill::fillLeaf(int x, int y, std::vector<std::pair<int, int>>& stack) {
+	const int leaf_x = x & ~3;
+	const int leaf_y = y & ~3;
+
+	// A leaf never straddles two blocks, each of its rows is four bits of a word
+	Block& block = getBlock(leaf_x, leaf_y);
+	const uint64_t mask = uint64_t(0xF) << (leaf_x & 63);
+	for (int row = leaf_y; row < leaf_y + 4; ++row) {
+		uint64_t& word = block[row & 63];
+		const uint64_t added = mask & ~word;
+		word |= mask;
+		for (int column = 0; column < 4; ++column) {
+			if (added >> ((leaf_x & 63) + column) & 1) {
+				positions.emplace_back(leaf_x + column, row, floor);
+			}
+		}
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		stack.emplace_back(leaf_x - 1, leaf_y + i);
+		stack.emplace_back(leaf_x + 4, leaf_y + i);
+		stack.emplace_back(leaf_x + i, leaf_y - 1);
+		stack.emplace_back(leaf_x + i, leaf_y + 4);
+	}
+	if (diagonal) {
+		stack.emplace_back(leaf_x - 1, leaf_y - 1);
+		stack.emplace_back(leaf_x + 4, leaf_y - 1);
+		stack.emplace_back(leaf_x - 1, leaf_y + 4);
+		stack.emplace_back(leaf_x + 4, leaf_y + 4);
+	}
+}
@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_FLOOD_FILL_H_
+#define RME_FLOOD_FILL_H_
+
+#include "position.h"
+
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class BaseMap;
+class Floor;
+class Tile;
+
+// Scanline flood fill over one floor. Filled tiles are kept in a sparse
+// bitmap of 64x64 blocks and tiles are read through a cached leaf, so tiles
+// in leaves that hold nothing on the floor never reach the predicate. A 4x4
+// leaf that is fillable as a whole is filled at once instead of row by row.
+class FloodFill {
+public:
+	// Called with nullptr for positions without a tile
+	typedef std::function<bool(const Tile*)> Predicate;
+
+	FloodFill(BaseMap& map, int floor, const Predicate& fillable);
+
+	// Also spread to diagonal neighbours
+	void setDiagonal(bool value) {
+		diagonal = value;
+	}
+	// Reaching a fillable tile outside the bounds stops the fill as leaked
+	void setBounds(int min_x, int min_y, int max_x, int max_y);
+
+	// Returns false if the fill leaked out of the bounds
+	bool run(const Position& start);
+
+	bool isFilled(int x, int y) const;
+	const PositionVector& getPositions() const {
+		return positions;
+	}
+	// Filled tiles next to unfilled ones, together with those neighbours
+	PositionVector getEdgePositions() const;
+
+protected:
+	typedef std::array<uint64_t, 64> Block; // One word per row
+
+	bool test(int x, int y);
+	Block& getBlock(int x, int y);
+	void mark(int x, int y);
+	const Tile* lookup(int x, int y);
+	// Whether the leaf holding x,y is inside the bounds and every tile of it
+	// is fillable, worked out once per leaf
+	bool isUniform(int x, int y);
+	// Fills the rest of a uniform leaf and queues the tiles around it
+	void fillLeaf(int x, int y, std::vector<std::pair<int, int>>& stack);
+
+	static uint32_t getBlockKey(int x, int y) {
+		return (uint32_t(x) >> 6) | ((uint32_t(y) >> 6) << 10);
+	}
+
+	BaseMap& map;
+	int floor;
+	Predicate fillable;
+	bool emptyFillable;
+	bool diagonal;
+	bool leaked;
+
+	int min_x, min_y, max_x, max_y;
+
+	std::unordered_map<uint32_t, Block> blocks;
+	Block* cachedBlock;
+	uint32_t cachedBlockKey;
+
+	Floor* cachedFloor;
+	int cachedLeafX, cachedLeafY;
+
+	std::unordered_map<uint32_t, bool> uniformLeaves;
+
+	PositionVector positions;
+};
+
+#endif
@@ -0,0 +1,416 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "floor_overlay_drawer.h"
+#include "map_drawer.h"
+#include "basemap.h"
+#include "tile.h"
+#include "item.h"
+#include "items.h"
+#include "sprites.h"
+#include "gui.h"
+#include "render_profiler.h"
+
+namespace {
+	const int OVERLAY_SECTOR_BITS = 4;
+	const int OVERLAY_SECTOR_SIZE = 1 << OVERLAY_SECTOR_BITS;
+	// Room above and left of a sector for large sprites and elevation
+	const int OVERLAY_APRON = 2;
+	const int OVERLAY_PIXELS = (OVERLAY_SECTOR_SIZE + OVERLAY_APRON) * TileSize;
+	// About 80 MB of textures, views needing more are drawn tile by tile
+	const size_t OVERLAY_MAX_SECTORS = 64;
+	const int OVERLAY_ALPHA = 96;
+
+	uint64_t getSectorKey(int sector_x, int sector_y) {
+		return (uint64_t(sector_y) << 32) | uint64_t(sector_x);
+	}
+
+	// Drawn as a square by MapDrawer::BlitItem when showing tech items
+	bool isTechSquare(const ItemType& type) {
+		switch (type.clientID) {
+			case 469:
+			case 470:
+			case 17970:
+			case 20028:
+			case 34168:
+			case 2187:
+				return true;
+			default:
+				return type.id == 0;
+		}
+	}
+
+	// Drawn as a light source by MapDrawer::BlitItem when showing tech items
+	bool isPrimalLight(const ItemType& type) {
+		return (type.clientID >= 39092 && type.clientID <= 39100) || type.clientID == 39236 || type.clientID == 39367 || type.clientID == 39368;
+	}
+
+	// How far MapDrawer::BlitItem raises the items above this one
+	int getElevation(const ItemType& type, const DrawingOptions& options) {
+		GameSprite* sprite = type.sprite;
+		if (!options.ingame && options.show_tech_items) {
+			if (isTechSquare(type)) {
+				return 0;
+			}
+			if (isPrimalLight(type)) {
+				sprite = g_items[SPRITE_LIGHTSOURCE].sprite;
+			}
+		}
+		if (type.isMetaItem() || !sprite || (type.pickupable && !options.show_items)) {
+			return 0;
+		}
+		return sprite->getDrawHeight();
+	}
+
+	// Porter-Duff over, the buffer holds straight (not premultiplied) alpha
+	// so the texture blends like the sprites it replaces
+	void blendSprite(std::vector<uint8_t>& buffer, int x, int y, const uint8_t* rgba, int red, int green, int blue, int alpha) {
+		for (int sy = 0; sy < SPRITE_PIXELS; ++sy) {
+			const int ty = y + sy;
+			if (ty < 0 || ty >= OVERLAY_PIXELS) {
+				continue;
+			}
+			for (int sx = 0; sx < SPRITE_PIXELS; ++sx) {
+				const int tx = x + sx;
+				if (tx < 0 || tx >= OVERLAY_PIXELS) {
+					continue;
+				}
+
+				const uint8_t* source = rgba + (sy * SPRITE_PIXELS + sx) * 4;
+				const int source_alpha = source[3] * alpha / 255;
+				if (source_alpha == 0) {
+					continue;
+				}
+
+				uint8_t* target = &buffer[(ty * OVERLAY_PIXELS + tx) * 4];
+				const int below = target[3] * (255 - source_alpha) / 255;
+				const int result = source_alpha + below;
+				target[0] = (source[0] * red / 255 * source_alpha + target[0] * below) / result;
+				target[1] = (source[1] * green / 255 * source_alpha + target[1] * below) / result;
+				target[2] = (source[2] * blue / 255 * source_alpha + target[2] * below) / result;
+				target[3] = result;
+			}
+		}
+	}
+}
+
+FloorOverlayDrawer::FloorOverlayDrawer() :
+	settings(0),
+	frame(0) {
+	////
+}
+
+FloorOverlayDrawer::~FloorOverlayDrawer() {
+	clear();
+}
+
+void FloorOverlayDrawer::clear() {
+	for (auto& sector : sectors) {
+		release(sector.second);
+	}
+	sectors.clear();
+}
+
+void FloorOverlayDrawer::release(Sector& sector) {
+	if (sector.texture != 0) {
+		glDeleteTextures(1, &sector.texture);
+		sector.texture = 0;
+	}
+}
+
+uint32_t FloorOverlayDrawer::getSettings(const DrawingOptions& options, bool show_items) const {
+	// Everything compose() reads from the options
+	return (options.ingame ? 1 : 0) | (options.show_items ? 2 : 0) | (options.show_tech_items ? 4 : 0) | (options.transparent_items ? 8 : 0) | (options.highlight_locked_doors ? 16 : 0) | (options.show_hooks ? 32 : 0) | (options.show_light_str ? 64 : 0) | (show_items ? 128 : 0);
+}
+
+bool FloorOverlayDrawer::isOutdated(BaseMap& map, int sector_x, int sector_y, int z, const Sector& sector) const {
+	if (map.getTouchAllRevision() > sector.revision) {
+		return true;
+	}
+
+	const int base_x = sector_x << OVERLAY_SECTOR_BITS;
+	const int base_y = sector_y << OVERLAY_SECTOR_BITS;
+	for (int leaf_x = base_x; leaf_x < base_x + OVERLAY_SECTOR_SIZE; leaf_x += 4) {
+		for (int leaf_y = base_y; leaf_y < base_y + OVERLAY_SECTOR_SIZE; leaf_y += 4) {
+			QTreeNode* leaf = map.getLeaf(leaf_x, leaf_y);
+			Floor* floor = leaf ? leaf->getFloor(z) : nullptr;
+			if (floor && floor->revision > sector.revision) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void FloorOverlayDrawer::compose(BaseMap& map, int sector_x, int sector_y, int z, const DrawingOptions& options, bool show_items, Sector& sector) {
+	sector.composed = true;
+	sector.revision = map.getRevision();
+	sector.empty = true;
+	sector.loose.clear();
+
+	const int base_x = sector_x << OVERLAY_SECTOR_BITS;
+	const int base_y = sector_y << OVERLAY_SECTOR_BITS;
+
+	std::vector<Tile*> tiles;
+	for (int map_x = base_x; map_x < base_x + OVERLAY_SECTOR_SIZE; ++map_x) {
+		for (int map_y = base_y; map_y < base_y + OVERLAY_SECTOR_SIZE; ++map_y) {
+			Tile* tile = map.getTile(map_x, map_y, z);
+			if (tile) {
+				tiles.push_back(tile);
+			}
+		}
+	}
+	if (tiles.empty()) {
+		release(sector);
+		return;
+	}
+
+	buffer.assign(OVERLAY_PIXELS * OVERLAY_PIXELS * 4, 0);
+	bool painted = false;
+
+	// Sprites are decoded once per sector, grounds repeat a lot
+	std::map<std::pair<GameSprite*, uint32_t>, std::unique_ptr<uint8_t[]>> decoded;
+	auto getPixels = [&decoded](GameSprite* sprite, uint32_t index) -> const uint8_t* {
+		auto it = decoded.find(std::make_pair(sprite, index));
+		if (it == decoded.end()) {
+			it = decoded.emplace(std::make_pair(sprite, index), std::unique_ptr<uint8_t[]>(sprite->getRGBAData(index))).first;
+		}
+		return it->second.get();
+	};
+
+	for (Tile* tile : tiles) {
+		const Position& position = tile->getPosition();
+		const int tile_x = (position.x - base_x + OVERLAY_APRON) * TileSize;
+		const int tile_y = (position.y - base_y + OVERLAY_APRON) * TileSize;
+		int elevation = 0;
+
+		// Same steps as MapDrawer::BlitItem, items it would treat specially are
+		// handed back to the caller
+		auto addItem = [&](Item* item, int index, int red, int green, int blue) {
+			const ItemType& type = g_items[item->getID()];
+			GameSprite* sprite = type.sprite;
+			int alpha = OVERLAY_ALPHA;
+
+			if (!options.ingame && options.highlight_locked_doors && type.isDoor() && type.isLocked) {
+				blue /= 2;
+				green /= 2;
+			}
+
+			bool loose = sprite && sprite->animator;
+			if (!options.ingame) {
+				loose = loose || item->isSelected() || type.isPodium();
+				loose = loose || (options.show_tech_items && (isTechSquare(type) || isPrimalLight(type)));
+				loose = loose || (options.show_hooks && (type.hookSouth || type.hookEast));
+				loose = loose || (options.show_light_str && item->getLight().intensity > 0);
+			}
+
+			if (!loose) {
+				if (type.isMetaItem() || !sprite || (type.pickupable && !options.show_items)) {
+					return;
+				}
+
+				int subtype = -1;
+				int pattern_x = position.x % sprite->pattern_x;
+				int pattern_y = position.y % sprite->pattern_y;
+				int pattern_z = position.z % sprite->pattern_z;
+				if (type.isSplash() || type.isFluidContainer()) {
+					subtype = item->getSubtype();
+				} else if (type.isHangable) {
+					if (tile->hasProperty(HOOK_SOUTH)) {
+						pattern_x = 1;
+					} else if (tile->hasProperty(HOOK_EAST)) {
+						pattern_x = 2;
+					} else {
+						pattern_x = 0;
+					}
+				} else if (type.stackable) {
+					const int count = item->getSubtype();
+					subtype = count <= 1 ? 0 : count <= 2 ? 1 : count <= 3 ? 2 : count <= 4 ? 3 : count < 10 ? 4 : count < 25 ? 5 : count < 50 ? 6 : 7;
+				}
+
+				if (options.transparent_items && (!type.isGroundTile() || sprite->width > 1 || sprite->height > 1) && !type.isSplash() && (!type.isBorder || sprite->width > 1 || sprite->height > 1)) {
+					alpha /= 2;
+				}
+
+				std::vector<const uint8_t*> parts;
+				const int frame = item->getFrame();
+				for (int cx = 0; cx != sprite->width; ++cx) {
+					for (int cy = 0; cy != sprite->height; ++cy) {
+						for (int cf = 0; cf != sprite->layers; ++cf) {
+							parts.push_back(getPixels(sprite, sprite->getSpriteIndex(cx, cy, cf, subtype, pattern_x, pattern_y, pattern_z, frame)));
+						}
+					}
+				}
+
+				// Sprites that can't be read here are still drawn the usual way
+				if (std::find(parts.begin(), parts.end(), nullptr) == parts.end()) {
+					const int screen_x = tile_x - elevation - sprite->getDrawOffset().first;
+					const int screen_y = tile_y - elevation - sprite->getDrawOffset().second;
+					size_t part = 0;
+					for (int cx = 0; cx != sprite->width; ++cx) {
+						for (int cy = 0; cy != sprite->height; ++cy) {
+							for (int cf = 0; cf != sprite->layers; ++cf) {
+								blendSprite(buffer, screen_x - cx * TileSize, screen_y - cy * TileSize, parts[part++], red, green, blue, alpha);
+							}
+						}
+					}
+					painted = true;
+					elevation += sprite->getDrawHeight();
+					return;
+				}
+			}
+
+			sector.loose.push_back({ position, index, item->getID(), elevation, uint8_t(red), uint8_t(green), uint8_t(blue) });
+			elevation += getElevation(type, options);
+		};
+
+		if (tile->ground) {
+			if (tile->isPZ()) {
+				addItem(tile->ground, -1, 128, 255, 128);
+			} else {
+				addItem(tile->ground, -1, 255, 255, 255);
+			}
+		}
+		if (show_items) {
+			for (size_t index = 0; index < tile->items.size(); ++index) {
+				addItem(tile->items[index], int(index), 255, 255, 255);
+			}
+		}
+	}
+
+	sector.empty = !painted && sector.loose.empty();
+	if (!painted) {
+		release(sector);
+		return;
+	}
+
+	if (sector.texture == 0) {
+		sector.texture = g_gui.gfx.getFreeTextureID();
+	}
+
+	glBindTexture(GL_TEXTURE_2D, sector.texture);
+	g_render_profiler.count(RENDER_COUNTER_TEXTURE_BINDS);
+	g_render_profiler.count(RENDER_COUNTER_TEXTURE_UPLOADS);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, OVERLAY_PIXELS, OVERLAY_PIXELS, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+}
+
+bool FloorOverlayDrawer::resolve(BaseMap& map, const Sector& sector, std::vector<LooseItem>& loose) const {
+	const size_t size = loose.size();
+	for (const PlacedItem& placed : sector.loose) {
+		Tile* tile = map.getTile(placed.position);
+		Item* item = nullptr;
+		if (tile) {
+			if (placed.index < 0) {
+				item = tile->ground;
+			} else if (size_t(placed.index) < tile->items.size()) {
+				item = tile->items[placed.index];
+			}
+		}
+		if (!item || item->getID() != placed.id) {
+			loose.resize(size);
+			return false;
+		}
+		loose.push_back({ tile, item, placed.offset, placed.red, placed.green, placed.blue });
+	}
+	return true;
+}
+
+bool FloorOverlayDrawer::draw(BaseMap& map, int start_x, int start_y, int end_x, int end_y, int z, int origin_x, int origin_y, const DrawingOptions& options, bool show_items, const std::function<void(const LooseItem&)>& draw_loose) {
+	const int first_x = std::max(0, start_x) >> OVERLAY_SECTOR_BITS;
+	const int first_y = std::max(0, start_y) >> OVERLAY_SECTOR_BITS;
+	const int last_x = std::max(0, end_x) >> OVERLAY_SECTOR_BITS;
+	const int last_y = std::max(0, end_y) >> OVERLAY_SECTOR_BITS;
+	if (size_t(last_x - first_x + 1) * size_t(last_y - first_y + 1) > OVERLAY_MAX_SECTORS) {
+		return false;
+	}
+
+	// The sectors are kept for one floor at a time
+	const uint32_t current = getSettings(options, show_items) | (uint32_t(z) << 8);
+	if (current != settings) {
+		clear();
+		settings = current;
+	}
+
+	++frame;
+	const uint64_t revision = map.getRevision();
+	std::vector<LooseItem> loose;
+
+	for (int sector_x = first_x; sector_x <= last_x; ++sector_x) {
+		for (int sector_y = first_y; sector_y <= last_y; ++sector_y) {
+			Sector& sector = sectors[getSectorKey(sector_x, sector_y)];
+			sector.used = frame;
+			if (!sector.composed || (sector.checked != revision && isOutdated(map, sector_x, sector_y, z, sector))) {
+				compose(map, sector_x, sector_y, z, options, show_items, sector);
+			}
+			sector.checked = revision;
+
+			if (sector.empty) {
+				continue;
+			}
+			loose.clear();
+			if (!resolve(map, sector, loose)) {
+				compose(map, sector_x, sector_y, z, options, show_items, sector);
+				resolve(map, sector, loose);
+			}
+			if (sector.texture == 0) {
+				continue;
+			}
+
+			const int draw_x = ((sector_x << OVERLAY_SECTOR_BITS) - OVERLAY_APRON) * TileSize + origin_x;
+			const int draw_y = ((sector_y << OVERLAY_SECTOR_BITS) - OVERLAY_APRON) * TileSize + origin_y;
+			glBindTexture(GL_TEXTURE_2D, sector.texture);
+			g_render_profiler.count(RENDER_COUNTER_TEXTURE_BINDS);
+			glColor4ub(255, 255, 255, 255);
+			glBegin(GL_QUADS);
+			glTexCoord2f(0.f, 0.f);
+			glVertex2f(draw_x, draw_y);
+			glTexCoord2f(1.f, 0.f);
+			glVertex2f(draw_x + OVERLAY_PIXELS, draw_y);
+			glTexCoord2f(1.f, 1.f);
+			glVertex2f(draw_x + OVERLAY_PIXELS, draw_y + OVERLAY_PIXELS);
+			glTexCoord2f(0.f, 1.f);
+			glVertex2f(draw_x, draw_y + OVERLAY_PIXELS);
+			glEnd();
+
+			for (const LooseItem& entry : loose) {
+				draw_loose(entry);
+			}
+		}
+	}
+
+	// Drop the sectors that have been out of view the longest
+	while (sectors.size() > OVERLAY_MAX_SECTORS) {
+		auto oldest = sectors.end();
+		for (auto it = sectors.begin(); it != sectors.end(); ++it) {
+			if (it->second.used != frame && (oldest == sectors.end() || it->second.used < oldest->second.used)) {
+				oldest = it;
+			}
+		}
+		if (oldest == sectors.end()) {
+			break;
+		}
+		release(oldest->second);
+		sectors.erase(oldest);
+	}
+	return true;
+}
@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_FLOOR_OVERLAY_DRAWER_H_
+#define RME_FLOOR_OVERLAY_DRAWER_H_
+
+#include "graphics.h"
+#include "position.h"
+
+#include <functional>
+#include <unordered_map>
+
+class BaseMap;
+class Tile;
+class Item;
+struct DrawingOptions;
+
+// Draws the transparent floor above the current one. Like the light map the
+// floor is composed on the CPU, one texture per 16x16 sector, and a sector
+// is only composed again after one of its tiles changed. Items a texture
+// can't hold (animations, podiums, indicators) are left to the caller.
+class FloorOverlayDrawer {
+public:
+	// Only valid until the map changes, they are looked up every frame
+	struct LooseItem {
+		Tile* tile;
+		Item* item;
+		int offset; // elevation of the items below it
+		uint8_t red, green, blue;
+	};
+
+	FloorOverlayDrawer();
+	~FloorOverlayDrawer();
+
+	// Draws floor z of the area, tile x,y goes to x * TileSize + origin_x.
+	// The loose items of a sector are passed to draw_loose right after its
+	// texture, before the next sector. Only large sprites of later tiles in
+	// the same sector end up below them. Returns false when the area needs
+	// more sectors than are kept, the caller draws the floor tile by tile.
+	bool draw(BaseMap& map, int start_x, int start_y, int end_x, int end_y, int z, int origin_x, int origin_y, const DrawingOptions& options, bool show_items, const std::function<void(const LooseItem&)>& draw_loose);
+	void clear();
+
+private:
+	// A loose item as kept between frames. Tiles and items can be deleted in
+	// place without the sector noticing, so only where it was is kept.
+	struct PlacedItem {
+		Position position;
+		int index; // stack position, -1 for the ground
+		uint16_t id;
+		int offset;
+		uint8_t red, green, blue;
+	};
+
+	struct Sector {
+		Sector() :
+			texture(0), revision(0), checked(0), used(0), composed(false), empty(true) { }
+		GLuint texture;
+		uint64_t revision; // map revision the texture was composed at
+		uint64_t checked; // map revision the floors were last compared to
+		uint64_t used; // frame it was last drawn in
+		bool composed;
+		bool empty;
+		std::vector<PlacedItem> loose;
+	};
+
+	// Appends the loose items of the sector, false when one of them is no
+	// longer where it was and the sector has to be composed again
+	bool resolve(BaseMap& map, const Sector& sector, std::vector<LooseItem>& loose) const;
+	bool isOutdated(BaseMap& map, int sector_x, int sector_y, int z, const Sector& sector) const;
+	void compose(BaseMap& map, int sector_x, int sector_y, int z, const DrawingOptions& options, bool show_items, Sector& sector);
+	void release(Sector& sector);
+	uint32_t getSettings(const DrawingOptions& options, bool show_items) const;
+
+	std::unordered_map<uint64_t, Sector> sectors;
+	std::vector<uint8_t> buffer;
+	uint32_t settings;
+	uint64_t frame;
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include "settings.h"
 #include "gui.h"
 #include "otml.h"
+#include "render_profiler.h"
 
 #include <wx/mstream.h>
 #include <wx/stopwatch.h>
@@ -42,6 +43,11 @@
 #include "../brushes/door_archway.xpm"
 #include "../brushes/door_archway_small.xpm"
 
+// Every game sprite is uploaded as one 32x32 RGBA texture
+static const uint64_t TEXTURE_BYTES = SPRITE_PIXELS * SPRITE_PIXELS * 4;
+// Upper bound on the textures freed by one garbage collection pass
+static const int TEXTURE_EVICTIONS_PER_FRAME = 64;
+
 // All 133 template colors
 static uint32_t TemplateOutfitLookupTable[] = {
 	0xFFFFFF,
@@ -189,7 +195,13 @@ GraphicManager::GraphicManager() :
 	has_frame_durations(false),
 	has_frame_groups(false),
 	loaded_textures(0),
-	lastclean(0) {
+	resident_head(nullptr),
+	resident_tail(nullptr),
+	texture_memory(0),
+	texture_hits(0),
+	texture_misses(0),
+	texture_uploads(0),
+	texture_evictions(0) {
 	animation_timer = newd wxStopWatch();
 	animation_timer->Start();
 }
@@ -240,7 +252,9 @@ void GraphicManager::clear() {
 	item_count = 0;
 	creature_count = 0;
 	loaded_textures = 0;
-	lastclean = time(nullptr);
+	resident_head = nullptr;
+	resident_tail = nullptr;
+	texture_memory = 0;
 	spritefile = "";
 
 	unloaded = true;
@@ -938,25 +952,69 @@ void GraphicManager::addSpriteToCleanup(GameSprite* spr) {
 }
 
 void GraphicManager::garbageCollection() {
-	if (g_settings.getInteger(Config::TEXTURE_MANAGEMENT)) {
-		int t = time(nullptr);
-		if (loaded_textures > g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD) && t - lastclean > g_settings.getInteger(Config::TEXTURE_CLEAN_PULSE)) {
-			ImageMap::iterator iit = image_space.begin();
-			while (iit != image_space.end()) {
-				iit->second->clean(t);
-				++iit;
-			}
-			SpriteMap::iterator sit = sprite_space.begin();
-			while (sit != sprite_space.end()) {
-				GameSprite* gs = dynamic_cast<GameSprite*>(sit->second);
-				if (gs) {
-					gs->clean(t);
-				}
-				++sit;
-			}
-			lastclean = t;
-		}
+	RenderProfileScope scope(RENDER_STAGE_GARBAGE_COLLECTION);
+	if (!g_settings.getInteger(Config::TEXTURE_MANAGEMENT)) {
+		return;
 	}
+
+	// Spread the work over frames, a lowered budget is reached after a while
+	const uint64_t budget = uint64_t(1024 * 1024) * g_settings.getInteger(Config::TEXTURE_MEMORY_BUDGET);
+	for (int evicted = 0; evicted < TEXTURE_EVICTIONS_PER_FRAME && texture_memory > budget && resident_tail; ++evicted) {
+		resident_tail->evict();
+		++texture_evictions;
+	}
+}
+
+void GraphicManager::addResidentTexture(GameSprite::Image* image) {
+	image->lru_prev = nullptr;
+	image->lru_next = resident_head;
+	if (resident_head) {
+		resident_head->lru_prev = image;
+	} else {
+		resident_tail = image;
+	}
+	resident_head = image;
+
+	loaded_textures += 1;
+	texture_memory += TEXTURE_BYTES;
+	++texture_uploads;
+}
+
+void GraphicManager::removeResidentTexture(GameSprite::Image* image) {
+	if (image->lru_prev) {
+		image->lru_prev->lru_next = image->lru_next;
+	} else {
+		resident_head = image->lru_next;
+	}
+	if (image->lru_next) {
+		image->lru_next->lru_prev = image->lru_prev;
+	} else {
+		resident_tail = image->lru_prev;
+	}
+	image->lru_prev = nullptr;
+	image->lru_next = nullptr;
+
+	loaded_textures -= 1;
+	texture_memory -= TEXTURE_BYTES;
+}
+
+void GraphicManager::touchResidentTexture(GameSprite::Image* image) {
+	if (image == resident_head) {
+		return;
+	}
+
+	// Unlink, then put it in front; it can not be the head here
+	image->lru_prev->lru_next = image->lru_next;
+	if (image->lru_next) {
+		image->lru_next->lru_prev = image->lru_prev;
+	} else {
+		resident_tail = image->lru_prev;
+	}
+
+	image->lru_prev = nullptr;
+	image->lru_next = resident_head;
+	resident_head->lru_prev = image;
+	resident_head = image;
 }
 
 EditorSprite::EditorSprite(wxBitmap* b16x16, wxBitmap* b32x32, wxBitmap* b64x64) {
@@ -1019,14 +1077,6 @@ GameSprite::~GameSprite() {
 	delete animator;
 }
 
-void GameSprite::clean(int time) {
-	for (std::list<TemplateImage*>::iterator iter = instanced_templates.begin();
-		 iter != instanced_templates.end();
-		 ++iter) {
-		(*iter)->clean(time);
-	}
-}
-
 void GameSprite::unloadDC() {
 	delete dc[SPRITE_SIZE_16x16];
 	delete dc[SPRITE_SIZE_32x32];
@@ -1051,6 +1101,10 @@ int GameSprite::getIndex(int width, int height, int layer, int pattern_x, int pa
 }
 
 GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) {
+	return spriteList[getSpriteIndex(_x, _y, _layer, _count, _pattern_x, _pattern_y, _pattern_z, _frame)]->getHardwareID();
+}
+
+uint32_t GameSprite::getSpriteIndex(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) const {
 	uint32_t v;
 	if (_count >= 0 && height <= 1 && width <= 1) {
 		v = _count;
@@ -1064,7 +1118,14 @@ GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pa
 			v %= numsprites;
 		}
 	}
-	return spriteList[v]->getHardwareID();
+	return v;
+}
+
+uint8_t* GameSprite::getRGBAData(uint32_t index) {
+	if (index >= spriteList.size()) {
+		return nullptr;
+	}
+	return spriteList[index]->getRGBAData();
 }
 
 GameSprite::TemplateImage* GameSprite::getTemplateImage(int sprite_index, const Outfit& outfit) {
@@ -1249,16 +1310,19 @@ void GameSprite::DrawOutfit(wxDC* dc, SpriteSize sz, int start_x, int start_y, c
 
 GameSprite::Image::Image() :
 	isGLLoaded(false),
-	lastaccess(0) {
+	lru_prev(nullptr),
+	lru_next(nullptr) {
 	////
 }
 
 GameSprite::Image::~Image() {
+	// Derived images unload their own texture, they know its id
 	unloadGLTexture(0);
 }
 
 void GameSprite::Image::createGLTexture(GLuint whatid) {
 	ASSERT(!isGLLoaded);
+	RenderProfileScope scope(RENDER_STAGE_TEXTURE_UPLOAD);
 
 	uint8_t* rgba = getRGBAData();
 	if (!rgba) {
@@ -1266,9 +1330,11 @@ void GameSprite::Image::createGLTexture(GLuint whatid) {
 	}
 
 	isGLLoaded = true;
-	g_gui.gfx.loaded_textures += 1;
+	g_gui.gfx.addResidentTexture(this);
 
 	glBindTexture(GL_TEXTURE_2D, whatid);
+	g_render_profiler.count(RENDER_COUNTER_TEXTURE_BINDS);
+	g_render_profiler.count(RENDER_COUNTER_TEXTURE_UPLOADS);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Linear Filtering
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Linear Filtering
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
@@ -1280,19 +1346,23 @@ void GameSprite::Image::createGLTexture(GLuint whatid) {
 }
 
 void GameSprite::Image::unloadGLTexture(GLuint whatid) {
+	if (!isGLLoaded) {
+		return;
+	}
+
 	isGLLoaded = false;
-	g_gui.gfx.loaded_textures -= 1;
+	g_gui.gfx.removeResidentTexture(this);
 	glDeleteTextures(1, &whatid);
 }
 
 void GameSprite::Image::visit() {
-	lastaccess = time(nullptr);
+	if (isGLLoaded) {
+		g_gui.gfx.touchResidentTexture(this);
+	}
 }
 
-void GameSprite::Image::clean(int time) {
-	if (isGLLoaded && time - lastaccess > g_settings.getInteger(Config::TEXTURE_LONGEVITY)) {
-		unloadGLTexture(0);
-	}
+void GameSprite::Image::evict() {
+	unloadGLTexture(0);
 }
 
 GameSprite::NormalImage::NormalImage() :
@@ -1303,12 +1373,14 @@ GameSprite::NormalImage::NormalImage() :
 }
 
 GameSprite::NormalImage::~NormalImage() {
+	unloadGLTexture();
 	delete[] dump;
 }
 
-void GameSprite::NormalImage::clean(int time) {
-	Image::clean(time);
-	if (time - lastaccess > 5 && !g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) { // We keep dumps around for 5 seconds.
+void GameSprite::NormalImage::evict() {
+	Image::evict();
+	// The dump goes with the texture unless sprites are kept in memory
+	if (!g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
 		delete[] dump;
 		dump = nullptr;
 	}
@@ -1421,9 +1493,12 @@ uint8_t* GameSprite::NormalImage::getRGBAData() {
 
 GLuint GameSprite::NormalImage::getHardwareID() {
 	if (!isGLLoaded) {
+		++g_gui.gfx.texture_misses;
 		createGLTexture(id);
+	} else {
+		++g_gui.gfx.texture_hits;
+		visit();
 	}
-	visit();
 	return id;
 }
 
@@ -1447,7 +1522,7 @@ GameSprite::TemplateImage::TemplateImage(GameSprite* parent, int v, const Outfit
 }
 
 GameSprite::TemplateImage::~TemplateImage() {
-	////
+	unloadGLTexture();
 }
 
 void GameSprite::TemplateImage::colorizePixel(uint8_t color, uint8_t& red, uint8_t& green, uint8_t& blue) {
@@ -1567,12 +1642,15 @@ GLuint GameSprite::TemplateImage::getHardwareID() {
 		if (gl_tid == 0) {
 			gl_tid = g_gui.gfx.getFreeTextureID();
 		}
+		++g_gui.gfx.texture_misses;
 		createGLTexture(gl_tid);
 		if (!isGLLoaded) {
 			return 0;
 		}
+	} else {
+		++g_gui.gfx.texture_hits;
+		visit();
 	}
-	visit();
 	return gl_tid;
 }
 
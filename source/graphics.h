@@ -84,6 +84,10 @@ public:
 	int getIndex(int width, int height, int layer, int pattern_x, int pattern_y, int pattern_z, int frame) const;
 	GLuint getHardwareID(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
 	GLuint getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame); // CreatureDatabase
+	// Index into the sprite list, takes the same arguments as getHardwareID
+	uint32_t getSpriteIndex(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) const;
+	// Decoded pixels of a sprite for drawing on the CPU, the caller deletes them
+	uint8_t* getRGBAData(uint32_t index);
 	virtual void DrawTo(wxDC* dc, SpriteSize sz, int start_x, int start_y, int width = -1, int height = -1);
 
 	// Method to draw creatures with outfit colors
@@ -91,8 +95,6 @@ public:
 
 	virtual void unloadDC();
 
-	void clean(int time);
-
 	int getDrawHeight() const;
 	std::pair<int, int> getDrawOffset() const;
 	uint8_t getMiniMapColor() const;
@@ -118,10 +120,14 @@ protected:
 		virtual ~Image();
 
 		bool isGLLoaded;
-		int lastaccess;
+
+		// Neighbours in the resident texture list, most recently drawn first
+		Image* lru_prev;
+		Image* lru_next;
 
 		void visit();
-		virtual void clean(int time);
+		// Frees the texture, called by the residency manager
+		virtual void evict();
 
 		virtual GLuint getHardwareID() = 0;
 		virtual uint8_t* getRGBData() = 0;
@@ -144,7 +150,7 @@ protected:
 		uint16_t size;
 		uint8_t* dump;
 
-		virtual void clean(int time);
+		virtual void evict();
 
 		virtual GLuint getHardwareID();
 		virtual uint8_t* getRGBData();
@@ -297,7 +303,8 @@ public:
 	bool loadSpriteMetadataFlags(FileReadHandle& file, GameSprite* sType, wxString& error, wxArrayString& warnings);
 	bool loadSpriteData(const FileName& datafile, wxString& error, wxArrayString& warnings);
 
-	// Cleans old & unused textures according to config settings
+	// Evicts the least recently drawn textures, a few per call, until the
+	// resident textures fit in the configured memory budget
 	void garbageCollection();
 	void addSpriteToCleanup(GameSprite* spr);
 
@@ -311,6 +318,26 @@ public:
 	bool hasTransparency() const;
 	bool isUnloaded() const;
 
+	// Texture residency statistics
+	int getResidentTextureCount() const {
+		return loaded_textures;
+	}
+	uint64_t getTextureMemory() const {
+		return texture_memory;
+	}
+	uint64_t getTextureHits() const {
+		return texture_hits;
+	}
+	uint64_t getTextureMisses() const {
+		return texture_misses;
+	}
+	uint64_t getTextureUploads() const {
+		return texture_uploads;
+	}
+	uint64_t getTextureEvictions() const {
+		return texture_evictions;
+	}
+
 	ClientVersion* client_version;
 
 private:
@@ -319,6 +346,10 @@ private:
 	std::string spritefile;
 	bool loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite_id);
 
+	void addResidentTexture(GameSprite::Image* image);
+	void removeResidentTexture(GameSprite::Image* image);
+	void touchResidentTexture(GameSprite::Image* image);
+
 	typedef std::map<int, Sprite*> SpriteMap;
 	SpriteMap sprite_space;
 	typedef std::map<int, GameSprite::Image*> ImageMap;
@@ -337,7 +368,16 @@ private:
 	wxFileName sprites_file;
 
 	int loaded_textures;
-	int lastclean;
+
+	// Intrusive LRU list of the textures on the GPU
+	GameSprite::Image* resident_head;
+	GameSprite::Image* resident_tail;
+	uint64_t texture_memory;
+
+	uint64_t texture_hits;
+	uint64_t texture_misses;
+	uint64_t texture_uploads;
+	uint64_t texture_evictions;
 
 	wxStopWatch* animation_timer;
 
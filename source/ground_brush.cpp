@@ -22,6 +22,8 @@
 #include "basemap.h"
 
 uint32_t GroundBrush::border_types[256];
+std::vector<const GroundBrush::BorderBlock*> GroundBrush::border_table;
+uint32_t GroundBrush::border_table_size = 0;
 
 int AutoBorder::edgeNameToID(const std::string& edgename) {
 	if (edgename == "n") {
@@ -122,6 +124,7 @@ GroundBrush::GroundBrush() :
 	optional_border(nullptr),
 	use_only_optional(false),
 	randomize(true),
+	ground_index(0),
 	total_chance(0) {
 	////
 }
@@ -599,7 +602,49 @@ void GroundBrush::draw(BaseMap* map, Tile* tile, void* parameter) {
 	tile->ground = groundItem;
 }
 
+void GroundBrush::buildBorderTable() {
+	clearBorderTable();
+
+	std::vector<GroundBrush*> grounds(1, nullptr);
+	for (const auto& brushEntry : g_brushes.getMap()) {
+		GroundBrush* ground = brushEntry.second->asGround();
+		if (ground && ground->ground_index == 0) {
+			ground->ground_index = grounds.size();
+			grounds.push_back(ground);
+		}
+	}
+
+	border_table_size = grounds.size();
+	border_table.resize(static_cast<size_t>(border_table_size) * border_table_size);
+	for (uint32_t from = 0; from < border_table_size; ++from) {
+		for (uint32_t to = 0; to < border_table_size; ++to) {
+			border_table[from * border_table_size + to] = findBrushTo(grounds[from], grounds[to]);
+		}
+	}
+}
+
+void GroundBrush::clearBorderTable() {
+	for (const auto& brushEntry : g_brushes.getMap()) {
+		GroundBrush* ground = brushEntry.second->asGround();
+		if (ground) {
+			ground->ground_index = 0;
+		}
+	}
+	border_table.clear();
+	border_table_size = 0;
+}
+
 const GroundBrush::BorderBlock* GroundBrush::getBrushTo(GroundBrush* first, GroundBrush* second) {
+	const uint32_t from = first ? first->ground_index : 0;
+	const uint32_t to = second ? second->ground_index : 0;
+	if (border_table_size != 0 && (!first || from != 0) && (!second || to != 0)) {
+		return border_table[from * border_table_size + to];
+	}
+	// Brush was added after the table was built
+	return findBrushTo(first, second);
+}
+
+const GroundBrush::BorderBlock* GroundBrush::findBrushTo(GroundBrush* first, GroundBrush* second) {
 	// printf("Border from %s to %s : ", first->getName().c_str(), second->getName().c_str());
 	if (first) {
 		if (second) {
@@ -688,16 +733,8 @@ void GroundBrush::doBorders(BaseMap* map, Tile* tile) {
 			ItemVector::iterator it = tile->items.begin();
 			while (it != tile->items.end()) {
 				if ((*it)->isBorder()) {
-					// Go through all borders in the map and check if this item matches any
-					bool found = false;
-					for (auto& borderPair : g_brushes.borders) {
-						if (borderPair.second && borderPair.second->hasItemId((*it)->getID())) {
-							found = true;
-							break;
-						}
-					}
-					
-					if (found) {
+					// Only remove items that belong to some border
+					if (g_brushes.getBorderByItem((*it)->getID())) {
 						delete *it;
 						it = tile->items.erase(it);
 					} else {
@@ -1007,7 +1044,8 @@ void GroundBrush::doBorders(BaseMap* map, Tile* tile) {
 		}
 	}
 
-	static std::vector<const BorderBlock*> specificList;
+	// Strokes are rebordered from several threads
+	thread_local std::vector<const BorderBlock*> specificList;
 	specificList.clear();
 
 	std::vector<BorderCluster> borderList;
@@ -47,6 +47,10 @@ public:
 	static const BorderBlock* getBrushTo(GroundBrush* from, GroundBrush* to);
 	static void reborderizeTile(BaseMap* map, Tile* tile);
 
+	// Precomputes getBrushTo for every pair of loaded ground brushes
+	static void buildBorderTable();
+	static void clearBorderTable();
+
 	virtual int32_t getZ() const {
 		return z_order;
 	}
@@ -82,6 +86,7 @@ protected: // Members
 	AutoBorder* optional_border;
 	bool use_only_optional; // If this is true, there will be no normal border under the gravel
 	bool randomize;
+	uint32_t ground_index; // Row in the border table, 0 if the brush was added after it was built
 
 	struct SpecificCaseBlock {
 		SpecificCaseBlock() :
@@ -123,6 +128,12 @@ protected: // Members
 	std::vector<ItemChanceBlock> border_items;
 	int total_chance;
 
+	static const BorderBlock* findBrushTo(GroundBrush* from, GroundBrush* to);
+
+	// (from, to) -> border block, index 0 stands for no ground
+	static std::vector<const BorderBlock*> border_table;
+	static uint32_t border_table_size;
+
 public: // Static global members
 	static uint32_t border_types[256];
 };
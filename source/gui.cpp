@@ -150,6 +150,7 @@
 #include "main.h"
 
 #include <wx/display.h>
+#include <wx/file.h>
 
 #include "gui.h"
 #include "main_menubar.h"
@@ -174,6 +175,8 @@
 #include "live_tab.h"
 #include "live_server.h"
 #include "dark_mode_manager.h"
+#include "load_tasks.h"
+#include "data_cache.h"
 #include <wx/regex.h>
 
 #ifdef __WXOSX__
@@ -235,6 +238,8 @@ GUI::GUI() :
 	progressFrom(0),
 	progressTo(0),
 	currentProgress(0),
+	progressCancelled(false),
+	headless(false),
 	winDisabler(nullptr),
 	disabled_counter(0),
 	last_autosave(time(nullptr)),
@@ -448,15 +453,17 @@ bool GUI::LoadVersion(ClientVersionID version, wxString& error, wxArrayString& w
 	}
 
 	if (version != loaded_version || force) {
-		if (getLoadedVersion() != nullptr) {
+		if (getLoadedVersion() != nullptr && !headless) {
 			// There is another version loaded right now, save window layout
 			g_gui.SavePerspective();
 		}
 
 		// Disable all rendering so the data is not accessed while reloading
 		UnnamedRenderingLock();
-		DestroyPalettes();
-		DestroyMinimap();
+		if (!headless) {
+			DestroyPalettes();
+			DestroyMinimap();
+		}
 
 		// Destroy the previous version
 		UnloadVersion();
@@ -472,7 +479,9 @@ bool GUI::LoadVersion(ClientVersionID version, wxString& error, wxArrayString& w
 
 		bool ret = LoadDataFiles(error, warnings);
 		if (ret) {
-			g_gui.LoadPerspective();
+			if (!headless) {
+				g_gui.LoadPerspective();
+			}
 		} else {
 			loaded_version = CLIENT_VERSION_NONE;
 		}
@@ -536,64 +545,111 @@ bool GUI::LoadDataFiles(wxString& error, wxArrayString& warnings) {
 	g_gui.CreateLoadBar("Loading asset files");
 	g_gui.SetLoadDone(0, "Loading metadata file...");
 
-	wxFileName metadata_path = g_gui.gfx.getMetadataFileName();
-	if (!g_gui.gfx.loadSpriteMetadata(metadata_path, error, warnings)) {
-		error = "Couldn't load metadata: " + error;
-		g_gui.DestroyLoadBar();
-		UnloadVersion();
-		return false;
-	}
-
-	g_gui.SetLoadDone(10, "Loading sprites file...");
+	const wxString data_directory = data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR);
+	FileName user_creatures = getLoadedVersion()->getLocalDataPath();
+	user_creatures.SetFullName("creatures.xml");
+
+	// Item types and materials documents come from the data cache while
+	// their files are unchanged, otherwise they are parsed and cached again
+	std::shared_ptr<DataCache> cache;
+	if (g_settings.getBoolean(Config::USE_DATA_CACHE)) {
+		cache = std::make_shared<DataCache>();
+		cache->load(DataCache::getFileName());
+	}
+
+	// Sprite data and the item/creature databases only share the metadata,
+	// materials need both items and creatures to resolve their brushes
+	LoadTaskGraph graph;
+	const size_t metadata = graph.add("metadata", [](wxString& error, wxArrayString& warnings) {
+		wxFileName metadata_path = g_gui.gfx.getMetadataFileName();
+		if (!g_gui.gfx.loadSpriteMetadata(metadata_path, error, warnings)) {
+			error = "Couldn't load metadata: " + error;
+			return false;
+		}
+		return true;
+	});
+	graph.add("sprites", [](wxString& error, wxArrayString& warnings) {
+		wxFileName sprites_path = g_gui.gfx.getSpritesFileName();
+		if (!g_gui.gfx.loadSpriteData(sprites_path.GetFullPath(), error, warnings)) {
+			error = "Couldn't load sprites: " + error;
+			return false;
+		}
+		return true;
+	}, { metadata });
+	const size_t items_otb = graph.add("items.otb", [data_directory, cache](wxString& error, wxArrayString& warnings) {
+		if (cache && cache->isLoaded()) {
+			if (cache->getItems(g_items, error)) {
+				return true;
+			}
+			warnings.push_back(error);
+			cache->reset();
+			g_items.clear();
+		}
+		if (!g_items.loadFromOtb(wxString(data_directory + "items.otb"), error, warnings)) {
+			error = "Couldn't load items.otb: " + error;
+			return false;
+		}
+		return true;
+	}, { metadata });
+	const size_t items_xml = graph.add("items.xml", [data_directory, cache](wxString& error, wxArrayString& warnings) {
+		if (cache && cache->isLoaded()) {
+			return true;
+		}
+		if (!g_items.loadFromGameXml(wxString(data_directory + "items.xml"), error, warnings)) {
+			warnings.push_back("Couldn't load items.xml: " + error);
+		}
+		if (cache) {
+			cache->setItems(g_items, wxString(data_directory + "items.otb"), wxString(data_directory + "items.xml"));
+		}
+		return true;
+	}, { items_otb });
+	const size_t creatures = graph.add("creatures.xml", [data_directory, user_creatures](wxString& error, wxArrayString& warnings) {
+		if (!g_creatures.loadFromXML(wxString(data_directory + "creatures.xml"), true, error, warnings)) {
+			warnings.push_back("Couldn't load creatures.xml: " + error);
+		}
 
-	wxFileName sprites_path = g_gui.gfx.getSpritesFileName();
-	if (!g_gui.gfx.loadSpriteData(sprites_path.GetFullPath(), error, warnings)) {
-		error = "Couldn't load sprites: " + error;
-		g_gui.DestroyLoadBar();
-		UnloadVersion();
-		return false;
-	}
+		wxString nerr;
+		wxArrayString nwarn;
+		g_creatures.loadFromXML(user_creatures, false, nerr, nwarn);
+		return true;
+	}, { metadata });
+	graph.add("materials", [data_directory, extension_path, cache](wxString& error, wxArrayString& warnings) {
+		g_materials.setDocumentCache(cache.get(), cache && cache->isLoaded());
+		if (!g_materials.loadMaterials(wxString(data_directory + "materials.xml"), error, warnings)) {
+			warnings.push_back("Couldn't load materials.xml: " + error);
+		}
+		if (!g_materials.loadMaterials(wxString(data_directory + "collections.xml"), error, warnings)) {
+			warnings.push_back("Couldn't load collections.xml: " + error);
+		}
+		if (!g_materials.loadExtensions(extension_path, error, warnings)) {
+			// warnings.push_back("Couldn't load extensions: " + error);
+		}
+		g_materials.setDocumentCache(nullptr, false);
+		return true;
+	}, { items_xml, creatures });
 
-	g_gui.SetLoadDone(20, "Loading items.otb file...");
-	if (!g_items.loadFromOtb(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.otb"), error, warnings)) {
-		error = "Couldn't load items.otb: " + error;
+	if (!graph.run(error, warnings, 0, 70)) {
 		g_gui.DestroyLoadBar();
 		UnloadVersion();
 		return false;
 	}
 
-	g_gui.SetLoadDone(30, "Loading items.xml ...");
-	if (!g_items.loadFromGameXml(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.xml"), error, warnings)) {
-		warnings.push_back("Couldn't load items.xml: " + error);
-	}
-
-	g_gui.SetLoadDone(45, "Loading creatures.xml ...");
-	if (!g_creatures.loadFromXML(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "creatures.xml"), true, error, warnings)) {
-		warnings.push_back("Couldn't load creatures.xml: " + error);
-	}
-
-	g_gui.SetLoadDone(45, "Loading user creatures.xml ...");
+	// Keep a record of how long every version takes to load
 	{
-		FileName cdb = getLoadedVersion()->getLocalDataPath();
-		cdb.SetFullName("creatures.xml");
-		wxString nerr;
-		wxArrayString nwarn;
-		g_creatures.loadFromXML(cdb, false, nerr, nwarn);
+		FileName timings_path = getLoadedVersion()->getLocalDataPath();
+		timings_path.SetFullName("load_times.log");
+		wxFile timings_file;
+		if (timings_file.Open(timings_path.GetFullPath(), wxFile::write_append)) {
+			timings_file.Write(wxString::Format("%s %s: %d ms\n", wxDateTime::Now().FormatISOCombined(' '), wxstr(getLoadedVersion()->getName()), static_cast<int>(graph.getElapsed() * 1000)));
+			timings_file.Write(graph.getTimings());
+		}
 	}
 
-	g_gui.SetLoadDone(50, "Loading materials.xml ...");
-	if (!g_materials.loadMaterials(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "materials.xml"), error, warnings)) {
-		warnings.push_back("Couldn't load materials.xml: " + error);
-	}
-	
-	g_gui.SetLoadDone(60, "Loading collections.xml ...");
-	if (!g_materials.loadMaterials(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "collections.xml"), error, warnings)) {
-		warnings.push_back("Couldn't load collections.xml: " + error);
-	}
-	
-	g_gui.SetLoadDone(70, "Loading extensions...");
-	if (!g_materials.loadExtensions(extension_path, error, warnings)) {
-		// warnings.push_back("Couldn't load extensions: " + error);
+	if (cache && !cache->isLoaded()) {
+		cache->addDirectory(extension_path);
+		if (!cache->save(DataCache::getFileName())) {
+			warnings.push_back("Couldn't write the data cache.");
+		}
 	}
 
 	g_gui.SetLoadDone(70, "Finishing...");
@@ -1581,6 +1637,12 @@ void GUI::CreateLoadBar(wxString message, bool canCancel /* = false */) {
 	progressFrom = 0;
 	progressTo = 100;
 	currentProgress = -1;
+	progressCancelled = false;
+
+	if (headless) {
+		std::cout << message << std::endl;
+		return;
+	}
 
 	progressBar = newd wxGenericProgressDialog("Loading", progressText + " (0%)", 100, root, wxPD_APP_MODAL | wxPD_SMOOTH | (canCancel ? wxPD_CAN_ABORT : 0));
 	progressBar->SetSize(280, -1);
@@ -1608,6 +1670,7 @@ bool GUI::SetLoadDone(int32_t done, const wxString& newMessage) {
 		return true;
 	}
 
+	bool messageChanged = !newMessage.empty() && newMessage != progressText;
 	if (!newMessage.empty()) {
 		progressText = newMessage;
 	}
@@ -1615,13 +1678,24 @@ bool GUI::SetLoadDone(int32_t done, const wxString& newMessage) {
 	int32_t newProgress = progressFrom + static_cast<int32_t>((done / 100.f) * (progressTo - progressFrom));
 	newProgress = std::max<int32_t>(0, std::min<int32_t>(100, newProgress));
 
+	if (headless) {
+		// Print every tenth instead of every update
+		if (newProgress / 10 != currentProgress / 10 || messageChanged) {
+			std::cout << "  " << progressText << " (" << newProgress << "%)" << std::endl;
+		}
+		currentProgress = newProgress;
+		return false;
+	}
+
 	bool skip = false;
 	if (progressBar) {
-		progressBar->Update(
-			newProgress,
-			wxString::Format("%s (%d%%)", progressText, newProgress),
-			&skip
-		);
+		if (!progressBar->Update(
+				newProgress,
+				wxString::Format("%s (%d%%)", progressText, newProgress),
+				&skip
+			)) {
+			progressCancelled = true;
+		}
 		currentProgress = newProgress;
 	}
 
@@ -1760,6 +1834,10 @@ void GUI::DoPaste() {
 void GUI::PreparePaste() {
 	Editor* editor = GetCurrentEditor();
 	if (editor) {
+		copybuffer.update(*editor);
+		if (copybuffer.GetTileCount() == 0) {
+			return;
+		}
 		SetSelectionMode();
 		editor->selection.start();
 		editor->selection.clear();
@@ -1785,17 +1863,17 @@ void GUI::EndPasting() {
 
 bool GUI::CanUndo() {
 	Editor* editor = GetCurrentEditor();
-	return (editor && editor->actionQueue->canUndo());
+	return (editor && editor->CanEdit() && editor->actionQueue->canUndo());
 }
 
 bool GUI::CanRedo() {
 	Editor* editor = GetCurrentEditor();
-	return (editor && editor->actionQueue->canRedo());
+	return (editor && editor->CanEdit() && editor->actionQueue->canRedo());
 }
 
 bool GUI::DoUndo() {
 	Editor* editor = GetCurrentEditor();
-	if (editor && editor->actionQueue->canUndo()) {
+	if (editor && editor->CanEdit() && editor->actionQueue->canUndo()) {
 		// Store the current mode before undoing
 		EditorMode previous_mode = mode;
 		
@@ -1822,7 +1900,7 @@ bool GUI::DoUndo() {
 
 bool GUI::DoRedo() {
 	Editor* editor = GetCurrentEditor();
-	if (editor && editor->actionQueue->canRedo()) {
+	if (editor && editor->CanEdit() && editor->actionQueue->canRedo()) {
 		// Store the current mode before redoing
 		EditorMode previous_mode = mode;
 		
@@ -1933,6 +2011,9 @@ void GUI::UpdateTitle() {
 }
 
 void GUI::UpdateMenus() {
+	if (!root) {
+		return;
+	}
 	wxCommandEvent evt(EVT_UPDATE_MENUS);
 	g_gui.root->AddPendingEvent(evt);
 }
@@ -2390,6 +2471,17 @@ long GUI::PopupDialog(wxWindow* parent, wxString title, wxString text, long styl
 		return wxID_ANY;
 	}
 
+	if (headless) {
+		// Nobody can answer, questions get the cautious answer
+		std::cout << title << ": " << text << std::endl;
+		if (style & wxCANCEL) {
+			return wxID_CANCEL;
+		} else if (style & wxNO) {
+			return wxID_NO;
+		}
+		return wxID_OK;
+	}
+
 	wxMessageDialog dlg(parent, text, title, style);
 	return dlg.ShowModal();
 }
@@ -2403,6 +2495,14 @@ void GUI::ListDialog(wxWindow* parent, wxString title, const wxArrayString& para
 		return;
 	}
 
+	if (headless) {
+		std::cout << title << ":" << std::endl;
+		for (const wxString& item : param_items) {
+			std::cout << "  " << item << std::endl;
+		}
+		return;
+	}
+
 	wxArrayString list_items(param_items);
 
 	// Create the window
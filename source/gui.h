@@ -160,6 +160,14 @@ public:
 	 */
 	void SetLoadScale(int32_t from, int32_t to);
 
+	/**
+	 * Whether the abort button of a loading bar created with canCancel has
+	 * been pressed, checked after SetLoadDone.
+	 */
+	bool IsLoadCancelled() const {
+		return progressCancelled;
+	}
+
 	void ShowWelcomeDialog(const wxBitmap& icon);
 	void FinishWelcomeDialog();
 	bool IsWelcomeDialogShown();
@@ -175,6 +183,14 @@ public:
 		return disabled_counter == 0;
 	}
 
+	// Headless runs have no windows, progress and dialogs go to stdout
+	void SetHeadless(bool value) {
+		headless = value;
+	}
+	bool IsHeadless() const {
+		return headless;
+	}
+
 	void EnableHotkeys();
 	void DisableHotkeys();
 	bool AreHotkeysEnabled() const;
@@ -498,6 +514,8 @@ protected:
 	int32_t progressFrom;
 	int32_t progressTo;
 	int32_t currentProgress;
+	bool progressCancelled;
+	bool headless;
 
 	wxWindowDisabler* winDisabler;
 	int disabled_counter;
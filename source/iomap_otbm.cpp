@@ -1210,7 +1210,7 @@ bool IOMapOTBM::loadSpawns(Map& map, pugi::xml_document& doc) {
 			creature->setSpawnTime(spawntime);
 			creatureTile->creature = creature;
 
-			if (creatureTile->getLocation()->getSpawnCount() == 0) {
+			if (map.getSpawnCount(creatureTile->getPosition()) == 0) {
 				// No spawn, create a newd one
 				ASSERT(creatureTile->spawn == nullptr);
 				Spawn* spawn = newd Spawn(5);
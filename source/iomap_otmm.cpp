@@ -613,7 +613,7 @@ bool IOMapOTMM::loadMap(Map& map, NodeFileReadHandle& f, const FileName& identif
 									Creature* creature = newd Creature(type);
 									creature->setSpawnTime(spawntime);
 									creature_tile->creature = creature;
-									if (creature_tile->spawn_count == 0) {
+									if (map.getSpawnCount(creature_tile->getPosition()) == 0) {
 										// No spawn, create a newd one (this happends if the radius of the spawn has been decreased due to g_settings)
 										ASSERT(creature_tile->spawn == nullptr);
 										Spawn* spawn = newd Spawn(5);
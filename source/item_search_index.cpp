@@ -0,0 +1,304 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "item_search_index.h"
+#include "items.h"
+#include "graphics.h"
+#include "raw_brush.h"
+
+namespace {
+	uint32_t getGramKey(const std::string& text, size_t offset, size_t length) {
+		uint32_t key = uint32_t(length) << 24;
+		for (size_t i = 0; i < length; ++i) {
+			key |= uint32_t(uint8_t(text[offset + i])) << (16 - 8 * i);
+		}
+		return key;
+	}
+}
+
+void IdRangeSet::add(uint16_t from, uint16_t to) {
+	if (from > to) {
+		return;
+	}
+
+	// First interval that ends at or after from - 1, it may be merged
+	auto first = std::lower_bound(ranges.begin(), ranges.end(), from, [](const Range& range, uint16_t id) {
+		return uint32_t(range.second) + 1 < id;
+	});
+	auto last = first;
+	while (last != ranges.end() && uint32_t(last->first) <= uint32_t(to) + 1) {
+		from = std::min(from, last->first);
+		to = std::max(to, last->second);
+		++last;
+	}
+	first = ranges.erase(first, last);
+	ranges.insert(first, Range(from, to));
+}
+
+void IdRangeSet::add(const std::vector<Range>& ranges) {
+	for (const Range& range : ranges) {
+		add(range.first, range.second);
+	}
+}
+
+bool IdRangeSet::contains(uint16_t id) const {
+	auto it = std::upper_bound(ranges.begin(), ranges.end(), id, [](uint16_t id, const Range& range) {
+		return id < range.first;
+	});
+	return it != ranges.begin() && id <= (--it)->second;
+}
+
+ItemSearchIndex::ItemSearchIndex() :
+	maxId(0) {
+	////
+}
+
+void ItemSearchIndex::build(ItemDatabase& items) {
+	maxId = items.getMaxID();
+	const size_t words = maxId / 64 + 1;
+	indexed.assign(words, 0);
+	for (Bitset& bits : properties) {
+		bits.assign(words, 0);
+	}
+	for (Bitset& bits : types) {
+		bits.assign(words, 0);
+	}
+	clientIds.clear();
+	names.assign(maxId + 1, std::string());
+	grams.clear();
+
+	for (int id = 0; id <= maxId; ++id) {
+		const ItemType& type = items.getItemType(id);
+		if (type.id == 0 || !type.raw_brush) {
+			continue;
+		}
+
+		setBit(indexed, id);
+		const bool flags[PROPERTY_COUNT] = {
+			type.unpassable,
+			!type.moveable,
+			type.blockMissiles,
+			type.blockPathfinder,
+			type.canReadText,
+			type.canWriteText,
+			type.pickupable,
+			type.stackable,
+			type.rotable,
+			type.isHangable,
+			type.hookEast,
+			type.hookSouth,
+			type.hasElevation,
+			type.ignoreLook,
+			type.floorChangeDown || type.floorChangeNorth || type.floorChangeSouth || type.floorChangeEast || type.floorChangeWest,
+			type.sprite && type.sprite->hasLight(),
+			(type.slot_position & SLOTP_HEAD) != 0,
+			(type.slot_position & SLOTP_NECKLACE) != 0,
+			(type.slot_position & SLOTP_BACKPACK) != 0,
+			(type.slot_position & SLOTP_ARMOR) != 0,
+			(type.slot_position & SLOTP_LEGS) != 0,
+			(type.slot_position & SLOTP_FEET) != 0,
+			(type.slot_position & SLOTP_RING) != 0,
+			(type.slot_position & SLOTP_AMMO) != 0,
+		};
+		for (int property = 0; property < PROPERTY_COUNT; ++property) {
+			if (flags[property]) {
+				setBit(properties[property], id);
+			}
+		}
+
+		const bool kinds[TYPE_COUNT] = {
+			type.isDepot(),
+			type.isMailbox(),
+			type.isTrashHolder(),
+			type.isContainer(),
+			type.isDoor(),
+			type.isMagicField(),
+			type.isTeleport(),
+			type.isBed(),
+			type.isKey(),
+			type.isPodium(),
+		};
+		for (int kind = 0; kind < TYPE_COUNT; ++kind) {
+			if (kinds[kind]) {
+				setBit(types[kind], id);
+			}
+		}
+
+		clientIds.emplace_back(type.clientID, id);
+
+		std::string& name = names[id];
+		name = as_lower_str(type.raw_brush->getName());
+		for (size_t length = 2; length <= 3; ++length) {
+			for (size_t offset = 0; offset + length <= name.size(); ++offset) {
+				// Ids are added in ascending order, so the lists stay sorted
+				std::vector<uint16_t>& postings = grams[getGramKey(name, offset, length)];
+				if (postings.empty() || postings.back() != id) {
+					postings.push_back(id);
+				}
+			}
+		}
+	}
+
+	std::sort(clientIds.begin(), clientIds.end());
+}
+
+ItemSearchIndex::Bitset ItemSearchIndex::getCandidates(bool pickupable) const {
+	Bitset candidates = indexed;
+	for (uint32_t id = 0; id < FIRST_LISTED_ID && id <= maxId; ++id) {
+		candidates[id >> 6] &= ~(uint64_t(1) << (id & 63));
+	}
+	if (pickupable) {
+		const Bitset& bits = properties[PROPERTY_PICKUPABLE];
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			candidates[i] &= bits[i];
+		}
+	}
+	return candidates;
+}
+
+void ItemSearchIndex::collect(const Bitset& bits, std::vector<uint16_t>& result) {
+	for (size_t i = 0; i < bits.size(); ++i) {
+		uint64_t word = bits[i];
+		while (word) {
+			int bit = 0;
+			while (!((word >> bit) & 1)) {
+				++bit;
+			}
+			result.push_back(uint16_t(i * 64 + bit));
+			word &= word - 1;
+		}
+	}
+}
+
+void ItemSearchIndex::findServerIds(const IdRangeSet& ranges, const IdRangeSet& ignored, bool pickupable, size_t limit, std::vector<uint16_t>& result) const {
+	const Bitset& filter = pickupable ? properties[PROPERTY_PICKUPABLE] : indexed;
+	for (const IdRangeSet::Range& range : ranges.getRanges()) {
+		const uint32_t last = std::min<uint32_t>(range.second, maxId);
+		for (uint32_t id = range.first; id <= last; ++id) {
+			if (result.size() >= limit) {
+				return;
+			}
+			if (testBit(filter, id) && !ignored.contains(id)) {
+				result.push_back(id);
+			}
+		}
+	}
+}
+
+void ItemSearchIndex::findClientIds(const IdRangeSet& ranges, const IdRangeSet& ignored, bool pickupable, size_t limit, std::vector<uint16_t>& result) const {
+	const Bitset& filter = pickupable ? properties[PROPERTY_PICKUPABLE] : indexed;
+	const size_t start = result.size();
+	for (const IdRangeSet::Range& range : ranges.getRanges()) {
+		auto it = std::lower_bound(clientIds.begin(), clientIds.end(), std::make_pair(range.first, uint16_t(0)));
+		for (; it != clientIds.end() && it->first <= range.second; ++it) {
+			if (it->second >= FIRST_LISTED_ID && testBit(filter, it->second) && !ignored.contains(it->first)) {
+				result.push_back(it->second);
+			}
+		}
+	}
+
+	// Results are listed by server id, like the other searches
+	std::sort(result.begin() + start, result.end());
+	if (result.size() - start > limit) {
+		result.resize(start + limit);
+	}
+}
+
+const std::vector<uint16_t>* ItemSearchIndex::getPostings(const std::string& text, size_t offset, size_t length) const {
+	auto it = grams.find(getGramKey(text, offset, length));
+	return it == grams.end() ? nullptr : &it->second;
+}
+
+void ItemSearchIndex::findName(const std::string& text, bool pickupable, std::vector<uint16_t>& result) const {
+	if (text.size() < 2) {
+		return;
+	}
+
+	// Every name containing the text contains all of its n-grams
+	std::vector<const std::vector<uint16_t>*> lists;
+	const size_t length = text.size() == 2 ? 2 : 3;
+	for (size_t offset = 0; offset + length <= text.size(); ++offset) {
+		const std::vector<uint16_t>* postings = getPostings(text, offset, length);
+		if (!postings) {
+			return;
+		}
+		lists.push_back(postings);
+	}
+	std::sort(lists.begin(), lists.end(), [](const std::vector<uint16_t>* a, const std::vector<uint16_t>* b) {
+		return a->size() < b->size();
+	});
+	lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+	std::vector<uint16_t> matches = *lists.front();
+	std::vector<uint16_t> next;
+	for (size_t i = 1; i < lists.size() && !matches.empty(); ++i) {
+		next.clear();
+		std::set_intersection(matches.begin(), matches.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(next));
+		matches.swap(next);
+	}
+
+	// The n-grams may appear in another order, check the actual names
+	for (uint16_t id : matches) {
+		if (id < FIRST_LISTED_ID || (pickupable && !testBit(properties[PROPERTY_PICKUPABLE], id))) {
+			continue;
+		}
+		if (text.size() <= 3 || names[id].find(text) != std::string::npos) {
+			result.push_back(id);
+		}
+	}
+}
+
+void ItemSearchIndex::findType(Type type, bool pickupable, std::vector<uint16_t>& result) const {
+	Bitset candidates = getCandidates(pickupable);
+	const Bitset& bits = types[type];
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		candidates[i] &= bits[i];
+	}
+	collect(candidates, result);
+}
+
+void ItemSearchIndex::findProperties(uint32_t required, uint32_t excluded, bool pickupable, std::vector<uint16_t>& result) const {
+	Bitset candidates = getCandidates(pickupable);
+	for (int property = 0; property < PROPERTY_COUNT; ++property) {
+		const Bitset& bits = properties[property];
+		if (required & (1 << property)) {
+			for (size_t i = 0; i < candidates.size(); ++i) {
+				candidates[i] &= bits[i];
+			}
+		} else if (excluded & (1 << property)) {
+			for (size_t i = 0; i < candidates.size(); ++i) {
+				candidates[i] &= ~bits[i];
+			}
+		}
+	}
+	collect(candidates, result);
+}
+
+size_t ItemSearchIndex::memsize() const {
+	size_t mem = sizeof(*this);
+	mem += indexed.capacity() * sizeof(uint64_t) * (1 + PROPERTY_COUNT + TYPE_COUNT);
+	mem += clientIds.capacity() * sizeof(clientIds[0]);
+	for (const std::string& name : names) {
+		mem += sizeof(name) + name.capacity();
+	}
+	for (const auto& gram : grams) {
+		mem += sizeof(gram) + gram.second.capacity() * sizeof(uint16_t);
+	}
+	return mem;
+}
@@ -0,0 +1,152 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_ITEM_SEARCH_INDEX_H_
+#define RME_ITEM_SEARCH_INDEX_H_
+
+#include <unordered_map>
+
+class ItemDatabase;
+
+// Sorted set of closed id intervals, overlapping and adjacent intervals are
+// merged as they are added so lookups are a binary search.
+class IdRangeSet {
+public:
+	typedef std::pair<uint16_t, uint16_t> Range;
+
+	void add(uint16_t from, uint16_t to);
+	void add(const std::vector<Range>& ranges);
+	void clear() {
+		ranges.clear();
+	}
+
+	bool contains(uint16_t id) const;
+	bool empty() const {
+		return ranges.empty();
+	}
+	const std::vector<Range>& getRanges() const {
+		return ranges;
+	}
+
+private:
+	std::vector<Range> ranges;
+};
+
+// Prebuilt lookup tables over the item types for the Find Item dialog. Each
+// property and item type has a bitset over the server ids and names have an
+// n-gram index, so a query intersects a few sets instead of looking at every
+// item type. Results are server ids in ascending order.
+class ItemSearchIndex {
+public:
+	enum Property {
+		PROPERTY_UNPASSABLE,
+		PROPERTY_UNMOVABLE,
+		PROPERTY_BLOCK_MISSILES,
+		PROPERTY_BLOCK_PATHFINDER,
+		PROPERTY_READABLE,
+		PROPERTY_WRITEABLE,
+		PROPERTY_PICKUPABLE,
+		PROPERTY_STACKABLE,
+		PROPERTY_ROTATABLE,
+		PROPERTY_HANGABLE,
+		PROPERTY_HOOK_EAST,
+		PROPERTY_HOOK_SOUTH,
+		PROPERTY_ELEVATION,
+		PROPERTY_IGNORE_LOOK,
+		PROPERTY_FLOOR_CHANGE,
+		PROPERTY_LIGHT,
+		PROPERTY_SLOT_HEAD,
+		PROPERTY_SLOT_NECKLACE,
+		PROPERTY_SLOT_BACKPACK,
+		PROPERTY_SLOT_ARMOR,
+		PROPERTY_SLOT_LEGS,
+		PROPERTY_SLOT_FEET,
+		PROPERTY_SLOT_RING,
+		PROPERTY_SLOT_AMMO,
+		PROPERTY_COUNT
+	};
+
+	// Same order as FindItemDialog::SearchItemType
+	enum Type {
+		TYPE_DEPOT,
+		TYPE_MAILBOX,
+		TYPE_TRASH_HOLDER,
+		TYPE_CONTAINER,
+		TYPE_DOOR,
+		TYPE_MAGIC_FIELD,
+		TYPE_TELEPORT,
+		TYPE_BED,
+		TYPE_KEY,
+		TYPE_PODIUM,
+		TYPE_COUNT
+	};
+
+	// Server ids below this are only found by a server id search, like in
+	// the scans the index replaced
+	static const uint16_t FIRST_LISTED_ID = 100;
+
+	ItemSearchIndex();
+
+	// Indexes every item type that has a raw brush
+	void build(ItemDatabase& items);
+
+	// Server ids inside the ranges
+	void findServerIds(const IdRangeSet& ranges, const IdRangeSet& ignored, bool pickupable, size_t limit, std::vector<uint16_t>& result) const;
+	// Server ids of the items whose client id is inside the ranges, ignored
+	// holds client ids
+	void findClientIds(const IdRangeSet& ranges, const IdRangeSet& ignored, bool pickupable, size_t limit, std::vector<uint16_t>& result) const;
+	// Items whose lowercase brush name contains the text, at least two
+	// characters long
+	void findName(const std::string& text, bool pickupable, std::vector<uint16_t>& result) const;
+	void findType(Type type, bool pickupable, std::vector<uint16_t>& result) const;
+	// Items having every property in required and none in excluded, the
+	// masks are made of 1 << Property
+	void findProperties(uint32_t required, uint32_t excluded, bool pickupable, std::vector<uint16_t>& result) const;
+
+	size_t memsize() const;
+
+private:
+	typedef std::vector<uint64_t> Bitset;
+
+	// Bitset of the indexed items from FIRST_LISTED_ID, optionally only the
+	// pickupable ones
+	Bitset getCandidates(bool pickupable) const;
+	const std::vector<uint16_t>* getPostings(const std::string& text, size_t offset, size_t length) const;
+
+	static void setBit(Bitset& bits, uint16_t id) {
+		bits[id >> 6] |= uint64_t(1) << (id & 63);
+	}
+	static bool testBit(const Bitset& bits, uint16_t id) {
+		return (bits[id >> 6] >> (id & 63)) & 1;
+	}
+	static void collect(const Bitset& bits, std::vector<uint16_t>& result);
+
+	uint16_t maxId;
+	Bitset indexed;
+	Bitset properties[PROPERTY_COUNT];
+	Bitset types[TYPE_COUNT];
+
+	// Sorted by client id, then server id
+	std::vector<std::pair<uint16_t, uint16_t>> clientIds;
+
+	// Lowercase brush names by server id, and the server ids having each
+	// two and three character sequence of them
+	std::vector<std::string> names;
+	std::unordered_map<uint32_t, std::vector<uint16_t>> grams;
+};
+
+#endif
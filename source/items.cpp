@@ -23,6 +23,7 @@
 
 #include "items.h"
 #include "item.h"
+#include "item_search_index.h"
 
 ItemDatabase g_items;
 
@@ -64,6 +65,7 @@ ItemType::ItemType() :
 	hookSouth(false),
 	canReadText(false),
 	canWriteText(false),
+	allowDistRead(false),
 	replaceable(true),
 	decays(false),
 	stackable(false),
@@ -76,6 +78,7 @@ ItemType::ItemType() :
 	isWall(false),
 	isBrushDoor(false),
 	isOpen(false),
+	isLocked(false),
 	isTable(false),
 	isCarpet(false),
 
@@ -94,7 +97,8 @@ ItemType::ItemType() :
 
 	alwaysOnTopOrder(0),
 	rotateTo(0),
-	border_alignment(BORDER_NONE) {
+	border_alignment(BORDER_NONE),
+	hasLight(false) {
 	////
 }
 
@@ -130,6 +134,7 @@ ItemDatabase::~ItemDatabase() {
 }
 
 void ItemDatabase::clear() {
+	search_index.reset();
 	for (uint32_t i = 0; i < items.size(); i++) {
 		delete items[i];
 		items.set(i, nullptr);
@@ -1082,6 +1087,14 @@ ItemType& ItemDatabase::getItemType(int id) {
 	}
 }
 
+ItemSearchIndex& ItemDatabase::getSearchIndex() {
+	if (!search_index) {
+		search_index.reset(newd ItemSearchIndex());
+		search_index->build(*this);
+	}
+	return *search_index;
+}
+
 bool ItemDatabase::typeExists(int id) const {
 	ItemType* it = items[id];
 	return it != nullptr;
@@ -21,6 +21,8 @@
 #include "filehandle.h"
 #include "brush_enums.h"
 
+#include <memory>
+
 class Brush;
 class GroundBrush;
 class WallBrush;
@@ -39,6 +41,7 @@ class ItemType;
 class GameSprite;
 class GameSprite;
 class ItemDatabase;
+class ItemSearchIndex;
 
 extern ItemDatabase g_items;
 
@@ -442,6 +445,9 @@ public:
 	bool loadItemFromGameXml(pugi::xml_node itemNode, int id);
 	bool loadMetaItem(pugi::xml_node node);
 
+	// Built on first use after the items and their raw brushes are loaded
+	ItemSearchIndex& getSearchIndex();
+
 	// typedef std::map<int32_t, ItemType*> ItemMap;
 	typedef contigous_vector<ItemType*> ItemMap;
 	typedef std::map<std::string, ItemType*> ItemNameMap;
@@ -468,8 +474,11 @@ protected:
 	uint16_t maxclientID;
 	uint16_t max_item_id;
 
+	std::unique_ptr<ItemSearchIndex> search_index;
+
 	friend class GameSprite;
 	friend class Item;
+	friend class DataCache;
 };
 
 #endif
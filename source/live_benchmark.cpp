@@ -0,0 +1,648 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "live_benchmark.h"
+#include "live_server.h"
+#include "iomap_otbm.h"
+#include "editor.h"
+#include "items.h"
+#include "gui.h"
+
+#include <wx/evtloop.h>
+
+#ifdef __WINDOWS__
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+static const uint32_t RECORDING_MAGIC = 0x524C4352; // "RCLR"
+
+wxString LiveChangeRecorder::defaultPath;
+
+//=============================================================================
+// LiveChangeRecorder
+
+LiveChangeRecorder::LiveChangeRecorder() :
+	file(), last() {
+	////
+}
+
+LiveChangeRecorder::~LiveChangeRecorder() {
+	close();
+}
+
+bool LiveChangeRecorder::open(const wxString& path) {
+	close();
+	file.open(path.ToStdString(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&RECORDING_MAGIC), sizeof(RECORDING_MAGIC));
+	last = std::chrono::steady_clock::now();
+	return true;
+}
+
+void LiveChangeRecorder::close() {
+	if (file.is_open()) {
+		file.close();
+	}
+}
+
+void LiveChangeRecorder::record(const std::string& data, const Position& anchor) {
+	if (!file.is_open()) {
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	uint32_t delay = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - last).count());
+	last = now;
+
+	uint16_t x = anchor.x;
+	uint16_t y = anchor.y;
+	uint8_t z = anchor.z;
+	uint32_t size = data.size();
+
+	file.write(reinterpret_cast<const char*>(&delay), sizeof(delay));
+	file.write(reinterpret_cast<const char*>(&x), sizeof(x));
+	file.write(reinterpret_cast<const char*>(&y), sizeof(y));
+	file.write(reinterpret_cast<const char*>(&z), sizeof(z));
+	file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	file.write(data.data(), size);
+	file.flush();
+}
+
+bool LiveChangeRecorder::load(const wxString& path, std::vector<RecordedChange>& changes) {
+	std::ifstream in(path.ToStdString(), std::ios::binary);
+	if (!in.is_open()) {
+		return false;
+	}
+
+	uint32_t magic = 0;
+	in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	if (!in || magic != RECORDING_MAGIC) {
+		return false;
+	}
+
+	while (true) {
+		RecordedChange change;
+		uint16_t x, y;
+		uint8_t z;
+		uint32_t size;
+
+		in.read(reinterpret_cast<char*>(&change.delay), sizeof(change.delay));
+		in.read(reinterpret_cast<char*>(&x), sizeof(x));
+		in.read(reinterpret_cast<char*>(&y), sizeof(y));
+		in.read(reinterpret_cast<char*>(&z), sizeof(z));
+		in.read(reinterpret_cast<char*>(&size), sizeof(size));
+		if (!in || size > 0xFFFF) {
+			break;
+		}
+
+		change.anchor = Position(x, y, z);
+		change.data.resize(size);
+		in.read(&change.data[0], size);
+		if (!in) {
+			break;
+		}
+		changes.push_back(std::move(change));
+	}
+	return !changes.empty();
+}
+
+//=============================================================================
+// LiveBenchmarkOptions
+
+bool LiveBenchmarkOptions::parse(const wxString& argument) {
+	wxString key = argument.BeforeFirst('=');
+	wxString value = argument.AfterFirst('=');
+
+	unsigned long number = 0;
+	if (key == "map") {
+		mapFile = value;
+	} else if (key == "replay") {
+		replayFile = value;
+	} else if (key == "report") {
+		reportFile = value;
+	} else if (!value.ToULong(&number)) {
+		return false;
+	} else if (key == "clients") {
+		clients = std::max<unsigned long>(1, number);
+	} else if (key == "seconds") {
+		seconds = std::max<unsigned long>(1, number);
+	} else if (key == "view") {
+		viewSize = std::max<unsigned long>(4, number);
+	} else if (key == "rate") {
+		changesPerSecond = std::max<unsigned long>(1, number);
+	} else if (key == "port") {
+		port = static_cast<uint16_t>(number);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+//=============================================================================
+// LiveBenchmarkClient
+
+LiveBenchmarkClient::LiveBenchmarkClient(LiveBenchmark& benchmark, boost::asio::io_context& service, uint32_t index) :
+	benchmark(benchmark),
+	socket(service),
+	timer(service),
+	readMessage(),
+	outgoing(),
+	pending(),
+	latencies(),
+	index(index),
+	state(STATE_CONNECTING),
+	replayIndex(0),
+	random(index + 1),
+	writer(),
+	joined(false),
+	dropped(false),
+	bytesSent(0),
+	bytesReceived(0),
+	nodesReceived(0),
+	changesSent(0) {
+	// Lay the viewports out on a grid with half a view of overlap, so every
+	// change is seen by a few neighbours as well
+	const int32_t step = benchmark.getOptions().viewSize / 2;
+	const Position& origin = benchmark.getOrigin();
+	center = Position(origin.x + (index % 4) * step, origin.y + (index / 4) * step, origin.z);
+}
+
+LiveBenchmarkClient::~LiveBenchmarkClient() {
+	close();
+}
+
+void LiveBenchmarkClient::connect(uint16_t port) {
+	boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+	socket.async_connect(endpoint, [this](const boost::system::error_code& error) -> void {
+		if (error) {
+			dropped = dropped || state != STATE_CLOSED;
+			state = STATE_CLOSED;
+			return;
+		}
+
+		boost::system::error_code ignored;
+		socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+
+		sendHello();
+		receiveHeader();
+	});
+}
+
+void LiveBenchmarkClient::close() {
+	boost::system::error_code ignored;
+	timer.cancel();
+	if (socket.is_open()) {
+		socket.close(ignored);
+	}
+	state = STATE_CLOSED;
+}
+
+void LiveBenchmarkClient::receiveHeader() {
+	readMessage.buffer.resize(4);
+	boost::asio::async_read(socket, boost::asio::buffer(readMessage.buffer.data(), 4), [this](const boost::system::error_code& error, size_t bytesReceived) -> void {
+		if (error) {
+			dropped = dropped || state != STATE_CLOSED;
+			state = STATE_CLOSED;
+			return;
+		}
+		this->bytesReceived += bytesReceived;
+
+		uint32_t packetSize;
+		memcpy(&packetSize, readMessage.buffer.data(), 4);
+		if (packetSize == 0) {
+			receiveHeader();
+		} else {
+			receive(packetSize);
+		}
+	});
+}
+
+void LiveBenchmarkClient::receive(uint32_t packetSize) {
+	readMessage.buffer.resize(4 + packetSize);
+	boost::asio::async_read(socket, boost::asio::buffer(&readMessage.buffer[4], packetSize), [this](const boost::system::error_code& error, size_t bytesReceived) -> void {
+		if (error) {
+			dropped = dropped || state != STATE_CLOSED;
+			state = STATE_CLOSED;
+			return;
+		}
+		this->bytesReceived += bytesReceived;
+
+		readMessage.position = 4;
+		try {
+			parsePacket();
+		} catch (std::exception&) {
+			// A malformed packet only costs us the sample
+		}
+		receiveHeader();
+	});
+}
+
+void LiveBenchmarkClient::parsePacket() {
+	// The server writes exactly one packet per message
+	const uint8_t packetType = readMessage.read<uint8_t>();
+	switch (packetType) {
+		case PACKET_ACCEPTED_CLIENT:
+		case PACKET_CHANGE_CLIENT_VERSION: {
+			if (state == STATE_HELLO) {
+				state = STATE_READY;
+				sendReady();
+			} else if (state == STATE_READY) {
+				state = STATE_ACTIVE;
+				joined = true;
+				sendNodeRequests();
+				// Stagger the clients so they don't all edit in lockstep
+				scheduleChange(random() % (1000 / benchmark.getOptions().changesPerSecond + 1));
+			}
+			break;
+		}
+		case PACKET_KICK: {
+			dropped = true;
+			close();
+			break;
+		}
+		case PACKET_NODE: {
+			++nodesReceived;
+			const uint32_t nodeId = readMessage.read<uint32_t>() & ~1u;
+			auto it = pending.find(nodeId);
+			if (it != pending.end()) {
+				std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - it->second;
+				latencies.push_back(latency.count());
+				pending.erase(it);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void LiveBenchmarkClient::send(const std::shared_ptr<NetworkMessage>& message) {
+	if (state == STATE_CLOSED || message->size == 0) {
+		return;
+	}
+
+	memcpy(&message->buffer[0], &message->size, 4);
+	outgoing.push_back(message);
+	if (outgoing.size() == 1) {
+		flush();
+	}
+}
+
+void LiveBenchmarkClient::flush() {
+	const std::shared_ptr<NetworkMessage>& message = outgoing.front();
+	boost::asio::async_write(socket, boost::asio::buffer(message->buffer.data(), message->size + 4), [this](const boost::system::error_code& error, size_t bytesTransferred) -> void {
+		if (error) {
+			dropped = dropped || state != STATE_CLOSED;
+			state = STATE_CLOSED;
+			outgoing.clear();
+			return;
+		}
+		bytesSent += bytesTransferred;
+
+		outgoing.pop_front();
+		if (!outgoing.empty()) {
+			flush();
+		}
+	});
+}
+
+void LiveBenchmarkClient::sendHello() {
+	state = STATE_HELLO;
+
+	auto message = std::make_shared<NetworkMessage>();
+	message->write<uint8_t>(PACKET_HELLO_FROM_CLIENT);
+	message->write<uint32_t>(__RME_VERSION_ID__);
+	message->write<uint32_t>(__LIVE_NET_VERSION__);
+	message->write<uint32_t>(benchmark.getClientVersion());
+	message->write<std::string>("bench-" + std::to_string(index));
+	message->write<std::string>("");
+	send(message);
+}
+
+void LiveBenchmarkClient::sendReady() {
+	auto message = std::make_shared<NetworkMessage>();
+	message->write<uint8_t>(PACKET_READY_CLIENT);
+	send(message);
+}
+
+void LiveBenchmarkClient::sendNodeRequests() {
+	// Request the whole viewport at once, the same storm a client zooming out
+	// produces, plus every node the replayed session is going to touch
+	std::set<uint32_t> nodes;
+
+	const int32_t half = benchmark.getOptions().viewSize / 2;
+	for (int32_t x = center.x - half; x <= center.x + half; x += 4) {
+		for (int32_t y = center.y - half; y <= center.y + half; y += 4) {
+			nodes.insert(getNodeId(Position(x, y, center.z)));
+		}
+	}
+
+	for (const RecordedChange& change : benchmark.getReplay()) {
+		nodes.insert(getNodeId(change.anchor));
+	}
+
+	auto message = std::make_shared<NetworkMessage>();
+	message->write<uint8_t>(PACKET_REQUEST_NODES);
+	message->write<uint32_t>(nodes.size());
+	for (uint32_t node : nodes) {
+		message->write<uint32_t>(node);
+	}
+	send(message);
+}
+
+void LiveBenchmarkClient::sendChange() {
+	if (std::chrono::steady_clock::now() >= benchmark.getDeadline()) {
+		return;
+	}
+
+	std::string data;
+	Position anchor;
+	uint32_t delay = 1000 / benchmark.getOptions().changesPerSecond;
+
+	const std::vector<RecordedChange>& replay = benchmark.getReplay();
+	if (!replay.empty()) {
+		const RecordedChange& change = replay[replayIndex++ % replay.size()];
+		data = change.data;
+		anchor = change.anchor;
+		delay = std::max<uint32_t>(1, change.delay);
+	} else {
+		// A single ground tile somewhere in our viewport, encoded the same
+		// way LiveClient::sendChanges does it
+		const uint32_t size = benchmark.getOptions().viewSize;
+		anchor = Position(
+			center.x - size / 2 + random() % size,
+			center.y - size / 2 + random() % size,
+			center.z
+		);
+
+		writer.reset();
+		writer.addNode(OTBM_TILE);
+		writer.addU16(anchor.x);
+		writer.addU16(anchor.y);
+		writer.addU8(anchor.z);
+		writer.addByte(OTBM_ATTR_ITEM);
+		writer.addU16(benchmark.getGroundId());
+		writer.endNode();
+		writer.endNode();
+		data.assign(reinterpret_cast<const char*>(writer.getMemory()), writer.getSize());
+	}
+
+	auto message = std::make_shared<NetworkMessage>();
+	message->write<uint8_t>(PACKET_CHANGE_LIST);
+	message->write<std::string>(data);
+	send(message);
+
+	// Keep the oldest timestamp if the node is already in flight
+	pending.emplace(getNodeId(anchor), std::chrono::steady_clock::now());
+	++changesSent;
+
+	scheduleChange(delay);
+}
+
+void LiveBenchmarkClient::scheduleChange(uint32_t delay) {
+	timer.expires_after(std::chrono::milliseconds(delay));
+	timer.async_wait([this](const boost::system::error_code& error) -> void {
+		if (!error && state == STATE_ACTIVE) {
+			sendChange();
+		}
+	});
+}
+
+uint32_t LiveBenchmarkClient::getNodeId(const Position& position) {
+	return ((position.x >> 2) << 18) | ((position.y >> 2) << 4) | (position.z > GROUND_LAYER ? 1 : 0);
+}
+
+//=============================================================================
+// LiveBenchmark
+
+LiveBenchmark::LiveBenchmark(Editor& editor, const LiveBenchmarkOptions& options) :
+	editor(editor),
+	server(nullptr),
+	options(options),
+	service(),
+	thread(),
+	clients(),
+	replay(),
+	groundId(0),
+	clientVersion(0),
+	origin(),
+	startCpuTime(0.0),
+	serverCpuTime(0.0),
+	elapsed(0.0),
+	finished(false),
+	exitCode(1) {
+	////
+}
+
+LiveBenchmark::~LiveBenchmark() {
+	stop();
+}
+
+bool LiveBenchmark::start(wxString& error) {
+	if (editor.IsLive()) {
+		error = "The benchmark needs a local map to host.";
+		return false;
+	}
+
+	if (!options.replayFile.empty() && !LiveChangeRecorder::load(options.replayFile, replay)) {
+		error = "Could not read any change lists from " + options.replayFile + ".";
+		return false;
+	}
+
+	for (uint16_t id = 1; id <= g_items.getMaxID(); ++id) {
+		if (g_items.typeExists(id) && g_items[id].isGroundTile()) {
+			groundId = id;
+			break;
+		}
+	}
+
+	if (groundId == 0 && replay.empty()) {
+		error = "No ground item found to paint with, load a client version first.";
+		return false;
+	}
+
+	clientVersion = g_gui.GetCurrentVersionID();
+	origin = Position(editor.map.getWidth() / 2, editor.map.getHeight() / 2, GROUND_LAYER);
+
+	server = editor.StartLiveServer();
+	server->setName("Benchmark");
+	server->setPort(options.port);
+	if (!server->bind()) {
+		error = server->getLastError();
+		editor.CloseLiveServer();
+		server = nullptr;
+		return false;
+	}
+	server->createLogWindow(g_gui.tabbook);
+
+	for (uint32_t index = 0; index < options.clients; ++index) {
+		clients.emplace_back(newd LiveBenchmarkClient(*this, service, index));
+		clients.back()->connect(server->getPort());
+	}
+
+	// Every client always has a read or a timer pending, so the loop only
+	// runs dry once all of them are closed
+	thread = std::thread([this]() -> void {
+		try {
+			service.run();
+		} catch (std::exception& e) {
+			std::cout << "Live benchmark client error: " << e.what() << std::endl;
+		}
+	});
+
+	startTime = std::chrono::steady_clock::now();
+	deadline = startTime + std::chrono::seconds(options.seconds);
+	startCpuTime = getThreadCpuTime();
+
+	wxTimer::Start(250);
+	return true;
+}
+
+void LiveBenchmark::stop() {
+	wxTimer::Stop();
+	if (!thread.joinable()) {
+		return;
+	}
+
+	// Closing aborts every pending read and timer, after which the loop runs
+	// out of work and the thread returns on its own
+	boost::asio::post(service, [this]() -> void {
+		for (auto& client : clients) {
+			client->close();
+		}
+	});
+	thread.join();
+}
+
+void LiveBenchmark::Notify() {
+	// Give changes sent just before the deadline a second to come back
+	if (finished || std::chrono::steady_clock::now() < deadline + std::chrono::seconds(1)) {
+		return;
+	}
+	finish();
+}
+
+void LiveBenchmark::finish() {
+	serverCpuTime = getThreadCpuTime() - startCpuTime;
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	stop();
+
+	finished = true;
+
+	size_t samples = 0;
+	size_t active = 0;
+	for (const auto& client : clients) {
+		samples += client->getLatencies().size();
+		if (client->isHealthy()) {
+			++active;
+		}
+	}
+	exitCode = (active == clients.size() && samples > 0) ? 0 : 1;
+
+	const std::string& report = getReport();
+	std::cout << report << std::flush;
+	if (!options.reportFile.empty()) {
+		std::ofstream out(options.reportFile.ToStdString(), std::ios::trunc);
+		out << report;
+	}
+
+	const int code = exitCode;
+	wxTheApp->CallAfter([code]() {
+		wxEventLoopBase* loop = wxEventLoopBase::GetActive();
+		if (loop) {
+			loop->Exit(code);
+		}
+	});
+}
+
+std::string LiveBenchmark::getReport() const {
+	std::vector<double> latencies;
+	size_t active = 0;
+	for (const auto& client : clients) {
+		const std::vector<double>& samples = client->getLatencies();
+		latencies.insert(latencies.end(), samples.begin(), samples.end());
+		if (client->isHealthy()) {
+			++active;
+		}
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	auto percentile = [&latencies](double p) -> double {
+		if (latencies.empty()) {
+			return 0.0;
+		}
+		size_t index = static_cast<size_t>(p * (latencies.size() - 1) + 0.5);
+		return latencies[std::min(index, latencies.size() - 1)];
+	};
+
+	const double seconds = std::max(elapsed, 0.001);
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(2);
+	out << "Live benchmark report" << std::endl;
+	out << "  clients: " << clients.size() << " (" << active << " active)"
+		<< ", duration: " << elapsed << " s"
+		<< ", view: " << options.viewSize << "x" << options.viewSize
+		<< ", map: " << (options.mapFile.empty() ? std::string("blank") : nstr(options.mapFile))
+		<< ", source: " << (replay.empty() ? std::string("synthetic") : nstr(options.replayFile))
+		<< std::endl;
+	out << "  edit-to-visible latency: " << latencies.size() << " samples"
+		<< ", p50 " << percentile(0.50) << " ms"
+		<< ", p99 " << percentile(0.99) << " ms"
+		<< ", max " << (latencies.empty() ? 0.0 : latencies.back()) << " ms" << std::endl;
+	out << "  server cpu (main thread): " << serverCpuTime << " s"
+		<< " (" << (100.0 * serverCpuTime / seconds) << "% of wall time)" << std::endl;
+
+	out << "  client  changes  nodes  sent B/s  received B/s" << std::endl;
+	for (const auto& client : clients) {
+		out << "  " << std::setw(6) << client->getIndex()
+			<< "  " << std::setw(7) << client->getChangesSent()
+			<< "  " << std::setw(5) << client->getNodesReceived()
+			<< "  " << std::setw(8) << (client->getBytesSent() / seconds)
+			<< "  " << std::setw(12) << (client->getBytesReceived() / seconds)
+			<< std::endl;
+	}
+	return out.str();
+}
+
+double LiveBenchmark::getThreadCpuTime() {
+#ifdef __WINDOWS__
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+		return 0.0;
+	}
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) / 1e7;
+#else
+	timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+		return 0.0;
+	}
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
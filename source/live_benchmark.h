@@ -0,0 +1,240 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _RME_LIVE_BENCHMARK_H_
+#define _RME_LIVE_BENCHMARK_H_
+
+#include "position.h"
+#include "net_connection.h"
+#include "live_packets.h"
+#include "filehandle.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+class Editor;
+class LiveServer;
+class LiveBenchmark;
+
+// A change list as it was received by a live server, used to replay real
+// editing sessions against the benchmark.
+struct RecordedChange {
+	uint32_t delay; // milliseconds since the previous change
+	Position anchor; // position of the first tile in the change list
+	std::string data;
+};
+
+// Appends every change list received by a live server to a file.
+// Enabled from the command line with "-live-record <file>".
+class LiveChangeRecorder {
+public:
+	LiveChangeRecorder();
+	~LiveChangeRecorder();
+
+	bool open(const wxString& path);
+	void close();
+	bool isOpen() const {
+		return file.is_open();
+	}
+
+	void record(const std::string& data, const Position& anchor);
+
+	static bool load(const wxString& path, std::vector<RecordedChange>& changes);
+
+	// Path every new live server starts recording to, empty when disabled
+	static wxString defaultPath;
+
+private:
+	std::ofstream file;
+	std::chrono::steady_clock::time_point last;
+};
+
+struct LiveBenchmarkOptions {
+	LiveBenchmarkOptions() :
+		clients(8), seconds(30), viewSize(64), changesPerSecond(10), port(31400) { }
+
+	// Parses "key=value" pairs, returns false on an unknown key
+	bool parse(const wxString& argument);
+
+	uint32_t clients;
+	uint32_t seconds;
+	uint32_t viewSize; // side of each client's viewport, in tiles
+	uint32_t changesPerSecond;
+	uint16_t port;
+	wxString mapFile; // map to host, a blank map when empty
+	wxString replayFile;
+	wxString reportFile;
+};
+
+// A scripted client speaking the live protocol on a raw socket, it does not
+// create an editor of its own so many of them can share one process.
+class LiveBenchmarkClient {
+public:
+	LiveBenchmarkClient(LiveBenchmark& benchmark, boost::asio::io_context& service, uint32_t index);
+	~LiveBenchmarkClient();
+
+	void connect(uint16_t port);
+	void close();
+
+	// Joined the session and was never disconnected
+	bool isHealthy() const {
+		return joined && !dropped;
+	}
+
+	uint32_t getIndex() const {
+		return index;
+	}
+	uint64_t getBytesSent() const {
+		return bytesSent;
+	}
+	uint64_t getBytesReceived() const {
+		return bytesReceived;
+	}
+	uint64_t getNodesReceived() const {
+		return nodesReceived;
+	}
+	uint64_t getChangesSent() const {
+		return changesSent;
+	}
+	const std::vector<double>& getLatencies() const {
+		return latencies;
+	}
+
+protected:
+	enum State {
+		STATE_CONNECTING,
+		STATE_HELLO,
+		STATE_READY,
+		STATE_ACTIVE,
+		STATE_CLOSED,
+	};
+
+	void receiveHeader();
+	void receive(uint32_t packetSize);
+	void parsePacket();
+
+	void send(const std::shared_ptr<NetworkMessage>& message);
+	void flush();
+
+	void sendHello();
+	void sendReady();
+	void sendNodeRequests();
+	void sendChange();
+	void scheduleChange(uint32_t delay);
+
+	static uint32_t getNodeId(const Position& position);
+
+	LiveBenchmark& benchmark;
+	boost::asio::ip::tcp::socket socket;
+	boost::asio::steady_timer timer;
+
+	NetworkMessage readMessage;
+	std::deque<std::shared_ptr<NetworkMessage>> outgoing;
+
+	// Nodes we changed and are waiting to see broadcasted back
+	std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> pending;
+	std::vector<double> latencies;
+
+	uint32_t index;
+	State state;
+	Position center;
+	size_t replayIndex;
+	std::minstd_rand random;
+	MemoryNodeFileWriteHandle writer;
+
+	bool joined;
+	bool dropped;
+
+	uint64_t bytesSent;
+	uint64_t bytesReceived;
+	uint64_t nodesReceived;
+	uint64_t changesSent;
+};
+
+// Hosts a live server on the loopback interface and drives it with scripted
+// clients, then reports latency, server time and traffic per client.
+// Started from the command line with "-live-benchmark [key=value ...]".
+class LiveBenchmark : public wxTimer {
+public:
+	LiveBenchmark(Editor& editor, const LiveBenchmarkOptions& options);
+	~LiveBenchmark();
+
+	bool start(wxString& error);
+	void stop();
+
+	bool isFinished() const {
+		return finished;
+	}
+	int getExitCode() const {
+		return exitCode;
+	}
+
+	std::string getReport() const;
+
+	void Notify();
+
+	const LiveBenchmarkOptions& getOptions() const {
+		return options;
+	}
+	const std::vector<RecordedChange>& getReplay() const {
+		return replay;
+	}
+	uint16_t getGroundId() const {
+		return groundId;
+	}
+	uint32_t getClientVersion() const {
+		return clientVersion;
+	}
+	const Position& getOrigin() const {
+		return origin;
+	}
+	std::chrono::steady_clock::time_point getDeadline() const {
+		return deadline;
+	}
+
+private:
+	void finish();
+
+	static double getThreadCpuTime();
+
+	Editor& editor;
+	LiveServer* server;
+	LiveBenchmarkOptions options;
+
+	boost::asio::io_context service;
+	std::thread thread;
+	std::vector<std::unique_ptr<LiveBenchmarkClient>> clients;
+
+	std::vector<RecordedChange> replay;
+	uint16_t groundId;
+	uint32_t clientVersion;
+	Position origin;
+
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point deadline;
+	double startCpuTime;
+	double serverCpuTime;
+	double elapsed;
+
+	bool finished;
+	int exitCode;
+};
+
+#endif
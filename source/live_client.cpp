@@ -23,23 +23,17 @@
 #include "editor.h"
 
 #include <wx/event.h>
-#include <fstream>
 
 LiveClient::LiveClient() :
 	LiveSocket(),
-	readMessage(), queryNodeList(), currentOperation(),
+	readMessage(), queryNodeList(), queryRegionList(), prefetchRegion(),
+	viewportX(0), viewportY(0), velocityX(0), velocityY(0), viewportZoom(0), currentOperation(),
 	resolver(nullptr), socket(nullptr), editor(nullptr), stopped(false), isDrawingReady(false) {
 	// Initialize buffer with minimum size to prevent "size 0" errors
 	readMessage.buffer.resize(1024);
 	readMessage.position = 0;
-	
-	// Log initialization to file only to help with debugging
-	std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "client_init.log").ToStdString(), std::ios::app);
-	if (logFile.is_open()) {
-		wxDateTime now = wxDateTime::Now();
-		logFile << now.FormatISOCombined() << ": LiveClient initialized\n";
-		logFile.close();
-	}
+
+	logMessage("[Client]: LiveClient initialized", LIVE_LOG_DEBUG);
 }
 
 LiveClient::~LiveClient() {
@@ -275,8 +269,6 @@ void LiveClient::receiveHeader() {
 	}
 	
 	try {
-		logMessage("[Client]: Waiting for incoming packet header...");
-		
 		boost::asio::async_read(*socket, boost::asio::buffer(readMessage.buffer, 4), 
 			[this](const boost::system::error_code& error, size_t bytesReceived) -> void {
 				if (error) {
@@ -315,7 +307,6 @@ void LiveClient::receiveHeader() {
 				} else {
 					// Successfully received header, now receive the packet
 					uint32_t packetSize = readMessage.read<uint32_t>();
-					logMessage(wxString::Format("[Client]: Received header, packet size: %u bytes", packetSize));
 					
 					// Check for zero packet size
 					if (packetSize == 0) {
@@ -345,8 +336,6 @@ void LiveClient::receive(uint32_t packetSize) {
 	// Resize buffer to accommodate the incoming packet
 	readMessage.buffer.resize(readMessage.position + packetSize);
 	
-	logMessage(wxString::Format("[Client]: Reading packet body (%u bytes)", packetSize));
-	
 	boost::asio::async_read(*socket, boost::asio::buffer(&readMessage.buffer[readMessage.position], packetSize), 
 	[this, packetSize](const boost::system::error_code& error, size_t bytesReceived) -> void {
 		if (error) {
@@ -388,8 +377,8 @@ void LiveClient::receive(uint32_t packetSize) {
 			});
 		} else {
 			// Successfully received the complete packet
-			logMessage(wxString::Format("[Client]: Successfully received complete packet (%zu bytes)", bytesReceived));
-			
+			g_live_log.countPacket(false, readMessage.buffer[4], bytesReceived + 4);
+
 			wxTheApp->CallAfter([this]() {
 				parsePacket(std::move(readMessage));
 				receiveHeader();
@@ -408,29 +397,7 @@ void LiveClient::send(NetworkMessage& message) {
 	// Write size to the first 4 bytes (header)
 	memcpy(&message.buffer[0], &message.size, 4);
 	
-	// Log the message we're sending
-	logMessage(wxString::Format("[Client]: Sending packet to server (size: %zu bytes)", 
-		message.size + 4));
-	
-	try {
-		boost::asio::async_write(*socket, 
-			boost::asio::buffer(message.buffer, message.size + 4), 
-			[this, msgSize = message.size](const boost::system::error_code& error, size_t bytesTransferred) -> void {
-				if (error) {
-					logMessage(wxString::Format("[Client]: Error sending packet to server: %s", 
-						error.message()));
-				} else if (bytesTransferred != msgSize + 4) {
-					logMessage(wxString::Format("[Client]: Incomplete packet sent to server [sent: %zu, expected: %zu]", 
-						bytesTransferred, msgSize + 4));
-				} else {
-					logMessage(wxString::Format("[Client]: Successfully sent packet to server (%zu bytes)", 
-						bytesTransferred));
-				}
-			}
-		);
-	} catch (std::exception& e) {
-		logMessage(wxString::Format("[Client]: Exception sending packet to server: %s", e.what()));
-	}
+	sendWithoutLogging(message);
 }
 
 void LiveClient::updateCursor(const Position& position) {
@@ -461,22 +428,27 @@ void LiveClient::sendWithoutLogging(NetworkMessage& message) {
 	
 	// Write size to the first 4 bytes (header)
 	memcpy(&message.buffer[0], &message.size, 4);
-	
+
+	// Packets are counted rather than logged, the log reports rates per type
+	g_live_log.countPacket(true, message.buffer[4], message.size + 4);
+
 	try {
+		// The message usually lives on the caller's stack, keep the bytes alive until written
+		auto buffer = std::make_shared<std::vector<uint8_t>>(message.buffer.begin(), message.buffer.begin() + message.size + 4);
 		boost::asio::async_write(*socket, 
-			boost::asio::buffer(message.buffer, message.size + 4), 
-			[this, msgSize = message.size](const boost::system::error_code& error, size_t bytesTransferred) -> void {
+			boost::asio::buffer(*buffer), 
+			[this, buffer](const boost::system::error_code& error, size_t bytesTransferred) -> void {
 				if (error) {
 					logMessage(wxString::Format("[Client]: Error sending packet to server: %s", 
-						error.message()));
-				} else if (bytesTransferred != msgSize + 4) {
+						error.message()), LIVE_LOG_ERROR);
+				} else if (bytesTransferred != buffer->size()) {
 					logMessage(wxString::Format("[Client]: Incomplete packet sent to server [sent: %zu, expected: %zu]", 
-						bytesTransferred, msgSize + 4));
+						bytesTransferred, buffer->size()), LIVE_LOG_WARNING);
 				}
 			}
 		);
 	} catch (std::exception& e) {
-		logMessage(wxString::Format("[Client]: Exception sending packet to server: %s", e.what()));
+		logMessage(wxString::Format("[Client]: Exception sending packet to server: %s", e.what()), LIVE_LOG_ERROR);
 	}
 }
 
@@ -526,20 +498,32 @@ void LiveClient::sendHello() {
 }
 
 void LiveClient::sendNodeRequests() {
-	if (queryNodeList.empty()) {
+	if (queryNodeList.empty() && queryRegionList.empty()) {
 		return;
 	}
 
 	NetworkMessage message;
-	message.write<uint8_t>(PACKET_REQUEST_NODES);
+	if (!queryNodeList.empty()) {
+		message.write<uint8_t>(PACKET_REQUEST_NODES);
 
-	message.write<uint32_t>(queryNodeList.size());
-	for (uint32_t node : queryNodeList) {
-		message.write<uint32_t>(node);
+		message.write<uint32_t>(queryNodeList.size());
+		for (uint32_t node : queryNodeList) {
+			message.write<uint32_t>(node);
+		}
+	}
+
+	for (const NodeRegion& region : queryRegionList) {
+		message.write<uint8_t>(PACKET_REQUEST_NODE_REGION);
+		message.write<uint16_t>(region.startX);
+		message.write<uint16_t>(region.startY);
+		message.write<uint16_t>(region.endX);
+		message.write<uint16_t>(region.endY);
+		message.write<uint8_t>(region.underground ? 1 : 0);
 	}
 
 	send(message);
 	queryNodeList.clear();
+	queryRegionList.clear();
 }
 
 void LiveClient::sendChanges(DirtyList& dirtyList) {
@@ -619,14 +603,97 @@ void LiveClient::queryNode(int32_t ndx, int32_t ndy, bool underground) {
 	queryNodeList.insert(nd);
 }
 
+void LiveClient::updateViewport(int startX, int startY, int endX, int endY, int floor, double zoom) {
+	if (!editor) {
+		return;
+	}
+
+	// How far ahead of the scroll direction we prefetch, and the ring around the view
+	const double lookahead = 0.5; // seconds
+	const int minimumMargin = 8; // tiles
+
+	const auto now = std::chrono::steady_clock::now();
+	const double elapsed = std::chrono::duration<double>(now - viewportTime).count();
+	const double centerX = (startX + endX) / 2.0;
+	const double centerY = (startY + endY) / 2.0;
+	const double zoomRatio = viewportZoom > 0 ? zoom / viewportZoom : 1.0;
+
+	if (viewportZoom <= 0 || elapsed > 0.5) {
+		// First frame, or the view sat still for a while
+		velocityX = 0;
+		velocityY = 0;
+	} else if (elapsed > 0.001) {
+		velocityX = velocityX * 0.7 + (centerX - viewportX) / elapsed * 0.3;
+		velocityY = velocityY * 0.7 + (centerY - viewportY) / elapsed * 0.3;
+	}
+
+	viewportTime = now;
+	viewportX = centerX;
+	viewportY = centerY;
+	viewportZoom = zoom;
+
+	const int width = endX - startX;
+	const int height = endY - startY;
+
+	int marginX = std::max(minimumMargin, width / 4);
+	int marginY = std::max(minimumMargin, height / 4);
+	if (zoomRatio > 1.0) {
+		// Zooming out, make room for the next step as well
+		marginX += static_cast<int>(width * (zoomRatio - 1.0));
+		marginY += static_cast<int>(height * (zoomRatio - 1.0));
+	}
+
+	const int aheadX = std::clamp(static_cast<int>(velocityX * lookahead), -width, width);
+	const int aheadY = std::clamp(static_cast<int>(velocityY * lookahead), -height, height);
+
+	NodeRegion region;
+	region.startX = std::max(0, startX - marginX + std::min(0, aheadX)) >> 2;
+	region.startY = std::max(0, startY - marginY + std::min(0, aheadY)) >> 2;
+	region.endX = std::clamp(endX + marginX + std::max(0, aheadX), 0, MAP_MAX_WIDTH) >> 2;
+	region.endY = std::clamp(endY + marginY + std::max(0, aheadY), 0, MAP_MAX_HEIGHT) >> 2;
+	region.underground = floor > GROUND_LAYER;
+
+	if (region == prefetchRegion) {
+		return;
+	}
+	prefetchRegion = region;
+
+	// Only ask for the bounding box of nodes we have neither received nor requested,
+	// the server skips whatever it has already sent us inside of it
+	NodeRegion request = region;
+	request.startX = region.endX;
+	request.startY = region.endY;
+	request.endX = region.startX;
+	request.endY = region.startY;
+
+	bool empty = true;
+	Map& map = editor->map;
+	for (int nx = region.startX; nx <= region.endX; ++nx) {
+		for (int ny = region.startY; ny <= region.endY; ++ny) {
+			QTreeNode* node = map.createLeaf(nx * 4, ny * 4);
+			if (!node || node->isVisible(region.underground) || node->isRequested(region.underground)) {
+				continue;
+			}
+
+			node->setRequested(region.underground, true);
+			request.startX = std::min<uint16_t>(request.startX, nx);
+			request.startY = std::min<uint16_t>(request.startY, ny);
+			request.endX = std::max<uint16_t>(request.endX, nx);
+			request.endY = std::max<uint16_t>(request.endY, ny);
+			empty = false;
+		}
+	}
+
+	if (!empty) {
+		queryRegionList.push_back(request);
+	}
+}
+
 void LiveClient::parsePacket(NetworkMessage message) {
 	uint8_t packetType;
 	
 	try {
 		while (message.position < message.buffer.size()) {
-			// Log packet position for debugging
-			size_t packetStart = message.position;
-			
 			// Check if we have at least 1 byte to read the packet type
 			if (message.position + 1 > message.buffer.size()) {
 				logMessage("[Client]: Warning - incomplete packet at end of buffer, ignoring");
@@ -634,9 +701,7 @@ void LiveClient::parsePacket(NetworkMessage message) {
 			}
 			
 			packetType = message.read<uint8_t>();
-			logMessage(wxString::Format("[Client]: Parsing packet type 0x%02X at position %zu", 
-				packetType, packetStart));
-				
+
 			try {
 				switch (packetType) {
 					case PACKET_HELLO_FROM_SERVER:
@@ -708,13 +773,8 @@ void LiveClient::parseKick(NetworkMessage& message) {
 
 void LiveClient::parseClientAccepted(NetworkMessage& message) {
 	try {
-		// Write to a diagnostic file instead of UI logging to prevent crashes
-		std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "client_status.log").ToStdString(), std::ios::app);
-		if (logFile.is_open()) {
-			wxDateTime now = wxDateTime::Now();
-			logFile << now.FormatISOCombined() << ": Client accepted, setting up cursor\n";
-		}
-		
+		logMessage("[Client]: Client accepted, setting up cursor");
+
 		// Initialize the host's cursor when we're accepted
 		LiveCursor hostCursor;
 		hostCursor.id = 0; // Host is always ID 0
@@ -731,32 +791,14 @@ void LiveClient::parseClientAccepted(NetworkMessage& message) {
 			// Set the ready flag in a deferred way to ensure all initialization is complete
 			if (!stopped) {
 				isDrawingReady = true;
-				
-				// Write to diagnostic file
-				std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "client_status.log").ToStdString(), std::ios::app);
-				if (logFile.is_open()) {
-					wxDateTime now = wxDateTime::Now();
-					logFile << now.FormatISOCombined() << ": Drawing ready flag set to true\n";
-					logFile.close();
-				}
+				logMessage("[Client]: Drawing ready flag set to true", LIVE_LOG_DEBUG);
 			}
 		});
-		
-		if (logFile.is_open()) {
-			logFile << "Ready flag setup queued\n";
-			logFile.close();
-		}
-		
+
 		sendReady();
 	}
 	catch (const std::exception& e) {
-		// Log error to file
-		std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "client_error.log").ToStdString(), std::ios::app);
-		if (logFile.is_open()) {
-			wxDateTime now = wxDateTime::Now();
-			logFile << now.FormatISOCombined() << ": Error in parseClientAccepted: " << e.what() << "\n";
-			logFile.close();
-		}
+		logMessage(wxString::Format("[Client]: Error in parseClientAccepted: %s", e.what()), LIVE_LOG_ERROR);
 	}
 }
 
@@ -790,10 +832,6 @@ void LiveClient::parseNode(NetworkMessage& message) {
 		int32_t ndy = (nodeid >> 4) & 0x3FFF;
 		bool underground = (nodeid & 1) == 1;
 
-		// Log node reception for debugging
-		logMessage(wxString::Format("[Client]: Received node update [%d,%d,%s]", 
-			ndx, ndy, underground ? "underground" : "surface"));
-
 		// Queue the node processing on the main thread to avoid threading issues
 		wxTheApp->CallAfter([this, message = std::move(message), ndx, ndy, underground]() mutable {
 			if (!editor) {
@@ -811,10 +849,6 @@ void LiveClient::parseNode(NetworkMessage& message) {
 				editor->actionQueue->addAction(action);
 				g_gui.RefreshView();
 				g_gui.UpdateMinimap();
-
-				logMessage(wxString::Format("[Client]: Applying node update [%d,%d,%s]", 
-					ndx, ndy, underground ? "underground" : "surface"));
-				logMessage("[Client]: Node update applied successfully.");
 			} else {
 				// Use proper action destruction
 				
@@ -22,6 +22,7 @@
 #include "net_connection.h"
 
 #include <set>
+#include <chrono>
 
 class DirtyList;
 class MapTab;
@@ -69,6 +70,9 @@ public:
 
 	// Flags a node as queried and stores it, need to call SendNodeRequest to send it to server
 	void queryNode(int32_t ndx, int32_t ndy, bool underground);
+	// Called every frame with the visible tile rectangle, queues the viewport plus
+	// a ring of nodes ahead of the scroll direction as a single region request
+	void updateViewport(int startX, int startY, int endX, int endY, int floor, double zoom);
 
 protected:
 	void parsePacket(NetworkMessage message);
@@ -88,7 +92,26 @@ protected:
 	//
 	NetworkMessage readMessage;
 
+	struct NodeRegion {
+		// Inclusive, in nodes
+		uint16_t startX, startY;
+		uint16_t endX, endY;
+		bool underground;
+
+		bool operator==(const NodeRegion& other) const {
+			return startX == other.startX && startY == other.startY && endX == other.endX && endY == other.endY && underground == other.underground;
+		}
+	};
+
 	std::set<uint32_t> queryNodeList;
+	std::vector<NodeRegion> queryRegionList;
+
+	// Viewport tracking for prefetching
+	NodeRegion prefetchRegion;
+	std::chrono::steady_clock::time_point viewportTime;
+	double viewportX, viewportY;
+	double velocityX, velocityY; // tiles per second, smoothed
+	double viewportZoom;
 	wxString currentOperation;
 
 	std::shared_ptr<boost::asio::ip::tcp::resolver> resolver;
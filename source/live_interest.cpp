@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "live_interest.h"
+
+#include <algorithm>
+
+LiveInterestMap::LiveInterestMap() {
+	////
+}
+
+LiveInterestMap::~LiveInterestMap() {
+	////
+}
+
+void LiveInterestMap::insert(uint32_t clientId, int32_t ndx, int32_t ndy, bool underground) {
+	const uint32_t key = getBlockKey(ndx, ndy, underground);
+	const uint32_t index = getBitIndex(ndx, ndy);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<Bitmap>& bitmaps = blocks[key];
+	auto it = std::find_if(bitmaps.begin(), bitmaps.end(), [clientId](const Bitmap& bitmap) {
+		return bitmap.clientId == clientId;
+	});
+	if (it == bitmaps.end()) {
+		bitmaps.push_back(Bitmap { clientId, {} });
+		clientBlocks[clientId].push_back(key);
+		it = bitmaps.end() - 1;
+	}
+	it->bits[index >> 6] |= static_cast<uint64_t>(1) << (index & 63);
+}
+
+bool LiveInterestMap::contains(uint32_t clientId, int32_t ndx, int32_t ndy, bool underground) const {
+	const uint32_t index = getBitIndex(ndx, ndy);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto block = blocks.find(getBlockKey(ndx, ndy, underground));
+	if (block == blocks.end()) {
+		return false;
+	}
+
+	for (const Bitmap& bitmap : block->second) {
+		if (bitmap.clientId == clientId) {
+			return (bitmap.bits[index >> 6] & (static_cast<uint64_t>(1) << (index & 63))) != 0;
+		}
+	}
+	return false;
+}
+
+void LiveInterestMap::query(int32_t ndx, int32_t ndy, bool underground, std::vector<uint32_t>& result) const {
+	const uint32_t index = getBitIndex(ndx, ndy);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto block = blocks.find(getBlockKey(ndx, ndy, underground));
+	if (block == blocks.end()) {
+		return;
+	}
+
+	for (const Bitmap& bitmap : block->second) {
+		if ((bitmap.bits[index >> 6] & (static_cast<uint64_t>(1) << (index & 63))) != 0) {
+			result.push_back(bitmap.clientId);
+		}
+	}
+}
+
+void LiveInterestMap::removeClient(uint32_t clientId) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = clientBlocks.find(clientId);
+	if (it == clientBlocks.end()) {
+		return;
+	}
+
+	for (uint32_t key : it->second) {
+		auto block = blocks.find(key);
+		if (block == blocks.end()) {
+			continue;
+		}
+
+		std::vector<Bitmap>& bitmaps = block->second;
+		bitmaps.erase(std::remove_if(bitmaps.begin(), bitmaps.end(), [clientId](const Bitmap& bitmap) {
+			return bitmap.clientId == clientId;
+		}), bitmaps.end());
+
+		if (bitmaps.empty()) {
+			blocks.erase(block);
+		}
+	}
+	clientBlocks.erase(it);
+}
+
+void LiveInterestMap::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	blocks.clear();
+	clientBlocks.clear();
+}
+
+size_t LiveInterestMap::getBlockCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return blocks.size();
+}
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _RME_LIVE_INTEREST_H_
+#define _RME_LIVE_INTEREST_H_
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Server side record of which nodes every live client has been sent, and so
+// must be kept up to date. Nodes are grouped in blocks of 16x16 and each block
+// stores a bitmap for every client that has any node inside of it, so finding
+// the clients of a node only looks at the clients around it.
+class LiveInterestMap {
+public:
+	LiveInterestMap();
+	~LiveInterestMap();
+
+	void insert(uint32_t clientId, int32_t ndx, int32_t ndy, bool underground);
+	bool contains(uint32_t clientId, int32_t ndx, int32_t ndy, bool underground) const;
+
+	// Appends the clients that have the node to result
+	void query(int32_t ndx, int32_t ndy, bool underground, std::vector<uint32_t>& result) const;
+
+	void removeClient(uint32_t clientId);
+	void clear();
+
+	size_t getBlockCount() const;
+
+private:
+	enum {
+		BLOCK_BITS = 4,
+		BLOCK_SIZE = 1 << BLOCK_BITS,
+		BLOCK_WORDS = BLOCK_SIZE * BLOCK_SIZE / 64,
+	};
+
+	struct Bitmap {
+		uint32_t clientId;
+		uint64_t bits[BLOCK_WORDS];
+	};
+
+	static uint32_t getBlockKey(int32_t ndx, int32_t ndy, bool underground) {
+		return ((ndx >> BLOCK_BITS) << 16) | ((ndy >> BLOCK_BITS) << 1) | (underground ? 1 : 0);
+	}
+	static uint32_t getBitIndex(int32_t ndx, int32_t ndy) {
+		return ((ndx & (BLOCK_SIZE - 1)) << BLOCK_BITS) | (ndy & (BLOCK_SIZE - 1));
+	}
+
+	std::unordered_map<uint32_t, std::vector<Bitmap>> blocks;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> clientBlocks; // for removal
+
+	mutable std::mutex mutex;
+};
+
+#endif
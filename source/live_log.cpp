@@ -0,0 +1,207 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "live_log.h"
+
+#include <chrono>
+
+LiveLogger g_live_log;
+
+namespace {
+	const char* levelNames[] = { "debug", "info", "warning", "error" };
+
+	int64_t getTime() {
+		using namespace std::chrono;
+		return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	}
+}
+
+LiveLogger::LiveLogger() :
+	slots(newd Slot[CAPACITY]), tail(0), head(0), reported(), dropped(0),
+	level(LIVE_LOG_INFO), statsInterval(5), running(false) {
+	for (size_t i = 0; i < CAPACITY; ++i) {
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	for (auto& direction : counters) {
+		for (Counter& counter : direction) {
+			counter.packets.store(0, std::memory_order_relaxed);
+			counter.bytes.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+LiveLogger::~LiveLogger() {
+	stop();
+}
+
+void LiveLogger::start(const wxString& path) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (running) {
+		return;
+	}
+
+	file.open(path.ToStdString(), std::ios::app);
+	running = true;
+	thread = std::thread(&LiveLogger::run, this);
+}
+
+void LiveLogger::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!running) {
+			return;
+		}
+		running = false;
+	}
+	wake.notify_all();
+	thread.join();
+	file.close();
+}
+
+void LiveLogger::setLevel(int newLevel) {
+	level.store(std::min<int>(std::max<int>(newLevel, LIVE_LOG_DEBUG), LIVE_LOG_NONE), std::memory_order_relaxed);
+}
+
+void LiveLogger::setStatsInterval(int seconds) {
+	statsInterval.store(seconds, std::memory_order_relaxed);
+}
+
+void LiveLogger::write(LiveLogLevel messageLevel, const wxString& message) {
+	if (!isEnabled(messageLevel)) {
+		return;
+	}
+
+	// Bounded multi-producer queue, every slot carries the position it is free for
+	size_t position = tail.load(std::memory_order_relaxed);
+	Slot* slot;
+	while (true) {
+		slot = &slots[position & (CAPACITY - 1)];
+		const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+		if (difference == 0) {
+			if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			position = tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	const wxScopedCharBuffer text = message.ToUTF8();
+	slot->time = getTime();
+	slot->level = static_cast<uint8_t>(messageLevel);
+	slot->length = static_cast<uint16_t>(std::min<size_t>(text.length(), LINE_SIZE));
+	memcpy(slot->text, text.data(), slot->length);
+	slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+void LiveLogger::countPacket(bool outgoing, uint8_t type, size_t bytes) {
+	Counter& counter = counters[outgoing ? 1 : 0][type];
+	counter.packets.fetch_add(1, std::memory_order_relaxed);
+	counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void LiveLogger::run() {
+	std::string batch;
+	auto lastStats = std::chrono::steady_clock::now();
+
+	bool stopping = false;
+	while (!stopping) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait_for(lock, std::chrono::milliseconds(250), [this] { return !running; });
+			stopping = !running;
+		}
+
+		batch.clear();
+		drain(batch);
+
+		const auto now = std::chrono::steady_clock::now();
+		const double elapsed = std::chrono::duration<double>(now - lastStats).count();
+		const int interval = statsInterval.load(std::memory_order_relaxed);
+		if ((interval > 0 && elapsed >= interval) || stopping) {
+			writeStats(batch, elapsed);
+			lastStats = now;
+		}
+
+		if (!batch.empty() && file.is_open()) {
+			file << batch;
+			file.flush();
+		}
+	}
+}
+
+void LiveLogger::drain(std::string& batch) {
+	char prefix[64];
+	while (true) {
+		Slot& slot = slots[head & (CAPACITY - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+			break;
+		}
+
+		const time_t seconds = static_cast<time_t>(slot.time / 1000);
+		tm local;
+#ifdef __WINDOWS__
+		localtime_s(&local, &seconds);
+#else
+		localtime_r(&seconds, &local);
+#endif
+		snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d [%s] ", local.tm_hour, local.tm_min, local.tm_sec, static_cast<int>(slot.time % 1000), levelNames[slot.level]);
+		batch += prefix;
+		batch.append(slot.text, slot.length);
+		batch += '\n';
+
+		slot.sequence.store(head + CAPACITY, std::memory_order_release);
+		++head;
+	}
+
+	const uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+	if (lost != 0) {
+		batch += "[warning] " + std::to_string(lost) + " log lines dropped, buffer full\n";
+	}
+}
+
+void LiveLogger::writeStats(std::string& batch, double seconds) {
+	if (seconds <= 0 || !isEnabled(LIVE_LOG_INFO)) {
+		return;
+	}
+
+	char line[128];
+	for (int direction = 0; direction < 2; ++direction) {
+		for (int type = 0; type < 256; ++type) {
+			const Counter& counter = counters[direction][type];
+			const uint64_t packets = counter.packets.load(std::memory_order_relaxed);
+			const uint64_t bytes = counter.bytes.load(std::memory_order_relaxed);
+
+			uint64_t* last = reported[direction][type];
+			if (packets == last[0]) {
+				continue;
+			}
+
+			snprintf(line, sizeof(line), "[stats] %s 0x%02X: %.1f packets/s, %.1f KB/s\n", direction ? "sent" : "received", type, (packets - last[0]) / seconds, (bytes - last[1]) / seconds / 1024.0);
+			batch += line;
+
+			last[0] = packets;
+			last[1] = bytes;
+		}
+	}
+}
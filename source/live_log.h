@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _RME_LIVE_LOG_H_
+#define _RME_LIVE_LOG_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+enum LiveLogLevel {
+	LIVE_LOG_DEBUG,
+	LIVE_LOG_INFO,
+	LIVE_LOG_WARNING,
+	LIVE_LOG_ERROR,
+	LIVE_LOG_NONE,
+};
+
+// Log for the live subsystem. Writers only copy the line into a lock-free ring
+// buffer, a background thread writes it to disk in batches. Packets are not
+// logged one by one but counted, and reported as rates per packet type.
+class LiveLogger {
+public:
+	LiveLogger();
+	~LiveLogger();
+
+	// Starts the flush thread the first time it is called
+	void start(const wxString& path);
+	void stop();
+
+	void setLevel(int newLevel);
+	void setStatsInterval(int seconds);
+
+	bool isEnabled(LiveLogLevel messageLevel) const {
+		return messageLevel >= level.load(std::memory_order_relaxed);
+	}
+
+	// Never blocks, drops the line when the buffer is full
+	void write(LiveLogLevel messageLevel, const wxString& message);
+
+	void countPacket(bool outgoing, uint8_t type, size_t bytes);
+
+private:
+	enum {
+		CAPACITY = 4096, // power of two
+		LINE_SIZE = 240,
+	};
+
+	struct Slot {
+		std::atomic<size_t> sequence;
+		int64_t time; // milliseconds
+		uint8_t level;
+		uint16_t length;
+		char text[LINE_SIZE];
+	};
+
+	struct Counter {
+		std::atomic<uint64_t> packets;
+		std::atomic<uint64_t> bytes;
+	};
+
+	void run();
+	void drain(std::string& batch);
+	void writeStats(std::string& batch, double seconds);
+
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<size_t> tail;
+	size_t head; // flush thread only
+
+	Counter counters[2][256];
+	uint64_t reported[2][256][2]; // flush thread only
+	std::atomic<uint64_t> dropped;
+
+	std::atomic<int> level;
+	std::atomic<int> statsInterval;
+
+	std::ofstream file;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool running;
+};
+
+extern LiveLogger g_live_log;
+
+#endif
@@ -24,6 +24,7 @@ enum LivePacketType {
 
 	PACKET_REQUEST_NODES = 0x20,
 	PACKET_CHANGE_LIST = 0x21,
+	PACKET_REQUEST_NODE_REGION = 0x22,
 	PACKET_ADD_HOUSE = 0x23,
 	PACKET_EDIT_HOUSE = 0x24,
 	PACKET_REMOVE_HOUSE = 0x25,
@@ -26,7 +26,7 @@
 
 LivePeer::LivePeer(LiveServer* server, boost::asio::ip::tcp::socket socket) :
 	LiveSocket(),
-	readMessage(), server(server), socket(std::move(socket)), color(), id(0), clientId(0), connected(false) {
+	readMessage(), server(server), socket(std::move(socket)), color(), cursor(-1, -1, -1), id(0), clientId(0), connected(false) {
 	ASSERT(server != nullptr);
 }
 
@@ -88,9 +88,7 @@ void LivePeer::receiveHeader() {
 		} else {
 			// Successfully received header
 			uint32_t packetSize = readMessage.read<uint32_t>();
-			logMessage(wxString::Format("[Client %s]: Received header, packet size: %u bytes", 
-				getHostName(), packetSize));
-				
+
 			// Prevent empty packet errors
 			if (packetSize == 0) {
 				logMessage("[Client]: Empty packet received, skipping and waiting for next header");
@@ -157,9 +155,8 @@ void LivePeer::receive(uint32_t packetSize) {
 			}
 		} else {
 			// Successfully received the complete packet
-			logMessage(wxString::Format("[Client %s]: Successfully received complete packet (%zu bytes)", 
-				getHostName(), bytesReceived));
-				
+			g_live_log.countPacket(false, readMessage.buffer[4], bytesReceived + 4);
+
 			wxTheApp->CallAfter([this]() {
 				if (connected) {
 					parseEditorPacket(std::move(readMessage));
@@ -182,33 +179,27 @@ void LivePeer::send(NetworkMessage& message) {
 	// Write size to the first 4 bytes (header)
 	memcpy(&message.buffer[0], &message.size, 4);
 	
-	// Only log non-cursor packets to reduce excessive logging
-	bool isCursorPacket = message.buffer.size() > 0 && message.buffer[4] == PACKET_CURSOR_UPDATE;
-	if (!isCursorPacket) {
-		logMessage(wxString::Format("[Server]: Sending packet to %s (size: %zu bytes, type: 0x%02X)", 
-			getHostName(), message.size + 4, message.buffer[4]));
-	}
-	
+	// Packets are counted rather than logged, the log reports rates per type
+	g_live_log.countPacket(true, message.buffer[4], message.size + 4);
+
 	try {
+		// The message usually lives on the caller's stack, keep the bytes alive until written
+		auto buffer = std::make_shared<std::vector<uint8_t>>(message.buffer.begin(), message.buffer.begin() + message.size + 4);
 		boost::asio::async_write(socket, 
-			boost::asio::buffer(message.buffer, message.size + 4), 
-			[this, msgSize = message.size, isCursorPacket](const boost::system::error_code& error, size_t bytesTransferred) -> void {
+			boost::asio::buffer(*buffer), 
+			[this, buffer](const boost::system::error_code& error, size_t bytesTransferred) -> void {
 				if (error) {
 					logMessage(wxString::Format("[Server]: Error sending packet to %s: %s", 
-						getHostName(), error.message()));
-				} else if (bytesTransferred != msgSize + 4) {
+						getHostName(), error.message()), LIVE_LOG_ERROR);
+				} else if (bytesTransferred != buffer->size()) {
 					logMessage(wxString::Format("[Server]: Incomplete packet sent to %s [sent: %zu, expected: %zu]", 
-						getHostName(), bytesTransferred, msgSize + 4));
-				} else if (!isCursorPacket) {
-					// Only log successful sends for non-cursor packets
-					logMessage(wxString::Format("[Server]: Successfully sent packet to %s (%zu bytes)", 
-						getHostName(), bytesTransferred));
+						getHostName(), bytesTransferred, buffer->size()), LIVE_LOG_WARNING);
 				}
 			}
 		);
 	} catch (std::exception& e) {
 		logMessage(wxString::Format("[Server]: Exception sending packet to %s: %s", 
-			getHostName(), e.what()));
+			getHostName(), e.what()), LIVE_LOG_ERROR);
 	}
 }
 
@@ -257,6 +248,9 @@ void LivePeer::parseEditorPacket(NetworkMessage message) {
 			case PACKET_REQUEST_NODES:
 				parseNodeRequest(message);
 				break;
+			case PACKET_REQUEST_NODE_REGION:
+				parseNodeRegionRequest(message);
+				break;
 			case PACKET_CHANGE_LIST:
 				parseReceiveChanges(message);
 				break;
@@ -551,17 +545,79 @@ void LivePeer::parseReady(NetworkMessage& message) {
 }
 
 void LivePeer::parseNodeRequest(NetworkMessage& message) {
-	Map& map = server->getEditor()->map;
-	for (uint32_t nodes = message.read<uint32_t>(); nodes != 0; --nodes) {
-		uint32_t ind = message.read<uint32_t>();
+	const uint32_t count = message.read<uint32_t>();
+
+	std::vector<uint32_t> nodes;
+	nodes.reserve(std::min<size_t>(count, (message.buffer.size() - message.position) / sizeof(uint32_t)));
+	for (uint32_t i = 0; i < count; ++i) {
+		nodes.push_back(message.read<uint32_t>());
+	}
+	sendNodes(nodes);
+}
+
+void LivePeer::parseNodeRegionRequest(NetworkMessage& message) {
+	const uint16_t startX = message.read<uint16_t>();
+	const uint16_t startY = message.read<uint16_t>();
+	const uint16_t endX = message.read<uint16_t>();
+	const uint16_t endY = message.read<uint16_t>();
+	const bool underground = message.read<uint8_t>() != 0;
+
+	const uint64_t area = static_cast<uint64_t>(endX - startX + 1) * (endY - startY + 1);
+	if (endX < startX || endY < startY || area > 0x100000) {
+		logMessage(wxString::Format("[Server]: Client %s requested an invalid node region, ignoring", name));
+		return;
+	}
 
+	LiveInterestMap& interest = server->getInterest();
+
+	std::vector<uint32_t> nodes;
+	for (uint32_t ndx = startX; ndx <= endX; ++ndx) {
+		for (uint32_t ndy = startY; ndy <= endY; ++ndy) {
+			// Nodes the client already has are kept up to date by broadcasts
+			if (interest.contains(clientId, ndx, ndy, underground)) {
+				continue;
+			}
+			nodes.push_back((ndx << 18) | (ndy << 4) | (underground ? 1 : 0));
+		}
+	}
+	sendNodes(nodes);
+}
+
+void LivePeer::sendNodes(std::vector<uint32_t>& nodes) {
+	// What the client is looking at fills in first, fall back to the middle of the request
+	int32_t focusX = cursor.x >> 2;
+	int32_t focusY = cursor.y >> 2;
+	if (!cursor.isValid() && !nodes.empty()) {
+		int64_t sumX = 0, sumY = 0;
+		for (uint32_t ind : nodes) {
+			sumX += ind >> 18;
+			sumY += (ind >> 4) & 0x3FFF;
+		}
+		focusX = static_cast<int32_t>(sumX / static_cast<int64_t>(nodes.size()));
+		focusY = static_cast<int32_t>(sumY / static_cast<int64_t>(nodes.size()));
+	}
+
+	const auto distance = [focusX, focusY](uint32_t ind) {
+		const int32_t dx = static_cast<int32_t>(ind >> 18) - focusX;
+		const int32_t dy = static_cast<int32_t>((ind >> 4) & 0x3FFF) - focusY;
+		return dx * dx + dy * dy;
+	};
+	std::stable_sort(nodes.begin(), nodes.end(), [&distance](uint32_t a, uint32_t b) {
+		return distance(a) < distance(b);
+	});
+
+	Map& map = server->getEditor()->map;
+	LiveInterestMap& interest = server->getInterest();
+	for (uint32_t ind : nodes) {
 		int32_t ndx = ind >> 18;
 		int32_t ndy = (ind >> 4) & 0x3FFF;
 		bool underground = ind & 1;
 
 		QTreeNode* node = map.createLeaf(ndx * 4, ndy * 4);
 		if (node) {
-			sendNode(clientId, node, ndx, ndy, underground ? 0xFF00 : 0x00FF);
+			// From now on the client gets every change to this node
+			interest.insert(clientId, ndx, ndy, underground);
+			sendNode(node, ndx, ndy, underground ? 0xFF00 : 0x00FF);
 		}
 	}
 }
@@ -595,17 +651,25 @@ void LivePeer::parseReceiveChanges(NetworkMessage& message) {
 				BinaryNode* tileNode = rootNode->getChild();
 				
 				bool anyChanges = false;
+				Position anchor;
 				
 				if (tileNode) {
 					do {
 						Tile* tile = readTile(tileNode, editor, nullptr);
 						if (tile) {
+							if (!anyChanges) {
+								anchor = tile->getPosition();
+							}
 							action->addChange(newd Change(tile));
 							anyChanges = true;
 						}
 					} while (tileNode->advance());
 				}
 				mapReader.close();
+
+				if (anyChanges) {
+					server->getRecorder().record(data, anchor);
+				}
 				
 				// Only add the action if we have changes
 				if (anyChanges) {
@@ -641,6 +705,7 @@ void LivePeer::parseRemoveHouse(NetworkMessage& message) {
 void LivePeer::parseCursorUpdate(NetworkMessage& message) {
 	LiveCursor cursor = readCursor(message);
 	cursor.id = clientId;
+	this->cursor = cursor.pos;
 
 	// Only log and update client list if the color changes, not for movement
 	if (cursor.color != color) {
@@ -66,6 +66,7 @@ protected:
 
 	// editor packets
 	void parseNodeRequest(NetworkMessage& message);
+	void parseNodeRegionRequest(NetworkMessage& message);
 	void parseReceiveChanges(NetworkMessage& message);
 	void parseAddHouse(NetworkMessage& message);
 	void parseEditHouse(NetworkMessage& message);
@@ -74,6 +75,9 @@ protected:
 	void parseChatMessage(NetworkMessage& message);
 	void parseClientColorUpdate(NetworkMessage& message);
 
+	// Sends the requested nodes, nearest to the client's cursor first
+	void sendNodes(std::vector<uint32_t>& nodes);
+
 	//
 	NetworkMessage readMessage;
 
@@ -81,6 +85,7 @@ protected:
 	boost::asio::ip::tcp::socket socket;
 
 	wxColor color;
+	Position cursor; // last cursor position received from the client, invalid until then
 
 	uint32_t id;
 	uint32_t clientId;
@@ -24,35 +24,26 @@
 
 #include "editor.h"
 
-#include <fstream>
 #include <wx/filename.h>
 
 LiveServer::LiveServer(Editor& editor) :
 	LiveSocket(),
 	clients(), acceptor(nullptr), socket(nullptr), editor(&editor),
-	clientIds(0), port(0), stopped(false), drawingReady(false) {
+	freeClientIds(), nextClientId(1), port(0), stopped(false), drawingReady(false) {
 	// Initialize with a safe color
 	usedColor = wxColor(255, 0, 0); // Red for host
-	
-	// Log server initialization to file
-	std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "server_init.log").ToStdString(), std::ios::app);
-	if (logFile.is_open()) {
-		wxDateTime now = wxDateTime::Now();
-		logFile << now.FormatISOCombined() << ": LiveServer initialized\n";
-		logFile.close();
+
+	// Record incoming change lists for the live benchmark, if requested
+	if (!LiveChangeRecorder::defaultPath.empty()) {
+		recorder.open(LiveChangeRecorder::defaultPath);
 	}
 	
+	logMessage("[Server]: LiveServer initialized");
+	
 	// Set the drawing ready flag after a short delay to ensure all initialization is complete
 	wxTheApp->CallAfter([this]() {
 		drawingReady = true;
-		
-		// Log to file
-		std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "server_status.log").ToStdString(), std::ios::app);
-		if (logFile.is_open()) {
-			wxDateTime now = wxDateTime::Now();
-			logFile << now.FormatISOCombined() << ": Server drawing ready flag set\n";
-			logFile.close();
-		}
+		logMessage("[Server]: Drawing ready flag set", LIVE_LOG_DEBUG);
 	});
 }
 
@@ -138,19 +129,16 @@ void LiveServer::close() {
 	// Also disable drawing operations
 	drawingReady = false;
 	
-	// Log server shutdown to file
-	std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "server_status.log").ToStdString(), std::ios::app);
-	if (logFile.is_open()) {
-		wxDateTime now = wxDateTime::Now();
-		logFile << now.FormatISOCombined() << ": Server shutting down\n";
-		logFile.close();
-	}
+	logMessage("[Server]: Server shutting down");
 	
 	// Then proceed with normal shutdown
 	for (auto& clientEntry : clients) {
 		delete clientEntry.second;
 	}
 	clients.clear();
+	interest.clear();
+	freeClientIds.clear();
+	nextClientId = 1;
 
 	if (log) {
 		log->Message("Server was shutdown.");
@@ -231,8 +219,8 @@ void LiveServer::removeClient(uint32_t id) {
 
 	const uint32_t clientId = it->second->getClientId();
 	if (clientId != 0) {
-		clientIds &= ~clientId;
-		editor->map.clearVisible(clientIds);
+		interest.removeClient(clientId);
+		freeClientIds.insert(clientId);
 	}
 
 	clients.erase(it);
@@ -277,13 +265,12 @@ bool LiveServer::setPort(int32_t newPort) {
 }
 
 uint32_t LiveServer::getFreeClientId() {
-	for (int32_t bit = 1; bit < (1 << 16); bit <<= 1) {
-		if (!testFlags(clientIds, bit)) {
-			clientIds |= bit;
-			return bit;
-		}
+	if (!freeClientIds.empty()) {
+		const uint32_t clientId = *freeClientIds.begin();
+		freeClientIds.erase(freeClientIds.begin());
+		return clientId;
 	}
-	return 0;
+	return nextClientId++;
 }
 
 std::string LiveServer::getHostName() const {
@@ -297,13 +284,7 @@ std::string LiveServer::getHostName() const {
 void LiveServer::broadcastNodes(DirtyList& dirtyList) {
 	// Skip if we're not ready for drawing operations
 	if (!drawingReady || stopped) {
-		// Log to file instead of UI
-		std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "server_status.log").ToStdString(), std::ios::app);
-		if (logFile.is_open()) {
-			wxDateTime now = wxDateTime::Now();
-			logFile << now.FormatISOCombined() << ": Skipped broadcast, drawing not ready\n";
-			logFile.close();
-		}
+		logMessage("[Server]: Skipped broadcast, drawing not ready", LIVE_LOG_DEBUG);
 		return;
 	}
 
@@ -312,13 +293,6 @@ void LiveServer::broadcastNodes(DirtyList& dirtyList) {
 		return;
 	}
 
-	// Log to file rather than UI
-	std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "server_ops.log").ToStdString(), std::ios::app);
-	if (logFile.is_open()) {
-		wxDateTime now = wxDateTime::Now();
-		logFile << now.FormatISOCombined() << ": Broadcasting changes to " << clients.size() << " clients\n";
-	}
-
 	// Extract the change information to a struct we can capture in our lambda
 	struct BroadcastData {
 		uint32_t owner;
@@ -356,11 +330,6 @@ void LiveServer::broadcastNodes(DirtyList& dirtyList) {
 			broadcastData->positions.push_back(pos);
 		}
 		
-		// Safe logging of the node count
-		if (logFile.is_open()) {
-			logFile << "Changes: " << broadcastData->changes.size() << ", Positions: " << broadcastData->positions.size() << "\n";
-		}
-		
 		// Use a safer approach with CallAfter
 		wxTheApp->CallAfter([this, broadcastData]() {
 			try {
@@ -392,12 +361,22 @@ void LiveServer::broadcastNodes(DirtyList& dirtyList) {
 					int32_t ndx;
 					int32_t ndy;
 					uint32_t floors;
-					uint32_t clientId;
 				};
-				
+
 				std::vector<BroadcastWork> workItems;
 
-				// First gather all the work without doing any actual sending
+				std::unordered_map<uint32_t, LivePeer*> peers;
+				for (auto& clientEntry : clients) {
+					LivePeer* peer = clientEntry.second;
+					if (peer && peer->getClientId() != 0) {
+						peers[peer->getClientId()] = peer;
+					}
+				}
+
+				// First gather all the work without doing any actual sending, only
+				// the clients that have the node are looked at
+				std::vector<uint32_t> overground;
+				std::vector<uint32_t> underground;
 				for (const auto& ind : broadcastData->positions) {
 					int32_t ndx = ind.pos >> 18;
 					int32_t ndy = (ind.pos >> 4) & 0x3FFF;
@@ -406,15 +385,30 @@ void LiveServer::broadcastNodes(DirtyList& dirtyList) {
 					QTreeNode* node = editor->map.getLeaf(ndx * 4, ndy * 4);
 					if (!node) continue;
 
-					for (auto& clientEntry : clients) {
-						LivePeer* peer = clientEntry.second;
-						if (!peer) continue;
+					overground.clear();
+					underground.clear();
+					if (floors & 0x00FF) {
+						interest.query(ndx, ndy, false, overground);
+					}
+					if (floors & 0xFF00) {
+						interest.query(ndx, ndy, true, underground);
+					}
+
+					for (uint32_t clientId : overground) {
+						auto peer = peers.find(clientId);
+						if (peer == peers.end()) continue;
 
-						const uint32_t clientId = peer->getClientId();
-						
-						if (node->isVisible(clientId, true) || node->isVisible(clientId, false)) {
-							workItems.push_back({peer, node, ndx, ndy, floors, clientId});
-						}
+						// Clients that have both layers get all floors in one node
+						const bool both = std::find(underground.begin(), underground.end(), clientId) != underground.end();
+						workItems.push_back({peer->second, node, ndx, ndy, both ? floors : floors & 0x00FF});
+					}
+					for (uint32_t clientId : underground) {
+						if (std::find(overground.begin(), overground.end(), clientId) != overground.end()) continue;
+
+						auto peer = peers.find(clientId);
+						if (peer == peers.end()) continue;
+
+						workItems.push_back({peer->second, node, ndx, ndy, floors & 0xFF00});
 					}
 				}
 
@@ -429,47 +423,21 @@ void LiveServer::broadcastNodes(DirtyList& dirtyList) {
 						for (size_t i = startIdx; i < endIdx; ++i) {
 							const auto& work = workItems[i];
 							if (work.peer && work.node) {
-								sendNode(work.clientId, work.node, work.ndx, work.ndy, work.floors);
+								work.peer->sendNode(work.node, work.ndx, work.ndy, work.floors);
 							}
 						}
 					}
 					
-					// Log completion to file
-					std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "server_ops.log").ToStdString(), std::ios::app);
-					if (logFile.is_open()) {
-						wxDateTime now = wxDateTime::Now();
-						logFile << now.FormatISOCombined() << ": Broadcast completed, sent " << workItems.size() << " node updates\n";
-						logFile.close();
+					if (g_live_log.isEnabled(LIVE_LOG_DEBUG)) {
+						logMessage(wxString::Format("[Server]: Broadcast completed, sent %zu node updates", workItems.size()), LIVE_LOG_DEBUG);
 					}
 				}
 			} catch (std::exception& e) {
-				// Log error to file
-				std::ofstream logFile((GetAppDir() + wxFileName::GetPathSeparator() + "server_error.log").ToStdString(), std::ios::app);
-				if (logFile.is_open()) {
-					wxDateTime now = wxDateTime::Now();
-					logFile << now.FormatISOCombined() << ": Error broadcasting nodes: " << e.what() << "\n";
-					logFile.close();
-				}
+				logMessage(wxString::Format("[Server]: Error broadcasting nodes: %s", e.what()), LIVE_LOG_ERROR);
 			}
 		});
-		
-		if (logFile.is_open()) {
-			logFile << "Broadcast queued to main thread\n";
-			logFile.close();
-		}
 	} catch (std::exception& e) {
-		// Log error to file
-		if (logFile.is_open()) {
-			logFile << "Error preparing broadcast: " << e.what() << "\n";
-			logFile.close();
-		} else {
-			std::ofstream errorLog((GetAppDir() + wxFileName::GetPathSeparator() + "server_error.log").ToStdString(), std::ios::app);
-			if (errorLog.is_open()) {
-				wxDateTime now = wxDateTime::Now();
-				errorLog << now.FormatISOCombined() << ": Error preparing broadcast: " << e.what() << "\n";
-				errorLog.close();
-			}
-		}
+		logMessage(wxString::Format("[Server]: Error preparing broadcast: %s", e.what()), LIVE_LOG_ERROR);
 	}
 }
 
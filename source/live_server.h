@@ -21,6 +21,10 @@
 #include "live_socket.h"
 #include "net_connection.h"
 #include "action.h"
+#include "live_benchmark.h"
+#include "live_interest.h"
+
+#include <set>
 
 class LivePeer;
 class LiveLogTab;
@@ -59,6 +63,7 @@ public:
 		return editor;
 	}
 
+	// Client ids are small integers starting at 1, 0 is the host
 	uint32_t getFreeClientId();
 	std::string getHostName() const;
 
@@ -79,6 +84,14 @@ public:
 	
 	const std::unordered_map<uint32_t, LivePeer*>& getClients() const { return clients; }
 
+	LiveInterestMap& getInterest() {
+		return interest;
+	}
+
+	LiveChangeRecorder& getRecorder() {
+		return recorder;
+	}
+
 	// Helper method for writing cursor data to messages
 	void writeCursorToMessage(NetworkMessage& message, const LiveCursor& cursor) {
 		writeCursor(message, cursor);
@@ -92,13 +105,17 @@ protected:
 
 	Editor* editor;
 
-	uint32_t clientIds;
+	std::set<uint32_t> freeClientIds;
+	uint32_t nextClientId;
 	uint16_t port;
 
 	bool stopped;
 	bool drawingReady;  // Flag indicating server is ready for drawing operations
 
 	wxColor usedColor;
+
+	LiveInterestMap interest;
+	LiveChangeRecorder recorder;
 };
 
 #endif
@@ -21,12 +21,15 @@
 #include "iomap_otbm.h"
 #include "live_tab.h"
 #include "editor.h"
+#include "settings.h"
 
 LiveSocket::LiveSocket() :
 	cursors(), mapReader(nullptr, 0), mapWriter(),
 	mapVersion(MapVersion(MAP_OTBM_4, CLIENT_VERSION_NONE)), log(nullptr),
 	name("User"), password("") {
-	//
+	g_live_log.setLevel(g_settings.getInteger(Config::LIVE_LOG_LEVEL));
+	g_live_log.setStatsInterval(g_settings.getInteger(Config::LIVE_LOG_STATS_INTERVAL));
+	g_live_log.start(LiveLogTab::GetLogFilePath("live"));
 }
 
 LiveSocket::~LiveSocket() {
@@ -82,12 +85,8 @@ std::vector<LiveCursor> LiveSocket::getCursorList() const {
 	return cursorList;
 }
 
-void LiveSocket::logMessage(const wxString& message) {
-	wxTheApp->CallAfter([this, message]() {
-		if (log) {
-			log->Message(message);
-		}
-	});
+void LiveSocket::logMessage(const wxString& message, LiveLogLevel level) {
+	g_live_log.write(level, message);
 }
 
 void LiveSocket::receiveNode(NetworkMessage& message, Editor& editor, Action* action, int32_t ndx, int32_t ndy, bool underground) {
@@ -112,27 +111,13 @@ void LiveSocket::receiveNode(NetworkMessage& message, Editor& editor, Action* ac
 	}
 }
 
-void LiveSocket::sendNode(uint32_t clientId, QTreeNode* node, int32_t ndx, int32_t ndy, uint32_t floorMask) {
+void LiveSocket::sendNode(QTreeNode* node, int32_t ndx, int32_t ndy, uint32_t floorMask) {
 	// Safety check
 	if (!node) {
 		logMessage(wxString::Format("Warning: Attempted to send null node at %d,%d", ndx * 4, ndy * 4));
 		return;
 	}
 
-	bool underground;
-	if (floorMask & 0xFF00) {
-		if (floorMask & 0x00FF) {
-			underground = false;
-		} else {
-			underground = true;
-		}
-	} else {
-		underground = false;
-	}
-
-	// Mark the node as visible to this client
-	node->setVisible(clientId, underground, true);
-
 	try {
 		// Prepare the message
 		NetworkMessage message;
@@ -165,8 +150,6 @@ void LiveSocket::sendNode(uint32_t clientId, QTreeNode* node, int32_t ndx, int32
 		}
 
 		// Send the message
-		logMessage(wxString::Format("Sending node [%d,%d,%s] with floor mask 0x%04X", 
-			ndx, ndy, underground ? "underground" : "surface", sendMask));
 		send(message);
 	} catch (std::exception& e) {
 		logMessage(wxString::Format("Error sending node [%d,%d]: %s", ndx, ndy, e.what()));
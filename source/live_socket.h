@@ -23,6 +23,7 @@
 #include "live_packets.h"
 #include "filehandle.h"
 #include "iomap.h"
+#include "live_log.h"
 
 #include <memory>
 #include <unordered_map>
@@ -58,8 +59,8 @@ public:
 	virtual bool IsServer() const { return false; }
 	virtual bool IsClient() const { return false; }
 
-	//
-	void logMessage(const wxString& message);
+	// Goes to the live log file through g_live_log, safe from any thread
+	void logMessage(const wxString& message, LiveLogLevel level = LIVE_LOG_INFO);
 
 	//
 	virtual void receiveHeader() = 0;
@@ -88,7 +89,7 @@ public:
 protected:
 	// receive / send methods
 	void receiveNode(NetworkMessage& message, Editor& editor, Action* action, int32_t ndx, int32_t ndy, bool underground);
-	void sendNode(uint32_t clientId, QTreeNode* node, int32_t ndx, int32_t ndy, uint32_t floorMask);
+	void sendNode(QTreeNode* node, int32_t ndx, int32_t ndy, uint32_t floorMask);
 
 	void receiveFloor(NetworkMessage& message, Editor& editor, Action* action, int32_t ndx, int32_t ndy, int32_t z, QTreeNode* node, Floor* floor);
 	void sendFloor(NetworkMessage& message, Floor* floor);
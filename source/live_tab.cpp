@@ -177,32 +177,8 @@ wxString LiveLogTab::GetLogFilePath(const wxString& logType) {
 }
 
 void LiveLogTab::Message(const wxString& str) {
-	// Simply log to file - no UI interaction, no CallAfter
-	wxDateTime t = wxDateTime::Now();
-	wxString time, message;
-	time << format00(t.GetHour()) << ":"
-		 << format00(t.GetMinute()) << ":"
-		 << format00(t.GetSecond());
-	
-	// Format the message with timestamp
-	message << time << " - " << str << "\n";
-	
-	// Write to log file only
-	static wxString logFilePath;
-	if (logFilePath.IsEmpty()) {
-		logFilePath = GetLogFilePath("debug");
-	}
-	
-	try {
-		std::ofstream logFile(logFilePath.ToStdString(), std::ios::app);
-		if (logFile.is_open()) {
-			logFile << message;
-			logFile.close();
-		}
-	}
-	catch (...) {
-		// Silent failure - don't propagate exceptions
-	}
+	// Simply log to file - no UI interaction, the live log writes it in the background
+	g_live_log.write(LIVE_LOG_INFO, str);
 }
 
 void LiveLogTab::Chat(const wxString& speaker, const wxString& str) {
@@ -365,7 +341,7 @@ void LiveLogTab::UpdateClientList(const std::unordered_map<uint32_t, LivePeer*>&
 						LivePeer* peer = clientEntry.second;
 						if (peer) {
 							user_list->SetCellBackgroundColour(i, 0, peer->getUsedColor());
-							user_list->SetCellValue(i, 1, i2ws((peer->getClientId() >> 1) + 1));
+							user_list->SetCellValue(i, 1, i2ws(peer->getClientId()));
 							user_list->SetCellValue(i, 2, peer->getName());
 							++i;
 						}
@@ -391,7 +367,7 @@ void LiveLogTab::UpdateClientList(const std::unordered_map<uint32_t, LivePeer*>&
 					for (const auto& cursor : cursors) {
 						user_list->SetCellBackgroundColour(i, 0, cursor.color);
 						
-						// In display, clientId 0 is the host, others are +1 and shifted
+						// In display, clientId 0 is the host
 						wxString displayId;
 						wxString displayName;
 						
@@ -399,7 +375,7 @@ void LiveLogTab::UpdateClientList(const std::unordered_map<uint32_t, LivePeer*>&
 							displayId = "Host";
 							displayName = "HOST";
 						} else {
-							displayId = i2ws((cursor.id >> 1) + 1);
+							displayId = i2ws(cursor.id);
 							displayName = wxString::Format("Client %s", displayId);
 						}
 						
@@ -471,8 +447,7 @@ void LiveLogTab::ChangeUserColor(int row, const wxColor& color) {
     uint32_t clientId = 0;
     
     if (clientIdStr.ToLong(&displayId)) {
-        // Convert display ID to actual client ID
-        clientId = (displayId - 1) << 1;
+        clientId = displayId;
     }
     
     // If we're the host, directly update and broadcast
@@ -69,7 +69,7 @@ public:
 	void ChangeUserColor(int row, const wxColor& color);
 
 	// Method to get the log file path
-	wxString GetLogFilePath(const wxString& logType);
+	static wxString GetLogFilePath(const wxString& logType);
 
 protected:
 	MapTabbook* aui;
@@ -0,0 +1,160 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "load_tasks.h"
+#include "gui.h"
+
+#include <thread>
+
+LoadTaskGraph::LoadTaskGraph() :
+	lastFinished(0), elapsed(0) {
+	////
+}
+
+LoadTaskGraph::~LoadTaskGraph() {
+	////
+}
+
+size_t LoadTaskGraph::add(const wxString& name, Function function, const std::vector<size_t>& dependencies) {
+	Task task;
+	task.name = name;
+	task.function = std::move(function);
+	task.dependencies = dependencies;
+	task.state = TASK_WAITING;
+	task.seconds = 0;
+	tasks.push_back(std::move(task));
+	return tasks.size() - 1;
+}
+
+void LoadTaskGraph::execute(size_t index) {
+	// Only this thread touches the task's function and output while it runs
+	Task& task = tasks[index];
+	const auto start = std::chrono::steady_clock::now();
+
+	bool success;
+	try {
+		success = task.function(task.error, task.warnings);
+	} catch (std::exception& e) {
+		task.error = task.name + ": " + wxString(e.what());
+		success = false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	task.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	task.state = success ? TASK_DONE : TASK_FAILED;
+	lastFinished = index;
+	changed.notify_all();
+}
+
+bool LoadTaskGraph::run(wxString& error, wxArrayString& warnings, int32_t progressFrom, int32_t progressTo) {
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	lastFinished = tasks.size();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		bool running = false;
+		bool failed = false;
+		for (Task& task : tasks) {
+			if (task.state == TASK_FAILED) {
+				failed = true;
+			}
+		}
+
+		// Start everything whose dependencies are done, skip what can never run
+		for (size_t index = 0; index < tasks.size(); ++index) {
+			Task& task = tasks[index];
+			if (task.state == TASK_WAITING) {
+				bool ready = true;
+				bool blocked = failed;
+				for (size_t dependency : task.dependencies) {
+					const State state = tasks[dependency].state;
+					ready = ready && state == TASK_DONE;
+					blocked = blocked || state == TASK_FAILED || state == TASK_SKIPPED;
+				}
+
+				if (blocked) {
+					task.state = TASK_SKIPPED;
+				} else if (ready) {
+					task.state = TASK_RUNNING;
+					workers.emplace_back(&LoadTaskGraph::execute, this, index);
+				}
+			}
+			running = running || task.state == TASK_RUNNING;
+		}
+
+		if (!running) {
+			break;
+		}
+
+		changed.wait_for(lock, std::chrono::milliseconds(50));
+
+		// Report the stages in flight and how long the last one took
+		wxString message;
+		size_t done = 0;
+		for (const Task& task : tasks) {
+			if (task.state == TASK_RUNNING) {
+				message += (message.empty() ? "Loading " : ", ") + task.name;
+			} else if (task.state == TASK_DONE) {
+				++done;
+			}
+		}
+		if (lastFinished < tasks.size()) {
+			const Task& task = tasks[lastFinished];
+			message += wxString::Format(" (%s took %d ms)", task.name, static_cast<int>(task.seconds * 1000));
+		}
+
+		const int32_t progress = progressFrom + static_cast<int32_t>((progressTo - progressFrom) * done / std::max<size_t>(1, tasks.size()));
+		lock.unlock();
+		g_gui.SetLoadDone(progress, message);
+		lock.lock();
+	}
+	lock.unlock();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (const Task& task : tasks) {
+		for (const wxString& warning : task.warnings) {
+			warnings.push_back(warning);
+		}
+	}
+	for (const Task& task : tasks) {
+		if (task.state == TASK_FAILED) {
+			error = task.error;
+			return false;
+		}
+	}
+	return true;
+}
+
+wxString LoadTaskGraph::getTimings() const {
+	wxString timings;
+	for (const Task& task : tasks) {
+		if (task.state == TASK_DONE || task.state == TASK_FAILED) {
+			timings << task.name << ": " << static_cast<int>(task.seconds * 1000) << " ms\n";
+		} else {
+			timings << task.name << ": skipped\n";
+		}
+	}
+	return timings;
+}
@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_LOAD_TASKS_H_
+#define RME_LOAD_TASKS_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Runs startup loaders on worker threads as soon as the loaders they depend
+// on have finished, while the calling thread keeps the load bar up to date.
+class LoadTaskGraph {
+public:
+	// Returning false aborts the graph, error is then reported as is
+	using Function = std::function<bool(wxString& error, wxArrayString& warnings)>;
+
+	LoadTaskGraph();
+	~LoadTaskGraph();
+
+	size_t add(const wxString& name, Function function, const std::vector<size_t>& dependencies = {});
+
+	// Blocks until every task has finished or one of them failed, warnings are
+	// collected in the order the tasks were added
+	bool run(wxString& error, wxArrayString& warnings, int32_t progressFrom, int32_t progressTo);
+
+	double getElapsed() const {
+		return elapsed;
+	}
+	// One line per task with its time in milliseconds
+	wxString getTimings() const;
+
+private:
+	enum State {
+		TASK_WAITING,
+		TASK_RUNNING,
+		TASK_DONE,
+		TASK_FAILED,
+		TASK_SKIPPED,
+	};
+
+	struct Task {
+		wxString name;
+		Function function;
+		std::vector<size_t> dependencies;
+		State state;
+		wxString error;
+		wxArrayString warnings;
+		double seconds;
+	};
+
+	void execute(size_t index);
+
+	std::vector<Task> tasks;
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t lastFinished;
+	double elapsed;
+};
+
+#endif
@@ -0,0 +1,295 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "lod_manager.h"
+#include "basemap.h"
+#include "tile.h"
+#include "item.h"
+#include "items.h"
+#include "gui.h"
+#include "render_profiler.h"
+
+#include <chrono>
+
+namespace {
+	// Every sector image is this wide, so the tiles it covers double per level
+	const int PYRAMID_PIXELS = 256;
+	const int PYRAMID_MAX_LEVEL = 4;
+	// About 96 MB of textures, all floors in view share them
+	const size_t PYRAMID_MAX_TEXTURES = 384;
+	const size_t PYRAMID_MAX_SECTORS = 4096;
+	// Time spent building images that were never drawn before, per frame
+	const int PYRAMID_BUILD_BUDGET = 8;
+
+	int getSectorTiles(int level) {
+		return PYRAMID_PIXELS / (SPRITE_PIXELS >> level);
+	}
+
+	uint64_t getSectorKey(int level, int sector_x, int sector_y, int z) {
+		return (uint64_t(level) << 56) | (uint64_t(z) << 48) | (uint64_t(sector_y) << 24) | uint64_t(sector_x);
+	}
+}
+
+LODManager::LODManager() :
+	current_level(FULL_DETAIL),
+	textures(0),
+	frame(0),
+	minimap(false),
+	ingame(false) {
+	////
+}
+
+LODManager::~LODManager() {
+	clearPyramid();
+}
+
+int LODManager::getPyramidLevel(double zoom) {
+	int level = 1;
+	while (level < PYRAMID_MAX_LEVEL && zoom >= double(2 << level)) {
+		++level;
+	}
+	return level;
+}
+
+void LODManager::clearPyramid() {
+	for (auto& sector : sectors) {
+		release(sector.second);
+	}
+	sectors.clear();
+}
+
+void LODManager::release(PyramidSector& sector) {
+	if (sector.texture != 0) {
+		glDeleteTextures(1, &sector.texture);
+		sector.texture = 0;
+		--textures;
+	}
+}
+
+const uint8_t* LODManager::getGroundMip(Item* ground, const Position& position, int level) {
+	const ItemType& type = g_items[ground->getID()];
+	GameSprite* sprite = type.sprite;
+	if (!sprite || type.isMetaItem()) {
+		return nullptr;
+	}
+
+	const uint32_t index = sprite->getSpriteIndex(0, 0, 0, -1, position.x % sprite->pattern_x, position.y % sprite->pattern_y, position.z % sprite->pattern_z, 0);
+	auto key = std::make_tuple(sprite, index, level);
+	auto it = ground_mips.find(key);
+	if (it != ground_mips.end()) {
+		return it->second.empty() ? nullptr : it->second.data();
+	}
+
+	std::vector<uint8_t>& mip = ground_mips[key];
+	std::unique_ptr<uint8_t[]> rgba(sprite->getRGBAData(index));
+	if (!rgba) {
+		return nullptr;
+	}
+
+	// Averaged with alpha weights so transparent pixels don't darken edges
+	const int factor = 1 << level;
+	const int size = SPRITE_PIXELS >> level;
+	mip.resize(size * size * 4);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			uint32_t red = 0, green = 0, blue = 0, alpha = 0;
+			for (int sy = y * factor; sy < (y + 1) * factor; ++sy) {
+				for (int sx = x * factor; sx < (x + 1) * factor; ++sx) {
+					const uint8_t* pixel = &rgba[(sy * SPRITE_PIXELS + sx) * 4];
+					red += pixel[0] * pixel[3];
+					green += pixel[1] * pixel[3];
+					blue += pixel[2] * pixel[3];
+					alpha += pixel[3];
+				}
+			}
+			uint8_t* target = &mip[(y * size + x) * 4];
+			target[0] = alpha ? red / alpha : 0;
+			target[1] = alpha ? green / alpha : 0;
+			target[2] = alpha ? blue / alpha : 0;
+			target[3] = alpha / (factor * factor);
+		}
+	}
+	return mip.data();
+}
+
+bool LODManager::isOutdated(BaseMap& map, int level, int sector_x, int sector_y, int z, const PyramidSector& sector) const {
+	if (map.getTouchAllRevision() > sector.revision) {
+		return true;
+	}
+
+	const int tiles = getSectorTiles(level);
+	for (int leaf_x = sector_x * tiles; leaf_x < (sector_x + 1) * tiles; leaf_x += 4) {
+		for (int leaf_y = sector_y * tiles; leaf_y < (sector_y + 1) * tiles; leaf_y += 4) {
+			QTreeNode* leaf = map.getLeaf(leaf_x, leaf_y);
+			Floor* floor = leaf ? leaf->getFloor(z) : nullptr;
+			if (floor && floor->revision > sector.revision) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void LODManager::compose(BaseMap& map, int level, int sector_x, int sector_y, int z, PyramidSector& sector) {
+	sector.composed = true;
+	sector.revision = map.getRevision();
+	sector.empty = true;
+
+	const int block = SPRITE_PIXELS >> level;
+	const int tiles = getSectorTiles(level);
+	const int base_x = sector_x * tiles;
+	const int base_y = sector_y * tiles;
+
+	buffer.assign(PYRAMID_PIXELS * PYRAMID_PIXELS * 4, 0);
+	for (int leaf_x = base_x; leaf_x < base_x + tiles; leaf_x += 4) {
+		for (int leaf_y = base_y; leaf_y < base_y + tiles; leaf_y += 4) {
+			QTreeNode* leaf = map.getLeaf(leaf_x, leaf_y);
+			Floor* floor = leaf ? leaf->getFloor(z) : nullptr;
+			if (!floor) {
+				continue;
+			}
+
+			for (TileLocation& location : floor->locs) {
+				Tile* tile = location.get();
+				if (!tile || !tile->ground) {
+					continue;
+				}
+
+				// Same colors DrawTile uses for the ground at this zoom
+				const int left = (location.getX() - base_x) * block;
+				const int top = (location.getY() - base_y) * block;
+				if (minimap) {
+					const uint8_t color = tile->getMiniMapColor();
+					const uint8_t pixel[4] = { uint8_t(int(color / 36) % 6 * 51), uint8_t(int(color / 6) % 6 * 51), uint8_t(color % 6 * 51), 255 };
+					for (int y = 0; y < block; ++y) {
+						for (int x = 0; x < block; ++x) {
+							memcpy(&buffer[((top + y) * PYRAMID_PIXELS + left + x) * 4], pixel, 4);
+						}
+					}
+				} else {
+					const uint8_t* mip = getGroundMip(tile->ground, location.getPosition(), level);
+					if (!mip) {
+						continue;
+					}
+					const int shift = !ingame && tile->ground->isSelected() ? 1 : 0;
+					for (int y = 0; y < block; ++y) {
+						for (int x = 0; x < block; ++x) {
+							const uint8_t* source = &mip[(y * block + x) * 4];
+							uint8_t* target = &buffer[((top + y) * PYRAMID_PIXELS + left + x) * 4];
+							target[0] = source[0] >> shift;
+							target[1] = source[1] >> shift;
+							target[2] = source[2] >> shift;
+							target[3] = source[3];
+						}
+					}
+				}
+				sector.empty = false;
+			}
+		}
+	}
+
+	if (sector.empty) {
+		release(sector);
+		return;
+	}
+
+	if (sector.texture == 0) {
+		sector.texture = g_gui.gfx.getFreeTextureID();
+		++textures;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, sector.texture);
+	g_render_profiler.count(RENDER_COUNTER_TEXTURE_BINDS);
+	g_render_profiler.count(RENDER_COUNTER_TEXTURE_UPLOADS);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, PYRAMID_PIXELS, PYRAMID_PIXELS, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+}
+
+void LODManager::drawPyramid(BaseMap& map, int level, int start_x, int start_y, int end_x, int end_y, int z, int origin_x, int origin_y, bool minimap, bool ingame, std::vector<PyramidArea>& pending) {
+	if (minimap != this->minimap || ingame != this->ingame) {
+		clearPyramid();
+		this->minimap = minimap;
+		this->ingame = ingame;
+	}
+
+	const uint64_t revision = map.getRevision();
+	const int tiles = getSectorTiles(level);
+	const int first_x = std::max(0, start_x) / tiles;
+	const int first_y = std::max(0, start_y) / tiles;
+	const int last_x = std::max(0, end_x) / tiles;
+	const int last_y = std::max(0, end_y) / tiles;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PYRAMID_BUILD_BUDGET);
+
+	for (int sector_x = first_x; sector_x <= last_x; ++sector_x) {
+		for (int sector_y = first_y; sector_y <= last_y; ++sector_y) {
+			PyramidSector& sector = sectors[getSectorKey(level, sector_x, sector_y, z)];
+			sector.used = frame;
+			if (!sector.composed) {
+				// New images wait for the next frame once the budget is spent
+				if (std::chrono::steady_clock::now() > deadline) {
+					pending.push_back({ sector_x * tiles, sector_y * tiles, (sector_x + 1) * tiles - 1, (sector_y + 1) * tiles - 1 });
+					continue;
+				}
+				compose(map, level, sector_x, sector_y, z, sector);
+			} else if (sector.checked != revision && isOutdated(map, level, sector_x, sector_y, z, sector)) {
+				compose(map, level, sector_x, sector_y, z, sector);
+			}
+			sector.checked = revision;
+
+			if (sector.empty) {
+				continue;
+			}
+
+			const int draw_x = sector_x * tiles * TileSize + origin_x;
+			const int draw_y = sector_y * tiles * TileSize + origin_y;
+			const int draw_size = tiles * TileSize;
+			glBindTexture(GL_TEXTURE_2D, sector.texture);
+			g_render_profiler.count(RENDER_COUNTER_TEXTURE_BINDS);
+			glColor4ub(255, 255, 255, 255);
+			glBegin(GL_QUADS);
+			glTexCoord2f(0.f, 0.f);
+			glVertex2f(draw_x, draw_y);
+			glTexCoord2f(1.f, 0.f);
+			glVertex2f(draw_x + draw_size, draw_y);
+			glTexCoord2f(1.f, 1.f);
+			glVertex2f(draw_x + draw_size, draw_y + draw_size);
+			glTexCoord2f(0.f, 1.f);
+			glVertex2f(draw_x, draw_y + draw_size);
+			glEnd();
+		}
+	}
+
+	// Drop the images that have been out of view the longest
+	while (textures > PYRAMID_MAX_TEXTURES || sectors.size() > PYRAMID_MAX_SECTORS) {
+		auto oldest = sectors.end();
+		for (auto it = sectors.begin(); it != sectors.end(); ++it) {
+			if (it->second.used != frame && (oldest == sectors.end() || it->second.used < oldest->second.used)) {
+				oldest = it;
+			}
+		}
+		if (oldest == sectors.end()) {
+			break;
+		}
+		release(oldest->second);
+		sectors.erase(oldest);
+	}
+}
@@ -1,7 +1,15 @@
-
 #ifndef RME_LOD_MANAGER_H
 #define RME_LOD_MANAGER_H
 
+#include "graphics.h"
+#include "position.h"
+
+#include <tuple>
+#include <unordered_map>
+
+class BaseMap;
+class Item;
+
 class LODManager {
 public:
     enum LODLevel {
@@ -10,16 +18,24 @@ public:
         GROUND_ONLY = 2     // Zoom 8+
     };
 
-    LODManager() : current_level(FULL_DETAIL) {}
-    
+    // Tiles a pyramid sector image has to redraw tile by tile this frame
+    struct PyramidArea {
+        int start_x, start_y, end_x, end_y;
+    };
+
+    LODManager();
+    ~LODManager();
+
     LODLevel getLevelForZoom(double zoom) {
         if(zoom >= 8.0) return GROUND_ONLY;
         if(zoom >= 4.0) return MEDIUM_DETAIL;
         return FULL_DETAIL;
     }
     
+    // Called once per frame
     void updateRenderSettings(double zoom) {
         current_level = getLevelForZoom(zoom);
+        ++frame;
     }
     
     bool isGroundOnly() const {
@@ -30,8 +46,43 @@ public:
         return current_level == MEDIUM_DETAIL;
     }
 
+    // Pyramid level for a zoom, level n holds the grounds at 1/2^n scale (1-4)
+    static int getPyramidLevel(double zoom);
+
+    // Draws the grounds of floor z in the area from pre-rendered sector
+    // images, tile x,y goes to x * TileSize + origin_x. Images are built
+    // lazily within a time budget and rebuilt once a tile under them changed,
+    // what isn't built yet is returned in pending for the caller to draw.
+    void drawPyramid(BaseMap& map, int level, int start_x, int start_y, int end_x, int end_y, int z, int origin_x, int origin_y, bool minimap, bool ingame, std::vector<PyramidArea>& pending);
+    void clearPyramid();
+
 private:
+    struct PyramidSector {
+        PyramidSector() :
+            texture(0), revision(0), checked(0), used(0), composed(false), empty(true) { }
+        GLuint texture;
+        uint64_t revision; // map revision the image was built at
+        uint64_t checked; // map revision the floors were last compared to
+        uint64_t used; // frame it was last drawn in
+        bool composed;
+        bool empty;
+    };
+
+    bool isOutdated(BaseMap& map, int level, int sector_x, int sector_y, int z, const PyramidSector& sector) const;
+    void compose(BaseMap& map, int level, int sector_x, int sector_y, int z, PyramidSector& sector);
+    void release(PyramidSector& sector);
+    const uint8_t* getGroundMip(Item* ground, const Position& position, int level);
+
     LODLevel current_level;
+
+    std::unordered_map<uint64_t, PyramidSector> sectors;
+    // Box filtered ground sprites, empty when the sprite couldn't be read
+    std::map<std::tuple<GameSprite*, uint32_t, int>, std::vector<uint8_t>> ground_mips;
+    std::vector<uint8_t> buffer;
+    size_t textures;
+    uint64_t frame;
+    bool minimap;
+    bool ingame;
 };
 
-#endif // RME_LOD_MANAGER_H
\ No newline at end of file
+#endif // RME_LOD_MANAGER_H
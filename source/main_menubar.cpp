@@ -78,6 +78,9 @@
 #include "live_server.h"
 #include "string_utils.h"
 #include "hotkey_manager.h"
+#include "render_profiler.h"
+#include "region_export.h"
+#include "map_statistics.h"
 
 const wxEventType EVT_MENU = wxEVT_COMMAND_MENU_SELECTED;
 
@@ -113,6 +116,7 @@ MainMenuBar::MainMenuBar(MainFrame* frame) :
 	MAKE_ACTION(IMPORT_MINIMAP, wxITEM_NORMAL, OnImportMinimap);
 	MAKE_ACTION(EXPORT_MINIMAP, wxITEM_NORMAL, OnExportMinimap);
 	MAKE_ACTION(EXPORT_TILESETS, wxITEM_NORMAL, OnExportTilesets);
+	MAKE_ACTION(EXPORT_SELECTION_IMAGE, wxITEM_NORMAL, OnExportSelectionImage);
 
 	MAKE_ACTION(RELOAD_DATA, wxITEM_NORMAL, OnReloadDataFiles);
 	// MAKE_ACTION(RECENT_FILES, wxITEM_NORMAL, OnRecent);
@@ -175,6 +179,7 @@ MainMenuBar::MainMenuBar(MainFrame* frame) :
 	MAKE_ACTION(MAP_CLEAN_HOUSE_ITEMS, wxITEM_NORMAL, OnMapCleanHouseItems);
 	MAKE_ACTION(MAP_PROPERTIES, wxITEM_NORMAL, OnMapProperties);
 	MAKE_ACTION(MAP_STATISTICS, wxITEM_NORMAL, OnMapStatistics);
+	MAKE_ACTION(MAP_UNDO_HISTORY, wxITEM_NORMAL, OnMapUndoHistory);
 
 	MAKE_ACTION(VIEW_TOOLBARS_BRUSHES, wxITEM_CHECK, OnToolbars);
 	MAKE_ACTION(VIEW_TOOLBARS_POSITION, wxITEM_CHECK, OnToolbars);
@@ -218,6 +223,8 @@ MainMenuBar::MainMenuBar(MainFrame* frame) :
 	MAKE_ACTION(EXT_HOUSE_SHADER, wxITEM_CHECK, OnChangeViewSettings);
 
 	MAKE_ACTION(EXPERIMENTAL_FOG, wxITEM_CHECK, OnChangeViewSettings); // experimental
+	MAKE_ACTION(SHOW_RENDER_PROFILER, wxITEM_CHECK, OnShowRenderProfiler);
+	MAKE_ACTION(RECORD_RENDER_TRACE, wxITEM_CHECK, OnRecordRenderTrace);
 
 	MAKE_ACTION(WIN_MINIMAP, wxITEM_NORMAL, OnMinimapWindow);
 	MAKE_ACTION(NEW_PALETTE, wxITEM_NORMAL, OnNewPalette);
@@ -373,8 +380,8 @@ void MainMenuBar::Update() {
 
 	Editor* editor = g_gui.GetCurrentEditor();
 	if (editor) {
-		EnableItem(UNDO, editor->actionQueue->canUndo());
-		EnableItem(REDO, editor->actionQueue->canRedo());
+		EnableItem(UNDO, editor->CanEdit() && editor->actionQueue->canUndo());
+		EnableItem(REDO, editor->CanEdit() && editor->actionQueue->canRedo());
 		EnableItem(PASTE, editor->copybuffer.canPaste());
 	} else {
 		EnableItem(UNDO, false);
@@ -388,20 +395,23 @@ void MainMenuBar::Update() {
 	bool is_live = editor && editor->IsLive();
 	bool is_host = has_map && !editor->IsLiveClient();
 	bool is_local = has_map && !is_live;
+	// Blocked while map statistics are collected
+	bool can_edit = has_map && editor->CanEdit();
 
 	EnableItem(CLOSE, is_local);
 	EnableItem(SAVE, is_host);
 	EnableItem(SAVE_AS, is_host);
 	EnableItem(GENERATE_MAP, false);
 
-	EnableItem(IMPORT_MAP, is_local);
-	EnableItem(IMPORT_MONSTERS, is_local);
+	EnableItem(IMPORT_MAP, is_local && can_edit);
+	EnableItem(IMPORT_MONSTERS, is_local && can_edit);
 	EnableItem(IMPORT_MINIMAP, false);
 	EnableItem(EXPORT_MINIMAP, is_local);
 	EnableItem(EXPORT_TILESETS, loaded);
+	EnableItem(EXPORT_SELECTION_IMAGE, has_selection);
 
 	EnableItem(FIND_ITEM, is_host);
-	EnableItem(REPLACE_ITEMS, is_local);
+	EnableItem(REPLACE_ITEMS, is_local && can_edit);
 	EnableItem(SEARCH_ON_MAP_EVERYTHING, is_host);
 	EnableItem(SEARCH_ON_MAP_UNIQUE, is_host);
 	EnableItem(SEARCH_ON_MAP_ACTION, is_host);
@@ -413,36 +423,37 @@ void MainMenuBar::Update() {
 	EnableItem(SEARCH_ON_SELECTION_CONTAINER, has_selection && is_host);
 	EnableItem(SEARCH_ON_SELECTION_WRITEABLE, has_selection && is_host);
 	EnableItem(SEARCH_ON_SELECTION_ITEM, has_selection && is_host);
-	EnableItem(REPLACE_ON_SELECTION_ITEMS, has_selection && is_host);
-	EnableItem(REMOVE_ON_SELECTION_ITEM, has_selection && is_host);
+	EnableItem(REPLACE_ON_SELECTION_ITEMS, has_selection && is_host && can_edit);
+	EnableItem(REMOVE_ON_SELECTION_ITEM, has_selection && is_host && can_edit);
 
-	EnableItem(CUT, has_map);
+	EnableItem(CUT, can_edit);
 	EnableItem(COPY, has_map);
 
-	EnableItem(BORDERIZE_SELECTION, has_map && has_selection);
-	EnableItem(BORDERIZE_MAP, is_local);
-	EnableItem(RANDOMIZE_SELECTION, has_map && has_selection);
-	EnableItem(RANDOMIZE_MAP, is_local);
+	EnableItem(BORDERIZE_SELECTION, can_edit && has_selection);
+	EnableItem(BORDERIZE_MAP, is_local && can_edit);
+	EnableItem(RANDOMIZE_SELECTION, can_edit && has_selection);
+	EnableItem(RANDOMIZE_MAP, is_local && can_edit);
 
 	EnableItem(GOTO_PREVIOUS_POSITION, has_map);
 	EnableItem(GOTO_POSITION, has_map);
 	EnableItem(JUMP_TO_BRUSH, loaded);
 	EnableItem(JUMP_TO_ITEM_BRUSH, loaded);
 
-	EnableItem(MAP_REMOVE_ITEMS, is_host);
-	EnableItem(MAP_REMOVE_CORPSES, is_local);
-	EnableItem(MAP_REMOVE_DUPLICATES, is_local);
-	EnableItem(MAP_REMOVE_UNREACHABLE_TILES, is_local);
-	EnableItem(CLEAR_INVALID_HOUSES, is_local);
-	EnableItem(CLEAR_MODIFIED_STATE, is_local);
+	EnableItem(MAP_REMOVE_ITEMS, is_host && can_edit);
+	EnableItem(MAP_REMOVE_CORPSES, is_local && can_edit);
+	EnableItem(MAP_REMOVE_DUPLICATES, is_local && can_edit);
+	EnableItem(MAP_REMOVE_UNREACHABLE_TILES, is_local && can_edit);
+	EnableItem(CLEAR_INVALID_HOUSES, is_local && can_edit);
+	EnableItem(CLEAR_MODIFIED_STATE, is_local && can_edit);
 
-	EnableItem(EDIT_TOWNS, is_local);
+	EnableItem(EDIT_TOWNS, is_local && can_edit);
 	EnableItem(EDIT_ITEMS, false);
 	EnableItem(EDIT_MONSTERS, false);
 
-	EnableItem(MAP_CLEANUP, is_local);
-	EnableItem(MAP_PROPERTIES, is_local);
-	EnableItem(MAP_STATISTICS, is_local);
+	EnableItem(MAP_CLEANUP, is_local && can_edit);
+	EnableItem(MAP_PROPERTIES, is_local && can_edit);
+	EnableItem(MAP_STATISTICS, is_local && can_edit);
+	EnableItem(MAP_UNDO_HISTORY, is_local);
 
 	EnableItem(NEW_VIEW, has_map);
 	EnableItem(NEW_DETACHED_VIEW, has_map);
@@ -465,10 +476,10 @@ void MainMenuBar::Update() {
 	EnableItem(SELECT_WAYPOINT, loaded);
 	EnableItem(SELECT_RAW, loaded);
 
-	EnableItem(LIVE_START, is_local);
+	EnableItem(LIVE_START, is_local && can_edit);
 	EnableItem(LIVE_JOIN, loaded);
 	EnableItem(LIVE_CLOSE, is_live);
-	EnableItem(ID_MENU_SERVER_HOST, is_local);
+	EnableItem(ID_MENU_SERVER_HOST, is_local && can_edit);
 	EnableItem(ID_MENU_SERVER_CONNECT, loaded);
 
 	EnableItem(DEBUG_VIEW_DAT, loaded);
@@ -540,6 +551,8 @@ void MainMenuBar::LoadValues() {
 	CheckItem(EXT_HOUSE_SHADER, g_settings.getBoolean(Config::EXT_HOUSE_SHADER));
 
 	CheckItem(EXPERIMENTAL_FOG, g_settings.getBoolean(Config::EXPERIMENTAL_FOG));
+	CheckItem(SHOW_RENDER_PROFILER, g_render_profiler.isOverlayVisible());
+	CheckItem(RECORD_RENDER_TRACE, g_render_profiler.isRecording());
 }
 
 void MainMenuBar::LoadRecentFiles() {
@@ -877,6 +890,33 @@ void MainMenuBar::OnExportTilesets(wxCommandEvent& WXUNUSED(event)) {
 	}
 }
 
+void MainMenuBar::OnExportSelectionImage(wxCommandEvent& WXUNUSED(event)) {
+	Editor* editor = g_gui.GetCurrentEditor();
+	if (!editor || !editor->hasSelection()) {
+		return;
+	}
+
+	wxFileDialog dialog(frame, "Export selection image", "", "selection.png", "*.png", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	if (dialog.ShowModal() != wxID_OK) {
+		return;
+	}
+
+	const Position minPos = editor->selection.minPosition();
+	const Position maxPos = editor->selection.maxPosition();
+
+	g_gui.CreateLoadBar("Exporting selection image...");
+	RegionExporter exporter(editor->map);
+	exporter.setShowProgress(true);
+	bool exported = exporter.exportRegion(FileName(dialog.GetPath()), minPos.x, minPos.y, maxPos.x, maxPos.y, g_gui.GetCurrentFloor());
+	g_gui.DestroyLoadBar();
+
+	if (!exported) {
+		g_gui.PopupDialog("Error", "Could not write " + dialog.GetPath(), wxOK);
+	} else {
+		g_gui.SetStatusText("Exported selection image to " + dialog.GetPath());
+	}
+}
+
 void MainMenuBar::OnDebugViewDat(wxCommandEvent& WXUNUSED(event)) {
 	wxDialog dlg(frame, wxID_ANY, "Debug .dat file", wxDefaultPosition, wxDefaultSize, wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
 	new DatDebugView(&dlg);
@@ -1933,257 +1973,92 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 		return;
 	}
 
-	g_gui.CreateLoadBar("Collecting data...");
-
-	Map* map = &g_gui.GetCurrentMap();
-
-	int load_counter = 0;
-
-	uint64_t tile_count = 0;
-	uint64_t detailed_tile_count = 0;
-	uint64_t blocking_tile_count = 0;
-	uint64_t walkable_tile_count = 0;
-	double percent_pathable = 0.0;
-	double percent_detailed = 0.0;
-	uint64_t spawn_count = 0;
-	uint64_t creature_count = 0;
-	double creatures_per_spawn = 0.0;
-
-	uint64_t item_count = 0;
-	uint64_t loose_item_count = 0;
-	uint64_t depot_count = 0;
-	uint64_t action_item_count = 0;
-	uint64_t unique_item_count = 0;
-	uint64_t container_count = 0; // Only includes containers containing more than 1 item
-
-	int town_count = map->towns.count();
-	int house_count = map->houses.count();
-	std::map<uint32_t, uint32_t> town_sqm_count;
-	const Town* largest_town = nullptr;
-	uint64_t largest_town_size = 0;
-	uint64_t total_house_sqm = 0;
-	const House* largest_house = nullptr;
-	uint64_t largest_house_size = 0;
-	double houses_per_town = 0.0;
-	double sqm_per_house = 0.0;
-	double sqm_per_town = 0.0;
-
-	for (MapIterator mit = map->begin(); mit != map->end(); ++mit) {
-		Tile* tile = (*mit)->get();
-		if (load_counter % 8192 == 0) {
-			g_gui.SetLoadDone((unsigned int)(int64_t(load_counter) * 95ll / int64_t(map->getTileCount())));
-		}
-
-		if (tile->empty()) {
-			continue;
-		}
-
-		tile_count += 1;
-
-		bool is_detailed = false;
-#define ANALYZE_ITEM(_item)                                         \
-	{                                                               \
-		item_count += 1;                                            \
-		if (!(_item)->isGroundTile() && !(_item)->isBorder()) {     \
-			is_detailed = true;                                     \
-			ItemType& it = g_items[(_item)->getID()];               \
-			if (it.moveable) {                                      \
-				loose_item_count += 1;                              \
-			}                                                       \
-			if (it.isDepot()) {                                     \
-				depot_count += 1;                                   \
-			}                                                       \
-			if ((_item)->getActionID() > 0) {                       \
-				action_item_count += 1;                             \
-			}                                                       \
-			if ((_item)->getUniqueID() > 0) {                       \
-				unique_item_count += 1;                             \
-			}                                                       \
-			if (Container* c = dynamic_cast<Container*>((_item))) { \
-				if (c->getVector().size()) {                        \
-					container_count += 1;                           \
-				}                                                   \
-			}                                                       \
-		}                                                           \
-	}
-
-		if (tile->ground) {
-			ANALYZE_ITEM(tile->ground);
-		}
+	Editor* editor = g_gui.GetCurrentEditor();
+	if (!editor->CanEdit()) {
+		return;
+	}
 
-		for (ItemVector::const_iterator item_iter = tile->items.begin(); item_iter != tile->items.end(); ++item_iter) {
-			Item* item = *item_iter;
-			ANALYZE_ITEM(item);
-		}
-#undef ANALYZE_ITEM
+	// Collected on a worker, the editor stays usable but edits are blocked
+	// until the dialog comes up
+	editor->statistics.reset(newd MapStatisticsTask(*editor, [this](MapStatisticsCollector& collector) {
+		ShowMapStatistics(collector);
+	}));
+	g_gui.UpdateMenus();
+}
 
-		if (tile->spawn) {
-			spawn_count += 1;
-		}
+void MainMenuBar::ShowMapStatistics(const MapStatisticsCollector& collector) {
+	wxDialog* dg = newd wxDialog(frame, wxID_ANY, "Map Statistics", wxDefaultPosition, wxDefaultSize, wxRESIZE_BORDER | wxCAPTION | wxCLOSE_BOX);
+	wxSizer* topsizer = newd wxBoxSizer(wxVERTICAL);
+	wxTextCtrl* text_field = newd wxTextCtrl(dg, wxID_ANY, wxstr(collector.getText()), wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY);
+	text_field->SetMinSize(wxSize(400, 300));
+	topsizer->Add(text_field, wxSizerFlags(5).Expand());
 
-		if (tile->creature) {
-			creature_count += 1;
-		}
+	wxSizer* choicesizer = newd wxBoxSizer(wxHORIZONTAL);
+	wxButton* export_button = newd wxButton(dg, wxID_OK, "Export as JSON");
+	choicesizer->Add(export_button, wxSizerFlags(1).Center());
+	choicesizer->Add(newd wxButton(dg, wxID_CANCEL, "OK"), wxSizerFlags(1).Center());
+	topsizer->Add(choicesizer, wxSizerFlags(1).Center());
+	dg->SetSizerAndFit(topsizer);
+	dg->Centre(wxBOTH);
 
-		if (tile->isBlocking()) {
-			blocking_tile_count += 1;
-		} else {
-			walkable_tile_count += 1;
-		}
+	int ret = dg->ShowModal();
 
-		if (is_detailed) {
-			detailed_tile_count += 1;
+	if (ret == wxID_OK) {
+		wxFileDialog file(dg, "Export statistics", "", "statistics.json", "*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+		if (file.ShowModal() == wxID_OK) {
+			std::ofstream out(nstr(file.GetPath()), std::ios::trunc);
+			out << collector.getJSON();
+			if (!out) {
+				g_gui.PopupDialog("Error", "Could not write " + file.GetPath(), wxOK);
+			}
 		}
-
-		load_counter += 1;
 	}
+	dg->Destroy();
+}
 
-	creatures_per_spawn = (spawn_count != 0 ? double(creature_count) / double(spawn_count) : -1.0);
-	percent_pathable = 100.0 * (tile_count != 0 ? double(walkable_tile_count) / double(tile_count) : -1.0);
-	percent_detailed = 100.0 * (tile_count != 0 ? double(detailed_tile_count) / double(tile_count) : -1.0);
-
-	load_counter = 0;
-	Houses& houses = map->houses;
-	for (HouseMap::const_iterator hit = houses.begin(); hit != houses.end(); ++hit) {
-		const House* house = hit->second;
-
-		if (load_counter % 64) {
-			g_gui.SetLoadDone((unsigned int)(95ll + int64_t(load_counter) * 5ll / int64_t(house_count)));
-		}
-
-		if (house->size() > largest_house_size) {
-			largest_house = house;
-			largest_house_size = house->size();
-		}
-		total_house_sqm += house->size();
-		town_sqm_count[house->townid] += house->size();
-	}
-
-	houses_per_town = (town_count != 0 ? double(house_count) / double(town_count) : -1.0);
-	sqm_per_house = (house_count != 0 ? double(total_house_sqm) / double(house_count) : -1.0);
-	sqm_per_town = (town_count != 0 ? double(total_house_sqm) / double(town_count) : -1.0);
-
-	Towns& towns = map->towns;
-	for (std::map<uint32_t, uint32_t>::iterator town_iter = town_sqm_count.begin();
-		 town_iter != town_sqm_count.end();
-		 ++town_iter) {
-		// No load bar for this, load is non-existant
-		uint32_t town_id = town_iter->first;
-		uint32_t town_sqm = town_iter->second;
-		Town* town = towns.getTown(town_id);
-		if (town && town_sqm > largest_town_size) {
-			largest_town = town;
-			largest_town_size = town_sqm;
-		} else {
-			// Non-existant town!
-		}
+void MainMenuBar::OnMapUndoHistory(wxCommandEvent& WXUNUSED(event)) {
+	if (!g_gui.IsEditorOpen()) {
+		return;
 	}
 
-	g_gui.DestroyLoadBar();
+	const ActionQueue* queue = g_gui.GetCurrentEditor()->actionQueue;
+	const UndoSpillFile* spill_file = queue->getSpillFile();
+	const double mb = 1024.0 * 1024.0;
 
 	std::ostringstream os;
-	os.setf(std::ios::fixed, std::ios::floatfield);
-	os.precision(2);
-	os << "Map statistics for the map \"" << map->getMapDescription() << "\"\n";
-
-	// Add map dimensions information
-	os << "\tMap dimensions:\n";
-	os << "\t\tWidth: " << map->getWidth() << " tiles\n";
-	os << "\t\tHeight: " << map->getHeight() << " tiles\n";
-	os << "\t\tTotal area: " << (map->getWidth() * map->getHeight()) << " square tiles\n";
-	os << "\t\tNumber of floors: " << (MAP_MAX_LAYER + 1) << "\n";
-
-	os << "\tTile data:\n";
-	os << "\t\tTotal number of tiles: " << tile_count << "\n";
-	os << "\t\tNumber of pathable tiles: " << walkable_tile_count << "\n";
-	os << "\t\tNumber of unpathable tiles: " << blocking_tile_count << "\n";
-	if (percent_pathable >= 0.0) {
-		os << "\t\tPercent walkable tiles: " << percent_pathable << "%\n";
-	}
-	os << "\t\tDetailed tiles: " << detailed_tile_count << "\n";
-	if (percent_detailed >= 0.0) {
-		os << "\t\tPercent detailed tiles: " << percent_detailed << "%\n";
-	}
-
-	os << "\tItem data:\n";
-	os << "\t\tTotal number of items: " << item_count << "\n";
-	os << "\t\tNumber of moveable tiles: " << loose_item_count << "\n";
-	os << "\t\tNumber of depots: " << depot_count << "\n";
-	os << "\t\tNumber of containers: " << container_count << "\n";
-	os << "\t\tNumber of items with Action ID: " << action_item_count << "\n";
-	os << "\t\tNumber of items with Unique ID: " << unique_item_count << "\n";
-	os << "\t\tItems per tile ratio: " << (tile_count > 0 ? (double)item_count / tile_count : 0) << "\n";
-
-	os << "\tCreature data:\n";
-	os << "\t\tTotal creature count: " << creature_count << "\n";
-	os << "\t\tTotal spawn count: " << spawn_count << "\n";
-	if (creatures_per_spawn >= 0) {
-		os << "\t\tMean creatures per spawn: " << creatures_per_spawn << "\n";
-	}
-	os << "\t\tCreature density: " << (tile_count > 0 ? (double)creature_count / tile_count * 100 : 0) << "% of tiles\n";
-
-	os << "\tTown/House data:\n";
-	os << "\t\tTotal number of towns: " << town_count << "\n";
-	os << "\t\tTotal number of houses: " << house_count << "\n";
-	if (houses_per_town >= 0) {
-		os << "\t\tMean houses per town: " << houses_per_town << "\n";
-	}
-	os << "\t\tTotal amount of housetiles: " << total_house_sqm << "\n";
-	if (sqm_per_house >= 0) {
-		os << "\t\tMean tiles per house: " << sqm_per_house << "\n";
-	}
-	if (sqm_per_town >= 0) {
-		os << "\t\tMean tiles per town: " << sqm_per_town << "\n";
-	}
-	os << "\t\tPercentage of map covered by houses: " << (tile_count > 0 ? (double)total_house_sqm / tile_count * 100 : 0) << "%\n";
-	/*
-	// Add waypoint statistics
-	int waypoint_count = map->waypoints.getWaypointCount();
-	os << "\tWaypoint data:\n";
-	os << "\t\tTotal number of waypoints: " << waypoint_count << "\n";
-
-	// Add zone statistics if available
-	os << "\tZone data:\n";
-	os << "\t\tTotal number of zones: " << map->zones.size() << "\n";
-	*/
-	if (largest_town) {
-		os << "\t\tLargest Town: \"" << largest_town->getName() << "\" (" << largest_town_size << " sqm)\n";
-	}
-	if (largest_house) {
-		os << "\t\tLargest House: \"" << largest_house->name << "\" (" << largest_house_size << " sqm)\n";
+	os << std::setprecision(2) << std::fixed;
+	os << "Undo history:\n";
+	os << "\tSteps: " << queue->getBatchCount() << "\n";
+	os << "\tSteps spilled to disk: " << queue->getSpilledBatchCount() << "\n";
+	os << "\tMemory used: " << queue->getMemorySize() / mb << " MB (limit " << g_settings.getInteger(Config::UNDO_MEM_SIZE) << " MB)\n";
+
+	os << "Spill file:\n";
+	if (spill_file) {
+		os << "\tFile size: " << spill_file->getFileSize() / mb << " MB (limit " << g_settings.getInteger(Config::UNDO_DISK_SIZE) << " MB)\n";
+		os << "\tRecords in use: " << spill_file->getRecordCount() << "\n";
+		os << "\tCompressed size in use: " << spill_file->getLiveSize() / mb << " MB\n";
+		os << "\tUncompressed size in use: " << spill_file->getLiveRawSize() / mb << " MB\n";
+	} else {
+		os << "\tNot created yet\n";
 	}
 
-	// Add map file information
-	os << "\tMap file information:\n";
-	os << "\t\tOTBM version: " << map->getVersion().otbm << "\n";
-	os << "\t\tClient version: " << map->getVersion().client << "\n";
-	os << "\t\tFile size (approximate): " << (map->getTileCount() * 512 / 1024) << " KB\n";
-
-	os << "\n";
-	os << "Generated by Remere's Map Editor version OTARMEIE " + __RME_VERSION__ + "\n";
+	os << "Reloads:\n";
+	os << "\tSteps read back from disk: " << queue->getReloadCount() << "\n";
+	if (queue->getReloadCount() > 0) {
+		os << "\tLast reload: " << queue->getLastReloadTime() * 1000.0 << " ms\n";
+		os << "\tMean reload: " << queue->getTotalReloadTime() * 1000.0 / queue->getReloadCount() << " ms\n";
+	}
 
-	wxDialog* dg = newd wxDialog(frame, wxID_ANY, "Map Statistics", wxDefaultPosition, wxDefaultSize, wxRESIZE_BORDER | wxCAPTION | wxCLOSE_BOX);
+	wxDialog* dg = newd wxDialog(frame, wxID_ANY, "Undo History", wxDefaultPosition, wxDefaultSize, wxRESIZE_BORDER | wxCAPTION | wxCLOSE_BOX);
 	wxSizer* topsizer = newd wxBoxSizer(wxVERTICAL);
 	wxTextCtrl* text_field = newd wxTextCtrl(dg, wxID_ANY, wxstr(os.str()), wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY);
 	text_field->SetMinSize(wxSize(400, 300));
 	topsizer->Add(text_field, wxSizerFlags(5).Expand());
-
-	wxSizer* choicesizer = newd wxBoxSizer(wxHORIZONTAL);
-	wxButton* export_button = newd wxButton(dg, wxID_OK, "Export as XML");
-	choicesizer->Add(export_button, wxSizerFlags(1).Center());
-	export_button->Enable(false);
-	choicesizer->Add(newd wxButton(dg, wxID_CANCEL, "OK"), wxSizerFlags(1).Center());
-	topsizer->Add(choicesizer, wxSizerFlags(1).Center());
+	topsizer->Add(newd wxButton(dg, wxID_CANCEL, "OK"), wxSizerFlags(1).Center());
 	dg->SetSizerAndFit(topsizer);
 	dg->Centre(wxBOTH);
-
-	int ret = dg->ShowModal();
-
-	if (ret == wxID_OK) {
-		// std::cout << "XML EXPORT";
-	} else if (ret == wxID_CANCEL) {
-		// std::cout << "OK";
-	}
+	dg->ShowModal();
+	dg->Destroy();
 }
 
 void MainMenuBar::OnMapCleanup(wxCommandEvent& WXUNUSED(event)) {
@@ -2704,6 +2579,27 @@ void MainMenuBar::OnChangeViewSettings(wxCommandEvent& event) {
 	g_gui.RefreshView();
 }
 
+void MainMenuBar::OnShowRenderProfiler(wxCommandEvent& WXUNUSED(event)) {
+	g_render_profiler.setOverlayVisible(IsItemChecked(MenuBar::SHOW_RENDER_PROFILER));
+	g_gui.RefreshView();
+}
+
+void MainMenuBar::OnRecordRenderTrace(wxCommandEvent& WXUNUSED(event)) {
+	if (!g_render_profiler.isRecording()) {
+		g_render_profiler.startRecording();
+		return;
+	}
+
+	g_render_profiler.stopRecording();
+	wxFileDialog dialog(frame, "Save render trace...", "", "render_trace.json", "Chrome trace (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	if (dialog.ShowModal() == wxID_OK) {
+		wxString error;
+		if (!g_render_profiler.saveTrace(dialog.GetPath(), error)) {
+			g_gui.PopupDialog("Error", error, wxOK);
+		}
+	}
+}
+
 void MainMenuBar::OnChangeFloor(wxCommandEvent& event) {
 	// Workaround to stop events from looping
 	if (checking_programmaticly) {
@@ -3608,6 +3504,7 @@ void MainMenuBar::OnRefreshItems(wxCommandEvent& WXUNUSED(event)) {
                         newItem
                     );
                 }
+                editor->map.touchTile(data.pos);
             }
         }
 
@@ -35,6 +35,7 @@ namespace MenuBar {
 		IMPORT_MINIMAP,
 		EXPORT_MINIMAP,
 		EXPORT_TILESETS,
+		EXPORT_SELECTION_IMAGE,
 		RELOAD_DATA,
 		RECENT_FILES,
 		PREFERENCES,
@@ -88,6 +89,7 @@ namespace MenuBar {
 		MAP_CLEAN_HOUSE_ITEMS,
 		MAP_PROPERTIES,
 		MAP_STATISTICS,
+		MAP_UNDO_HISTORY,
 		VIEW_TOOLBARS_BRUSHES,
 		VIEW_TOOLBARS_POSITION,
 		VIEW_TOOLBARS_SIZES,
@@ -167,6 +169,8 @@ namespace MenuBar {
 		ID_MENU_SERVER_CONNECT,
 
 		EXPERIMENTAL_FOG,
+		SHOW_RENDER_PROFILER,
+		RECORD_RENDER_TRACE,
 		MAP_REMOVE_DUPLICATES,
 		SHOW_HOTKEYS,
 		MAP_MENU_REPLACE_ITEMS,
@@ -180,6 +184,7 @@ namespace MenuBar {
 }
 
 class MainFrame;
+class MapStatisticsCollector;
 
 class MainMenuBar : public wxEvtHandler {
 public:
@@ -222,6 +227,7 @@ public:
 	void OnImportMinimap(wxCommandEvent& event);
 	void OnExportMinimap(wxCommandEvent& event);
 	void OnExportTilesets(wxCommandEvent& event);
+	void OnExportSelectionImage(wxCommandEvent& event);
 	void OnReloadDataFiles(wxCommandEvent& event);
 
 	// Edit Menu
@@ -273,6 +279,7 @@ public:
 	void OnMapCleanup(wxCommandEvent& event);
 	void OnMapProperties(wxCommandEvent& event);
 	void OnMapStatistics(wxCommandEvent& event);
+	void OnMapUndoHistory(wxCommandEvent& event);
 	void OnMapRemoveDuplicates(wxCommandEvent& event);
 	void OnMapValidateGround(wxCommandEvent& event);
 
@@ -285,6 +292,8 @@ public:
 	void OnZoomOut(wxCommandEvent& event);
 	void OnZoomNormal(wxCommandEvent& event);
 	void OnChangeViewSettings(wxCommandEvent& event);
+	void OnShowRenderProfiler(wxCommandEvent& event);
+	void OnRecordRenderTrace(wxCommandEvent& event);
 
 	// Network menu
 	void OnStartLive(wxCommandEvent& event);
@@ -327,6 +336,7 @@ protected:
 	// Checks the items in the menus according to the settings (in config)
 	void LoadValues();
 	void SearchItems(bool unique, bool action, bool container, bool writable, bool zones, bool onSelection = false);
+	void ShowMapStatistics(const MapStatisticsCollector& collector);
 
 protected:
 	MainFrame* frame;
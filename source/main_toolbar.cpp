@@ -189,8 +189,8 @@ MainToolBar::~MainToolBar() {
 void MainToolBar::UpdateButtons() {
 	Editor* editor = g_gui.GetCurrentEditor();
 	if (editor) {
-		standard_toolbar->EnableTool(wxID_UNDO, editor->actionQueue->canUndo());
-		standard_toolbar->EnableTool(wxID_REDO, editor->actionQueue->canRedo());
+		standard_toolbar->EnableTool(wxID_UNDO, editor->CanEdit() && editor->actionQueue->canUndo());
+		standard_toolbar->EnableTool(wxID_REDO, editor->CanEdit() && editor->actionQueue->canRedo());
 		standard_toolbar->EnableTool(wxID_PASTE, editor->copybuffer.canPaste());
 	} else {
 		standard_toolbar->EnableTool(wxID_UNDO, false);
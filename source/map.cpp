@@ -20,6 +20,8 @@
 #include "gui.h" // loadbar
 
 #include "map.h"
+#include "minimap_export.h"
+#include "conversion_table.h"
 
 #include <sstream>
 #include "string_utils.h"
@@ -115,6 +117,32 @@ bool Map::open(const std::string file) {
 	return true;
 }
 
+typedef ConversionMap (*ConversionFactory)();
+
+// Item conversions between two client versions, in the order they are applied
+static std::vector<ConversionFactory> getItemConversions(const MapVersion& from, const MapVersion& to) {
+	std::vector<ConversionFactory> conversions;
+	// A new map has no items of any version yet
+	if (from.client == CLIENT_VERSION_NONE || from.client == to.client) {
+		return conversions;
+	}
+
+	if (from.client >= CLIENT_VERSION_760 && to.client < CLIENT_VERSION_760) {
+		conversions.push_back(&getReplacementMapFrom760To740);
+	}
+	if (from.client < CLIENT_VERSION_810 && to.client >= CLIENT_VERSION_810) {
+		conversions.push_back(&getReplacementMapFrom800To810);
+	}
+	if (from.client == CLIENT_VERSION_854_BAD && to.client >= CLIENT_VERSION_854) {
+		conversions.push_back(&getReplacementMapFrom854To854);
+	}
+	return conversions;
+}
+
+bool Map::hasItemConversion(MapVersion to) const {
+	return !getItemConversions(mapVersion, to).empty();
+}
+
 bool Map::convert(MapVersion to, bool showdialog) {
 	if (mapVersion.client == to.client) {
 		// Only OTBM version differs
@@ -123,20 +151,9 @@ bool Map::convert(MapVersion to, bool showdialog) {
 		return true;
 	}
 
-	/* TODO
-
-	if(to.otbm == MAP_OTBM_4 && to.client < CLIENT_VERSION_850)
-		return false;
-
-	if(mapVersion.client >= CLIENT_VERSION_760 && to.client < CLIENT_VERSION_760)
-		convert(getReplacementMapFrom760To740(), showdialog);
-
-	if(mapVersion.client < CLIENT_VERSION_810 && to.client >= CLIENT_VERSION_810)
-		convert(getReplacementMapFrom800To810(), showdialog);
-
-	if(mapVersion.client == CLIENT_VERSION_854_BAD && to.client >= CLIENT_VERSION_854)
-		convert(getReplacementMapFrom854To854(), showdialog);
-	*/
+	for (ConversionFactory conversion : getItemConversions(mapVersion, to)) {
+		convert(conversion(), showdialog);
+	}
 	mapVersion = to;
 
 	return true;
@@ -147,20 +164,16 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 		g_gui.CreateLoadBar("Converting map ...");
 	}
 
-	uint64_t tiles_done = 0;
-	std::vector<uint16_t> id_list;
-
-	// std::ofstream conversions("converted_items.txt");
-
-	for (MapIterator miter = begin(); miter != end(); ++miter) {
-		Tile* tile = (*miter)->get();
-		ASSERT(tile);
+	const ConversionTable table(rm);
 
+	// Every tile is converted on its own, so subtrees can go in parallel
+	forEachTileParallel([&](Tile* tile) {
 		if (tile->size() == 0) {
-			continue;
+			return;
 		}
 
 		// id_list try MTM conversion
+		thread_local std::vector<uint16_t> id_list;
 		id_list.clear();
 
 		if (tile->ground) {
@@ -174,20 +187,25 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 
 		std::sort(id_list.begin(), id_list.end());
 
-		ConversionMap::MTM::const_iterator cfmtm = rm.mtm.end();
-
-		while (id_list.size()) {
-			cfmtm = rm.mtm.find(id_list);
-			if (cfmtm != rm.mtm.end()) {
-				break;
-			}
-			id_list.pop_back();
-		}
-
 		// Keep track of how many items have been inserted at the bottom
 		size_t inserted_items = 0;
 
-		if (cfmtm != rm.mtm.end()) {
+		const ConversionTable::MultiEntry* cfmtm = table.match(id_list);
+#ifdef __DEBUG__
+		// The table has to find the entry the ConversionMap lookup finds
+		std::vector<uint16_t> probe(id_list);
+		ConversionMap::MTM::const_iterator reference = rm.mtm.end();
+		while (!probe.empty() && (reference = rm.mtm.find(probe)) == rm.mtm.end()) {
+			probe.pop_back();
+		}
+		ASSERT(cfmtm == (reference == rm.mtm.end() ? nullptr : &*reference));
+		for (uint16_t id : id_list) {
+			ConversionMap::STM::const_iterator single = rm.stm.find(id);
+			ASSERT(table.getReplacement(id) == (single == rm.stm.end() ? nullptr : &single->second));
+		}
+#endif
+
+		if (cfmtm) {
 			const std::vector<uint16_t>& v = cfmtm->first;
 
 			if (tile->ground && std::find(v.begin(), v.end(), tile->ground->getID()) != v.end()) {
@@ -217,18 +235,14 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 		}
 
 		if (tile->ground) {
-			ConversionMap::STM::const_iterator cfstm = rm.stm.find(tile->ground->getID());
-			if (cfstm != rm.stm.end()) {
+			if (const std::vector<uint16_t>* v = table.getReplacement(tile->ground->getID())) {
 				uint16_t aid = tile->ground->getActionID();
 				uint16_t uid = tile->ground->getUniqueID();
 				delete tile->ground;
 				tile->ground = nullptr;
 
-				const std::vector<uint16_t>& v = cfstm->second;
-				// conversions << "Converted " << tile->getX() << ":" << tile->getY() << ":" << tile->getZ() << " " << id << " -> ";
-				for (std::vector<uint16_t>::const_iterator iit = v.begin(); iit != v.end(); ++iit) {
+				for (std::vector<uint16_t>::const_iterator iit = v->begin(); iit != v->end(); ++iit) {
 					Item* item = Item::Create(*iit);
-					// conversions << *iit << " ";
 					if (item->isGroundTile()) {
 						item->setActionID(aid);
 						item->setUniqueID(uid);
@@ -238,35 +252,29 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 						++inserted_items;
 					}
 				}
-				// conversions << std::endl;
 			}
 		}
 
 		for (ItemVector::iterator replace_item_iter = tile->items.begin() + inserted_items; replace_item_iter != tile->items.end();) {
-			uint16_t id = (*replace_item_iter)->getID();
-			ConversionMap::STM::const_iterator cf = rm.stm.find(id);
-			if (cf != rm.stm.end()) {
-				// uint16_t aid = (*replace_item_iter)->getActionID();
-				// uint16_t uid = (*replace_item_iter)->getUniqueID();
+			if (const std::vector<uint16_t>* v = table.getReplacement((*replace_item_iter)->getID())) {
 				delete *replace_item_iter;
 
 				replace_item_iter = tile->items.erase(replace_item_iter);
-				const std::vector<uint16_t>& v = cf->second;
-				for (std::vector<uint16_t>::const_iterator iit = v.begin(); iit != v.end(); ++iit) {
+				for (std::vector<uint16_t>::const_iterator iit = v->begin(); iit != v->end(); ++iit) {
 					replace_item_iter = tile->items.insert(replace_item_iter, Item::Create(*iit));
-					// conversions << "Converted " << tile->getX() << ":" << tile->getY() << ":" << tile->getZ() << " " << id << " -> " << *iit << std::endl;
 					++replace_item_iter;
 				}
 			} else {
 				++replace_item_iter;
 			}
 		}
-
-		++tiles_done;
-		if (showdialog && tiles_done % 0x10000 == 0) {
+	}, [this, showdialog](uint64_t tiles_done) {
+		if (showdialog) {
 			g_gui.SetLoadDone(int(tiles_done / double(getTileCount()) * 100.0));
 		}
-	}
+	});
+	// Tiles were converted in place, from several threads
+	touchAllTiles();
 
 	if (showdialog) {
 		g_gui.DestroyLoadBar();
@@ -324,6 +332,7 @@ void Map::cleanInvalidTiles(bool showdialog) {
 				delete *item_iter;
 				item_iter = tile->items.erase(item_iter);
 				++removed_count;
+				touchTile(tile->getPosition());
 			}
 		}
 
@@ -354,6 +363,7 @@ void Map::convertHouseTiles(uint32_t fromId, uint32_t toId) {
 		}
 
 		tile->setHouseID(toId);
+		touchTile(tile->getPosition());
 		++tiles_done;
 		if (tiles_done % 0x10000 == 0) {
 			g_gui.SetLoadDone(int(tiles_done / double(getTileCount()) * 100.0));
@@ -421,245 +431,58 @@ void Map::setSpawnFilename(const std::string& new_spawnfile) {
 }
 
 bool Map::addSpawn(Tile* tile) {
-	Spawn* spawn = tile->spawn;
-	if (spawn) {
-		int z = tile->getZ();
-		int start_x = tile->getX() - spawn->getSize();
-		int start_y = tile->getY() - spawn->getSize();
-		int end_x = tile->getX() + spawn->getSize();
-		int end_y = tile->getY() + spawn->getSize();
-
-		for (int y = start_y; y <= end_y; ++y) {
-			for (int x = start_x; x <= end_x; ++x) {
-				TileLocation* ctile_loc = createTileL(x, y, z);
-				ctile_loc->increaseSpawnCount();
-			}
-		}
+	if (tile->spawn) {
 		spawns.addSpawn(tile);
 		return true;
 	}
 	return false;
 }
 
-void Map::removeSpawnInternal(Tile* tile) {
-	Spawn* spawn = tile->spawn;
-	ASSERT(spawn);
-
-	int z = tile->getZ();
-	int start_x = tile->getX() - spawn->getSize();
-	int start_y = tile->getY() - spawn->getSize();
-	int end_x = tile->getX() + spawn->getSize();
-	int end_y = tile->getY() + spawn->getSize();
-
-	for (int y = start_y; y <= end_y; ++y) {
-		for (int x = start_x; x <= end_x; ++x) {
-			TileLocation* ctile_loc = getTileL(x, y, z);
-			if (ctile_loc != nullptr && ctile_loc->getSpawnCount() > 0) {
-				ctile_loc->decreaseSpawnCount();
-			}
-		}
-	}
-}
-
 void Map::removeSpawn(Tile* tile) {
 	if (tile->spawn) {
-		removeSpawnInternal(tile);
 		spawns.removeSpawn(tile);
 	}
 }
 
+size_t Map::getSpawnCount(const Position& position) const {
+	return spawns.countSpawns(position);
+}
+
+void Map::getSpawnAreas(int start_x, int start_y, int end_x, int end_y, int z, std::vector<SpawnArea>& result) const {
+	spawns.getAreas(start_x, start_y, end_x, end_y, z, result);
+}
+
 SpawnList Map::getSpawnList(Tile* where) {
 	SpawnList list;
-	TileLocation* tile_loc = where->getLocation();
-	if (tile_loc) {
-		if (tile_loc->getSpawnCount() > 0) {
-			uint32_t found = 0;
-			if (where->spawn) {
-				++found;
-				list.push_back(where->spawn);
-			}
-
-			// Scans the border tiles in an expanding square around the original spawn
-			int z = where->getZ();
-			int start_x = where->getX() - 1, end_x = where->getX() + 1;
-			int start_y = where->getY() - 1, end_y = where->getY() + 1;
-			while (found != tile_loc->getSpawnCount()) {
-				for (int x = start_x; x <= end_x; ++x) {
-					Tile* tile = getTile(x, start_y, z);
-					if (tile && tile->spawn) {
-						list.push_back(tile->spawn);
-						++found;
-					}
-					tile = getTile(x, end_y, z);
-					if (tile && tile->spawn) {
-						list.push_back(tile->spawn);
-						++found;
-					}
-				}
+	if (!where) {
+		return list;
+	}
 
-				for (int y = start_y + 1; y < end_y; ++y) {
-					Tile* tile = getTile(start_x, y, z);
-					if (tile && tile->spawn) {
-						list.push_back(tile->spawn);
-						++found;
-					}
-					tile = getTile(end_x, y, z);
-					if (tile && tile->spawn) {
-						list.push_back(tile->spawn);
-						++found;
-					}
-				}
-				--start_x, --start_y;
-				++end_x, ++end_y;
-			}
+	const Position& position = where->getPosition();
+	std::vector<Position> centers;
+	spawns.getSpawns(position, centers);
+
+	// Nearest spawn first, the one on the tile itself leads
+	std::sort(centers.begin(), centers.end(), [&position](const Position& a, const Position& b) {
+		int da = std::max(std::abs(a.x - position.x), std::abs(a.y - position.y));
+		int db = std::max(std::abs(b.x - position.x), std::abs(b.y - position.y));
+		return da < db || (da == db && a < b);
+	});
+
+	for (const Position& center : centers) {
+		Tile* tile = getTile(center);
+		if (tile && tile->spawn) {
+			list.push_back(tile->spawn);
 		}
 	}
 	return list;
 }
 
 bool Map::exportMinimap(FileName filename, int floor, bool displaydialog) {
-	uint8_t* pic = nullptr;
-
-	try {
-		// Find the actual bounds of used tiles
-		int min_x = 0x10000, min_y = 0x10000;
-		int max_x = 0x00000, max_y = 0x00000;
-		bool found_tiles = false;
-
-		for (MapIterator mit = begin(); mit != end(); ++mit) {
-			if ((*mit)->get() == nullptr || (*mit)->empty() || (*mit)->getZ() != floor) {
-				continue;
-			}
-
-			found_tiles = true;
-			Position pos = (*mit)->getPosition();
-
-			min_x = std::min(min_x, pos.x);
-			min_y = std::min(min_y, pos.y);
-			max_x = std::max(max_x, pos.x);
-			max_y = std::max(max_y, pos.y);
-		}
-
-		if (!found_tiles) {
-			return true;
-		}
-
-		// Add padding of 10 tiles
-		min_x = std::max(0, min_x - 10);
-		min_y = std::max(0, min_y - 10);
-		max_x = std::min(65535, max_x + 10);
-		max_y = std::min(65535, max_y + 10);
-
-		// Calculate dimensions
-		int minimap_width = max_x - min_x + 1;
-		int minimap_height = max_y - min_y + 1;
-
-		// Allocate memory for the bitmap
-		pic = newd uint8_t[minimap_width * minimap_height];
-		memset(pic, 0, minimap_width * minimap_height);
-
-		// Fill the bitmap
-		for (MapIterator mit = begin(); mit != end(); ++mit) {
-			Tile* tile = (*mit)->get();
-			if (!tile || tile->empty() || tile->getZ() != floor) {
-				continue;
-			}
-
-			uint32_t pixelpos = (tile->getY() - min_y) * minimap_width + (tile->getX() - min_x);
-			uint8_t& pixel = pic[pixelpos];
-
-			// Get color from items
-			for (ItemVector::const_reverse_iterator item_iter = tile->items.rbegin(); 
-				 item_iter != tile->items.rend(); ++item_iter) {
-				if ((*item_iter)->getMiniMapColor()) {
-					pixel = (*item_iter)->getMiniMapColor();
-					break;
-				}
-			}
-
-			// If no item color, check ground
-			if (pixel == 0 && tile->hasGround()) {
-				pixel = tile->ground->getMiniMapColor();
-			}
-		}
-
-		// Write to file
-		FileWriteHandle fh(nstr(filename.GetFullPath()));
-		if (!fh.isOpen()) {
-			delete[] pic;
-			return false;
-		}
-
-		// Store the magic number
-		fh.addRAW("BM");
-
-		// Store the file size
-		// We need to predict how large it will be
-		uint32_t file_size = 14 // header
-			+ 40 // image data header
-			+ 256 * 4 // color palette
-			+ ((minimap_width + 3) / 4 * 4) * height; // pixels
-		fh.addU32(file_size);
-
-		// Two values reserved, must always be 0.
-		fh.addU16(0);
-		fh.addU16(0);
-
-		// Bitmapdata offset
-		fh.addU32(14 + 40 + 256 * 4);
-
-		// Header size
-		fh.addU32(40);
-
-		// Header width/height
-		fh.addU32(minimap_width);
-		fh.addU32(minimap_height);
-
-		// Color planes
-		fh.addU16(1);
-
-		// bits per pixel, OT map format is 8
-		fh.addU16(8);
-
-		// compression type, 0 is no compression
-		fh.addU32(0);
-
-		// image size, 0 is valid if we use no compression
-		fh.addU32(0);
-
-		// horizontal/vertical resolution in pixels / meter
-		fh.addU32(4000);
-		fh.addU32(4000);
-
-		// Number of colors
-		fh.addU32(256);
-		// Important colors, 0 is all
-		fh.addU32(0);
-
-		// Write the color palette
-		for (int i = 0; i < 256; ++i) {
-			fh.addU32(uint32_t(minimap_color[i]));
-		}
-
-		// Bitmap width must be divisible by four, calculate how much padding we need
-		int padding = ((minimap_width & 3) != 0 ? 4 - (minimap_width & 3) : 0);
-		// Bitmap rows are saved in reverse order
-		for (int y = minimap_height - 1; y >= 0; --y) {
-			fh.addRAW(pic + y * minimap_width, minimap_width);
-			for (int i = 0; i < padding; ++i) {
-				fh.addU8(0);
-			}
-			if (y % 100 == 0 && displaydialog) {
-				g_gui.SetLoadDone(90 + int((minimap_height - y) / double(minimap_height) * 10.0));
-			}
-		}
-
-		delete[] pic;
-		return true;
-	} catch (...) {
-		delete[] pic;
-		throw;
-	}
+	MinimapExporter exporter(*this, filename.GetExt().Lower() == "png" ? MINIMAP_EXPORT_PNG : MINIMAP_EXPORT_BMP);
+	exporter.setPadding(10);
+	exporter.setShowProgress(displaydialog);
+	return exporter.exportFloor(filename, floor);
 }
 
 uint32_t Map::cleanDuplicateItems(const std::vector<std::pair<uint16_t, uint16_t>>& ranges, const PropertyFlags& flags) {
@@ -753,6 +576,7 @@ uint32_t Map::cleanDuplicateItems(const std::vector<std::pair<uint16_t, uint16_t
 		}
 
 		if (tile_modified) {
+			touchTile(tile->getPosition());
 			tiles_affected++;
 		}
 	}
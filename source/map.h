@@ -26,6 +26,7 @@
 #include "complexitem.h"
 #include "waypoints.h"
 #include "templates.h"
+#include "zone_labeler.h"
 
 // Add this struct before the Map class definition
 struct PropertyFlags {
@@ -89,6 +90,8 @@ public:
 	bool exportMinimap(FileName filename, int floor = GROUND_LAYER, bool showdialog = false);
 	//
 	bool convert(MapVersion to, bool showdialog = false);
+	// Whether converting to the version replaces items, not only the version
+	bool hasItemConversion(MapVersion to) const;
 	bool convert(const ConversionMap& cm, bool showdialog = false);
 
 	// Query information about the map
@@ -122,6 +125,15 @@ public:
 		removeSpawn(getTile(position));
 	}
 
+	// Number of spawns whose radius covers the position
+	size_t getSpawnCount(const Position& position) const override;
+	// Spawns whose radius overlaps the rectangle on floor z
+	void getSpawnAreas(int start_x, int start_y, int end_x, int end_y, int z, std::vector<SpawnArea>& result) const;
+
+	void zonesChanged(int x, int y, int z) override {
+		zoneLabels.invalidate(x, y, z);
+	}
+
 	// Returns all possible spawns on the target tile
 	SpawnList getSpawnList(Tile* t);
 	SpawnList getSpawnList(const Position& position) {
@@ -184,8 +196,6 @@ protected:
 	bool open(const std::string identifier);
 
 protected:
-	void removeSpawnInternal(Tile* tile);
-
 	wxArrayString warnings;
 	wxString error;
 
@@ -206,6 +216,7 @@ public:
 	Towns towns;
 	Houses houses;
 	Spawns spawns;
+	ZoneLabeler zoneLabels;
 
 protected:
 	bool has_changed; // If the map has changed
@@ -316,6 +327,7 @@ inline int64_t RemoveItemOnMap(Map& map, RemoveIfType& condition, bool selectedO
 			continue;
 		}
 
+		const int64_t removed_before = removed;
 		if (tile->ground) {
 			if (condition(map, tile->ground, removed, done)) {
 				delete tile->ground;
@@ -334,6 +346,9 @@ inline int64_t RemoveItemOnMap(Map& map, RemoveIfType& condition, bool selectedO
 				++iit;
 			}
 		}
+		if (removed != removed_before) {
+			map.touchTile(tile->getPosition());
+		}
 		++it;
 	}
 	return removed;
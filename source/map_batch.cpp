@@ -0,0 +1,663 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_batch.h"
+#include "editor.h"
+#include "gui.h"
+#include "settings.h"
+#include "iomap_otbm.h"
+#include "copybuffer.h"
+#include "ground_brush.h"
+#include "region_export.h"
+#include "map_statistics.h"
+#include "data_cache.h"
+#include "item_search_index.h"
+#include "raw_brush.h"
+
+#include <wx/init.h>
+
+#include <chrono>
+#include <random>
+
+#ifdef __WINDOWS__
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+MapBatch::MapBatch() {
+	////
+}
+
+MapBatch::~MapBatch() {
+	////
+}
+
+int MapBatch::main(int argc, char** argv) {
+	// A console application never opens a connection to the display
+	wxApp::SetInstance(newd wxAppConsole());
+	wxInitializer initializer(argc, argv);
+	if (!initializer.IsOk()) {
+		std::cout << "Could not initialize wxWidgets." << std::endl;
+		return EXIT_USAGE;
+	}
+
+	wxArrayString arguments;
+	for (int i = 2; i < argc; ++i) {
+		arguments.Add(wxString(argv[i], wxConvUTF8));
+	}
+
+	MapBatch batch;
+	return batch.run(arguments);
+}
+
+int MapBatch::run(const wxArrayString& arguments) {
+	g_gui.SetHeadless(true);
+
+	if (arguments.empty()) {
+		std::cout << "Usage: -batch <map> <step> [<step> ...]" << std::endl;
+		return EXIT_USAGE;
+	}
+
+	wxArrayString steps;
+	wxArrayString stepArguments(arguments);
+	stepArguments.RemoveAt(0);
+	if (!expandSteps(stepArguments, steps)) {
+		return EXIT_USAGE;
+	}
+
+	g_gui.discoverDataDirectory("clients.xml");
+	g_settings.load();
+	ClientVersion::loadVersions();
+
+	auto started = std::chrono::steady_clock::now();
+	if (!loadMap(arguments[0])) {
+		return EXIT_LOAD_FAILED;
+	}
+
+	int exitCode = EXIT_OK;
+	for (size_t i = 0; i < steps.size(); ++i) {
+		std::cout << "[" << (i + 1) << "/" << steps.size() << "] " << steps[i] << std::endl;
+
+		auto stepStarted = std::chrono::steady_clock::now();
+		bool success = runStep(steps[i]);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStarted).count();
+
+		std::cout << "[" << (i + 1) << "/" << steps.size() << "] " << steps[i] << (success ? " done" : " FAILED")
+				  << " in " << static_cast<int>(seconds * 1000) << " ms, peak memory " << (getPeakMemory() >> 20) << " MB" << std::endl;
+		if (!success) {
+			exitCode = EXIT_STEP_FAILED;
+			break;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	std::cout << "Finished in " << static_cast<int>(seconds * 1000) << " ms, peak memory " << (getPeakMemory() >> 20) << " MB" << std::endl;
+
+	editor.reset();
+	g_gui.SetHeadless(false);
+	return exitCode;
+}
+
+bool MapBatch::expandSteps(const wxArrayString& arguments, wxArrayString& steps) {
+	for (const wxString& argument : arguments) {
+		if (!argument.StartsWith("@")) {
+			steps.Add(argument);
+			continue;
+		}
+
+		std::ifstream file(nstr(argument.Mid(1)));
+		if (!file.is_open()) {
+			std::cout << "Could not open step file " << argument.Mid(1) << std::endl;
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(file, line)) {
+			wxString step = wxString(line.c_str(), wxConvUTF8).Trim().Trim(false);
+			if (!step.empty() && !step.StartsWith("#")) {
+				steps.Add(step);
+			}
+		}
+	}
+	return true;
+}
+
+bool MapBatch::loadMap(const wxString& path) {
+	FileName filename(path);
+	MapVersion version;
+	if (!IOMapOTBM::getVersionInfo(filename, version)) {
+		std::cout << "Could not open map " << path << std::endl;
+		return false;
+	}
+
+	auto started = std::chrono::steady_clock::now();
+
+	wxString error;
+	wxArrayString warnings;
+	if (!g_gui.LoadVersion(version.client, error, warnings)) {
+		std::cout << "Could not load client version: " << error << std::endl;
+		return false;
+	}
+	g_gui.ListDialog("Client data warnings", warnings);
+
+	try {
+		editor.reset(newd Editor(g_gui.copybuffer, filename));
+	} catch (std::runtime_error& e) {
+		std::cout << "Could not load map: " << e.what() << std::endl;
+		return false;
+	}
+	g_gui.ListDialog("Map warnings", editor->map.getWarnings());
+
+	if (editor->map.hasError()) {
+		std::cout << "Could not load map: " << editor->map.getError() << std::endl;
+		return false;
+	}
+
+	mapPath = filename.GetFullPath();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	std::cout << "Loaded " << mapPath << " (" << editor->map.getTileCount() << " tiles) in " << static_cast<int>(seconds * 1000)
+			  << " ms, peak memory " << (getPeakMemory() >> 20) << " MB" << std::endl;
+	return true;
+}
+
+bool MapBatch::runStep(const wxString& step) {
+	wxString name = step.BeforeFirst('=');
+	wxString value = step.AfterFirst('=');
+	Map& map = editor->map;
+
+	if (name == "convert") {
+		ClientVersion* client = ClientVersion::get(nstr(value));
+		if (!client) {
+			std::cout << "Unknown client version " << value << std::endl;
+			return false;
+		}
+
+		const MapVersion target(client->getPrefferedMapVersionID(), client->getID());
+		if (client->getID() != map.getVersion().client && !map.hasItemConversion(target)) {
+			// The editor only has item tables for a few old client versions
+			std::cout << "  WARNING: no item conversion to " << client->getName() << ", the map keeps its item ids and only its version changes" << std::endl;
+		}
+
+		wxString error;
+		wxArrayString warnings;
+		if (!g_gui.LoadVersion(client->getID(), error, warnings)) {
+			std::cout << "Could not load client version: " << error << std::endl;
+			return false;
+		}
+		g_gui.ListDialog("Client data warnings", warnings);
+
+		ScopedLoadingBar loadingBar("Converting map...");
+		return map.convert(target, true);
+	} else if (name == "clean-invalid") {
+		ScopedLoadingBar loadingBar("Removing invalid items...");
+		map.cleanInvalidTiles(true);
+		return true;
+	} else if (name == "clean-duplicates") {
+		uint32_t removed = map.cleanDuplicateItems(std::vector<std::pair<uint16_t, uint16_t>>(), PropertyFlags());
+		std::cout << "  Removed " << removed << " duplicated items" << std::endl;
+		return true;
+	} else if (name == "validate-grounds") {
+		uint32_t changes = editor->validateGrounds(true, true, true);
+		std::cout << "  Changed " << changes << " tiles" << std::endl;
+		return true;
+	} else if (name == "borderize") {
+		auto started = std::chrono::steady_clock::now();
+		editor->borderizeMap(false);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		std::cout << "  Borderized " << map.getTileCount() << " tiles, " << static_cast<uint64_t>(map.getTileCount() / std::max(seconds, 0.001)) << " tiles/s" << std::endl;
+		return true;
+	} else if (name == "minimap") {
+		int floor = GROUND_LAYER;
+		wxString file = value;
+		long number;
+		if (value.AfterLast(':').ToLong(&number) && value.Contains(":")) {
+			floor = static_cast<int>(number);
+			file = value.BeforeLast(':');
+		}
+		if (file.empty() || floor < 0 || floor > MAP_MAX_LAYER) {
+			std::cout << "Usage: minimap=<file>[:<floor>]" << std::endl;
+			return false;
+		}
+		ScopedLoadingBar loadingBar("Exporting minimap...");
+		return map.exportMinimap(FileName(file), floor, true);
+	} else if (name == "region") {
+		wxArrayString numbers = wxSplit(value.AfterLast(':'), ',');
+		long area[5] = { 0, 0, 0, 0, GROUND_LAYER };
+		bool valid = value.Contains(":") && (numbers.size() == 4 || numbers.size() == 5);
+		for (size_t i = 0; valid && i < numbers.size(); ++i) {
+			valid = numbers[i].ToLong(&area[i]) && area[i] >= 0;
+		}
+		wxString file = value.BeforeLast(':');
+		if (!valid || file.empty() || area[2] < area[0] || area[3] < area[1] || area[4] > MAP_MAX_LAYER) {
+			std::cout << "Usage: region=<file>:<x1>,<y1>,<x2>,<y2>[,<floor>]" << std::endl;
+			return false;
+		}
+
+		auto started = std::chrono::steady_clock::now();
+		ScopedLoadingBar loadingBar("Exporting region...");
+		RegionExporter exporter(map);
+		exporter.setShowProgress(true);
+		if (!exporter.exportRegion(FileName(file), area[0], area[1], area[2], area[3], area[4])) {
+			std::cout << "Could not export " << file << std::endl;
+			return false;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		const uint64_t tiles = uint64_t(area[2] - area[0] + 1) * (area[3] - area[1] + 1);
+		std::cout << "  Rendered " << tiles << " tiles, " << static_cast<uint64_t>(tiles / std::max(seconds, 0.001)) << " tiles/s" << std::endl;
+		return true;
+	} else if (name == "statistics") {
+		MapStatisticsCollector collector(map);
+		collector.collect(false);
+		if (value.empty()) {
+			std::cout << collector.getText();
+			return true;
+		}
+		std::ofstream out(nstr(value), std::ios::trunc);
+		out << collector.getJSON();
+		if (!out) {
+			std::cout << "Could not write " << value << std::endl;
+			return false;
+		}
+		return true;
+	} else if (name == "paste-benchmark") {
+		long side = 512;
+		if (!value.empty() && (!value.ToLong(&side) || side < 16 || side > 4096)) {
+			std::cout << "Usage: paste-benchmark[=<side>], side between 16 and 4096" << std::endl;
+			return false;
+		}
+		return benchmarkPaste(static_cast<int>(side));
+	} else if (name == "move-benchmark") {
+		long side = 256;
+		if (!value.empty() && (!value.ToLong(&side) || side < 32 || side > 4096)) {
+			std::cout << "Usage: move-benchmark[=<side>], side between 32 and 4096" << std::endl;
+			return false;
+		}
+		return benchmarkMove(static_cast<int>(side));
+	} else if (name == "brush-benchmark") {
+		long size = 8;
+		if (!value.empty() && (!value.ToLong(&size) || size < 1 || size > 64)) {
+			std::cout << "Usage: brush-benchmark[=<size>], size between 1 and 64" << std::endl;
+			return false;
+		}
+		return benchmarkBrush(static_cast<int>(size));
+	} else if (name == "item-search-benchmark") {
+		long queries = 500;
+		if (!value.empty() && (!value.ToLong(&queries) || queries < 1 || queries > 100000)) {
+			std::cout << "Usage: item-search-benchmark[=<queries>], queries between 1 and 100000" << std::endl;
+			return false;
+		}
+		return benchmarkItemSearch(static_cast<int>(queries));
+	} else if (name == "data-cache-benchmark") {
+		long runs = 5;
+		if (!value.empty() && (!value.ToLong(&runs) || runs < 1 || runs > 100)) {
+			std::cout << "Usage: data-cache-benchmark[=<runs>], runs between 1 and 100" << std::endl;
+			return false;
+		}
+		return benchmarkDataCache(static_cast<int>(runs));
+	} else if (name == "data-cache-validate") {
+		DataCache cache;
+		if (!cache.load(DataCache::getFileName())) {
+			std::cout << "  There is no current data cache for this client version" << std::endl;
+			return false;
+		}
+
+		wxArrayString differences;
+		const bool same = cache.validate(differences);
+		for (const wxString& difference : differences) {
+			std::cout << "  " << difference << std::endl;
+		}
+		std::cout << "  " << differences.size() << " differences between the data cache and the data files" << std::endl;
+		return same;
+	} else if (name == "save") {
+		FileName file(value.empty() ? mapPath : value);
+		ScopedLoadingBar loadingBar("Saving map...");
+		IOMapOTBM saver(map.getVersion());
+		if (!saver.saveMap(map, file)) {
+			std::cout << "Could not save " << file.GetFullPath() << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	std::cout << "Unknown step " << name << std::endl;
+	return false;
+}
+
+bool MapBatch::getBenchmarkGrounds(std::vector<uint16_t>& grounds) {
+	// Two ground brushes in a checkerboard, so borderizing has work to do
+	GroundBrush* firstBrush = nullptr;
+	for (MapIterator it = editor->map.begin(); it != editor->map.end() && grounds.size() < 2; ++it) {
+		Tile* tile = (*it)->get();
+		GroundBrush* brush = tile && tile->ground ? tile->ground->getGroundBrush() : nullptr;
+		if (brush && brush != firstBrush) {
+			firstBrush = firstBrush ? firstBrush : brush;
+			grounds.push_back(tile->ground->getID());
+		}
+	}
+	if (grounds.empty()) {
+		std::cout << "  The map has no ground brushes to paste" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void MapBatch::fillBenchmarkBuffer(CopyBuffer& copybuffer, int side, const std::vector<uint16_t>& grounds) {
+	BaseMap* buffer = newd BaseMap();
+	for (int y = 0; y < side; ++y) {
+		for (int x = 0; x < side; ++x) {
+			TileLocation* location = buffer->createTileL(x, y, GROUND_LAYER);
+			Tile* tile = buffer->allocator(location);
+			tile->addItem(Item::Create(grounds[((x >> 3) + (y >> 3)) % grounds.size()]));
+			buffer->setTile(tile);
+		}
+	}
+	copybuffer.setTiles(buffer, Position(0, 0, GROUND_LAYER));
+}
+
+bool MapBatch::benchmarkPaste(int maxSide) {
+	std::vector<uint16_t> grounds;
+	if (!getBenchmarkGrounds(grounds)) {
+		return false;
+	}
+
+	std::cout << "  Borderize on paste is " << (g_settings.getInteger(Config::USE_AUTOMAGIC) && g_settings.getInteger(Config::BORDERIZE_PASTE) ? "on" : "off") << std::endl;
+
+	const Position target(64, 64, GROUND_LAYER);
+	for (int side = 64; side <= maxSide; side *= 2) {
+		CopyBuffer copybuffer;
+		fillBenchmarkBuffer(copybuffer, side, grounds);
+
+		const uint64_t peakBefore = getPeakMemory();
+		auto started = std::chrono::steady_clock::now();
+		copybuffer.paste(*editor, target);
+		double pasteSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+		started = std::chrono::steady_clock::now();
+		editor->actionQueue->undo();
+		double undoSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+		const uint64_t tiles = uint64_t(side) * side;
+		std::cout << "  " << side << "x" << side << " (" << tiles << " tiles): paste " << static_cast<int>(pasteSeconds * 1000)
+				  << " ms, " << static_cast<uint64_t>(tiles / std::max(pasteSeconds, 0.001)) << " tiles/s, undo " << static_cast<int>(undoSeconds * 1000)
+				  << " ms, peak memory " << (getPeakMemory() >> 20) << " MB (+" << ((getPeakMemory() - peakBefore) >> 20) << " MB)" << std::endl;
+	}
+	return true;
+}
+
+uint64_t MapBatch::getPeakMemory() {
+#ifdef __WINDOWS__
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+	#ifdef __APPLE__
+	return usage.ru_maxrss;
+	#else
+	// Linux reports kilobytes
+	return uint64_t(usage.ru_maxrss) * 1024;
+	#endif
+#endif
+}
+
+bool MapBatch::benchmarkMove(int maxSide) {
+	std::vector<uint16_t> grounds;
+	if (!getBenchmarkGrounds(grounds)) {
+		return false;
+	}
+
+	std::cout << "  Borderize on drag is " << (g_settings.getInteger(Config::USE_AUTOMAGIC) && g_settings.getInteger(Config::BORDERIZE_DRAG) ? "on" : "off") << std::endl;
+
+	Map& map = editor->map;
+	const Position target(64, 64, GROUND_LAYER);
+	// One tile to the east, as dragging does
+	const Position offset(-1, 0, 0);
+	for (int side = 32; side <= maxSide; side *= 2) {
+		CopyBuffer copybuffer;
+		fillBenchmarkBuffer(copybuffer, side, grounds);
+		copybuffer.paste(*editor, target);
+
+		editor->selection.start();
+		for (int y = 0; y < side; ++y) {
+			for (int x = 0; x < side; ++x) {
+				Tile* tile = map.getTile(target.x + x, target.y + y, target.z);
+				if (tile) {
+					editor->selection.add(tile);
+				}
+			}
+		}
+		editor->selection.finish();
+
+		double moveSeconds[2];
+		double undoSeconds[2];
+		for (int copying = 0; copying < 2; ++copying) {
+			auto started = std::chrono::steady_clock::now();
+			if (copying) {
+				editor->moveSelectionByCopy(offset);
+			} else {
+				editor->moveSelection(offset);
+			}
+			moveSeconds[copying] = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+			started = std::chrono::steady_clock::now();
+			editor->actionQueue->undo();
+			undoSeconds[copying] = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		}
+
+		// Drop the selection and the pasted square again
+		editor->actionQueue->undo();
+		editor->actionQueue->undo();
+
+		const uint64_t tiles = uint64_t(side) * side;
+		std::cout << "  " << side << "x" << side << " (" << tiles << " tiles): in place " << static_cast<int>(moveSeconds[0] * 1000)
+				  << " ms, undo " << static_cast<int>(undoSeconds[0] * 1000) << " ms; copying " << static_cast<int>(moveSeconds[1] * 1000)
+				  << " ms, undo " << static_cast<int>(undoSeconds[1] * 1000) << " ms (" << wxString::Format("%.1f", moveSeconds[1] / std::max(moveSeconds[0], 0.0001))
+				  << "x)" << std::endl;
+	}
+	return true;
+}
+
+bool MapBatch::benchmarkBrush(int maxSize) {
+	std::vector<uint16_t> grounds;
+	if (!getBenchmarkGrounds(grounds)) {
+		return false;
+	}
+
+	// Drawing the second ground over a map of the first leaves borders on
+	// both sides of the stroke
+	Brush* brush = g_items.getItemType(grounds.back()).brush;
+	if (!brush || !brush->isGround()) {
+		std::cout << "  The map has no ground brushes to draw with" << std::endl;
+		return false;
+	}
+
+	std::cout << "  Drawing with " << brush->getName() << ", automagic is " << (g_settings.getInteger(Config::USE_AUTOMAGIC) ? "on" : "off") << std::endl;
+
+	// One editor.draw call per tile the mouse moves, as dragging does
+	const int steps = 256;
+	const Position start(64, 64, GROUND_LAYER);
+	for (int size = 1; size <= maxSize; size *= 2) {
+		const size_t batchesBefore = editor->actionQueue->getUndoCount();
+		editor->actionQueue->resetTimer();
+
+		PositionVector tilestodraw;
+		PositionVector tilestoborder;
+		auto started = std::chrono::steady_clock::now();
+		for (int step = 0; step < steps; ++step) {
+			const int center_x = start.x + size + step;
+			const int center_y = start.y + size;
+
+			// The square brush shape of MapCanvas::getTilesToDraw
+			tilestodraw.clear();
+			tilestoborder.clear();
+			for (int y = -size - 1; y <= size + 1; ++y) {
+				for (int x = -size - 1; x <= size + 1; ++x) {
+					if (x >= -size && x <= size && y >= -size && y <= size) {
+						tilestodraw.push_back(Position(center_x + x, center_y + y, start.z));
+					}
+					tilestoborder.push_back(Position(center_x + x, center_y + y, start.z));
+				}
+			}
+			editor->draw(brush, tilestodraw, tilestoborder, false);
+		}
+		double strokeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+		started = std::chrono::steady_clock::now();
+		while (editor->actionQueue->getUndoCount() > batchesBefore) {
+			editor->actionQueue->undo();
+		}
+		double undoSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+		const uint64_t tiles = uint64_t(steps) * tilestodraw.size();
+		std::cout << "  size " << size << " (" << tilestodraw.size() << " tiles a step): " << steps << " steps in " << static_cast<int>(strokeSeconds * 1000)
+				  << " ms, " << wxString::Format("%.2f", strokeSeconds * 1000 / steps) << " ms a step, " << static_cast<uint64_t>(tiles / std::max(strokeSeconds, 0.001))
+				  << " tiles/s, undo " << static_cast<int>(undoSeconds * 1000) << " ms" << std::endl;
+	}
+	return true;
+}
+
+bool MapBatch::benchmarkItemSearch(int count) {
+	auto started = std::chrono::steady_clock::now();
+	ItemSearchIndex index;
+	index.build(g_items);
+	const double building = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	std::vector<uint16_t> ids;
+	for (int id = ItemSearchIndex::FIRST_LISTED_ID; id <= g_items.getMaxID(); ++id) {
+		if (g_items.getItemType(id).raw_brush) {
+			ids.push_back(id);
+		}
+	}
+	if (ids.empty()) {
+		std::cout << "  There are no item types to search" << std::endl;
+		return false;
+	}
+
+	// Queries are pieces of real brush names, two to six characters long
+	std::minstd_rand random(1);
+	std::vector<std::string> queries;
+	for (int i = 0; i < count; ++i) {
+		const std::string name = as_lower_str(g_items.getItemType(ids[random() % ids.size()]).raw_brush->getName());
+		const size_t length = std::min<size_t>(2 + random() % 5, name.size());
+		queries.push_back(name.substr(random() % (name.size() - length + 1), length));
+	}
+
+	// The scan is what the Find Item dialog did before it had the index
+	double indexed = 0, indexedWorst = 0;
+	double scanned = 0, scannedWorst = 0;
+	size_t mismatches = 0;
+	std::vector<uint16_t> found, expected;
+	for (const std::string& query : queries) {
+		found.clear();
+		started = std::chrono::steady_clock::now();
+		index.findName(query, false, found);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		indexed += seconds;
+		indexedWorst = std::max(indexedWorst, seconds);
+
+		expected.clear();
+		started = std::chrono::steady_clock::now();
+		for (uint16_t id : ids) {
+			if (as_lower_str(g_items.getItemType(id).raw_brush->getName()).find(query) != std::string::npos) {
+				expected.push_back(id);
+			}
+		}
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		scanned += seconds;
+		scannedWorst = std::max(scannedWorst, seconds);
+
+		if (found != expected) {
+			++mismatches;
+		}
+	}
+
+	std::cout << "  Index of " << ids.size() << " item types built in " << static_cast<int>(building * 1000) << " ms, "
+			  << (index.memsize() >> 10) << " KB" << std::endl;
+	std::cout << "  " << queries.size() << " name searches, indexed " << wxString::Format("%.3f", indexed * 1000 / queries.size())
+			  << " ms average, " << wxString::Format("%.3f", indexedWorst * 1000) << " ms worst, scanning "
+			  << wxString::Format("%.3f", scanned * 1000 / queries.size()) << " ms average, "
+			  << wxString::Format("%.3f", scannedWorst * 1000) << " ms worst (" << wxString::Format("%.1f", scanned / std::max(indexed, 1e-9))
+			  << "x)" << std::endl;
+	if (mismatches != 0) {
+		std::cout << "  " << mismatches << " searches found different items than the scan" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool MapBatch::benchmarkDataCache(int runs) {
+	const ClientVersionID version = g_gui.GetCurrentVersionID();
+	const bool enabled = g_settings.getBoolean(Config::USE_DATA_CACHE);
+
+	auto reload = [version](bool useCache, double& seconds) {
+		g_settings.setInteger(Config::USE_DATA_CACHE, useCache ? 1 : 0);
+
+		wxString error;
+		wxArrayString warnings;
+		auto started = std::chrono::steady_clock::now();
+		const bool loaded = g_gui.LoadVersion(version, error, warnings, true);
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		if (!loaded) {
+			std::cout << "Could not load client version: " << error << std::endl;
+		}
+		return loaded;
+	};
+
+	// Cold loads parse every file, the first load with the cache enabled
+	// writes it and every one after that only reads it
+	double cold = std::numeric_limits<double>::max();
+	double warm = std::numeric_limits<double>::max();
+	double writing = 0;
+	double seconds;
+	bool success = true;
+	for (int run = 0; success && run < runs; ++run) {
+		success = reload(false, seconds);
+		cold = std::min(cold, seconds);
+	}
+	if (success) {
+		wxRemoveFile(DataCache::getFileName().GetFullPath());
+		success = reload(true, writing);
+	}
+	for (int run = 0; success && run < runs; ++run) {
+		success = reload(true, seconds);
+		warm = std::min(warm, seconds);
+	}
+	g_settings.setInteger(Config::USE_DATA_CACHE, enabled ? 1 : 0);
+	if (!success) {
+		return false;
+	}
+
+	DataCache cache;
+	if (!cache.load(DataCache::getFileName())) {
+		std::cout << "  The data cache was not written" << std::endl;
+		return false;
+	}
+
+	std::cout << "  Cold " << static_cast<int>(cold * 1000) << " ms, writing the cache " << static_cast<int>(writing * 1000)
+			  << " ms, warm " << static_cast<int>(warm * 1000) << " ms (" << wxString::Format("%.1f", cold / std::max(warm, 0.001))
+			  << "x), cache " << (cache.getSize() >> 10) << " KB" << std::endl;
+	return true;
+}
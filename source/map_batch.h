@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_BATCH_H_
+#define RME_MAP_BATCH_H_
+
+class Editor;
+class CopyBuffer;
+
+// Runs whole-map operations from the command line without creating any
+// windows or GL context, for build servers:
+//
+//   rme -batch <map> <step> [<step> ...]
+//
+//   convert=<client version>   load another client version and switch the map
+//                              to it, items are only replaced between 7.6 and
+//                              7.4, 8.0 and 8.1 and the bad 8.54 OTB and 8.54,
+//                              other switches keep the item ids and warn
+//   clean-invalid              remove items that are not in items.otb
+//   clean-duplicates           remove duplicated items on every tile
+//   validate-grounds           fix ground stacking and fill enclosed holes
+//   borderize                  borderize the whole map
+//   minimap=<file>[:<floor>]   export the minimap, .png or .bmp
+//   region=<file>:<x1>,<y1>,<x2>,<y2>[,<floor>]
+//                              render an area at full resolution to a .png
+//   statistics[=<file>]        print the map statistics, or write them as JSON
+//   paste-benchmark[=<side>]   paste synthetic squares up to side x side tiles
+//                              and undo them, default side is 512
+//   move-benchmark[=<side>]    move synthetic squares up to side x side tiles
+//                              by one tile, in place and by copying tiles, and
+//                              undo the moves, default side is 256
+//   brush-benchmark[=<size>]   drag a ground brush across the map with brush
+//                              sizes up to size and undo the strokes, default 8
+//   item-search-benchmark[=<queries>]
+//                              search item names with the Find Item index and
+//                              by scanning every item type, default 500
+//   data-cache-benchmark[=<runs>]
+//                              reload the client data without and with the data
+//                              cache, best of runs loads each, default 5
+//   data-cache-validate        compare the data cache with a fresh parse
+//   save[=<file>]              save as .otbm or .otgz, default is the loaded file
+//   @<file>                    read more steps from a file, one per line
+//
+// Progress, per step wall time and peak memory are printed to stdout.
+class MapBatch {
+public:
+	enum ExitCode {
+		EXIT_OK = 0,
+		EXIT_USAGE = 1,
+		EXIT_LOAD_FAILED = 2,
+		EXIT_STEP_FAILED = 3,
+	};
+
+	MapBatch();
+	~MapBatch();
+
+	// Arguments are the ones following "-batch"
+	int run(const wxArrayString& arguments);
+
+	// Entry point for platforms where the GUI toolkit needs a display
+	static int main(int argc, char** argv);
+
+	static bool isBatchArgument(const wxString& argument) {
+		return argument == "-batch";
+	}
+
+private:
+	bool expandSteps(const wxArrayString& arguments, wxArrayString& steps);
+	bool loadMap(const wxString& path);
+	bool runStep(const wxString& step);
+	bool getBenchmarkGrounds(std::vector<uint16_t>& grounds);
+	static void fillBenchmarkBuffer(CopyBuffer& copybuffer, int side, const std::vector<uint16_t>& grounds);
+	bool benchmarkPaste(int maxSide);
+	bool benchmarkMove(int maxSide);
+	bool benchmarkBrush(int maxSize);
+	bool benchmarkItemSearch(int count);
+	bool benchmarkDataCache(int runs);
+
+	// Peak resident memory of the process, in bytes
+	static uint64_t getPeakMemory();
+
+	std::unique_ptr<Editor> editor;
+	wxString mapPath;
+};
+
+#endif
@@ -43,6 +43,8 @@
 #include "table_brush.h"
 #include "waypoint_brush.h"
 #include "light_drawer.h"
+#include "floor_overlay_drawer.h"
+#include "render_profiler.h"
 
 using Color = std::tuple<int, int, int>;
 
@@ -155,8 +157,10 @@ bool DrawingOptions::isDrawLight() const noexcept {
 }
 
 MapDrawer::MapDrawer(MapCanvas* canvas) :
-	canvas(canvas), editor(canvas->editor) {
+	canvas(canvas), editor(canvas->editor),
+	spawn_start_x(0), spawn_start_y(0), spawn_z(-1), spawn_width(0), spawn_height(0) {
 	light_drawer = std::make_shared<LightDrawer>();
+	floor_overlay = std::make_shared<FloorOverlayDrawer>();
 }
 
 MapDrawer::~MapDrawer() {
@@ -171,6 +175,7 @@ void MapDrawer::SetupVars() {
 	dragging_draw = canvas->dragging_draw;
 
 	zoom = (float)canvas->GetZoom();
+	lod_manager.updateRenderSettings(zoom);
 	tile_size = int(TileSize / zoom); // after zoom
 	floor = canvas->GetFloor();
 
@@ -236,17 +241,30 @@ void MapDrawer::Release() {
 }
 
 void MapDrawer::Draw() {
-	DrawBackground();
-	DrawMap();
+	{
+		RenderProfileScope scope(RENDER_STAGE_BACKGROUND);
+		DrawBackground();
+	}
+	{
+		RenderProfileScope scope(RENDER_STAGE_MAP);
+		DrawMap();
+	}
 	if (options.isDrawLight()) {
+		RenderProfileScope scope(RENDER_STAGE_LIGHT);
 		DrawLight();
 	}
 	DrawDraggingShadow();
-	DrawHigherFloors();
+	{
+		RenderProfileScope scope(RENDER_STAGE_HIGHER_FLOORS);
+		DrawHigherFloors();
+	}
 	if (options.dragging) {
 		DrawSelectionBox();
 	}
-	DrawLiveCursors();
+	{
+		RenderProfileScope scope(RENDER_STAGE_LIVE_CURSORS);
+		DrawLiveCursors();
+	}
 	DrawBrush();
 	if (options.show_grid) {
 		DrawGrid();
@@ -255,6 +273,7 @@ void MapDrawer::Draw() {
 		DrawIngameBox();
 	}
 	if (options.show_tooltips) {
+		RenderProfileScope scope(RENDER_STAGE_TOOLTIPS);
 		DrawTooltips();
 	}
 }
@@ -291,6 +310,10 @@ void MapDrawer::DrawMap() {
 	int box_end_map_y = center_y + ClientMapHeight + offset_y;
 
 	bool live_client = editor.IsLiveClient();
+	if (live_client) {
+		// Queue the viewport and the ring ahead of it before the per-node fallback below
+		editor.PrefetchNodes(start_x, start_y, end_x, end_y, floor, zoom);
+	}
 
 	Brush* brush = g_gui.GetCurrentBrush();
 
@@ -306,6 +329,9 @@ void MapDrawer::DrawMap() {
 
 	bool only_colors = options.show_as_minimap || options.show_only_colors;
 
+	// Spawns are counted again the first time a floor asks for them
+	spawn_z = -1;
+
 	// Enable texture mode
 	if (!only_colors) {
 		glEnable(GL_TEXTURE_2D);
@@ -332,65 +358,63 @@ void MapDrawer::DrawMap() {
 		}
 
 		if (map_z >= end_z) {
-			int nd_start_x = start_x & ~3;
-			int nd_start_y = start_y & ~3;
-			int nd_end_x = (end_x & ~3) + 4;
-			int nd_end_y = (end_y & ~3) + 4;
-
-			zoneTiles.clear();
-			for (int nd_map_x = nd_start_x; nd_map_x <= nd_end_x; nd_map_x += 4) {
-				for (int nd_map_y = nd_start_y; nd_map_y <= nd_end_y; nd_map_y += 4) {
-					QTreeNode* nd = editor.map.getLeaf(nd_map_x, nd_map_y);
-					if (!nd) {
-						if (live_client) {
-							nd = editor.map.createLeaf(nd_map_x, nd_map_y);
-							nd->setVisible(false, false);
-						} else {
-							continue;
+			// Far out only grounds are drawn, they come from the LOD pyramid
+			if (!DrawGroundPyramid(map_z, live_client)) {
+				int nd_start_x = start_x & ~3;
+				int nd_start_y = start_y & ~3;
+				int nd_end_x = (end_x & ~3) + 4;
+				int nd_end_y = (end_y & ~3) + 4;
+
+				for (int nd_map_x = nd_start_x; nd_map_x <= nd_end_x; nd_map_x += 4) {
+					for (int nd_map_y = nd_start_y; nd_map_y <= nd_end_y; nd_map_y += 4) {
+						QTreeNode* nd = editor.map.getLeaf(nd_map_x, nd_map_y);
+						if (!nd) {
+							if (live_client) {
+								nd = editor.map.createLeaf(nd_map_x, nd_map_y);
+								nd->setVisible(false, false);
+							} else {
+								continue;
+							}
 						}
-					}
 
-					if (!live_client || nd->isVisible(map_z > GROUND_LAYER)) {
-						for (int map_x = 0; map_x < 4; ++map_x) {
-							for (int map_y = 0; map_y < 4; ++map_y) {
-								TileLocation* location = nd->getTile(map_x, map_y, map_z);
-								DrawTile(location);
-								// draw light, but only if not zoomed too far
-								if (location && options.isDrawLight() && zoom <= 10.0) {
-									AddLight(location);
+						if (!live_client || nd->isVisible(map_z > GROUND_LAYER)) {
+							for (int map_x = 0; map_x < 4; ++map_x) {
+								for (int map_y = 0; map_y < 4; ++map_y) {
+									TileLocation* location = nd->getTile(map_x, map_y, map_z);
+									DrawTile(location);
+									// draw light, but only if not zoomed too far
+									if (location && options.isDrawLight() && zoom <= 10.0) {
+										AddLight(location);
+									}
 								}
 							}
+						} else {
+							if (!nd->isRequested(map_z > GROUND_LAYER)) {
+								// Request the node
+								editor.QueryNode(nd_map_x, nd_map_y, map_z > GROUND_LAYER);
+								nd->setRequested(map_z > GROUND_LAYER, true);
+							}
+							int cy = (nd_map_y)*TileSize - view_scroll_y - getFloorAdjustment(floor);
+							int cx = (nd_map_x)*TileSize - view_scroll_x - getFloorAdjustment(floor);
+
+							glColor4ub(255, 0, 255, 128);
+							glBegin(GL_QUADS);
+							glVertex2f(cx, cy + TileSize * 4);
+							glVertex2f(cx + TileSize * 4, cy + TileSize * 4);
+							glVertex2f(cx + TileSize * 4, cy);
+							glVertex2f(cx, cy);
+							glEnd();
 						}
-					} else {
-						if (!nd->isRequested(map_z > GROUND_LAYER)) {
-							// Request the node
-							editor.QueryNode(nd_map_x, nd_map_y, map_z > GROUND_LAYER);
-							nd->setRequested(map_z > GROUND_LAYER, true);
-						}
-						int cy = (nd_map_y)*TileSize - view_scroll_y - getFloorAdjustment(floor);
-						int cx = (nd_map_x)*TileSize - view_scroll_x - getFloorAdjustment(floor);
-
-						glColor4ub(255, 0, 255, 128);
-						glBegin(GL_QUADS);
-						glVertex2f(cx, cy + TileSize * 4);
-						glVertex2f(cx + TileSize * 4, cy + TileSize * 4);
-						glVertex2f(cx + TileSize * 4, cy);
-						glVertex2f(cx, cy);
-						glEnd();
 					}
 				}
 			}
-			for (auto& itZonePos : zoneTiles) {
-				ZoneFinder finder(itZonePos.second);
-				auto zones = finder.findZones();
 
-				for (const auto& itZone : zones) {
-					const FinderPosition center = finder.findClosestToCenter(itZone);
-
-					QTreeNode* nd = editor.getMap().getLeaf(center.x, center.y);
-					TileLocation* location = nd->getTile(center.x, center.y, center.z);
-
-					const Tile* tile = location->get();
+			if (options.show_tooltips && map_z == floor && zoom <= g_settings.getInteger(Config::TOOLTIP_MAX_ZOOM)) {
+				for (const ZoneLabel& label : editor.map.zoneLabels.getLabels(editor.map, start_x, start_y, end_x, end_y, map_z)) {
+					const Tile* tile = editor.map.getTile(label.position);
+					if (!tile) {
+						continue;
+					}
 
 					std::ostringstream tooltip;
 					tooltip << "zone id: ";
@@ -428,6 +452,8 @@ void MapDrawer::DrawMap() {
 
 			if (canvas->isPasting()) {
 				normalPos = editor.copybuffer.getPosition();
+				// Sectors of a shared copy are parsed once they come into view
+				editor.copybuffer.prepare(normalPos.x - to.x + start_x, normalPos.y - to.y + start_y, normalPos.x - to.x + end_x, normalPos.y - to.y + end_y, normalPos.z + map_z - to.z);
 			} else if (brush && brush->isDoodad()) {
 				normalPos = Position(0x8000, 0x8000, 0x8);
 			}
@@ -612,6 +638,45 @@ void MapDrawer::DrawGrid() {
 	}
 }
 
+bool MapDrawer::DrawGroundPyramid(int map_z, bool live_client) {
+	if (zoom < g_settings.getInteger(Config::GROUND_ONLY_ZOOM_THRESHOLD) || live_client || options.show_only_modified) {
+		return false;
+	}
+	// Plain colors and lights still need every tile
+	if ((options.show_only_colors && !options.show_as_minimap) || (options.isDrawLight() && zoom <= 10.0)) {
+		return false;
+	}
+
+	int offset;
+	if (map_z <= GROUND_LAYER) {
+		offset = (GROUND_LAYER - map_z) * TileSize;
+	} else {
+		offset = TileSize * (floor - map_z);
+	}
+
+	std::vector<LODManager::PyramidArea> pending;
+	if (options.show_as_minimap) {
+		glEnable(GL_TEXTURE_2D);
+	}
+	lod_manager.drawPyramid(editor.map, LODManager::getPyramidLevel(zoom), start_x, start_y, end_x, end_y, map_z, -view_scroll_x - offset, -view_scroll_y - offset, options.show_as_minimap, options.ingame, pending);
+	if (options.show_as_minimap) {
+		glDisable(GL_TEXTURE_2D);
+	}
+
+	// Images past the build budget are drawn the slow way until they exist
+	for (const LODManager::PyramidArea& area : pending) {
+		for (int map_x = std::max(area.start_x, start_x); map_x <= std::min(area.end_x, end_x); ++map_x) {
+			for (int map_y = std::max(area.start_y, start_y); map_y <= std::min(area.end_y, end_y); ++map_y) {
+				DrawTile(editor.map.getTileL(map_x, map_y, map_z));
+			}
+		}
+	}
+	if (!pending.empty()) {
+		canvas->Refresh();
+	}
+	return true;
+}
+
 void MapDrawer::DrawDraggingShadow() {
 	glEnable(GL_TEXTURE_2D);
 
@@ -679,6 +744,26 @@ void MapDrawer::DrawHigherFloors() {
 	// Draw "transparent higher floor"
 	if (floor != 8 && floor != 0 && options.transparent_floors) {
 		int map_z = floor - 1;
+
+		int floor_offset;
+		if (map_z <= GROUND_LAYER) {
+			floor_offset = (GROUND_LAYER - map_z) * TileSize;
+		} else {
+			floor_offset = TileSize * (floor - map_z);
+		}
+
+		// Composed sector textures, only what they can't hold is drawn per item
+		bool show_items = zoom <= g_settings.getInteger(Config::ITEM_DISPLAY_ZOOM_THRESHOLD) || !options.hide_items_when_zoomed;
+		auto draw_loose = [&](const FloorOverlayDrawer::LooseItem& entry) {
+			int draw_x = entry.tile->getX() * TileSize - view_scroll_x - floor_offset - entry.offset;
+			int draw_y = entry.tile->getY() * TileSize - view_scroll_y - floor_offset - entry.offset;
+			BlitItem(draw_x, draw_y, entry.tile, entry.item, false, entry.red, entry.green, entry.blue, 96);
+		};
+		if (floor_overlay->draw(editor.map, start_x, start_y, end_x, end_y, map_z, -view_scroll_x - floor_offset, -view_scroll_y - floor_offset, options, show_items, draw_loose)) {
+			glDisable(GL_TEXTURE_2D);
+			return;
+		}
+
 		for (int map_x = start_x; map_x <= end_x; map_x++) {
 			for (int map_y = start_y; map_y <= end_y; map_y++) {
 				Tile* tile = editor.map.getTile(map_x, map_y, map_z);
@@ -1493,6 +1578,8 @@ void MapDrawer::BlitSquare(int sx, int sy, int red, int green, int blue, int alp
 	}
 
 	glBindTexture(GL_TEXTURE_2D, texnum);
+	g_render_profiler.count(RENDER_COUNTER_TEXTURE_BINDS);
+	g_render_profiler.count(RENDER_COUNTER_SPRITES);
 	glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 	glBegin(GL_QUADS);
 	glTexCoord2f(0.f, 0.f);
@@ -1582,16 +1669,8 @@ void MapDrawer::WriteTooltip(Tile* tile, Item* item, std::ostringstream& stream,
 		stream << "\n";
 	}
 
-	if (!zoneIds.empty()) {
-		for (auto& zoneId : zoneIds) {
-			auto itZone = zoneTiles.find(zoneId);
-			if (itZone == zoneTiles.end()) {
-				zoneTiles.emplace(zoneId, std::vector<FinderPosition>({ FinderPosition(tile->getX(), tile->getY(), tile->getZ()) }));
-			} else {
-				itZone->second.push_back(FinderPosition(tile->getX(), tile->getY(), tile->getZ()));
-			}
-		}
-	} else {
+	// Zones get one label per area instead, see ZoneLabeler
+	if (zoneIds.empty()) {
 		stream << "id: " << id << "\n";
 	}
 
@@ -1628,6 +1707,7 @@ void MapDrawer::DrawTile(TileLocation* location) {
 	if (!location) {
 		return;
 	}
+	g_render_profiler.count(RENDER_COUNTER_TILES);
 	Tile* tile = location->get();
 
 	if (!tile) {
@@ -1701,13 +1781,16 @@ void MapDrawer::DrawTile(TileLocation* location) {
 			r = int(r * factor[idx]);
 		}
 
-		if (options.show_spawns && location->getSpawnCount() > 0) {
-			float f = 1.0f;
-			for (uint32_t i = 0; i < location->getSpawnCount(); ++i) {
-				f *= 0.7f;
+		if (options.show_spawns) {
+			size_t spawn_count = GetSpawnCount(location->getPosition());
+			if (spawn_count > 0) {
+				float f = 1.0f;
+				for (size_t i = 0; i < spawn_count; ++i) {
+					f *= 0.7f;
+				}
+				g = uint8_t(g * f);
+				b = uint8_t(b * f);
 			}
-			g = uint8_t(g * f);
-			b = uint8_t(b * f);
 		}
 
 		if (options.show_houses && tile->isHouseTile()) {
@@ -1861,6 +1944,44 @@ void MapDrawer::DrawTile(TileLocation* location) {
 	}
 }
 
+void MapDrawer::CountSpawns(int start_x, int start_y, int end_x, int end_y, int map_z) {
+	spawn_start_x = start_x;
+	spawn_start_y = start_y;
+	spawn_z = map_z;
+	spawn_width = end_x - start_x + 1;
+	spawn_height = end_y - start_y + 1;
+	spawn_counts.assign(spawn_width * spawn_height, 0);
+
+	std::vector<SpawnArea> areas;
+	editor.map.getSpawnAreas(start_x, start_y, end_x, end_y, map_z, areas);
+	for (const SpawnArea& area : areas) {
+		int area_start_x = std::max(area.center.x - area.radius, start_x) - start_x;
+		int area_start_y = std::max(area.center.y - area.radius, start_y) - start_y;
+		int area_end_x = std::min(area.center.x + area.radius, end_x) - start_x;
+		int area_end_y = std::min(area.center.y + area.radius, end_y) - start_y;
+		for (int y = area_start_y; y <= area_end_y; ++y) {
+			uint16_t* row = &spawn_counts[y * spawn_width];
+			for (int x = area_start_x; x <= area_end_x; ++x) {
+				++row[x];
+			}
+		}
+	}
+}
+
+size_t MapDrawer::GetSpawnCount(const Position& position) {
+	if (position.z != spawn_z) {
+		CountSpawns(start_x & ~3, start_y & ~3, (end_x & ~3) + 7, (end_y & ~3) + 7, position.z);
+	}
+
+	int x = position.x - spawn_start_x;
+	int y = position.y - spawn_start_y;
+	if (x < 0 || y < 0 || x >= spawn_width || y >= spawn_height) {
+		// Outside of the counted area, ask the spawn index directly
+		return editor.map.getSpawnCount(position);
+	}
+	return spawn_counts[y * spawn_width + x];
+}
+
 void MapDrawer::DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_t g, uint8_t b) {
 	x += (TileSize / 2);
 	y += (TileSize / 2);
@@ -2040,6 +2161,44 @@ void MapDrawer::DrawTooltips() {
 	}
 }
 
+void MapDrawer::DrawRenderProfiler() {
+	std::vector<std::string> lines = g_render_profiler.getSummary();
+
+	const GraphicManager& gfx = g_gui.gfx;
+	char line[128];
+	snprintf(line, sizeof(line), "Textures: %d resident, %.1f / %d MB", gfx.getResidentTextureCount(), gfx.getTextureMemory() / (1024.0 * 1024.0), g_settings.getInteger(Config::TEXTURE_MEMORY_BUDGET));
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Texture hits %llu, misses %llu, uploads %llu, evictions %llu", (unsigned long long)gfx.getTextureHits(), (unsigned long long)gfx.getTextureMisses(), (unsigned long long)gfx.getTextureUploads(), (unsigned long long)gfx.getTextureEvictions());
+	lines.push_back(line);
+
+	// Keep the text readable at any zoom, the projection is in zoomed pixels
+	const float line_height = 14.0f * zoom;
+	const float x = 8.0f * zoom;
+	const float y = 8.0f * zoom;
+
+	float width = 0.0f;
+	for (const std::string& line : lines) {
+		float line_width = 0.0f;
+		for (char c : line) {
+			line_width += glutBitmapWidth(GLUT_BITMAP_8_BY_13, c);
+		}
+		width = std::max(width, line_width);
+	}
+
+	glDisable(GL_TEXTURE_2D);
+	drawFilledRect(x, y, (width + 12.0f) * zoom, lines.size() * line_height + 8.0f * zoom, wxColor(0, 0, 0, 180));
+
+	glColor4ub(255, 255, 255, 255);
+	float line_y = y + line_height;
+	for (const std::string& line : lines) {
+		glRasterPos2f(x + 6.0f * zoom, line_y);
+		for (char c : line) {
+			glutBitmapCharacter(GLUT_BITMAP_8_BY_13, c);
+		}
+		line_y += line_height;
+	}
+}
+
 void MapDrawer::DrawLight() {
 	// draw in-game light
 	light_drawer->draw(start_x, start_y, end_x, end_y, view_scroll_x, view_scroll_y, options.experimental_fog);
@@ -2111,6 +2270,8 @@ void MapDrawer::TakeScreenshot(uint8_t* screenshot_buffer) {
 void MapDrawer::glBlitTexture(int sx, int sy, int texture_number, int red, int green, int blue, int alpha) {
 	if (texture_number != 0) {
 		glBindTexture(GL_TEXTURE_2D, texture_number);
+		g_render_profiler.count(RENDER_COUNTER_TEXTURE_BINDS);
+		g_render_profiler.count(RENDER_COUNTER_SPRITES);
 		glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 		glBegin(GL_QUADS);
 		glTexCoord2f(0.f, 0.f);
@@ -96,107 +96,14 @@ struct DrawingOptions {
 
 class MapCanvas;
 class LightDrawer;
-
-struct FinderPosition {
-	FinderPosition() { }
-	FinderPosition(int _x, int _y, int _z) :
-		x(_x), y(_y), z(_z) { }
-	int x, y, z;
-
-	bool operator==(const FinderPosition& other) const {
-		return x == other.x && y == other.y && z == other.z;
-	}
-
-	double distance(const FinderPosition& b) const {
-		return std::sqrt(std::pow(x - b.x, 2) + std::pow(y - b.y, 2));
-	}
-
-	struct Hash {
-		size_t operator()(const FinderPosition& p) const {
-			return p.x ^ p.y ^ p.z;
-		}
-	};
-};
-
-class ZoneFinder {
-private:
-	std::unordered_set<FinderPosition, FinderPosition::Hash> positions;
-	std::vector<std::vector<FinderPosition>> zones;
-	std::unordered_set<FinderPosition, FinderPosition::Hash> visited;
-
-	bool isValid(const FinderPosition& pos) {
-		return positions.find(pos) != positions.end() && visited.find(pos) == visited.end();
-	}
-
-	void dfs(const FinderPosition& pos, std::vector<FinderPosition>& zone) {
-		if (visited.find(pos) != visited.end()) {
-			return;
-		}
-
-		visited.insert(pos);
-		zone.push_back(pos);
-
-		std::vector<FinderPosition> neighbors = {
-			{ pos.x + 1, pos.y, pos.z },
-			{ pos.x - 1, pos.y, pos.z },
-			{ pos.x, pos.y + 1, pos.z },
-			{ pos.x, pos.y - 1, pos.z }
-		};
-
-		for (const auto& next : neighbors) {
-			if (isValid(next)) {
-				dfs(next, zone);
-			}
-		}
-	}
-
-public:
-	ZoneFinder(const std::vector<FinderPosition>& inputPositions) :
-		positions(inputPositions.begin(), inputPositions.end()) { }
-
-	std::vector<std::vector<FinderPosition>> findZones() {
-		for (const auto& pos : positions) {
-			if (visited.find(pos) == visited.end()) {
-				std::vector<FinderPosition> zone;
-				dfs(pos, zone);
-				zones.push_back(zone);
-			}
-		}
-
-		return zones;
-	}
-
-	FinderPosition findClosestToCenter(const std::vector<FinderPosition>& zone) {
-		FinderPosition centroid = { 0, 0, 0 };
-		for (const auto& pos : zone) {
-			centroid.x += pos.x;
-			centroid.y += pos.y;
-			centroid.z += pos.z;
-		}
-
-		centroid.x /= zone.size();
-		centroid.y /= zone.size();
-		centroid.z /= zone.size();
-
-		double minDistance = std::numeric_limits<double>::max();
-		FinderPosition closestPosition;
-		for (const auto& pos : zone) {
-			const double dist = pos.distance(centroid);
-			if (dist < minDistance) {
-				minDistance = dist;
-				closestPosition = pos;
-			}
-		}
-
-		return closestPosition;
-	}
-};
+class FloorOverlayDrawer;
 
 class MapDrawer {
 	MapCanvas* canvas;
 	Editor& editor;
 	DrawingOptions options;
 	std::shared_ptr<LightDrawer> light_drawer;
+	std::shared_ptr<FloorOverlayDrawer> floor_overlay;
 	LODManager lod_manager;
 
 	float zoom;
@@ -211,8 +118,12 @@ class MapDrawer {
 	int tile_size;
 	int floor;
 
+	// Spawns covering each tile of the floor being drawn, counted once per floor
+	// and frame
+	std::vector<uint16_t> spawn_counts;
+	int spawn_start_x, spawn_start_y, spawn_z, spawn_width, spawn_height;
+
 protected:
-	std::unordered_map<uint16_t, std::vector<FinderPosition>> zoneTiles;
 	std::vector<MapTooltip*> tooltips;
 	std::ostringstream tooltip;
 
@@ -230,6 +141,8 @@ public:
 	void Draw();
 	void DrawBackground();
 	void DrawMap();
+	// Returns false when the floor has to be drawn tile by tile
+	bool DrawGroundPyramid(int map_z, bool live_client);
 	void DrawDraggingShadow();
 	void DrawHigherFloors();
 	void DrawSelectionBox();
@@ -239,7 +152,8 @@ public:
 	void DrawGrid();
 	void DrawTooltips();
 	void DrawLight();
-
+	// Frame time overlay of the render profiler, in the top left corner
+	void DrawRenderProfiler();
 
 
 	void TakeScreenshot(uint8_t* screenshot_buffer);
@@ -258,6 +172,8 @@ protected:
 	void BlitSquare(int sx, int sy, int red, int green, int blue, int alpha, int size = 0);
 	void DrawRawBrush(int screenx, int screeny, ItemType* itemType, uint8_t r, uint8_t g, uint8_t b, uint8_t alpha);
 	void DrawTile(TileLocation* tile);
+	void CountSpawns(int start_x, int start_y, int end_x, int end_y, int map_z);
+	size_t GetSpawnCount(const Position& position);
 	void DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_t g, uint8_t b);
 	void DrawHookIndicator(int x, int y, const ItemType& type);
 	void WriteTooltip(Tile* tile, Item* item, std::ostringstream& stream, bool isHouseTile);
@@ -27,7 +27,6 @@
 TileLocation::TileLocation() :
 	tile(nullptr),
 	position(0, 0, 0),
-	spawn_count(0),
 	waypoint_count(0),
 	town_count(0),
 	house_exits(nullptr) {
@@ -43,7 +42,7 @@ int TileLocation::size() const {
 	if (tile) {
 		return tile->size();
 	}
-	return spawn_count + waypoint_count + (house_exits ? 1 : 0);
+	return waypoint_count + (house_exits ? 1 : 0);
 }
 
 bool TileLocation::empty() const {
@@ -52,7 +51,8 @@ bool TileLocation::empty() const {
 
 //**************** Floor **********************
 
-Floor::Floor(int sx, int sy, int z) {
+Floor::Floor(int sx, int sy, int z) :
+	revision(0) {
 	sx = sx & ~3;
 	sy = sy & ~3;
 
@@ -158,26 +158,6 @@ bool QTreeNode::isRequested(bool underground) {
 	}
 }
 
-void QTreeNode::clearVisible(uint32_t u) {
-	if (isLeaf) {
-		visible &= u;
-	} else {
-		for (int i = 0; i < MAP_LAYERS; ++i) {
-			if (child[i]) {
-				child[i]->clearVisible(u);
-			}
-		}
-	}
-}
-
-bool QTreeNode::isVisible(uint32_t client, bool underground) {
-	if (underground) {
-		return testFlags(visible >> MAP_LAYERS, static_cast<uint64_t>(1) << client);
-	} else {
-		return testFlags(visible, static_cast<uint64_t>(1) << client);
-	}
-}
-
 void QTreeNode::setVisible(bool underground, bool value) {
 	if (underground) {
 		if (value) {
@@ -189,7 +169,7 @@ void QTreeNode::setVisible(bool underground, bool value) {
 		if (value) {
 			visible |= 1;
 		} else {
-			visible &= 1;
+			visible &= ~1;
 		}
 	}
 }
@@ -202,14 +182,6 @@ void QTreeNode::setRequested(bool underground, bool r) {
 	}
 }
 
-void QTreeNode::setVisible(uint32_t client, bool underground, bool value) {
-	if (value) {
-		visible |= (1 << client << (underground ? MAP_LAYERS : 0));
-	} else {
-		visible &= ~(1 << client << (underground ? MAP_LAYERS : 0));
-	}
-}
-
 TileLocation* QTreeNode::getTile(int x, int y, int z) {
 	ASSERT(isLeaf);
 	Floor* f = array[z];
@@ -235,6 +207,13 @@ Tile* QTreeNode::setTile(int x, int y, int z, Tile* newtile) {
 	TileLocation* tmp = &f->locs[offset_x * 4 + offset_y];
 	Tile* oldtile = tmp->tile;
 	tmp->tile = newtile;
+	f->revision = ++map.revision;
+
+	const bool oldZones = oldtile && !oldtile->getZoneIds().empty();
+	const bool newZones = newtile && !newtile->getZoneIds().empty();
+	if ((oldZones || newZones) && (!oldZones || !newZones || oldtile->getZoneIds() != newtile->getZoneIds())) {
+		map.zonesChanged(x, y, z);
+	}
 
 	if (newtile && !oldtile) {
 		++map.tilecount;
@@ -255,4 +234,5 @@ void QTreeNode::clearTile(int x, int y, int z) {
 	TileLocation* tmp = &f->locs[offset_x * 4 + offset_y];
 	delete tmp->tile;
 	tmp->tile = map.allocator(tmp);
+	f->revision = ++map.revision;
 }
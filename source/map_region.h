@@ -36,7 +36,6 @@ public:
 protected:
 	Tile* tile;
 	Position position;
-	size_t spawn_count;
 	size_t waypoint_count;
 	size_t town_count;
 	HouseExitList* house_exits; // Any house exits pointing here
@@ -68,15 +67,6 @@ public:
 		return position.z;
 	}
 
-	size_t getSpawnCount() const {
-		return spawn_count;
-	}
-	void increaseSpawnCount() {
-		spawn_count++;
-	}
-	void decreaseSpawnCount() {
-		spawn_count--;
-	}
 	size_t getWaypointCount() const {
 		return waypoint_count;
 	}
@@ -114,6 +104,8 @@ class Floor {
 public:
 	Floor(int x, int y, int z);
 	TileLocation locs[MAP_LAYERS];
+	// Map revision of the last tile change on this floor
+	uint64_t revision;
 };
 
 // This is not a QuadTree, but a HexTree (16 child nodes to every node), so the name is abit misleading
@@ -143,18 +135,15 @@ public:
 		return array;
 	}
 
-	void setVisible(bool overground, bool underground);
-	void setVisible(uint32_t client, bool underground, bool value);
-	bool isVisible(uint32_t client, bool underground);
-	void clearVisible(uint32_t client);
-
+	// Live client state, which clients the server has sent a node to is kept in LiveInterestMap
+	void setVisible(bool underground, bool value);
 	void setRequested(bool underground, bool r);
 	bool isVisible(bool underground);
 	bool isRequested(bool underground);
 
 protected:
 	BaseMap& map;
-	uint32_t visible;
+	uint8_t visible;
 
 	bool isLeaf;
 	union {
@@ -169,6 +158,7 @@ protected:
 
 	friend class BaseMap;
 	friend class MapIterator;
+	friend class MinimapExporter;
 };
 
 #endif
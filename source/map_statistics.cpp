@@ -0,0 +1,435 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_statistics.h"
+#include "map.h"
+#include "editor.h"
+#include "complexitem.h"
+#include "gui.h"
+#include "json.h"
+
+MapStatistics::MapStatistics() :
+	tile_count(0),
+	detailed_tile_count(0),
+	blocking_tile_count(0),
+	walkable_tile_count(0),
+	spawn_count(0),
+	creature_count(0),
+	item_count(0),
+	loose_item_count(0),
+	depot_count(0),
+	action_item_count(0),
+	unique_item_count(0),
+	container_count(0) {
+	////
+}
+
+void MapStatistics::addTile(const Tile* tile) {
+	if (tile->empty()) {
+		return;
+	}
+
+	tile_count += 1;
+
+	bool is_detailed = false;
+	auto addItem = [&](Item* item) {
+		item_count += 1;
+		const ItemType& type = g_items[item->getID()];
+		if (type.isGroundTile() || type.isBorder) {
+			return;
+		}
+
+		is_detailed = true;
+		if (type.moveable) {
+			loose_item_count += 1;
+		}
+		if (type.isDepot()) {
+			depot_count += 1;
+		} else if (type.isContainer()) {
+			// Item::Create makes every container type a Container
+			if (!static_cast<Container*>(item)->getVector().empty()) {
+				container_count += 1;
+			}
+		}
+		if (item->getActionID() > 0) {
+			action_item_count += 1;
+		}
+		if (item->getUniqueID() > 0) {
+			unique_item_count += 1;
+		}
+	};
+
+	if (tile->ground) {
+		addItem(tile->ground);
+	}
+	for (Item* item : tile->items) {
+		addItem(item);
+	}
+
+	if (tile->spawn) {
+		spawn_count += 1;
+	}
+	if (tile->creature) {
+		creature_count += 1;
+	}
+
+	if (tile->isBlocking()) {
+		blocking_tile_count += 1;
+	} else {
+		walkable_tile_count += 1;
+	}
+
+	if (is_detailed) {
+		detailed_tile_count += 1;
+	}
+}
+
+void MapStatistics::merge(const MapStatistics& other) {
+	tile_count += other.tile_count;
+	detailed_tile_count += other.detailed_tile_count;
+	blocking_tile_count += other.blocking_tile_count;
+	walkable_tile_count += other.walkable_tile_count;
+	spawn_count += other.spawn_count;
+	creature_count += other.creature_count;
+	item_count += other.item_count;
+	loose_item_count += other.loose_item_count;
+	depot_count += other.depot_count;
+	action_item_count += other.action_item_count;
+	unique_item_count += other.unique_item_count;
+	container_count += other.container_count;
+}
+
+MapStatisticsCollector::MapStatisticsCollector(Map& map) :
+	map(map),
+	workers(0),
+	total_house_sqm(0),
+	largest_house(nullptr),
+	largest_house_size(0),
+	largest_town(nullptr),
+	largest_town_size(0) {
+	////
+}
+
+void MapStatisticsCollector::addTiming(const std::string& name, std::chrono::steady_clock::time_point& started) {
+	auto now = std::chrono::steady_clock::now();
+	timings.push_back({ name, std::chrono::duration<double>(now - started).count() });
+	started = now;
+}
+
+bool MapStatisticsCollector::collect(bool showProgress) {
+	bool completed = collectTiles([showProgress](int percent) {
+		if (!showProgress) {
+			return true;
+		}
+		g_gui.SetLoadDone(percent);
+		return !g_gui.IsLoadCancelled();
+	});
+	if (!completed) {
+		return false;
+	}
+
+	collectHouses();
+	if (showProgress) {
+		g_gui.SetLoadDone(100);
+	}
+	return true;
+}
+
+bool MapStatisticsCollector::collectTiles(const std::function<bool(int)>& progress) {
+	auto started = std::chrono::steady_clock::now();
+	timings.clear();
+
+	// Padded so the counters of two workers never share a cache line
+	struct alignas(64) Partial {
+		MapStatistics statistics;
+	};
+	std::vector<Partial> partials(BaseMap::getWorkerCount());
+
+	const uint64_t total = std::max<uint64_t>(1, map.getTileCount());
+	bool completed = map.forEachTileByWorker([&partials](Tile* tile, size_t worker) {
+		partials[worker].statistics.addTile(tile);
+	}, [&progress, total](uint64_t done) {
+		return progress(static_cast<int>(done * 95 / total));
+	});
+	if (!completed) {
+		return false;
+	}
+	addTiming("Tiles, items and creatures", started);
+
+	totals = MapStatistics();
+	workers = 0;
+	for (const Partial& partial : partials) {
+		if (partial.statistics.tile_count > 0) {
+			++workers;
+		}
+		totals.merge(partial.statistics);
+	}
+	addTiming("Merge", started);
+	return true;
+}
+
+void MapStatisticsCollector::collectHouses() {
+	auto started = std::chrono::steady_clock::now();
+
+	total_house_sqm = 0;
+	largest_house = nullptr;
+	largest_house_size = 0;
+	std::map<uint32_t, uint64_t> town_sqm_count;
+	for (HouseMap::const_iterator hit = map.houses.begin(); hit != map.houses.end(); ++hit) {
+		const House* house = hit->second;
+		if (house->size() > largest_house_size) {
+			largest_house = house;
+			largest_house_size = house->size();
+		}
+		total_house_sqm += house->size();
+		town_sqm_count[house->townid] += house->size();
+	}
+	addTiming("Houses", started);
+
+	largest_town = nullptr;
+	largest_town_size = 0;
+	for (const auto& town_sqm : town_sqm_count) {
+		const Town* town = map.towns.getTown(town_sqm.first);
+		if (town && town_sqm.second > largest_town_size) {
+			largest_town = town;
+			largest_town_size = town_sqm.second;
+		}
+	}
+	addTiming("Towns", started);
+
+	double total = 0.0;
+	for (const Timing& timing : timings) {
+		total += timing.seconds;
+	}
+	timings.push_back({ "Total", total });
+}
+
+std::string MapStatisticsCollector::getText() const {
+	const MapStatistics& s = totals;
+	const int town_count = map.towns.count();
+	const int house_count = map.houses.count();
+
+	const double creatures_per_spawn = (s.spawn_count != 0 ? double(s.creature_count) / double(s.spawn_count) : -1.0);
+	const double percent_pathable = 100.0 * (s.tile_count != 0 ? double(s.walkable_tile_count) / double(s.tile_count) : -1.0);
+	const double percent_detailed = 100.0 * (s.tile_count != 0 ? double(s.detailed_tile_count) / double(s.tile_count) : -1.0);
+	const double houses_per_town = (town_count != 0 ? double(house_count) / double(town_count) : -1.0);
+	const double sqm_per_house = (house_count != 0 ? double(total_house_sqm) / double(house_count) : -1.0);
+	const double sqm_per_town = (town_count != 0 ? double(total_house_sqm) / double(town_count) : -1.0);
+
+	std::ostringstream os;
+	os.setf(std::ios::fixed, std::ios::floatfield);
+	os.precision(2);
+	os << "Map statistics for the map \"" << map.getMapDescription() << "\"\n";
+
+	os << "\tMap dimensions:\n";
+	os << "\t\tWidth: " << map.getWidth() << " tiles\n";
+	os << "\t\tHeight: " << map.getHeight() << " tiles\n";
+	os << "\t\tTotal area: " << (map.getWidth() * map.getHeight()) << " square tiles\n";
+	os << "\t\tNumber of floors: " << (MAP_MAX_LAYER + 1) << "\n";
+
+	os << "\tTile data:\n";
+	os << "\t\tTotal number of tiles: " << s.tile_count << "\n";
+	os << "\t\tNumber of pathable tiles: " << s.walkable_tile_count << "\n";
+	os << "\t\tNumber of unpathable tiles: " << s.blocking_tile_count << "\n";
+	if (percent_pathable >= 0.0) {
+		os << "\t\tPercent walkable tiles: " << percent_pathable << "%\n";
+	}
+	os << "\t\tDetailed tiles: " << s.detailed_tile_count << "\n";
+	if (percent_detailed >= 0.0) {
+		os << "\t\tPercent detailed tiles: " << percent_detailed << "%\n";
+	}
+
+	os << "\tItem data:\n";
+	os << "\t\tTotal number of items: " << s.item_count << "\n";
+	os << "\t\tNumber of moveable tiles: " << s.loose_item_count << "\n";
+	os << "\t\tNumber of depots: " << s.depot_count << "\n";
+	os << "\t\tNumber of containers: " << s.container_count << "\n";
+	os << "\t\tNumber of items with Action ID: " << s.action_item_count << "\n";
+	os << "\t\tNumber of items with Unique ID: " << s.unique_item_count << "\n";
+	os << "\t\tItems per tile ratio: " << (s.tile_count > 0 ? (double)s.item_count / s.tile_count : 0) << "\n";
+
+	os << "\tCreature data:\n";
+	os << "\t\tTotal creature count: " << s.creature_count << "\n";
+	os << "\t\tTotal spawn count: " << s.spawn_count << "\n";
+	if (creatures_per_spawn >= 0) {
+		os << "\t\tMean creatures per spawn: " << creatures_per_spawn << "\n";
+	}
+	os << "\t\tCreature density: " << (s.tile_count > 0 ? (double)s.creature_count / s.tile_count * 100 : 0) << "% of tiles\n";
+
+	os << "\tTown/House data:\n";
+	os << "\t\tTotal number of towns: " << town_count << "\n";
+	os << "\t\tTotal number of houses: " << house_count << "\n";
+	if (houses_per_town >= 0) {
+		os << "\t\tMean houses per town: " << houses_per_town << "\n";
+	}
+	os << "\t\tTotal amount of housetiles: " << total_house_sqm << "\n";
+	if (sqm_per_house >= 0) {
+		os << "\t\tMean tiles per house: " << sqm_per_house << "\n";
+	}
+	if (sqm_per_town >= 0) {
+		os << "\t\tMean tiles per town: " << sqm_per_town << "\n";
+	}
+	os << "\t\tPercentage of map covered by houses: " << (s.tile_count > 0 ? (double)total_house_sqm / s.tile_count * 100 : 0) << "%\n";
+	if (largest_town) {
+		os << "\t\tLargest Town: \"" << largest_town->getName() << "\" (" << largest_town_size << " sqm)\n";
+	}
+	if (largest_house) {
+		os << "\t\tLargest House: \"" << largest_house->name << "\" (" << largest_house_size << " sqm)\n";
+	}
+
+	os << "\tMap file information:\n";
+	os << "\t\tOTBM version: " << map.getVersion().otbm << "\n";
+	os << "\t\tClient version: " << map.getVersion().client << "\n";
+	os << "\t\tFile size (approximate): " << (map.getTileCount() * 512 / 1024) << " KB\n";
+
+	os << "\tCollection time (" << workers << " threads):\n";
+	for (const Timing& timing : timings) {
+		os << "\t\t" << timing.name << ": " << timing.seconds * 1000.0 << " ms\n";
+	}
+
+	os << "\n";
+	os << "Generated by Remere's Map Editor version OTARMEIE " + __RME_VERSION__ + "\n";
+	return os.str();
+}
+
+std::string MapStatisticsCollector::getJSON() const {
+	const MapStatistics& s = totals;
+	typedef boost::uint64_t Count;
+
+	json::Object dimensions;
+	dimensions.push_back(json::Pair("width", map.getWidth()));
+	dimensions.push_back(json::Pair("height", map.getHeight()));
+	dimensions.push_back(json::Pair("floors", MAP_MAX_LAYER + 1));
+
+	json::Object tiles;
+	tiles.push_back(json::Pair("total", Count(s.tile_count)));
+	tiles.push_back(json::Pair("walkable", Count(s.walkable_tile_count)));
+	tiles.push_back(json::Pair("blocking", Count(s.blocking_tile_count)));
+	tiles.push_back(json::Pair("detailed", Count(s.detailed_tile_count)));
+
+	json::Object items;
+	items.push_back(json::Pair("total", Count(s.item_count)));
+	items.push_back(json::Pair("moveable", Count(s.loose_item_count)));
+	items.push_back(json::Pair("depots", Count(s.depot_count)));
+	items.push_back(json::Pair("containers", Count(s.container_count)));
+	items.push_back(json::Pair("action_ids", Count(s.action_item_count)));
+	items.push_back(json::Pair("unique_ids", Count(s.unique_item_count)));
+
+	json::Object creatures;
+	creatures.push_back(json::Pair("creatures", Count(s.creature_count)));
+	creatures.push_back(json::Pair("spawns", Count(s.spawn_count)));
+
+	json::Object houses;
+	houses.push_back(json::Pair("towns", int(map.towns.count())));
+	houses.push_back(json::Pair("houses", int(map.houses.count())));
+	houses.push_back(json::Pair("house_tiles", Count(total_house_sqm)));
+	if (largest_town) {
+		json::Object town;
+		town.push_back(json::Pair("name", largest_town->getName()));
+		town.push_back(json::Pair("tiles", Count(largest_town_size)));
+		houses.push_back(json::Pair("largest_town", town));
+	}
+	if (largest_house) {
+		json::Object house;
+		house.push_back(json::Pair("name", largest_house->name));
+		house.push_back(json::Pair("tiles", Count(largest_house_size)));
+		houses.push_back(json::Pair("largest_house", house));
+	}
+
+	json::Object version;
+	version.push_back(json::Pair("otbm", int(map.getVersion().otbm)));
+	version.push_back(json::Pair("client", int(map.getVersion().client)));
+
+	json::Object timing;
+	timing.push_back(json::Pair("threads", int(workers)));
+	for (const Timing& entry : timings) {
+		timing.push_back(json::Pair(entry.name, Count(entry.seconds * 1000000.0)));
+	}
+
+	json::Object root;
+	root.push_back(json::Pair("description", map.getMapDescription()));
+	root.push_back(json::Pair("dimensions", dimensions));
+	root.push_back(json::Pair("tiles", tiles));
+	root.push_back(json::Pair("items", items));
+	root.push_back(json::Pair("creatures", creatures));
+	root.push_back(json::Pair("houses", houses));
+	root.push_back(json::Pair("version", version));
+	root.push_back(json::Pair("timings_us", timing));
+	return json::write_formatted(root);
+}
+
+// How often the UI thread looks in on the worker
+static const int STATISTICS_POLL_INTERVAL = 100;
+
+MapStatisticsTask::MapStatisticsTask(Editor& editor, std::function<void(MapStatisticsCollector&)> done) :
+	editor(editor),
+	collector(editor.map),
+	done(done),
+	progress(0),
+	cancelled(false),
+	finished(false),
+	completed(false),
+	running(true) {
+	editor.BlockEdits();
+	worker = std::thread([this]() {
+		completed = collector.collectTiles([this](int percent) {
+			progress = percent;
+			return !cancelled;
+		});
+		finished = true;
+	});
+	Start(STATISTICS_POLL_INTERVAL);
+}
+
+MapStatisticsTask::~MapStatisticsTask() {
+	Stop();
+	cancelled = true;
+	if (worker.joinable()) {
+		worker.join();
+	}
+	if (running) {
+		editor.UnblockEdits();
+	}
+}
+
+void MapStatisticsTask::Notify() {
+	if (!finished) {
+		g_gui.SetStatusText(wxString::Format("Collecting map statistics... %d%%", progress.load()));
+		return;
+	}
+	finish();
+}
+
+void MapStatisticsTask::finish() {
+	Stop();
+	worker.join();
+	running = false;
+	editor.UnblockEdits();
+	g_gui.UpdateMenus();
+	if (!completed) {
+		g_gui.SetStatusText("Map statistics cancelled.");
+		return;
+	}
+
+	// Houses and towns are edited outside of actions, so they are only
+	// read here, on the UI thread
+	collector.collectHouses();
+	g_gui.SetStatusText("Map statistics collected.");
+	done(collector);
+}
@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_STATISTICS_H_
+#define RME_MAP_STATISTICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+class Editor;
+class Map;
+class Tile;
+class Town;
+class House;
+
+// Counters of the tile pass. Every worker fills its own copy and the copies
+// are added up once all of them are done.
+struct MapStatistics {
+	MapStatistics();
+
+	void addTile(const Tile* tile);
+	void merge(const MapStatistics& other);
+
+	uint64_t tile_count;
+	uint64_t detailed_tile_count;
+	uint64_t blocking_tile_count;
+	uint64_t walkable_tile_count;
+	uint64_t spawn_count;
+	uint64_t creature_count;
+
+	uint64_t item_count;
+	uint64_t loose_item_count;
+	uint64_t depot_count;
+	uint64_t action_item_count;
+	uint64_t unique_item_count;
+	uint64_t container_count; // Only includes containers holding items
+};
+
+// Collects the statistics of a map in one pass over the tiles. The pass runs
+// on worker threads that each own whole subtrees of the map.
+class MapStatisticsCollector {
+public:
+	MapStatisticsCollector(Map& map);
+
+	// Both passes, on the calling thread. Returns false when cancelled from
+	// the load bar.
+	bool collect(bool showProgress);
+	// The tile pass, it may run on any thread as long as the map is not
+	// edited. Progress gets the percentage done and returns false to cancel.
+	bool collectTiles(const std::function<bool(int)>& progress);
+	// Houses and towns, on the thread that edits the map
+	void collectHouses();
+
+	const MapStatistics& getTotals() const {
+		return totals;
+	}
+
+	// The report shown in the statistics dialog
+	std::string getText() const;
+	std::string getJSON() const;
+
+protected:
+	struct Timing {
+		std::string name;
+		double seconds;
+	};
+
+	void addTiming(const std::string& name, std::chrono::steady_clock::time_point& started);
+
+	Map& map;
+	MapStatistics totals;
+	size_t workers;
+
+	uint64_t total_house_sqm;
+	const House* largest_house;
+	uint64_t largest_house_size;
+	const Town* largest_town;
+	uint64_t largest_town_size;
+
+	std::vector<Timing> timings;
+};
+
+// Runs the tile pass of a collector on a thread of its own so the editor
+// stays responsive. Edits of the map are blocked until it is done, then the
+// rest is collected and the callback gets the results on the UI thread.
+// Destroying the task cancels it and waits for the thread.
+class MapStatisticsTask : public wxTimer {
+public:
+	MapStatisticsTask(Editor& editor, std::function<void(MapStatisticsCollector&)> done);
+	~MapStatisticsTask();
+
+	bool isRunning() const {
+		return running;
+	}
+
+	void Notify() override;
+
+protected:
+	void finish();
+
+	Editor& editor;
+	MapStatisticsCollector collector;
+	std::function<void(MapStatisticsCollector&)> done;
+	std::thread worker;
+	std::atomic<int> progress;
+	std::atomic<bool> cancelled;
+	std::atomic<bool> finished;
+	bool completed;
+	bool running;
+};
+
+#endif
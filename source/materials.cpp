@@ -28,6 +28,7 @@
 #include "brush.h"
 #include "creature_brush.h"
 #include "raw_brush.h"
+#include "data_cache.h"
 
 Materials g_materials;
 
@@ -66,10 +67,23 @@ MaterialsExtensionList Materials::getExtensionsByVersion(uint16_t version_id) {
 	return ret_list;
 }
 
+bool Materials::loadDocument(const FileName& filename, pugi::xml_document& doc) {
+	if (documentCache && warmCache && documentCache->getDocument(filename, doc)) {
+		return true;
+	}
+
+	if (!doc.load_file(filename.GetFullPath().mb_str())) {
+		return false;
+	}
+	if (documentCache && !warmCache) {
+		documentCache->addDocument(filename, doc);
+	}
+	return true;
+}
+
 bool Materials::loadMaterials(const FileName& identifier, wxString& error, wxArrayString& warnings) {
 	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(identifier.GetFullPath().mb_str());
-	if (!result) {
+	if (!loadDocument(identifier, doc)) {
 		warnings.push_back("Could not open " + identifier.GetFullName() + " (file not found or syntax error)");
 		return false;
 	}
@@ -109,8 +123,7 @@ bool Materials::loadExtensions(FileName directoryName, wxString& error, wxArrayS
 		}
 
 		pugi::xml_document doc;
-		pugi::xml_parse_result result = doc.load_file(fn.GetFullPath().mb_str());
-		if (!result) {
+		if (!loadDocument(fn, doc)) {
 			warnings.push_back("Could not open " + filename + " (file not found or syntax error)");
 			continue;
 		}
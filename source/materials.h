@@ -20,6 +20,8 @@
 
 #include "extension.h"
 
+class DataCache;
+
 class Materials {
 public:
 	Materials();
@@ -47,14 +49,24 @@ public:
 		this->modified = newValue;
 	}
 
+	// Documents are read from a warm cache, or handed to a cold one as they
+	// are parsed. Pass nullptr once the materials are loaded.
+	void setDocumentCache(DataCache* cache, bool warm) {
+		documentCache = cache;
+		warmCache = warm;
+	}
+
 protected:
 	bool unserializeMaterials(const FileName& filename, pugi::xml_node node, wxString& error, wxArrayString& warnings);
 	bool unserializeTileset(pugi::xml_node node, wxArrayString& warnings);
+	bool loadDocument(const FileName& filename, pugi::xml_document& doc);
 
 	MaterialsExtensionList extensions;
 
 private:
 	bool modified = false;
+	DataCache* documentCache = nullptr;
+	bool warmCache = false;
 	Materials(const Materials&);
 	Materials& operator=(const Materials&);
 };
@@ -0,0 +1,368 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "minimap_export.h"
+#include "basemap.h"
+#include "tile.h"
+#include "gui.h"
+#include "graphics.h"
+#include "filehandle.h"
+
+#include <png.h>
+#include <thread>
+
+namespace {
+	class MinimapImageWriter {
+	public:
+		virtual ~MinimapImageWriter() { }
+
+		virtual bool open(const std::string& path, int width, int height) = 0;
+		virtual bool writeRow(const uint8_t* row) = 0;
+		virtual bool finish() = 0;
+		// BMP stores the bottom row first
+		virtual bool isBottomUp() const = 0;
+	};
+
+	class BMPMinimapWriter : public MinimapImageWriter {
+	public:
+		BMPMinimapWriter() :
+			width(0), padding(0) { }
+
+		bool open(const std::string& path, int width, int height) {
+			file.reset(newd FileWriteHandle(path));
+			if (!file->isOpen()) {
+				return false;
+			}
+
+			this->width = width;
+			// Bitmap width must be divisible by four
+			padding = (width & 3) != 0 ? 4 - (width & 3) : 0;
+
+			file->addRAW("BM");
+			// File size, header, image data header, color palette and pixels
+			file->addU32(14 + 40 + 256 * 4 + uint32_t(width + padding) * height);
+			// Two values reserved, must always be 0.
+			file->addU16(0);
+			file->addU16(0);
+			// Bitmapdata offset
+			file->addU32(14 + 40 + 256 * 4);
+			// Header size
+			file->addU32(40);
+			file->addU32(width);
+			file->addU32(height);
+			// Color planes
+			file->addU16(1);
+			// Bits per pixel, OT map format is 8
+			file->addU16(8);
+			// Compression type, 0 is no compression
+			file->addU32(0);
+			// Image size, 0 is valid if we use no compression
+			file->addU32(0);
+			// Horizontal/vertical resolution in pixels / meter
+			file->addU32(4000);
+			file->addU32(4000);
+			// Number of colors, important colors (0 is all)
+			file->addU32(256);
+			file->addU32(0);
+
+			for (int i = 0; i < 256; ++i) {
+				file->addU32(uint32_t(minimap_color[i]));
+			}
+			return file->isOk();
+		}
+
+		bool writeRow(const uint8_t* row) {
+			static const uint8_t zeroes[4] = { 0, 0, 0, 0 };
+			file->addRAW(row, width);
+			return file->addRAW(zeroes, padding);
+		}
+
+		bool finish() {
+			file->close();
+			return true;
+		}
+
+		bool isBottomUp() const {
+			return true;
+		}
+
+	private:
+		std::unique_ptr<FileWriteHandle> file;
+		int width;
+		int padding;
+	};
+
+	// libpng reports errors through longjmp, only plain data may live in the
+	// frames between setjmp and the png calls
+	class PNGMinimapWriter : public MinimapImageWriter {
+	public:
+		PNGMinimapWriter() :
+			png(nullptr), info(nullptr) { }
+		~PNGMinimapWriter() {
+			if (png) {
+				png_destroy_write_struct(&png, info ? &info : nullptr);
+			}
+		}
+
+		bool open(const std::string& path, int width, int height) {
+			file.reset(newd FileWriteHandle(path));
+			if (!file->isOpen()) {
+				return false;
+			}
+
+			png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+			if (!png) {
+				return false;
+			}
+			info = png_create_info_struct(png);
+			if (!info) {
+				return false;
+			}
+
+			png_color palette[256];
+			for (int i = 0; i < 256; ++i) {
+				palette[i].red = minimap_color[i].red;
+				palette[i].green = minimap_color[i].green;
+				palette[i].blue = minimap_color[i].blue;
+			}
+
+			if (setjmp(png_jmpbuf(png))) {
+				return false;
+			}
+
+			png_set_write_fn(png, file.get(), &PNGMinimapWriter::write, &PNGMinimapWriter::flush);
+			png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+			png_set_PLTE(png, info, palette, 256);
+			// Row filters do not help paletted images
+			png_set_filter(png, 0, PNG_FILTER_NONE);
+			png_write_info(png, info);
+			return true;
+		}
+
+		bool writeRow(const uint8_t* row) {
+			if (setjmp(png_jmpbuf(png))) {
+				return false;
+			}
+			png_write_row(png, const_cast<png_bytep>(row));
+			return true;
+		}
+
+		bool finish() {
+			if (setjmp(png_jmpbuf(png))) {
+				return false;
+			}
+			png_write_end(png, nullptr);
+			file->close();
+			return true;
+		}
+
+		bool isBottomUp() const {
+			return false;
+		}
+
+	private:
+		static void write(png_structp png, png_bytep data, size_t length) {
+			FileWriteHandle* file = static_cast<FileWriteHandle*>(png_get_io_ptr(png));
+			if (!file->addRAW(data, length)) {
+				png_error(png, "write failed");
+			}
+		}
+		static void flush(png_structp png) {
+			////
+		}
+
+		std::unique_ptr<FileWriteHandle> file;
+		png_structp png;
+		png_infop info;
+	};
+}
+
+MinimapExporter::MinimapExporter(BaseMap& map, MinimapExportFormat format) :
+	map(map),
+	format(format),
+	selectedOnly(false),
+	showProgress(false),
+	hasArea(false),
+	padding(0) {
+	fixedArea.min_x = fixedArea.min_y = 0;
+	fixedArea.max_x = fixedArea.max_y = -1;
+}
+
+void MinimapExporter::setArea(int min_x, int min_y, int max_x, int max_y) {
+	hasArea = true;
+	fixedArea.min_x = min_x;
+	fixedArea.min_y = min_y;
+	fixedArea.max_x = max_x;
+	fixedArea.max_y = max_y;
+}
+
+bool MinimapExporter::isExported(const Tile* tile) const {
+	return tile && !tile->empty() && (!selectedOnly || tile->isSelected());
+}
+
+template <typename Callback>
+void MinimapExporter::forEachLeaf(QTreeNode* node, int x, int y, int span, const Area& area, Callback& callback) const {
+	if (node->isLeaf) {
+		callback(node, x, y);
+		return;
+	}
+
+	// Every node splits its span in four on both axes
+	int child_span = span >> 2;
+	for (int i = 0; i < MAP_LAYERS; ++i) {
+		QTreeNode* child = node->child[i];
+		if (!child) {
+			continue;
+		}
+
+		int child_x = x + (i & 3) * child_span;
+		int child_y = y + (i >> 2) * child_span;
+		if (child_x > area.max_x || child_y > area.max_y || child_x + child_span <= area.min_x || child_y + child_span <= area.min_y) {
+			continue;
+		}
+		forEachLeaf(child, child_x, child_y, child_span, area, callback);
+	}
+}
+
+bool MinimapExporter::getBounds(int floor, int& min_x, int& min_y, int& max_x, int& max_y) const {
+	Area area;
+	area.min_x = area.min_y = 0;
+	area.max_x = area.max_y = 0xFFFF;
+
+	bool found = false;
+	min_x = min_y = 0x10000;
+	max_x = max_y = 0;
+
+	auto callback = [&](QTreeNode* leaf, int x, int y) {
+		Floor* tiles = leaf->getFloor(floor);
+		if (!tiles) {
+			return;
+		}
+		for (int i = 0; i < MAP_LAYERS; ++i) {
+			if (!isExported(tiles->locs[i].get())) {
+				continue;
+			}
+			int tile_x = x + (i >> 2);
+			int tile_y = y + (i & 3);
+			min_x = std::min(min_x, tile_x);
+			min_y = std::min(min_y, tile_y);
+			max_x = std::max(max_x, tile_x);
+			max_y = std::max(max_y, tile_y);
+			found = true;
+		}
+	};
+	forEachLeaf(&map.root, 0, 0, 0x10000, area, callback);
+	return found;
+}
+
+void MinimapExporter::rasterize(int floor, const Area& area, uint8_t* pixels, int stride) const {
+	auto callback = [&](QTreeNode* leaf, int x, int y) {
+		Floor* tiles = leaf->getFloor(floor);
+		if (!tiles) {
+			return;
+		}
+		for (int i = 0; i < MAP_LAYERS; ++i) {
+			int tile_x = x + (i >> 2);
+			int tile_y = y + (i & 3);
+			if (tile_x < area.min_x || tile_x > area.max_x || tile_y < area.min_y || tile_y > area.max_y) {
+				continue;
+			}
+
+			const Tile* tile = tiles->locs[i].get();
+			if (isExported(tile)) {
+				pixels[(tile_y - area.min_y) * stride + (tile_x - area.min_x)] = tile->getMiniMapColor();
+			}
+		}
+	};
+	forEachLeaf(&map.root, 0, 0, 0x10000, area, callback);
+}
+
+bool MinimapExporter::exportFloor(const FileName& filename, int floor) {
+	Area bounds;
+	if (hasArea) {
+		bounds = fixedArea;
+	} else if (!getBounds(floor, bounds.min_x, bounds.min_y, bounds.max_x, bounds.max_y)) {
+		return true;
+	}
+
+	bounds.min_x = std::max(0, bounds.min_x - padding);
+	bounds.min_y = std::max(0, bounds.min_y - padding);
+	bounds.max_x = std::min(0xFFFF, bounds.max_x + padding);
+	bounds.max_y = std::min(0xFFFF, bounds.max_y + padding);
+	if (bounds.max_x < bounds.min_x || bounds.max_y < bounds.min_y) {
+		return false;
+	}
+
+	const int width = bounds.max_x - bounds.min_x + 1;
+	const int height = bounds.max_y - bounds.min_y + 1;
+
+	std::unique_ptr<MinimapImageWriter> writer;
+	if (format == MINIMAP_EXPORT_PNG) {
+		writer.reset(newd PNGMinimapWriter());
+	} else {
+		writer.reset(newd BMPMinimapWriter());
+	}
+	if (!writer->open(nstr(filename.GetFullPath()), width, height)) {
+		return false;
+	}
+
+	// Each thread rasterizes a column of the strip, leaves are 4 tiles wide
+	int thread_count = std::max<int>(1, std::thread::hardware_concurrency());
+	thread_count = std::min(thread_count, (width + 3) / 4);
+	int column_width = ((width + thread_count - 1) / thread_count + 3) & ~3;
+
+	std::vector<uint8_t> strip(size_t(width) * STRIP_HEIGHT);
+	int strip_count = (height + STRIP_HEIGHT - 1) / STRIP_HEIGHT;
+	for (int n = 0; n < strip_count; ++n) {
+		int index = writer->isBottomUp() ? strip_count - 1 - n : n;
+		Area area = bounds;
+		area.min_y = bounds.min_y + index * STRIP_HEIGHT;
+		area.max_y = std::min(bounds.max_y, area.min_y + STRIP_HEIGHT - 1);
+		int rows = area.max_y - area.min_y + 1;
+
+		std::fill(strip.begin(), strip.begin() + size_t(width) * rows, 0);
+
+		std::vector<std::thread> threads;
+		for (int x = bounds.min_x; x <= bounds.max_x; x += column_width) {
+			Area column = area;
+			column.min_x = x;
+			column.max_x = std::min(bounds.max_x, x + column_width - 1);
+			// Columns never overlap, the threads share the strip
+			uint8_t* pixels = strip.data() + (column.min_x - area.min_x);
+			threads.emplace_back([this, floor, column, pixels, width]() {
+				rasterize(floor, column, pixels, width);
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		for (int row = 0; row < rows; ++row) {
+			int y = writer->isBottomUp() ? rows - 1 - row : row;
+			if (!writer->writeRow(strip.data() + size_t(y) * width)) {
+				return false;
+			}
+		}
+
+		if (showProgress) {
+			g_gui.SetLoadDone(int((n + 1) * 100.0 / strip_count));
+		}
+	}
+	return writer->finish();
+}
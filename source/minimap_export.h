@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MINIMAP_EXPORT_H_
+#define RME_MINIMAP_EXPORT_H_
+
+class BaseMap;
+class QTreeNode;
+class Tile;
+
+enum MinimapExportFormat {
+	MINIMAP_EXPORT_BMP,
+	MINIMAP_EXPORT_PNG,
+};
+
+// Writes the minimap colors of a floor as an 8-bit paletted image. The rows
+// are rasterized from the map tree in strips by a few threads and streamed to
+// the file, so memory use does not grow with the size of the map.
+class MinimapExporter {
+public:
+	MinimapExporter(BaseMap& map, MinimapExportFormat format);
+
+	// Only export selected tiles
+	void setSelectedOnly(bool value) {
+		selectedOnly = value;
+	}
+	// Tiles of empty border around the used area
+	void setPadding(int value) {
+		padding = value;
+	}
+	// Export a fixed area instead of the used area of each floor
+	void setArea(int min_x, int min_y, int max_x, int max_y);
+	void setShowProgress(bool value) {
+		showProgress = value;
+	}
+
+	// An empty floor writes no file and is not an error
+	bool exportFloor(const FileName& filename, int floor);
+
+	// Bounds of the exported tiles on a floor, false if there are none
+	bool getBounds(int floor, int& min_x, int& min_y, int& max_x, int& max_y) const;
+
+	static const int STRIP_HEIGHT = 256;
+
+protected:
+	struct Area {
+		int min_x, min_y, max_x, max_y;
+	};
+
+	template <typename Callback>
+	void forEachLeaf(QTreeNode* node, int x, int y, int span, const Area& area, Callback& callback) const;
+
+	// Pixels start at the top left of the area, rows are stride bytes apart
+	void rasterize(int floor, const Area& area, uint8_t* pixels, int stride) const;
+	bool isExported(const Tile* tile) const;
+
+	BaseMap& map;
+	MinimapExportFormat format;
+	bool selectedOnly;
+	bool showProgress;
+	bool hasArea;
+	int padding;
+	Area fixedArea;
+};
+
+#endif
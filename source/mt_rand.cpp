@@ -17,6 +17,8 @@
 
 #include "main.h"
 
+#include <atomic>
+
 static inline unsigned long int mt_get(void* vstate);
 static double mt_get_double(void* vstate);
 static void mt_set(void* state, unsigned long int s);
@@ -106,16 +108,32 @@ mt_set(void* vstate, unsigned long int s) {
 	state->mti = i;
 }
 
-static mt_state_t mt_state;
+// Each thread draws from its own generator, brushes are applied from worker
+// threads when rebordering large strokes. Threads other than the one that
+// seeded are seeded from it on first use.
+static std::atomic<unsigned long> mt_base_seed(4357);
+static std::atomic<unsigned long> mt_thread_count(0);
+static thread_local mt_state_t mt_state;
+static thread_local bool mt_seeded = false;
+
+static mt_state_t* mt_current() {
+	if (!mt_seeded) {
+		mt_set(&mt_state, mt_base_seed + 0x9E3779B9UL * ++mt_thread_count);
+		mt_seeded = true;
+	}
+	return &mt_state;
+}
 
 void mt_seed(unsigned long s) {
+	mt_base_seed = s;
 	mt_set(&mt_state, s);
+	mt_seeded = true;
 }
 
 unsigned long mt_randi() {
-	return mt_get(&mt_state);
+	return mt_get(mt_current());
 }
 
 double mt_randd() {
-	return mt_get_double(&mt_state);
+	return mt_get_double(mt_current());
 }
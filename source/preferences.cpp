@@ -145,6 +145,11 @@ wxNotebookPage* PreferencesWindow::CreateGeneralPage() {
 	grid_sizer->Add(undo_mem_size_spin, 0);
 	SetWindowToolTip(tmptext, undo_mem_size_spin, "The approximite limit for the memory usage of the undo queue.");
 
+	grid_sizer->Add(tmptext = newd wxStaticText(general_page, wxID_ANY, "Undo disk spill size (MB): "), 0);
+	undo_disk_size_spin = newd wxSpinCtrl(general_page, wxID_ANY, i2ws(g_settings.getInteger(Config::UNDO_DISK_SIZE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 65536);
+	grid_sizer->Add(undo_disk_size_spin, 0);
+	SetWindowToolTip(tmptext, undo_disk_size_spin, "Older undo steps that do not fit in memory are compressed to a temporary file up to this size, 0 disables it.");
+
 	grid_sizer->Add(tmptext = newd wxStaticText(general_page, wxID_ANY, "Worker Threads: "), 0);
 	worker_threads_spin = newd wxSpinCtrl(general_page, wxID_ANY, i2ws(g_settings.getInteger(Config::WORKER_THREADS)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 64);
 	grid_sizer->Add(worker_threads_spin, 0);
@@ -353,6 +358,12 @@ wxNotebookPage* PreferencesWindow::CreateGraphicsPage() {
 	subsizer->Add(screenshot_format_choice, 0);
 	SetWindowToolTip(screenshot_format_choice, tmp, "This will affect the screenshot format used by the editor.\nTo take a screenshot, press F11.");
 
+	// Texture memory
+	subsizer->Add(tmp = newd wxStaticText(graphics_page, wxID_ANY, "Texture memory budget (MB): "), 0);
+	texture_budget_spin = newd wxSpinCtrl(graphics_page, wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_MEMORY_BUDGET)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 16, 8192);
+	subsizer->Add(texture_budget_spin, 0);
+	SetWindowToolTip(texture_budget_spin, tmp, "Sprite textures kept on the graphics card, the least recently drawn ones are freed above this.");
+
 	sizer->Add(subsizer, 1, wxEXPAND | wxALL, 5);
 
 	// Advanced g_settings
@@ -370,21 +381,6 @@ wxNotebookPage* PreferencesWindow::CreateGraphicsPage() {
 		wxFlexGridSizer* pane_grid_sizer = newd wxFlexGridSizer(2, 10, 10);
 		pane_grid_sizer->AddGrowableCol(1);
 
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture clean interval: "), 0);
-		clean_interval_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_CLEAN_PULSE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 0x1000000);
-		pane_grid_sizer->Add(clean_interval_spin, 0);
-		SetWindowToolTip(clean_interval_spin, tmp, "This controls how often the editor tries to free hardware texture resources.");
-
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture longevity: "), 0);
-		texture_longevity_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_LONGEVITY)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 0x1000000);
-		pane_grid_sizer->Add(texture_longevity_spin, 0);
-		SetWindowToolTip(texture_longevity_spin, tmp, "This controls for how long (in seconds) that the editor will keep textures in memory before it cleans them up.");
-
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture clean threshold: "), 0);
-		texture_threshold_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 100, 0x1000000);
-		pane_grid_sizer->Add(texture_threshold_spin, 0);
-		SetWindowToolTip(texture_threshold_spin, tmp, "This controls how many textures the editor will hold in memory before it attempts to clean up old textures. However, an infinite amount MIGHT be loaded.");
-
 		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Software clean threshold: "), 0);
 		software_threshold_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::SOFTWARE_CLEAN_THRESHOLD)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 100, 0x1000000);
 		pane_grid_sizer->Add(software_threshold_spin, 0);
@@ -931,6 +927,7 @@ void PreferencesWindow::Apply() {
 	g_settings.setInteger(Config::AUTO_SELECT_RAW_ON_RIGHTCLICK, auto_select_raw_chkbox->GetValue());
 	g_settings.setInteger(Config::UNDO_SIZE, undo_size_spin->GetValue());
 	g_settings.setInteger(Config::UNDO_MEM_SIZE, undo_mem_size_spin->GetValue());
+	g_settings.setInteger(Config::UNDO_DISK_SIZE, undo_disk_size_spin->GetValue());
 	g_settings.setInteger(Config::WORKER_THREADS, worker_threads_spin->GetValue());
 	g_settings.setInteger(Config::REPLACE_SIZE, replace_size_spin->GetValue());
 	g_settings.setInteger(Config::COPY_POSITION_FORMAT, position_format->GetSelection());
@@ -1028,6 +1025,8 @@ void PreferencesWindow::Apply() {
 		g_settings.setString(Config::SCREENSHOT_FORMAT, "bmp");
 	}
 
+	g_settings.setInteger(Config::TEXTURE_MEMORY_BUDGET, texture_budget_spin->GetValue());
+
 	wxColor clr = cursor_color_pick->GetColour();
 	g_settings.setInteger(Config::CURSOR_RED, clr.Red());
 	g_settings.setInteger(Config::CURSOR_GREEN, clr.Green());
@@ -1043,9 +1042,6 @@ void PreferencesWindow::Apply() {
 	g_settings.setInteger(Config::HIDE_ITEMS_WHEN_ZOOMED, hide_items_when_zoomed_chkbox->GetValue());
 	/*
 	g_settings.setInteger(Config::TEXTURE_MANAGEMENT, texture_managment_chkbox->GetValue());
-	g_settings.setInteger(Config::TEXTURE_CLEAN_PULSE, clean_interval_spin->GetValue());
-	g_settings.setInteger(Config::TEXTURE_LONGEVITY, texture_longevity_spin->GetValue());
-	g_settings.setInteger(Config::TEXTURE_CLEAN_THRESHOLD, texture_threshold_spin->GetValue());
 	g_settings.setInteger(Config::SOFTWARE_CLEAN_THRESHOLD, software_threshold_spin->GetValue());
 	g_settings.setInteger(Config::SOFTWARE_CLEAN_SIZE, software_clean_amount_spin->GetValue());
 	*/
@@ -56,6 +56,7 @@ protected:
 	wxCheckBox* enable_tileset_editing_chkbox;
 	wxSpinCtrl* undo_size_spin;
 	wxSpinCtrl* undo_mem_size_spin;
+	wxSpinCtrl* undo_disk_size_spin;
 	wxSpinCtrl* worker_threads_spin;
 	wxSpinCtrl* replace_size_spin;
 	wxRadioBox* position_format;
@@ -78,6 +79,7 @@ protected:
 	wxCheckBox* use_memcached_chkbox;
 	wxDirPickerCtrl* screenshot_directory_picker;
 	wxChoice* screenshot_format_choice;
+	wxSpinCtrl* texture_budget_spin;
 	wxCheckBox* hide_items_when_zoomed_chkbox;
 	wxColourPickerCtrl* cursor_color_pick;
 	wxColourPickerCtrl* cursor_alt_color_pick;
@@ -86,9 +88,6 @@ protected:
 	wxColourPickerCtrl* dark_mode_color_pick;
 	/*
 	wxCheckBox* texture_managment_chkbox;
-	wxSpinCtrl* clean_interval_spin;
-	wxSpinCtrl* texture_longevity_spin;
-	wxSpinCtrl* texture_threshold_spin;
 	wxSpinCtrl* software_threshold_spin;
 	wxSpinCtrl* software_clean_amount_spin;
 	*/
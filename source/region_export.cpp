@@ -0,0 +1,320 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "region_export.h"
+#include "basemap.h"
+#include "tile.h"
+#include "item.h"
+#include "items.h"
+#include "graphics.h"
+#include "sprites.h"
+#include "gui.h"
+
+#include <png.h>
+#include <thread>
+
+namespace {
+	// libpng reports errors through longjmp, only plain data may live in the
+	// frames between setjmp and the png calls
+	class PNGRegionWriter {
+	public:
+		PNGRegionWriter() :
+			png(nullptr), info(nullptr) { }
+		~PNGRegionWriter() {
+			if (png) {
+				png_destroy_write_struct(&png, info ? &info : nullptr);
+			}
+		}
+
+		bool open(const std::string& path, int width, int height) {
+			file.reset(newd FileWriteHandle(path));
+			if (!file->isOpen()) {
+				return false;
+			}
+
+			png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+			if (!png) {
+				return false;
+			}
+			info = png_create_info_struct(png);
+			if (!info) {
+				return false;
+			}
+
+			if (setjmp(png_jmpbuf(png))) {
+				return false;
+			}
+
+			png_set_write_fn(png, file.get(), &PNGRegionWriter::write, &PNGRegionWriter::flush);
+			png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+			png_write_info(png, info);
+			return true;
+		}
+
+		bool writeRow(const uint8_t* row) {
+			if (setjmp(png_jmpbuf(png))) {
+				return false;
+			}
+			png_write_row(png, const_cast<png_bytep>(row));
+			return true;
+		}
+
+		bool finish() {
+			if (setjmp(png_jmpbuf(png))) {
+				return false;
+			}
+			png_write_end(png, nullptr);
+			file->close();
+			return true;
+		}
+
+	private:
+		static void write(png_structp png, png_bytep data, size_t length) {
+			FileWriteHandle* file = static_cast<FileWriteHandle*>(png_get_io_ptr(png));
+			if (!file->addRAW(data, length)) {
+				png_error(png, "write failed");
+			}
+		}
+		static void flush(png_structp png) {
+			////
+		}
+
+		std::unique_ptr<FileWriteHandle> file;
+		png_structp png;
+		png_infop info;
+	};
+}
+
+RegionExporter::RegionExporter(BaseMap& map) :
+	map(map),
+	showLowerFloors(true),
+	showProgress(false) {
+	////
+}
+
+RegionExporter::~RegionExporter() {
+	////
+}
+
+const uint8_t* RegionExporter::getPixels(SpriteCache& sprites, GameSprite* sprite, uint32_t index) {
+	const SpriteKey key(sprite, index);
+	auto local = sprites.find(key);
+	if (local != sprites.end()) {
+		return local->second;
+	}
+
+	// Sprite dumps are read from the file on first use, that is not thread
+	// safe. The shared entries stay until all threads of the strip are done.
+	const uint8_t* rgba;
+	{
+		std::lock_guard<std::mutex> lock(cacheLock);
+		auto it = cache.find(key);
+		if (it == cache.end()) {
+			it = cache.emplace(key, std::unique_ptr<uint8_t[]>(sprite->getRGBAData(index))).first;
+		}
+		rgba = it->second.get();
+	}
+	sprites.emplace(key, rgba);
+	return rgba;
+}
+
+void RegionExporter::drawTile(const Tile* tile, int screen_x, int screen_y, const Clip& clip, uint8_t* pixels, size_t stride, SpriteCache& sprites) {
+	const Position& position = tile->getPosition();
+	int elevation = 0;
+
+	// Same steps as MapDrawer::BlitItem in ingame mode, animations stay at
+	// their first frame
+	auto drawItem = [&](Item* item) {
+		const ItemType& type = g_items[item->getID()];
+		GameSprite* sprite = type.sprite;
+		if (type.isMetaItem() || !sprite) {
+			return;
+		}
+
+		int subtype = -1;
+		int pattern_x = position.x % sprite->pattern_x;
+		int pattern_y = position.y % sprite->pattern_y;
+		int pattern_z = position.z % sprite->pattern_z;
+		if (type.isSplash() || type.isFluidContainer()) {
+			subtype = item->getSubtype();
+		} else if (type.isHangable) {
+			if (tile->hasProperty(HOOK_SOUTH)) {
+				pattern_x = 1;
+			} else if (tile->hasProperty(HOOK_EAST)) {
+				pattern_x = 2;
+			} else {
+				pattern_x = 0;
+			}
+		} else if (type.stackable) {
+			const int count = item->getSubtype();
+			subtype = count <= 1 ? 0 : count <= 2 ? 1 : count <= 3 ? 2 : count <= 4 ? 3 : count < 10 ? 4 : count < 25 ? 5 : count < 50 ? 6 : 7;
+		}
+
+		const int draw_x = screen_x - elevation - sprite->getDrawOffset().first;
+		const int draw_y = screen_y - elevation - sprite->getDrawOffset().second;
+		for (int cx = 0; cx != sprite->width; ++cx) {
+			for (int cy = 0; cy != sprite->height; ++cy) {
+				const int x = draw_x - cx * TileSize;
+				const int y = draw_y - cy * TileSize;
+				if (x >= clip.max_x || y >= clip.max_y || x + SPRITE_PIXELS <= clip.min_x || y + SPRITE_PIXELS <= clip.min_y) {
+					continue;
+				}
+
+				for (int cf = 0; cf != sprite->layers; ++cf) {
+					const uint8_t* rgba = getPixels(sprites, sprite, sprite->getSpriteIndex(cx, cy, cf, subtype, pattern_x, pattern_y, pattern_z, 0));
+					if (!rgba) {
+						continue;
+					}
+
+					// Straight alpha over an opaque RGB buffer
+					const int begin_x = std::max(clip.min_x, x);
+					const int end_x = std::min(clip.max_x, x + SPRITE_PIXELS);
+					const int begin_y = std::max(clip.min_y, y);
+					const int end_y = std::min(clip.max_y, y + SPRITE_PIXELS);
+					for (int ty = begin_y; ty < end_y; ++ty) {
+						const uint8_t* source = rgba + ((ty - y) * SPRITE_PIXELS + (begin_x - x)) * 4;
+						uint8_t* target = pixels + ty * stride + begin_x * 3;
+						for (int tx = begin_x; tx < end_x; ++tx, source += 4, target += 3) {
+							const int alpha = source[3];
+							if (alpha == 255) {
+								target[0] = source[0];
+								target[1] = source[1];
+								target[2] = source[2];
+							} else if (alpha != 0) {
+								target[0] = (source[0] * alpha + target[0] * (255 - alpha)) / 255;
+								target[1] = (source[1] * alpha + target[1] * (255 - alpha)) / 255;
+								target[2] = (source[2] * alpha + target[2] * (255 - alpha)) / 255;
+							}
+						}
+					}
+				}
+			}
+		}
+		elevation += sprite->getDrawHeight();
+	};
+
+	if (tile->ground) {
+		drawItem(tile->ground);
+	}
+	for (Item* item : tile->items) {
+		drawItem(item);
+	}
+}
+
+void RegionExporter::compose(int origin_x, int origin_y, int z, const Clip& clip, uint8_t* pixels, size_t stride) {
+	int start_z = z;
+	if (showLowerFloors) {
+		start_z = z <= GROUND_LAYER ? GROUND_LAYER : std::min(MAP_MAX_LAYER, z + 2);
+	}
+
+	// Sprites only reach up and left, tiles a bit past the clip still count
+	const int first_x = clip.min_x / TileSize;
+	const int first_y = clip.min_y / TileSize;
+	const int last_x = (clip.max_x - 1) / TileSize + APRON;
+	const int last_y = (clip.max_y - 1) / TileSize + APRON;
+	SpriteCache sprites;
+
+	for (int map_z = start_z; map_z >= z; --map_z) {
+		// Lower floors are seen one tile down and right per floor
+		const int shift = map_z - z;
+		for (int x = first_x; x <= last_x; ++x) {
+			const int map_x = origin_x + x - shift;
+			if (map_x < 0 || map_x > 0xFFFF) {
+				continue;
+			}
+			for (int y = first_y; y <= last_y; ++y) {
+				const int map_y = origin_y + y - shift;
+				if (map_y < 0 || map_y > 0xFFFF) {
+					continue;
+				}
+				const Tile* tile = map.getTile(map_x, map_y, map_z);
+				if (tile) {
+					drawTile(tile, x * TileSize, y * TileSize, clip, pixels, stride, sprites);
+				}
+			}
+		}
+	}
+}
+
+bool RegionExporter::exportRegion(const FileName& filename, int min_x, int min_y, int max_x, int max_y, int z) {
+	min_x = std::max(0, min_x);
+	min_y = std::max(0, min_y);
+	max_x = std::min(0xFFFF, max_x);
+	max_y = std::min(0xFFFF, max_y);
+	if (max_x < min_x || max_y < min_y || z < 0 || z > MAP_MAX_LAYER) {
+		return false;
+	}
+
+	const int columns = max_x - min_x + 1;
+	const int rows = max_y - min_y + 1;
+	const int width = columns * TileSize;
+	const size_t row_bytes = size_t(width) * 3;
+
+	PNGRegionWriter writer;
+	if (!writer.open(nstr(filename.GetFullPath()), width, rows * TileSize)) {
+		return false;
+	}
+
+	// A strip holds as many tile rows as the budget allows, the tiles below it
+	// are composed again by the next strip
+	const int strip_rows = static_cast<int>(std::max<size_t>(1, std::min<size_t>(rows, STRIP_MEMORY / (row_bytes * TileSize))));
+	std::vector<uint8_t> strip(row_bytes * TileSize * strip_rows);
+
+	// Each thread composes a column of the strip
+	int thread_count = std::max<int>(1, std::thread::hardware_concurrency());
+	thread_count = std::min(thread_count, columns);
+	const int column_width = (columns + thread_count - 1) / thread_count;
+
+	const int strip_count = (rows + strip_rows - 1) / strip_rows;
+	for (int n = 0; n < strip_count; ++n) {
+		const int first_row = n * strip_rows;
+		const int height = std::min(strip_rows, rows - first_row) * TileSize;
+		std::fill(strip.begin(), strip.begin() + row_bytes * height, 0);
+
+		std::vector<std::thread> threads;
+		for (int x = 0; x < columns; x += column_width) {
+			Clip clip;
+			clip.min_x = x * TileSize;
+			clip.max_x = std::min(columns, x + column_width) * TileSize;
+			clip.min_y = 0;
+			clip.max_y = height;
+			// Columns never overlap, the threads share the strip
+			threads.emplace_back([this, min_x, min_y, first_row, z, clip, &strip, row_bytes]() {
+				compose(min_x, min_y + first_row, z, clip, strip.data(), row_bytes);
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		for (int row = 0; row < height; ++row) {
+			if (!writer.writeRow(strip.data() + row * row_bytes)) {
+				return false;
+			}
+		}
+
+		if (cache.size() > MAX_CACHED_SPRITES) {
+			cache.clear();
+		}
+		if (showProgress) {
+			g_gui.SetLoadDone(int((n + 1) * 100.0 / strip_count));
+		}
+	}
+	return writer.finish();
+}
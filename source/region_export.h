@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_REGION_EXPORT_H_
+#define RME_REGION_EXPORT_H_
+
+#include <mutex>
+#include <memory>
+
+class BaseMap;
+class Tile;
+class GameSprite;
+
+// Renders a rectangle of the map at full tile resolution without OpenGL, so
+// it also runs headless. Strips of tile rows are composed on the CPU by a few
+// threads and streamed to a PNG file row by row, memory use depends on the
+// width of the area and not on its height.
+class RegionExporter {
+public:
+	RegionExporter(BaseMap& map);
+	~RegionExporter();
+
+	// Draw the floors below like the editor does, on by default
+	void setShowLowerFloors(bool value) {
+		showLowerFloors = value;
+	}
+	void setShowProgress(bool value) {
+		showProgress = value;
+	}
+
+	// The area is inclusive and in tiles, the image is 32 pixels per tile
+	bool exportRegion(const FileName& filename, int min_x, int min_y, int max_x, int max_y, int z);
+
+	// Budget of the strip buffer, a strip is at least one tile row
+	static const size_t STRIP_MEMORY = 64 << 20;
+	// Tiles right of and below a strip whose sprites may reach into it
+	static const int APRON = 3;
+	// Decoded sprites are dropped between strips past this count
+	static const size_t MAX_CACHED_SPRITES = 8192;
+
+protected:
+	struct Clip {
+		int min_x, min_y, max_x, max_y; // pixels, exclusive max
+	};
+	typedef std::pair<GameSprite*, uint32_t> SpriteKey;
+	// Per thread view of the shared cache, only a miss takes the lock
+	typedef std::map<SpriteKey, const uint8_t*> SpriteCache;
+
+	// Pixel 0,0 is the top left of tile origin_x,origin_y, rows are stride
+	// bytes apart. Only the pixels inside clip are written.
+	void compose(int origin_x, int origin_y, int z, const Clip& clip, uint8_t* pixels, size_t stride);
+	void drawTile(const Tile* tile, int screen_x, int screen_y, const Clip& clip, uint8_t* pixels, size_t stride, SpriteCache& sprites);
+	const uint8_t* getPixels(SpriteCache& sprites, GameSprite* sprite, uint32_t index);
+
+	BaseMap& map;
+	bool showLowerFloors;
+	bool showProgress;
+
+	std::mutex cacheLock;
+	std::map<SpriteKey, std::unique_ptr<uint8_t[]>> cache;
+};
+
+#endif
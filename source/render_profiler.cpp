@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "render_profiler.h"
+
+RenderProfiler g_render_profiler;
+
+RenderProfiler::RenderProfiler() :
+	overlay(false),
+	recording(false),
+	inFrame(false),
+	stageTimes(),
+	counters(),
+	stageHistory(),
+	counterHistory(),
+	historyIndex(0),
+	historyCount(0) {
+	////
+}
+
+void RenderProfiler::setOverlayVisible(bool visible) {
+	overlay = visible;
+	historyIndex = 0;
+	historyCount = 0;
+}
+
+void RenderProfiler::startRecording() {
+	trace.clear();
+	recordingStart = Clock::now();
+	recording = true;
+}
+
+void RenderProfiler::stopRecording() {
+	recording = false;
+}
+
+bool RenderProfiler::saveTrace(const wxString& path, wxString& error) const {
+	std::ofstream file(path.ToStdString(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		error = "Could not open " + path + " for writing.";
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Map canvas\"}}";
+	for (const TraceEvent& event : trace) {
+		if (event.stage >= 0) {
+			file << ",\n{\"name\":\"" << getStageName(static_cast<RenderStage>(event.stage)) << "\",\"cat\":\"render\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+				 << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+		} else {
+			file << ",\n{\"name\":\"Frame counters\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":" << event.start << ",\"args\":{";
+			for (int counter = 0; counter < RENDER_COUNTER_COUNT; ++counter) {
+				file << (counter > 0 ? "," : "") << "\"" << getCounterName(static_cast<RenderCounter>(counter)) << "\":" << event.counters[counter];
+			}
+			file << "}}";
+		}
+	}
+	file << "\n]}\n";
+
+	if (!file) {
+		error = "Could not write the trace to " + path + ".";
+		return false;
+	}
+	return true;
+}
+
+void RenderProfiler::beginFrame() {
+	inFrame = isEnabled();
+	if (!inFrame) {
+		return;
+	}
+
+	frameStart = Clock::now();
+	std::fill(std::begin(stageTimes), std::end(stageTimes), 0.0);
+	std::fill(std::begin(counters), std::end(counters), 0);
+}
+
+void RenderProfiler::endFrame() {
+	if (!inFrame) {
+		return;
+	}
+
+	Clock::time_point end = Clock::now();
+	addTime(RENDER_STAGE_FRAME, frameStart, end);
+	inFrame = false;
+
+	for (int stage = 0; stage < RENDER_STAGE_COUNT; ++stage) {
+		stageHistory[stage][historyIndex] = static_cast<float>(stageTimes[stage]);
+	}
+	for (int counter = 0; counter < RENDER_COUNTER_COUNT; ++counter) {
+		counterHistory[counter][historyIndex] = static_cast<float>(counters[counter]);
+	}
+	historyIndex = (historyIndex + 1) % HISTORY_SIZE;
+	historyCount = std::min<size_t>(historyCount + 1, HISTORY_SIZE);
+
+	if (recording && trace.size() < MAX_TRACE_EVENTS) {
+		TraceEvent event;
+		event.stage = -1;
+		event.start = std::chrono::duration_cast<std::chrono::microseconds>(end - recordingStart).count();
+		event.duration = 0;
+		std::copy(std::begin(counters), std::end(counters), event.counters);
+		trace.push_back(event);
+	}
+}
+
+void RenderProfiler::addTime(RenderStage stage, Clock::time_point start, Clock::time_point end) {
+	// Stages outside of a canvas frame (like uploads for the palettes) are not ours
+	if (!inFrame) {
+		return;
+	}
+
+	stageTimes[stage] += std::chrono::duration<double, std::milli>(end - start).count();
+
+	if (recording && trace.size() < MAX_TRACE_EVENTS) {
+		TraceEvent event;
+		event.stage = stage;
+		event.start = std::chrono::duration_cast<std::chrono::microseconds>(start - recordingStart).count();
+		event.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		trace.push_back(event);
+	}
+}
+
+double RenderProfiler::percentile(const float* history, double p) const {
+	if (historyCount == 0) {
+		return 0.0;
+	}
+
+	std::vector<float> values(history, history + historyCount);
+	size_t index = std::min<size_t>(static_cast<size_t>(p * values.size()), values.size() - 1);
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+std::vector<std::string> RenderProfiler::getSummary() const {
+	std::vector<std::string> lines;
+	char line[128];
+
+	snprintf(line, sizeof(line), "Last %zu frames%s", historyCount, recording ? " (recording trace)" : "");
+	lines.push_back(line);
+	for (int stage = 0; stage < RENDER_STAGE_COUNT; ++stage) {
+		const float* history = stageHistory[stage];
+		snprintf(line, sizeof(line), "%-20s p50 %7.2f ms  p99 %7.2f ms", getStageName(static_cast<RenderStage>(stage)), percentile(history, 0.5), percentile(history, 0.99));
+		lines.push_back(line);
+	}
+	for (int counter = 0; counter < RENDER_COUNTER_COUNT; ++counter) {
+		const float* history = counterHistory[counter];
+		snprintf(line, sizeof(line), "%-20s p50 %7.0f     p99 %7.0f", getCounterName(static_cast<RenderCounter>(counter)), percentile(history, 0.5), percentile(history, 0.99));
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+const char* RenderProfiler::getStageName(RenderStage stage) {
+	switch (stage) {
+		case RENDER_STAGE_FRAME:
+			return "Frame";
+		case RENDER_STAGE_BACKGROUND:
+			return "DrawBackground";
+		case RENDER_STAGE_MAP:
+			return "DrawMap";
+		case RENDER_STAGE_LIGHT:
+			return "DrawLight";
+		case RENDER_STAGE_HIGHER_FLOORS:
+			return "DrawHigherFloors";
+		case RENDER_STAGE_LIVE_CURSORS:
+			return "DrawLiveCursors";
+		case RENDER_STAGE_TOOLTIPS:
+			return "DrawTooltips";
+		case RENDER_STAGE_TEXTURE_UPLOAD:
+			return "Texture upload";
+		case RENDER_STAGE_GARBAGE_COLLECTION:
+			return "Garbage collection";
+		case RENDER_STAGE_SWAP:
+			return "SwapBuffers";
+		default:
+			return "Unknown";
+	}
+}
+
+const char* RenderProfiler::getCounterName(RenderCounter counter) {
+	switch (counter) {
+		case RENDER_COUNTER_TILES:
+			return "Tiles visited";
+		case RENDER_COUNTER_SPRITES:
+			return "Sprites blitted";
+		case RENDER_COUNTER_TEXTURE_BINDS:
+			return "Texture binds";
+		case RENDER_COUNTER_TEXTURE_UPLOADS:
+			return "Textures uploaded";
+		default:
+			return "Unknown";
+	}
+}
@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_RENDER_PROFILER_H_
+#define RME_RENDER_PROFILER_H_
+
+#include <chrono>
+#include <vector>
+
+enum RenderStage {
+	RENDER_STAGE_FRAME,
+	RENDER_STAGE_BACKGROUND,
+	RENDER_STAGE_MAP,
+	RENDER_STAGE_LIGHT,
+	RENDER_STAGE_HIGHER_FLOORS,
+	RENDER_STAGE_LIVE_CURSORS,
+	RENDER_STAGE_TOOLTIPS,
+	RENDER_STAGE_TEXTURE_UPLOAD,
+	RENDER_STAGE_GARBAGE_COLLECTION,
+	RENDER_STAGE_SWAP,
+	RENDER_STAGE_COUNT,
+};
+
+enum RenderCounter {
+	RENDER_COUNTER_TILES,
+	RENDER_COUNTER_SPRITES,
+	RENDER_COUNTER_TEXTURE_BINDS,
+	RENDER_COUNTER_TEXTURE_UPLOADS,
+	RENDER_COUNTER_COUNT,
+};
+
+// Times the stages of every map canvas frame and counts what they did. Stage
+// times are summed per frame, so a stage that runs inside another one (like
+// texture uploads inside the map) is also part of the outer stage's time.
+// Nothing is measured unless the overlay is shown or a trace is recorded.
+class RenderProfiler {
+public:
+	RenderProfiler();
+
+	typedef std::chrono::steady_clock Clock;
+
+	bool isEnabled() const {
+		return overlay || recording;
+	}
+
+	bool isOverlayVisible() const {
+		return overlay;
+	}
+	void setOverlayVisible(bool visible);
+
+	bool isRecording() const {
+		return recording;
+	}
+	void startRecording();
+	void stopRecording();
+	// Writes the recorded session as Chrome trace JSON (chrome://tracing, Perfetto)
+	bool saveTrace(const wxString& path, wxString& error) const;
+
+	void beginFrame();
+	void endFrame();
+
+	void addTime(RenderStage stage, Clock::time_point start, Clock::time_point end);
+	void count(RenderCounter counter, uint32_t amount = 1) {
+		if (inFrame) {
+			counters[counter] += amount;
+		}
+	}
+
+	// Rolling percentiles over the last frames, one line per stage and counter
+	std::vector<std::string> getSummary() const;
+
+	static const char* getStageName(RenderStage stage);
+	static const char* getCounterName(RenderCounter counter);
+
+private:
+	enum {
+		HISTORY_SIZE = 240,
+		MAX_TRACE_EVENTS = 2000000,
+	};
+
+	struct TraceEvent {
+		int stage; // -1 for the counters of a frame
+		uint64_t start; // microseconds since the recording started
+		uint64_t duration;
+		uint32_t counters[RENDER_COUNTER_COUNT];
+	};
+
+	double percentile(const float* history, double p) const;
+
+	bool overlay;
+	bool recording;
+	bool inFrame;
+
+	Clock::time_point recordingStart;
+	Clock::time_point frameStart;
+
+	double stageTimes[RENDER_STAGE_COUNT];
+	uint32_t counters[RENDER_COUNTER_COUNT];
+
+	// Ring buffers, milliseconds for stages
+	float stageHistory[RENDER_STAGE_COUNT][HISTORY_SIZE];
+	float counterHistory[RENDER_COUNTER_COUNT][HISTORY_SIZE];
+	size_t historyIndex;
+	size_t historyCount;
+
+	std::vector<TraceEvent> trace;
+};
+
+extern RenderProfiler g_render_profiler;
+
+// Adds the time until the end of the scope to a stage of the current frame
+class RenderProfileScope {
+public:
+	explicit RenderProfileScope(RenderStage stage) :
+		stage(stage), active(g_render_profiler.isEnabled()) {
+		if (active) {
+			start = RenderProfiler::Clock::now();
+		}
+	}
+	~RenderProfileScope() {
+		if (active) {
+			g_render_profiler.addTime(stage, start, RenderProfiler::Clock::now());
+		}
+	}
+
+private:
+	RenderStage stage;
+	bool active;
+	RenderProfiler::Clock::time_point start;
+};
+
+#endif
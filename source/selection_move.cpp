@@ -0,0 +1,405 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "selection_move.h"
+#include "editor.h"
+#include "map.h"
+#include "action.h"
+#include "settings.h"
+#include "creature.h"
+
+namespace {
+	void setTileHouse(Map& map, Tile* tile, uint32_t houseId) {
+		if (tile->getHouseID() == houseId) {
+			return;
+		}
+		if (House* house = map.houses.getHouse(tile->getHouseID())) {
+			house->removeTile(tile);
+		}
+		tile->setHouseID(houseId);
+		if (House* house = map.houses.getHouse(houseId)) {
+			house->addTile(tile);
+		}
+	}
+
+	void setTileZones(Tile* tile, const std::vector<uint16_t>& zoneIds) {
+		tile->clearZoneId();
+		for (uint16_t zoneId : zoneIds) {
+			tile->addZoneId(zoneId);
+		}
+	}
+
+	uint64_t getPositionKey(int x, int y, int z) {
+		return (uint64_t(z) << 32) | (uint64_t(uint16_t(y)) << 16) | uint16_t(x);
+	}
+
+	bool containsKey(const std::vector<uint64_t>& keys, uint64_t key) {
+		return std::binary_search(keys.begin(), keys.end(), key);
+	}
+}
+
+SelectionMove::Entry::Entry() :
+	ground(false),
+	creature(false),
+	spawn(false),
+	houseId(0),
+	oldGround(nullptr),
+	oldCreature(nullptr),
+	oldSpawn(nullptr),
+	oldHouseId(0),
+	oldMapFlags(0) {
+	////
+}
+
+SelectionMove::SelectionMove(const Position& offset, bool merge) :
+	offset(offset),
+	merge(merge),
+	groundMoved(false),
+	recorded(false) {
+	////
+}
+
+SelectionMove::~SelectionMove() {
+	// Only a committed move holds what it took off the destinations
+	for (Entry& entry : entries) {
+		delete entry.oldGround;
+		for (Item* item : entry.oldItems) {
+			delete item;
+		}
+		delete entry.oldCreature;
+		delete entry.oldSpawn;
+	}
+}
+
+SelectionMove* SelectionMove::create(Editor& editor, const Position& offset) {
+	SelectionMove* move = newd SelectionMove(offset, g_settings.getInteger(Config::MERGE_MOVE) != 0);
+	move->entries.reserve(editor.selection.size());
+
+	for (Tile* tile : editor.selection) {
+		Entry entry;
+		entry.from = tile->getPosition();
+		entry.ground = tile->ground && tile->ground->isSelected();
+		entry.creature = tile->creature && tile->creature->isSelected();
+		entry.spawn = tile->spawn && tile->spawn->isSelected();
+
+		bool supported = tile->items.size() <= 0xFFFF && (entry.from - offset).isValid();
+		for (size_t index = 0; supported && index < tile->items.size(); ++index) {
+			Item* item = tile->items[index];
+			if (item->isSelected()) {
+				// Dropping these creates or deletes a ground, which can't be undone by moving it back
+				supported = !item->isGroundTile() && item->getGroundEquivalent() == 0;
+				entry.sourceIndexes.push_back(static_cast<uint16_t>(index));
+			}
+		}
+		if (!supported) {
+			delete move;
+			return nullptr;
+		}
+
+		if (entry.ground || entry.creature || entry.spawn || !entry.sourceIndexes.empty()) {
+			move->groundMoved = move->groundMoved || entry.ground;
+			move->entries.push_back(std::move(entry));
+		}
+	}
+	return move;
+}
+
+void SelectionMove::commit(Editor& editor, DirtyList* dirty_list) {
+	Map& map = editor.map;
+	std::vector<Lifted> lifted(entries.size());
+
+	// Everything is lifted first, a destination can be the source of another entry
+	for (size_t i = 0; i < entries.size(); ++i) {
+		Entry& entry = entries[i];
+		Lifted& moving = lifted[i];
+		Tile* tile = map.getTile(entry.from);
+		ASSERT(tile);
+
+		if (entry.ground) {
+			moving.ground = tile->ground;
+			tile->ground = nullptr;
+			entry.houseId = tile->getHouseID();
+			setTileHouse(map, tile, 0);
+			entry.zoneIds = tile->getZoneIds();
+			tile->clearZoneId();
+		}
+		// Back to front, so the indexes before stay valid
+		for (auto it = entry.sourceIndexes.rbegin(); it != entry.sourceIndexes.rend(); ++it) {
+			moving.items.push_back(tile->items[*it]);
+			tile->items.erase(tile->items.begin() + *it);
+		}
+		std::reverse(moving.items.begin(), moving.items.end());
+		if (entry.spawn) {
+			map.removeSpawn(tile);
+			moving.spawn = tile->spawn;
+			tile->spawn = nullptr;
+		}
+		if (entry.creature) {
+			moving.creature = tile->creature;
+			tile->creature = nullptr;
+		}
+	}
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+		Entry& entry = entries[i];
+		Lifted& moving = lifted[i];
+		const Position to = entry.from - offset;
+		Tile* tile = map.getTile(to);
+		if (!tile) {
+			tile = map.allocator(map.createTileL(to));
+			map.setTile(to, tile);
+		}
+
+		if (replaces(entry)) {
+			entry.oldGround = tile->ground;
+			tile->ground = nullptr;
+			entry.oldItems.swap(tile->items);
+			if (tile->spawn) {
+				map.removeSpawn(tile);
+			}
+			entry.oldSpawn = tile->spawn;
+			tile->spawn = nullptr;
+			entry.oldCreature = tile->creature;
+			tile->creature = nullptr;
+			entry.oldHouseId = tile->getHouseID();
+			entry.oldMapFlags = tile->getMapFlags();
+			tile->unsetMapFlags(entry.oldMapFlags);
+			entry.oldZoneIds = tile->getZoneIds();
+
+			setTileHouse(map, tile, entry.houseId);
+			setTileZones(tile, entry.zoneIds);
+		} else {
+			// Same as Tile::merge
+			entry.oldHouseId = tile->getHouseID();
+			if (entry.houseId != 0) {
+				setTileHouse(map, tile, entry.houseId);
+			}
+			if (entry.ground) {
+				entry.oldGround = tile->ground;
+				tile->ground = nullptr;
+			}
+			if (entry.creature) {
+				entry.oldCreature = tile->creature;
+				tile->creature = nullptr;
+			}
+			if (entry.spawn && tile->spawn) {
+				map.removeSpawn(tile);
+				entry.oldSpawn = tile->spawn;
+				tile->spawn = nullptr;
+			}
+		}
+
+		if (moving.ground) {
+			tile->ground = moving.ground;
+		}
+		if (moving.creature) {
+			tile->creature = moving.creature;
+		}
+		if (moving.spawn) {
+			tile->spawn = moving.spawn;
+			map.addSpawn(tile);
+		}
+		for (size_t index = 0; index < moving.items.size(); ++index) {
+			if (!recorded) {
+				entry.destIndexes.push_back(static_cast<uint16_t>(tile->getInsertIndex(moving.items[index])));
+			}
+			tile->items.insert(tile->items.begin() + entry.destIndexes[index], moving.items[index]);
+		}
+	}
+
+	recorded = true;
+	finishTiles(editor, dirty_list);
+}
+
+void SelectionMove::undo(Editor& editor, DirtyList* dirty_list) {
+	Map& map = editor.map;
+	std::vector<Lifted> lifted(entries.size());
+
+	// Take the moved things off the destinations and put back what was there
+	for (size_t i = entries.size(); i-- > 0;) {
+		Entry& entry = entries[i];
+		Lifted& moving = lifted[i];
+		Tile* tile = map.getTile(entry.from - offset);
+		ASSERT(tile);
+
+		for (auto it = entry.destIndexes.rbegin(); it != entry.destIndexes.rend(); ++it) {
+			moving.items.push_back(tile->items[*it]);
+			tile->items.erase(tile->items.begin() + *it);
+		}
+		std::reverse(moving.items.begin(), moving.items.end());
+		if (entry.ground) {
+			moving.ground = tile->ground;
+			tile->ground = entry.oldGround;
+			entry.oldGround = nullptr;
+		}
+		if (entry.creature) {
+			moving.creature = tile->creature;
+			tile->creature = nullptr;
+		}
+		if (entry.spawn) {
+			map.removeSpawn(tile);
+			moving.spawn = tile->spawn;
+			tile->spawn = nullptr;
+		}
+
+		if (replaces(entry) || entry.creature) {
+			tile->creature = entry.oldCreature;
+			entry.oldCreature = nullptr;
+		}
+		if (entry.oldSpawn) {
+			tile->spawn = entry.oldSpawn;
+			entry.oldSpawn = nullptr;
+			map.addSpawn(tile);
+		}
+		if (replaces(entry)) {
+			tile->items.swap(entry.oldItems);
+			tile->setMapFlags(entry.oldMapFlags);
+			setTileZones(tile, entry.oldZoneIds);
+		}
+		setTileHouse(map, tile, entry.oldHouseId);
+	}
+
+	// Then put them back where they came from
+	for (size_t i = entries.size(); i-- > 0;) {
+		Entry& entry = entries[i];
+		Lifted& moving = lifted[i];
+		Tile* tile = map.getTile(entry.from);
+		ASSERT(tile);
+
+		if (entry.ground) {
+			tile->ground = moving.ground;
+			setTileHouse(map, tile, entry.houseId);
+			setTileZones(tile, entry.zoneIds);
+		}
+		for (size_t index = 0; index < moving.items.size(); ++index) {
+			tile->items.insert(tile->items.begin() + entry.sourceIndexes[index], moving.items[index]);
+		}
+		if (entry.creature) {
+			tile->creature = moving.creature;
+		}
+		if (entry.spawn) {
+			tile->spawn = moving.spawn;
+			map.addSpawn(tile);
+		}
+	}
+
+	finishTiles(editor, dirty_list);
+}
+
+void SelectionMove::finishTiles(Editor& editor, DirtyList* dirty_list) {
+	Map& map = editor.map;
+	const bool live = editor.IsLiveServer() && dirty_list;
+
+	auto finish = [&](const Position& position) {
+		Tile* tile = map.getTile(position);
+		if (!tile) {
+			return;
+		}
+
+		tile->update();
+		tile->modify();
+		if (tile->isSelected()) {
+			editor.selection.addInternal(tile);
+		} else {
+			editor.selection.removeInternal(tile);
+		}
+
+		map.touchTile(position);
+		if (groundMoved) {
+			map.zonesChanged(position.x, position.y, position.z);
+		}
+		if (live) {
+			dirty_list->AddPosition(position.x, position.y, position.z);
+		}
+	};
+
+	for (const Entry& entry : entries) {
+		finish(entry.from);
+		finish(entry.from - offset);
+	}
+}
+
+void SelectionMove::getFringe(BaseMap& map, TileList& tiles) const {
+	std::vector<uint64_t> destinations;
+	destinations.reserve(entries.size());
+	for (const Entry& entry : entries) {
+		const Position to = entry.from - offset;
+		destinations.push_back(getPositionKey(to.x, to.y, to.z));
+	}
+	std::sort(destinations.begin(), destinations.end());
+
+	std::vector<uint64_t> fringe;
+	auto addAround = [&](const Position& position) {
+		for (int y = position.y - 1; y <= position.y + 1; ++y) {
+			for (int x = position.x - 1; x <= position.x + 1; ++x) {
+				if (x < 0 || y < 0) {
+					continue;
+				}
+				const uint64_t key = getPositionKey(x, y, position.z);
+				if (containsKey(destinations, key)) {
+					// Moved together with all of its neighbours
+					bool inside = true;
+					for (int ny = y - 1; inside && ny <= y + 1; ++ny) {
+						for (int nx = x - 1; inside && nx <= x + 1; ++nx) {
+							inside = containsKey(destinations, getPositionKey(nx, ny, position.z));
+						}
+					}
+					if (inside) {
+						continue;
+					}
+				}
+				fringe.push_back(key);
+			}
+		}
+	};
+	for (const Entry& entry : entries) {
+		addAround(entry.from);
+		addAround(entry.from - offset);
+	}
+
+	std::sort(fringe.begin(), fringe.end());
+	fringe.erase(std::unique(fringe.begin(), fringe.end()), fringe.end());
+	for (uint64_t key : fringe) {
+		Tile* tile = map.getTile(key & 0xFFFF, (key >> 16) & 0xFFFF, key >> 32);
+		if (tile) {
+			tiles.push_back(tile);
+		}
+	}
+}
+
+uint32_t SelectionMove::memsize() const {
+	uint32_t mem = sizeof(*this) + entries.capacity() * sizeof(Entry);
+	for (const Entry& entry : entries) {
+		mem += (entry.sourceIndexes.capacity() + entry.destIndexes.capacity() + entry.zoneIds.capacity() + entry.oldZoneIds.capacity()) * sizeof(uint16_t);
+		if (entry.oldGround) {
+			mem += entry.oldGround->memsize();
+		}
+		for (const Item* item : entry.oldItems) {
+			mem += item->memsize();
+		}
+		mem += entry.oldItems.capacity() * sizeof(Item*);
+		if (entry.oldCreature) {
+			mem += sizeof(Creature);
+		}
+		if (entry.oldSpawn) {
+			mem += sizeof(Spawn);
+		}
+	}
+	return mem;
+}
@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_SELECTION_MOVE_H_
+#define RME_SELECTION_MOVE_H_
+
+#include "position.h"
+
+class Editor;
+class BaseMap;
+class DirtyList;
+
+// A selection move recorded as things changing tiles. Committing it lifts
+// the selected items, creatures and spawns off their tiles and drops them
+// on the tiles they were moved to, in place, without copying any tile.
+// Undo moves them back. Only stack indexes are recorded, not the tiles or
+// moved items, so the record stays valid when undoing other actions brings
+// back different objects with the same contents.
+class SelectionMove {
+public:
+	~SelectionMove();
+
+	// Plans moving the selection of the editor, nullptr when the selection
+	// holds something that can't be moved in place, like items that turn
+	// into grounds, the caller copies the tiles then
+	static SelectionMove* create(Editor& editor, const Position& offset);
+
+	void commit(Editor& editor, DirtyList* dirty_list);
+	void undo(Editor& editor, DirtyList* dirty_list);
+
+	// Tiles whose borders, walls, tables and carpets have to be redone after
+	// the move. Tiles surrounded by moved tiles took theirs along.
+	void getFringe(BaseMap& map, TileList& tiles) const;
+	bool movesGround() const {
+		return groundMoved;
+	}
+
+	size_t size() const {
+		return entries.size();
+	}
+	uint32_t memsize() const;
+
+protected:
+	SelectionMove(const Position& offset, bool merge);
+
+	// What moved away from one tile
+	struct Entry {
+		Entry();
+
+		Position from;
+		// Indexes in the item stack of the source tile, ascending, and in the
+		// stack of the destination tile in the order the items were dropped
+		std::vector<uint16_t> sourceIndexes;
+		std::vector<uint16_t> destIndexes;
+		bool ground;
+		bool creature;
+		bool spawn;
+		// Moved along with the ground
+		uint32_t houseId;
+		std::vector<uint16_t> zoneIds;
+
+		// What the move took off the destination tile, kept while the move
+		// is committed. A moved ground replaces the whole destination unless
+		// moves merge, then only what is moved onto it is replaced.
+		Item* oldGround;
+		ItemVector oldItems;
+		Creature* oldCreature;
+		Spawn* oldSpawn;
+		uint32_t oldHouseId;
+		uint16_t oldMapFlags;
+		std::vector<uint16_t> oldZoneIds;
+	};
+
+	// Things between being lifted and dropped
+	struct Lifted {
+		Lifted() :
+			ground(nullptr), creature(nullptr), spawn(nullptr) { }
+		Item* ground;
+		ItemVector items;
+		Creature* creature;
+		Spawn* spawn;
+	};
+
+	bool replaces(const Entry& entry) const {
+		return entry.ground && !merge;
+	}
+	void finishTiles(Editor& editor, DirtyList* dirty_list);
+
+	std::vector<Entry> entries;
+	Position offset;
+	bool merge;
+	bool groundMoved;
+	// Destination indexes are known after the first commit
+	bool recorded;
+};
+
+#endif
@@ -248,6 +248,8 @@ void Settings::IO(IOMode mode) {
 	Int(MERGE_PASTE, 0);
 	Int(UNDO_SIZE, 40);
 	Int(UNDO_MEM_SIZE, 64);
+	Int(UNDO_DISK_SIZE, 2048);
+	Int(USE_DATA_CACHE, 1);
 	Int(GROUP_ACTIONS, 1);
 	Int(SELECTION_TYPE, SELECT_CURRENT_FLOOR);
 	Int(COMPENSATED_SELECT, 1);
@@ -290,9 +292,7 @@ void Settings::IO(IOMode mode) {
 
 	section("Graphics");
 	Int(TEXTURE_MANAGEMENT, 1);
-	Int(TEXTURE_CLEAN_PULSE, 15);
-	Int(TEXTURE_LONGEVITY, 20);
-	Int(TEXTURE_CLEAN_THRESHOLD, 2500);
+	Int(TEXTURE_MEMORY_BUDGET, 256);
 	Int(SOFTWARE_CLEAN_THRESHOLD, 1800);
 	Int(SOFTWARE_CLEAN_SIZE, 500);
 	Int(ICON_BACKGROUND, 0);
@@ -304,6 +304,7 @@ void Settings::IO(IOMode mode) {
 	Int(MINIMAP_UPDATE_DELAY, 333);
 	Int(MINIMAP_VIEW_BOX, 1);
 	String(MINIMAP_EXPORT_DIR, "");
+	String(MINIMAP_EXPORT_FORMAT, "bmp");
 	String(TILESET_EXPORT_DIR, "");
 
 	Int(CURSOR_RED, 0);
@@ -413,6 +414,11 @@ void Settings::IO(IOMode mode) {
 	Int(GRID_CHUNK_SIZE, 3000);
 	Int(GRID_VISIBLE_ROWS_MARGIN, 30);
 
+	// Live session log, level is 0 debug, 1 info, 2 warning, 3 error, 4 none
+	section("LiveLog");
+	Int(LIVE_LOG_LEVEL, 1);
+	Int(LIVE_LOG_STATS_INTERVAL, 5);
+
 #undef section
 #undef Int
 #undef IntToSave
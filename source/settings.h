@@ -31,9 +31,7 @@ namespace Config {
 
 		MERGE_MOVE,
 		TEXTURE_MANAGEMENT,
-		TEXTURE_CLEAN_PULSE,
-		TEXTURE_CLEAN_THRESHOLD,
-		TEXTURE_LONGEVITY,
+		TEXTURE_MEMORY_BUDGET,
 		HARD_REFRESH_RATE,
 		USE_MEMCACHED_SPRITES,
 		USE_MEMCACHED_SPRITES_TO_SAVE,
@@ -227,6 +225,19 @@ namespace Config {
 		// Website link control setting
 		LAST_WEBSITES_OPEN_TIME,
 
+		// Live session log
+		LIVE_LOG_LEVEL,
+		LIVE_LOG_STATS_INTERVAL,
+
+		// Minimap export
+		MINIMAP_EXPORT_FORMAT,
+
+		// Undo history spilled to disk
+		UNDO_DISK_SIZE,
+
+		// Binary cache of the data files
+		USE_DATA_CACHE,
+
 		LAST,
 	};
 
@@ -0,0 +1,604 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "shared_clipboard.h"
+#include "basemap.h"
+#include "tile.h"
+#include "item.h"
+#include "creature.h"
+#include "spawn.h"
+#include "iomap.h"
+#include "iomap_otbm.h"
+#include "filehandle.h"
+
+#include <boost/interprocess/mapped_region.hpp>
+#ifdef __WINDOWS__
+	#include <boost/interprocess/windows_shared_memory.hpp>
+	#include <windows.h>
+#else
+	#include <boost/interprocess/shared_memory_object.hpp>
+	#include <cerrno>
+	#include <signal.h>
+	#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace bip = boost::interprocess;
+
+namespace {
+	const char* const CONTROL_NAME = "rme_clipboard_control";
+	const char* const BLOCK_PREFIX = "rme_clipboard_";
+
+	const uint32_t CLIPBOARD_MAGIC = 0x434D4552; // "RMEC"
+	const uint32_t CLIPBOARD_LAYOUT = 2;
+	const int SECTOR_BITS = 6;
+	const int MAX_INSTANCES = 32;
+	// A lock held longer than this belongs to a hung instance
+	const auto LOCK_TIMEOUT = std::chrono::seconds(2);
+
+	static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free, "the control block is shared between processes");
+
+	struct ClipboardControl {
+		uint32_t magic;
+		uint32_t layout;
+		std::atomic<uint32_t> lockOwner; // process id, 0 when free
+		std::atomic<uint32_t> instances[MAX_INSTANCES]; // process ids of the running instances
+		std::atomic<uint64_t> generation; // of the current block, 0 when there is none
+		// The current block, only read and written under the lock
+		uint64_t blockSize;
+		uint32_t publisher;
+		uint32_t otbmVersion;
+		uint32_t clientVersion;
+		int32_t x, y, z; // upper left corner of the copied area
+	};
+
+	struct ClipboardBlock {
+		uint32_t magic;
+		uint32_t sectorCount;
+		uint32_t tileCount;
+		uint32_t reserved;
+		uint64_t generation;
+	};
+
+	struct ClipboardSector {
+		uint32_t x, y, z; // in sectors
+		uint32_t tileCount;
+		uint64_t offset; // of the OTBM node stream, from the start of the block
+		uint64_t size;
+		uint64_t extrasOffset; // creatures and spawns of the sector
+		uint64_t extrasSize;
+	};
+
+#ifdef __WINDOWS__
+	// Backed by the paging file rather than a file on disk, it is gone once
+	// the last instance holding it closes it
+	typedef bip::windows_shared_memory SharedMemory;
+
+	std::unique_ptr<SharedMemory> createMemory(const std::string& name, uint64_t size, bool openExisting) {
+		if (openExisting) {
+			return std::unique_ptr<SharedMemory>(newd SharedMemory(bip::open_or_create, name.c_str(), bip::read_write, size));
+		}
+		return std::unique_ptr<SharedMemory>(newd SharedMemory(bip::create_only, name.c_str(), bip::read_write, size));
+	}
+
+	void removeMemory(const std::string& name) {
+		// Released with the last handle
+	}
+
+	uint32_t getProcessId() {
+		return GetCurrentProcessId();
+	}
+
+	bool isProcessRunning(uint32_t processId) {
+		HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, processId);
+		if (!process) {
+			return GetLastError() == ERROR_ACCESS_DENIED;
+		}
+		const bool running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+		CloseHandle(process);
+		return running;
+	}
+#else
+	typedef bip::shared_memory_object SharedMemory;
+
+	std::unique_ptr<SharedMemory> createMemory(const std::string& name, uint64_t size, bool openExisting) {
+		std::unique_ptr<SharedMemory> memory;
+		if (openExisting) {
+			memory.reset(newd SharedMemory(bip::open_or_create, name.c_str(), bip::read_write));
+		} else {
+			memory.reset(newd SharedMemory(bip::create_only, name.c_str(), bip::read_write));
+		}
+		bip::offset_t current = 0;
+		if (!memory->get_size(current) || static_cast<uint64_t>(current) < size) {
+			memory->truncate(size);
+		}
+		return memory;
+	}
+
+	void removeMemory(const std::string& name) {
+		SharedMemory::remove(name.c_str());
+	}
+
+	uint32_t getProcessId() {
+		return static_cast<uint32_t>(getpid());
+	}
+
+	bool isProcessRunning(uint32_t processId) {
+		return kill(static_cast<pid_t>(processId), 0) == 0 || errno == EPERM;
+	}
+#endif
+
+	std::string getBlockName(uint64_t generation) {
+		return BLOCK_PREFIX + std::to_string(generation);
+	}
+
+	// Spin lock in the control block. The lock of an instance that crashed,
+	// or that held it for longer than LOCK_TIMEOUT, is taken over so the
+	// other instances keep working.
+	class ClipboardLock {
+	public:
+		ClipboardLock(ClipboardControl& control, uint32_t processId) :
+			control(control), processId(processId) {
+			const auto started = std::chrono::steady_clock::now();
+			for (;;) {
+				uint32_t owner = 0;
+				if (control.lockOwner.compare_exchange_strong(owner, processId)) {
+					break;
+				}
+				if (owner == processId || !isProcessRunning(owner) || std::chrono::steady_clock::now() - started > LOCK_TIMEOUT) {
+					if (control.lockOwner.compare_exchange_strong(owner, processId)) {
+						break;
+					}
+				} else {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}
+		}
+		~ClipboardLock() {
+			// A no-op if another instance took the lock over meanwhile
+			uint32_t owner = processId;
+			control.lockOwner.compare_exchange_strong(owner, 0);
+		}
+
+	private:
+		ClipboardControl& control;
+		uint32_t processId;
+	};
+
+	template <typename T>
+	void append(std::vector<uint8_t>& buffer, const T& value) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T>
+	bool consume(const uint8_t*& cursor, const uint8_t* end, T& value) {
+		if (end - cursor < static_cast<ptrdiff_t>(sizeof(T))) {
+			return false;
+		}
+		memcpy(&value, cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	// Same node layout as the live protocol, which follows OTBM
+	void writeTile(MemoryNodeFileWriteHandle& writer, const IOMap& iomap, Tile* tile) {
+		writer.addNode(tile->isHouseTile() ? OTBM_HOUSETILE : OTBM_TILE);
+		writer.addU16(tile->getX());
+		writer.addU16(tile->getY());
+		writer.addU8(tile->getZ());
+		if (tile->isHouseTile()) {
+			writer.addU32(tile->getHouseID());
+		}
+
+		if (tile->getMapFlags()) {
+			writer.addByte(OTBM_ATTR_TILE_FLAGS);
+			writer.addU32(tile->getMapFlags());
+			if (tile->getMapFlags() & TILESTATE_ZONE_BRUSH) {
+				for (uint16_t zoneId : tile->getZoneIds()) {
+					writer.addU16(zoneId);
+				}
+				writer.addU16(0);
+			}
+		}
+
+		if (tile->ground) {
+			if (tile->ground->isComplex()) {
+				tile->ground->serializeItemNode_OTBM(iomap, writer);
+			} else {
+				writer.addByte(OTBM_ATTR_ITEM);
+				tile->ground->serializeItemCompact_OTBM(iomap, writer);
+			}
+		}
+		for (Item* item : tile->items) {
+			item->serializeItemNode_OTBM(iomap, writer);
+		}
+		writer.endNode();
+	}
+
+	Tile* readTile(BinaryNode* node, const IOMap& iomap, BaseMap& map) {
+		uint8_t type;
+		uint16_t x, y;
+		uint8_t z;
+		if (!node->getByte(type) || (type != OTBM_TILE && type != OTBM_HOUSETILE) || !node->getU16(x) || !node->getU16(y) || !node->getU8(z)) {
+			return nullptr;
+		}
+
+		uint32_t houseId = 0;
+		if (type == OTBM_HOUSETILE && !node->getU32(houseId)) {
+			return nullptr;
+		}
+
+		Tile* tile = map.allocator(map.createTileL(x, y, z));
+		tile->house_id = houseId;
+
+		uint8_t attribute;
+		while (node->getU8(attribute)) {
+			if (attribute == OTBM_ATTR_TILE_FLAGS) {
+				uint32_t flags = 0;
+				node->getU32(flags);
+				if (flags & TILESTATE_ZONE_BRUSH) {
+					uint16_t zoneId = 0;
+					while (node->getU16(zoneId) && zoneId != 0) {
+						tile->addZoneId(zoneId);
+					}
+				}
+				tile->setMapFlags(flags);
+			} else if (attribute == OTBM_ATTR_ITEM) {
+				Item* item = Item::Create_OTBM(iomap, node);
+				if (item) {
+					tile->addItem(item);
+				}
+			} else {
+				break;
+			}
+		}
+
+		for (BinaryNode* itemNode = node->getChild(); itemNode; itemNode = itemNode->advance()) {
+			uint8_t itemType;
+			if (!itemNode->getByte(itemType) || itemType != OTBM_ITEM) {
+				continue;
+			}
+			Item* item = Item::Create_OTBM(iomap, itemNode);
+			if (item) {
+				item->unserializeItemNode_OTBM(iomap, itemNode);
+				tile->addItem(item);
+			}
+		}
+		return tile;
+	}
+}
+
+struct SharedClipboard::Memory {
+	std::unique_ptr<SharedMemory> controlMemory;
+	bip::mapped_region controlRegion;
+	ClipboardControl* control = nullptr;
+	// Our last published block, on Windows it lives as long as a handle does
+	std::unique_ptr<SharedMemory> block;
+};
+
+SharedClipboard::SharedClipboard() :
+	processId(getProcessId()),
+	lastGeneration(0) {
+	// Unique enough between the instances of one user
+	std::random_device device;
+	nextGeneration = (uint64_t(device()) << 32) ^ device();
+
+	// Mapped once, everything polled later only reads from the mapping
+	try {
+		std::unique_ptr<Memory> mapped(newd Memory());
+		mapped->controlMemory = createMemory(CONTROL_NAME, sizeof(ClipboardControl), true);
+		mapped->controlRegion = bip::mapped_region(*mapped->controlMemory, bip::read_write, 0, sizeof(ClipboardControl));
+		mapped->control = static_cast<ClipboardControl*>(mapped->controlRegion.get_address());
+
+		ClipboardControl& control = *mapped->control;
+		ClipboardLock lock(control, processId);
+		if (control.magic != CLIPBOARD_MAGIC || control.layout != CLIPBOARD_LAYOUT) {
+			control.generation = 0;
+			for (std::atomic<uint32_t>& instance : control.instances) {
+				instance = 0;
+			}
+			control.magic = CLIPBOARD_MAGIC;
+			control.layout = CLIPBOARD_LAYOUT;
+		}
+
+		// Free slots and those of instances that crashed
+		for (std::atomic<uint32_t>& instance : control.instances) {
+			uint32_t owner = instance;
+			if ((owner == 0 || !isProcessRunning(owner)) && instance.compare_exchange_strong(owner, processId)) {
+				break;
+			}
+		}
+		memory = std::move(mapped);
+	} catch (bip::interprocess_exception&) {
+		memory.reset();
+	}
+}
+
+SharedClipboard::~SharedClipboard() {
+	if (!memory) {
+		return;
+	}
+
+	ClipboardControl& control = *memory->control;
+	for (std::atomic<uint32_t>& instance : control.instances) {
+		uint32_t owner = processId;
+		instance.compare_exchange_strong(owner, 0);
+	}
+
+#ifdef __WINDOWS__
+	// Our block goes away with us
+	ClipboardLock lock(control, processId);
+	if (control.publisher == processId) {
+		control.generation = 0;
+	}
+#endif
+}
+
+bool SharedClipboard::hasOtherInstances() const {
+	if (!memory) {
+		return false;
+	}
+	for (const std::atomic<uint32_t>& instance : memory->control->instances) {
+		const uint32_t owner = instance;
+		if (owner != 0 && owner != processId && isProcessRunning(owner)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t SharedClipboard::getGeneration() const {
+	return memory ? memory->control->generation.load() : 0;
+}
+
+bool SharedClipboard::publish(BaseMap& tiles, const Position& position, const MapVersion& version) {
+	if (!memory) {
+		return false;
+	}
+	VirtualIOMap iomap(version);
+
+	// Tiles grouped by sector, every sector is a stream of its own
+	std::map<std::tuple<int, int, int>, std::vector<Tile*>> sectors;
+	for (MapIterator it = tiles.begin(); it != tiles.end(); ++it) {
+		Tile* tile = (*it)->get();
+		if (tile) {
+			sectors[std::make_tuple(tile->getZ(), tile->getY() >> SECTOR_BITS, tile->getX() >> SECTOR_BITS)].push_back(tile);
+		}
+	}
+
+	std::vector<ClipboardSector> index;
+	std::vector<uint8_t> streams;
+	const uint64_t streamsOffset = sizeof(ClipboardBlock) + sectors.size() * sizeof(ClipboardSector);
+	uint32_t tileCount = 0;
+
+	MemoryNodeFileWriteHandle writer;
+	for (const auto& sector : sectors) {
+		std::vector<uint8_t> extras;
+		writer.reset();
+		writer.addNode(0);
+		for (Tile* tile : sector.second) {
+			writeTile(writer, iomap, tile);
+
+			if (tile->creature || tile->spawn) {
+				append<uint16_t>(extras, tile->getX());
+				append<uint16_t>(extras, tile->getY());
+				append<uint8_t>(extras, tile->getZ());
+				append<int32_t>(extras, tile->spawn ? tile->spawn->getSize() : 0);
+				const std::string name = tile->creature ? tile->creature->getName() : std::string();
+				append<uint16_t>(extras, name.size());
+				extras.insert(extras.end(), name.begin(), name.end());
+				append<uint8_t>(extras, tile->creature ? tile->creature->getDirection() : 0);
+				append<int32_t>(extras, tile->creature ? tile->creature->getSpawnTime() : 0);
+			}
+		}
+		writer.endNode();
+
+		ClipboardSector entry;
+		entry.z = std::get<0>(sector.first);
+		entry.y = std::get<1>(sector.first);
+		entry.x = std::get<2>(sector.first);
+		entry.tileCount = sector.second.size();
+		entry.offset = streamsOffset + streams.size();
+		entry.size = writer.getSize();
+		entry.extrasOffset = entry.offset + entry.size;
+		entry.extrasSize = extras.size();
+		index.push_back(entry);
+
+		streams.insert(streams.end(), writer.getMemory(), writer.getMemory() + writer.getSize());
+		streams.insert(streams.end(), extras.begin(), extras.end());
+		tileCount += entry.tileCount;
+	}
+
+	ClipboardBlock header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CLIPBOARD_MAGIC;
+	header.sectorCount = index.size();
+	header.tileCount = tileCount;
+	header.generation = ++nextGeneration;
+	const uint64_t blockSize = streamsOffset + streams.size();
+
+	try {
+		// A block of its own, readers of the previous one are not disturbed
+		// while it is filled
+		std::unique_ptr<SharedMemory> block = createMemory(getBlockName(header.generation), blockSize, false);
+		{
+			bip::mapped_region region(*block, bip::read_write, 0, blockSize);
+			uint8_t* base = static_cast<uint8_t*>(region.get_address());
+			memcpy(base, &header, sizeof(header));
+			memcpy(base + sizeof(ClipboardBlock), index.data(), index.size() * sizeof(ClipboardSector));
+			memcpy(base + streamsOffset, streams.data(), streams.size());
+		}
+
+		ClipboardControl& control = *memory->control;
+		ClipboardLock lock(control, processId);
+		const uint64_t previous = control.generation;
+		control.blockSize = blockSize;
+		control.publisher = processId;
+		control.otbmVersion = version.otbm;
+		control.clientVersion = version.client;
+		control.x = position.x;
+		control.y = position.y;
+		control.z = position.z;
+		control.generation = header.generation;
+		if (previous != 0) {
+			removeMemory(getBlockName(previous));
+		}
+		memory->block = std::move(block);
+	} catch (bip::interprocess_exception&) {
+		return false;
+	}
+
+	lastGeneration = header.generation;
+	return true;
+}
+
+bool SharedClipboard::hasNewer() const {
+	const uint64_t generation = getGeneration();
+	return generation != 0 && generation != lastGeneration;
+}
+
+bool SharedClipboard::fetch(const MapVersion& version, Position& position, wxString& error) {
+	if (!hasNewer()) {
+		return false;
+	}
+
+	try {
+		ClipboardControl& control = *memory->control;
+		ClipboardLock lock(control, processId);
+		const uint64_t generation = control.generation;
+		if (generation == 0 || generation == lastGeneration) {
+			return false;
+		}
+		lastGeneration = generation;
+		if (control.clientVersion != static_cast<uint32_t>(version.client)) {
+			error = "The shared clipboard was copied from a map of another client version.";
+			return false;
+		}
+
+		// Copied out so the publisher can replace the block at any time,
+		// the sectors are parsed when they are needed
+		std::unique_ptr<SharedMemory> block(newd SharedMemory(bip::open_only, getBlockName(generation).c_str(), bip::read_only));
+		bip::mapped_region region(*block, bip::read_only, 0, control.blockSize);
+		const uint8_t* base = static_cast<const uint8_t*>(region.get_address());
+		snapshot.assign(base, base + control.blockSize);
+		snapshotVersion = MapVersion(static_cast<MapVersionID>(control.otbmVersion), static_cast<ClientVersionID>(control.clientVersion));
+		position = Position(control.x, control.y, control.z);
+	} catch (bip::interprocess_exception&) {
+		releaseSnapshot();
+		return false;
+	}
+
+	ClipboardBlock header;
+	bool valid = snapshot.size() >= sizeof(ClipboardBlock);
+	if (valid) {
+		memcpy(&header, snapshot.data(), sizeof(header));
+		valid = header.magic == CLIPBOARD_MAGIC && sizeof(ClipboardBlock) + uint64_t(header.sectorCount) * sizeof(ClipboardSector) <= snapshot.size();
+	}
+	if (!valid) {
+		error = "The shared clipboard is damaged.";
+		releaseSnapshot();
+		return false;
+	}
+	return true;
+}
+
+void SharedClipboard::releaseSnapshot() {
+	snapshot.clear();
+	snapshot.shrink_to_fit();
+}
+
+size_t SharedClipboard::getSectorCount() const {
+	if (snapshot.empty()) {
+		return 0;
+	}
+	ClipboardBlock header;
+	memcpy(&header, snapshot.data(), sizeof(header));
+	return header.sectorCount;
+}
+
+uint32_t SharedClipboard::getTileCount() const {
+	if (snapshot.empty()) {
+		return 0;
+	}
+	ClipboardBlock header;
+	memcpy(&header, snapshot.data(), sizeof(header));
+	return header.tileCount;
+}
+
+void SharedClipboard::getSector(size_t index, Position& corner, uint32_t& tileCount) const {
+	ClipboardSector sector;
+	memcpy(&sector, snapshot.data() + sizeof(ClipboardBlock) + index * sizeof(ClipboardSector), sizeof(sector));
+	corner = Position(sector.x << SECTOR_BITS, sector.y << SECTOR_BITS, sector.z);
+	tileCount = sector.tileCount;
+}
+
+void SharedClipboard::readSector(size_t index, BaseMap& tiles) const {
+	ClipboardSector sector;
+	memcpy(&sector, snapshot.data() + sizeof(ClipboardBlock) + index * sizeof(ClipboardSector), sizeof(sector));
+	if (sector.offset + sector.size > snapshot.size() || sector.extrasOffset + sector.extrasSize > snapshot.size()) {
+		return;
+	}
+
+	VirtualIOMap iomap(snapshotVersion);
+	MemoryNodeFileReadHandle reader(snapshot.data() + sector.offset, sector.size);
+	BinaryNode* root = reader.getRootNode();
+	for (BinaryNode* node = root ? root->getChild() : nullptr; node; node = node->advance()) {
+		Tile* tile = readTile(node, iomap, tiles);
+		if (tile) {
+			tiles.setTile(tile);
+		}
+	}
+
+	const uint8_t* cursor = snapshot.data() + sector.extrasOffset;
+	const uint8_t* end = cursor + sector.extrasSize;
+	while (cursor < end) {
+		uint16_t x, y, nameLength;
+		uint8_t z, direction;
+		int32_t spawnSize, spawnTime;
+		if (!consume(cursor, end, x) || !consume(cursor, end, y) || !consume(cursor, end, z) || !consume(cursor, end, spawnSize) || !consume(cursor, end, nameLength) || end - cursor < nameLength) {
+			break;
+		}
+		std::string name(reinterpret_cast<const char*>(cursor), nameLength);
+		cursor += nameLength;
+		if (!consume(cursor, end, direction) || !consume(cursor, end, spawnTime)) {
+			break;
+		}
+
+		Tile* tile = tiles.getTile(x, y, z);
+		if (!tile) {
+			tile = tiles.allocator(tiles.createTileL(x, y, z));
+			tiles.setTile(tile);
+		}
+		if (spawnSize > 0 && !tile->spawn) {
+			tile->spawn = newd Spawn(spawnSize);
+		}
+		if (!name.empty() && !tile->creature) {
+			tile->creature = newd Creature(name);
+			tile->creature->setDirection(static_cast<Direction>(direction));
+			tile->creature->setSpawnTime(spawnTime);
+		}
+	}
+}
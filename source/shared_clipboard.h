@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_SHARED_CLIPBOARD_H_
+#define RME_SHARED_CLIPBOARD_H_
+
+#include "position.h"
+#include "client_version.h"
+
+#include <memory>
+#include <vector>
+
+class BaseMap;
+
+// Copy buffer shared by every editor instance of the user through named
+// shared memory. A small control block, mapped once by every instance,
+// holds a lock, the running instances and the generation of the current
+// copy. Every publish gets a block of its own with an index of 64x64
+// sectors and, for every sector, an OTBM node stream of its tiles followed
+// by its creatures and spawns.
+//
+// A fetch only copies the block out of shared memory, its sectors are
+// parsed one at a time when they are drawn or pasted.
+class SharedClipboard {
+public:
+	static const int SECTOR_SIZE = 64;
+
+	SharedClipboard();
+	~SharedClipboard();
+
+	// Another editor instance is running and could paste what we publish
+	bool hasOtherInstances() const;
+	// Generation of the current copy, 0 when nothing was published
+	uint64_t getGeneration() const;
+
+	// Returns false if the shared memory could not be used
+	bool publish(BaseMap& tiles, const Position& position, const MapVersion& version);
+	// Another instance published since our last publish or fetch
+	bool hasNewer() const;
+	// Takes a snapshot of what another instance published, false when there
+	// is nothing newer or it can not be used (error is set then)
+	bool fetch(const MapVersion& version, Position& position, wxString& error);
+	void releaseSnapshot();
+
+	// Sectors of the snapshot
+	size_t getSectorCount() const;
+	uint32_t getTileCount() const;
+	// Upper left corner of a sector and the number of tiles in it
+	void getSector(size_t index, Position& corner, uint32_t& tileCount) const;
+	// Parses the tiles, creatures and spawns of a sector into the map
+	void readSector(size_t index, BaseMap& tiles) const;
+
+private:
+	struct Memory;
+
+	std::unique_ptr<Memory> memory;
+	uint32_t processId;
+	uint64_t lastGeneration;
+	uint64_t nextGeneration;
+
+	std::vector<uint8_t> snapshot;
+	MapVersion snapshotVersion;
+};
+
+#endif
@@ -31,24 +31,171 @@ Spawns::~Spawns() {
 void Spawns::addSpawn(Tile* tile) {
 	ASSERT(tile->spawn);
 
-	auto it = spawns.insert(tile->getPosition());
-	ASSERT(it.second);
+	const Position& position = tile->getPosition();
+	auto it = spawns.insert(position);
+	if (!it.second) {
+		// Re-added with a new size, drop the old area
+		removeArea(position);
+	}
+
+	SpawnArea area;
+	area.center = position;
+	area.radius = tile->spawn->getSize();
+	insertArea(area);
 }
 
 void Spawns::removeSpawn(Tile* tile) {
 	ASSERT(tile->spawn);
-	spawns.erase(tile->getPosition());
-#if 0
-	SpawnPositionList::iterator iter = begin();
-	while(iter != end()) {
-		if(*iter == tile->getPosition()) {
-			spawns.erase(iter);
-			return;
+	const Position& position = tile->getPosition();
+	if (spawns.erase(position) != 0) {
+		removeArea(position);
+	}
+}
+
+size_t Spawns::countSpawns(const Position& position) const {
+	const SpawnCell* cell = getCell(position);
+	if (!cell) {
+		return 0;
+	}
+
+	size_t count = 0;
+	for (const SpawnArea& area : *cell) {
+		if (area.covers(position)) {
+			++count;
+		}
+	}
+	return count;
+}
+
+void Spawns::getSpawns(const Position& position, std::vector<Position>& result) const {
+	const SpawnCell* cell = getCell(position);
+	if (!cell) {
+		return;
+	}
+
+	for (const SpawnArea& area : *cell) {
+		if (area.covers(position)) {
+			result.push_back(area.center);
+		}
+	}
+}
+
+void Spawns::getAreas(int start_x, int start_y, int end_x, int end_y, int z, std::vector<SpawnArea>& result) const {
+	if (z < 0 || z > MAP_MAX_LAYER) {
+		return;
+	}
+
+	start_x = std::max(start_x, 0);
+	start_y = std::max(start_y, 0);
+	if (end_x < start_x || end_y < start_y) {
+		return;
+	}
+
+	const SpawnGrid& floor = grid[z];
+	const int cell_start_x = start_x >> SPAWN_CELL_SHIFT;
+	const int cell_start_y = start_y >> SPAWN_CELL_SHIFT;
+	for (int x = cell_start_x; x <= (end_x >> SPAWN_CELL_SHIFT); ++x) {
+		for (int y = cell_start_y; y <= (end_y >> SPAWN_CELL_SHIFT); ++y) {
+			auto it = floor.find(getCellKey(x << SPAWN_CELL_SHIFT, y << SPAWN_CELL_SHIFT));
+			if (it == floor.end()) {
+				continue;
+			}
+
+			for (const SpawnArea& area : it->second) {
+				const Position& center = area.center;
+				if (center.x + area.radius < start_x || center.x - area.radius > end_x || center.y + area.radius < start_y || center.y - area.radius > end_y) {
+					continue;
+				}
+				// An area is listed in every cell it overlaps, only the first
+				// of those inside the rectangle reports it
+				const int first_x = std::max(std::max(center.x - area.radius, 0) >> SPAWN_CELL_SHIFT, cell_start_x);
+				const int first_y = std::max(std::max(center.y - area.radius, 0) >> SPAWN_CELL_SHIFT, cell_start_y);
+				if (x == first_x && y == first_y) {
+					result.push_back(area);
+				}
+			}
+		}
+	}
+}
+
+const Spawns::SpawnCell* Spawns::getCell(const Position& position) const {
+	if (position.z < 0 || position.z > MAP_MAX_LAYER || position.x < 0 || position.y < 0) {
+		return nullptr;
+	}
+
+	const SpawnGrid& floor = grid[position.z];
+	auto it = floor.find(getCellKey(position.x, position.y));
+	if (it == floor.end()) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
+void Spawns::insertArea(const SpawnArea& area) {
+	const Position& center = area.center;
+	if (center.z < 0 || center.z > MAP_MAX_LAYER) {
+		return;
+	}
+
+	SpawnGrid& floor = grid[center.z];
+	int start_x = std::max<int>(center.x - area.radius, 0) >> SPAWN_CELL_SHIFT;
+	int start_y = std::max<int>(center.y - area.radius, 0) >> SPAWN_CELL_SHIFT;
+	int end_x = std::min<int>(center.x + area.radius, MAP_MAX_WIDTH) >> SPAWN_CELL_SHIFT;
+	int end_y = std::min<int>(center.y + area.radius, MAP_MAX_HEIGHT) >> SPAWN_CELL_SHIFT;
+	for (int x = start_x; x <= end_x; ++x) {
+		for (int y = start_y; y <= end_y; ++y) {
+			floor[getCellKey(x << SPAWN_CELL_SHIFT, y << SPAWN_CELL_SHIFT)].push_back(area);
+		}
+	}
+}
+
+void Spawns::removeArea(const Position& center) {
+	if (center.z < 0 || center.z > MAP_MAX_LAYER) {
+		return;
+	}
+
+	// The cell holding the center always lists the spawn, it knows the radius
+	SpawnGrid& floor = grid[center.z];
+	auto centerCell = floor.find(getCellKey(center.x, center.y));
+	if (centerCell == floor.end()) {
+		return;
+	}
+
+	int radius = -1;
+	for (const SpawnArea& area : centerCell->second) {
+		if (area.center == center) {
+			radius = area.radius;
+			break;
+		}
+	}
+	if (radius < 0) {
+		return;
+	}
+
+	int start_x = std::max<int>(center.x - radius, 0) >> SPAWN_CELL_SHIFT;
+	int start_y = std::max<int>(center.y - radius, 0) >> SPAWN_CELL_SHIFT;
+	int end_x = std::min<int>(center.x + radius, MAP_MAX_WIDTH) >> SPAWN_CELL_SHIFT;
+	int end_y = std::min<int>(center.y + radius, MAP_MAX_HEIGHT) >> SPAWN_CELL_SHIFT;
+	for (int x = start_x; x <= end_x; ++x) {
+		for (int y = start_y; y <= end_y; ++y) {
+			auto it = floor.find(getCellKey(x << SPAWN_CELL_SHIFT, y << SPAWN_CELL_SHIFT));
+			if (it == floor.end()) {
+				continue;
+			}
+
+			SpawnCell& cell = it->second;
+			for (auto area = cell.begin(); area != cell.end(); ++area) {
+				if (area->center == center) {
+					*area = cell.back();
+					cell.pop_back();
+					break;
+				}
+			}
+			if (cell.empty()) {
+				floor.erase(it);
+			}
 		}
-		++iter;
 	}
-	ASSERT(false);
-#endif
 }
 
 std::ostream& operator<<(std::ostream& os, const Spawn& spawn) {
@@ -18,6 +18,8 @@
 #ifndef RME_SPAWN_H_
 #define RME_SPAWN_H_
 
+#include <unordered_map>
+
 class Tile;
 
 class Spawn {
@@ -68,6 +70,19 @@ protected:
 typedef std::set<Position> SpawnPositionList;
 typedef std::list<Spawn*> SpawnList;
 
+// Spawns are bucketed per floor into square cells, every spawn is listed in
+// all cells its radius overlaps so a single cell answers a coverage query.
+#define SPAWN_CELL_SHIFT 5
+
+struct SpawnArea {
+	Position center;
+	int radius;
+
+	bool covers(const Position& position) const {
+		return std::abs(position.x - center.x) <= radius && std::abs(position.y - center.y) <= radius;
+	}
+};
+
 class Spawns {
 public:
 	Spawns();
@@ -76,6 +91,13 @@ public:
 	void addSpawn(Tile* tile);
 	void removeSpawn(Tile* tile);
 
+	// Number of spawns whose radius covers the position
+	size_t countSpawns(const Position& position) const;
+	// Centers of the spawns whose radius covers the position
+	void getSpawns(const Position& position, std::vector<Position>& result) const;
+	// Every spawn whose area overlaps the rectangle, each listed once
+	void getAreas(int start_x, int start_y, int end_x, int end_y, int z, std::vector<SpawnArea>& result) const;
+
 	SpawnPositionList::iterator begin() {
 		return spawns.begin();
 	}
@@ -89,6 +111,7 @@ public:
 		return spawns.end();
 	}
 	void erase(SpawnPositionList::iterator iter) {
+		removeArea(*iter);
 		spawns.erase(iter);
 	}
 	SpawnPositionList::iterator find(Position& pos) {
@@ -96,7 +119,19 @@ public:
 	}
 
 private:
+	typedef std::vector<SpawnArea> SpawnCell;
+	typedef std::unordered_map<uint32_t, SpawnCell> SpawnGrid;
+
+	static uint32_t getCellKey(int x, int y) {
+		return (uint32_t(x >> SPAWN_CELL_SHIFT) << 16) | uint32_t(y >> SPAWN_CELL_SHIFT);
+	}
+	const SpawnCell* getCell(const Position& position) const;
+
+	void insertArea(const SpawnArea& area);
+	void removeArea(const Position& center);
+
 	SpawnPositionList spawns;
+	SpawnGrid grid[MAP_LAYERS];
 };
 
 #endif
@@ -168,9 +168,6 @@ int Tile::size() const {
 		if (location->getHouseExits()) {
 			++sz;
 		}
-		if (location->getSpawnCount()) {
-			++sz;
-		}
 		if (location->getWaypointCount()) {
 			++sz;
 		}
@@ -337,32 +334,29 @@ void Tile::addItem(Item* item) {
 	}
 	
 	// Handle normal items
-	ItemVector::iterator it;
-	if (item->isAlwaysOnBottom()) {
-		it = items.begin();
-		while (true) {
-			if (it == items.end()) {
-				break;
-			} else if ((*it)->isAlwaysOnBottom()) {
-				if (item->getTopOrder() < (*it)->getTopOrder()) {
-					break;
-				}
-			} else { // Always on top
-				break;
-			}
-			++it;
-		}
-	} else {
-		it = items.end();
-	}
-
-	items.insert(it, item);
+	items.insert(items.begin() + getInsertIndex(item), item);
 
 	if (item->isSelected()) {
 		statflags |= TILESTATE_SELECTED;
 	}
 }
 
+size_t Tile::getInsertIndex(const Item* item) const {
+	if (!item->isAlwaysOnBottom()) {
+		return items.size();
+	}
+
+	size_t index = 0;
+	while (index < items.size()) {
+		const Item* other = items[index];
+		if (!other->isAlwaysOnBottom() || item->getTopOrder() < other->getTopOrder()) {
+			break;
+		}
+		++index;
+	}
+	return index;
+}
+
 void Tile::select() {
 	if (size() == 0) {
 		return;
@@ -141,6 +141,8 @@ public: // Functions
 	Item* getTopItem() const; // Returns the topmost item, or nullptr if the tile is empty
 	Item* getItemAt(int index) const;
 	void addItem(Item* item);
+	// Where addItem puts an item that is neither ground nor has a ground equivalent
+	size_t getInsertIndex(const Item* item) const;
 
 	void select();
 	void deselect();
@@ -0,0 +1,217 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "undo_spill.h"
+#include "basemap.h"
+#include "tile.h"
+#include "item.h"
+#include "iomap_otbm.h"
+#include "filehandle.h"
+
+#include <wx/filename.h>
+#include <wx/mstream.h>
+#include <wx/zstream.h>
+
+UndoSpillFile::UndoSpillFile() :
+	end(0),
+	liveSize(0),
+	liveRawSize(0),
+	recordCount(0) {
+	path = wxFileName::CreateTempFileName("rme_undo", &file);
+}
+
+UndoSpillFile::~UndoSpillFile() {
+	file.Close();
+	if (!path.empty()) {
+		wxRemoveFile(path);
+	}
+}
+
+bool UndoSpillFile::write(const uint8_t* data, size_t size, Record& record) {
+	if (!file.IsOpened()) {
+		return false;
+	}
+
+	// Favour speed, this runs while the user is waiting for an action
+	wxMemoryOutputStream memory;
+	{
+		wxZlibOutputStream zlib(memory, wxZ_BEST_SPEED, wxZLIB_ZLIB);
+		zlib.Write(data, size);
+		if (!zlib.Close()) {
+			return false;
+		}
+	}
+
+	std::string buffer(memory.GetSize(), '\0');
+	memory.CopyTo(&buffer[0], buffer.size());
+
+	if (file.Seek(end) == wxInvalidOffset || file.Write(buffer.data(), buffer.size()) != buffer.size()) {
+		return false;
+	}
+
+	record.offset = end;
+	record.size = buffer.size();
+	record.rawSize = size;
+
+	end += buffer.size();
+	liveSize += record.size;
+	liveRawSize += record.rawSize;
+	++recordCount;
+	return true;
+}
+
+bool UndoSpillFile::read(const Record& record, std::string& data) {
+	if (!file.IsOpened()) {
+		return false;
+	}
+
+	std::string buffer(record.size, '\0');
+	if (file.Seek(record.offset) == wxInvalidOffset || file.Read(&buffer[0], buffer.size()) != static_cast<ssize_t>(buffer.size())) {
+		return false;
+	}
+
+	wxMemoryInputStream memory(buffer.data(), buffer.size());
+	wxZlibInputStream zlib(memory, wxZLIB_ZLIB);
+	data.assign(record.rawSize, '\0');
+	return zlib.ReadAll(&data[0], data.size());
+}
+
+void UndoSpillFile::release(const Record& record) {
+	liveSize -= record.size;
+	liveRawSize -= record.rawSize;
+	if (--recordCount == 0 && file.IsOpened()) {
+		// Nothing left in use, start over instead of growing forever
+		file.Close();
+		file.Create(path, true);
+		end = 0;
+	}
+}
+
+bool UndoSpillFile::canSpill(const Tile* tile) {
+	return tile && !tile->creature && !tile->spawn;
+}
+
+void UndoSpillFile::writeTile(NodeFileWriteHandle& writer, const IOMap& iomap, Tile* tile) {
+	const Position position = tile->getPosition();
+	writer.addNode(OTBM_TILE);
+	writer.addU16(position.x);
+	writer.addU16(position.y);
+	writer.addU8(position.z);
+	writer.addU32(tile->house_id);
+	writer.addU16(tile->getMapFlags());
+	writer.addU16(tile->getStatFlags());
+
+	const std::vector<uint16_t>& zoneIds = tile->getZoneIds();
+	writer.addU16(zoneIds.size());
+	for (uint16_t zoneId : zoneIds) {
+		writer.addU16(zoneId);
+	}
+
+	// Selection of the ground and every item, in node order
+	writer.addU8(tile->ground ? 1 : 0);
+	writer.addU16(tile->items.size());
+	if (tile->ground) {
+		writer.addU8(tile->ground->isSelected() ? 1 : 0);
+	}
+	for (Item* item : tile->items) {
+		writer.addU8(item->isSelected() ? 1 : 0);
+	}
+
+	if (tile->ground) {
+		tile->ground->serializeItemNode_OTBM(iomap, writer);
+	}
+	for (Item* item : tile->items) {
+		item->serializeItemNode_OTBM(iomap, writer);
+	}
+	writer.endNode();
+}
+
+Tile* UndoSpillFile::readTile(BinaryNode* node, const IOMap& iomap, BaseMap& map) {
+	uint8_t type;
+	uint16_t x, y;
+	uint8_t z;
+	uint32_t houseId;
+	uint16_t mapFlags, statFlags, zoneCount;
+	if (!node->getByte(type) || type != OTBM_TILE || !node->getU16(x) || !node->getU16(y) || !node->getU8(z) || !node->getU32(houseId) || !node->getU16(mapFlags) || !node->getU16(statFlags) || !node->getU16(zoneCount)) {
+		return nullptr;
+	}
+
+	Tile* tile = map.allocator(map.createTileL(x, y, z));
+	tile->setHouseID(houseId);
+	tile->setMapFlags(mapFlags);
+	for (uint16_t i = 0; i < zoneCount; ++i) {
+		uint16_t zoneId;
+		if (!node->getU16(zoneId)) {
+			delete tile;
+			return nullptr;
+		}
+		tile->addZoneId(zoneId);
+	}
+
+	uint8_t hasGround;
+	uint16_t itemCount;
+	if (!node->getU8(hasGround) || !node->getU16(itemCount)) {
+		delete tile;
+		return nullptr;
+	}
+
+	std::vector<uint8_t> selected(hasGround + itemCount);
+	for (uint8_t& value : selected) {
+		if (!node->getU8(value)) {
+			delete tile;
+			return nullptr;
+		}
+	}
+
+	// Items are placed back exactly as they were, not through addItem
+	size_t index = 0;
+	BinaryNode* itemNode = node->getChild();
+	while (itemNode && index < selected.size()) {
+		uint8_t itemType;
+		Item* item = nullptr;
+		if (itemNode->getByte(itemType) && itemType == OTBM_ITEM) {
+			item = Item::Create_OTBM(iomap, itemNode);
+		}
+		if (!item || !item->unserializeItemNode_OTBM(iomap, itemNode)) {
+			delete item;
+			delete tile;
+			return nullptr;
+		}
+
+		if (selected[index]) {
+			item->select();
+		}
+		if (hasGround && index == 0) {
+			tile->ground = item;
+		} else {
+			tile->items.push_back(item);
+		}
+		++index;
+		itemNode = itemNode->advance();
+	}
+
+	if (index != selected.size()) {
+		delete tile;
+		return nullptr;
+	}
+
+	tile->update();
+	tile->setStatFlags(statFlags);
+	return tile;
+}
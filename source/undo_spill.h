@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_UNDO_SPILL_H_
+#define RME_UNDO_SPILL_H_
+
+#include <wx/file.h>
+
+class BaseMap;
+class BinaryNode;
+class IOMap;
+class NodeFileWriteHandle;
+class Tile;
+
+// Temporary file holding undo data that no longer fits the memory budget of
+// an action queue. Each record is a zlib compressed list of OTBM tile nodes,
+// records are read back when the action they belong to is undone or redone.
+class UndoSpillFile {
+public:
+	UndoSpillFile();
+	~UndoSpillFile();
+
+	struct Record {
+		wxFileOffset offset;
+		uint32_t size; // compressed
+		uint32_t rawSize;
+	};
+
+	bool isOpen() const {
+		return file.IsOpened();
+	}
+
+	bool write(const uint8_t* data, size_t size, Record& record);
+	bool read(const Record& record, std::string& data);
+	// The record is not needed anymore, the file is emptied once all are
+	void release(const Record& record);
+
+	uint64_t getFileSize() const {
+		return end;
+	}
+	// Compressed and uncompressed size of the records still in use
+	uint64_t getLiveSize() const {
+		return liveSize;
+	}
+	uint64_t getLiveRawSize() const {
+		return liveRawSize;
+	}
+	size_t getRecordCount() const {
+		return recordCount;
+	}
+
+	// Tiles holding creatures or spawns are kept in memory
+	static bool canSpill(const Tile* tile);
+	// Unlike map files these keep the selection and state flags of the tile
+	static void writeTile(NodeFileWriteHandle& writer, const IOMap& iomap, Tile* tile);
+	static Tile* readTile(BinaryNode* node, const IOMap& iomap, BaseMap& map);
+
+protected:
+	wxString path;
+	wxFile file;
+	wxFileOffset end;
+	uint64_t liveSize;
+	uint64_t liveRawSize;
+	size_t recordCount;
+};
+
+#endif
@@ -0,0 +1,252 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "zone_labeler.h"
+#include "basemap.h"
+#include "tile.h"
+
+namespace {
+	const int ZONE_SECTOR_BITS = 6;
+	const int ZONE_SECTOR_SIZE = 1 << ZONE_SECTOR_BITS;
+	const uint16_t ZONE_NO_CELL = 0xFFFF;
+
+	uint64_t getSectorKey(int sector_x, int sector_y, int z) {
+		return (uint64_t(z) << 40) | (uint64_t(sector_y) << 20) | uint64_t(sector_x);
+	}
+
+	uint64_t getCellKey(uint16_t zoneId, int x, int y) {
+		return (uint64_t(zoneId) << 40) | (uint64_t(y) << 20) | uint64_t(x);
+	}
+
+	template <typename T>
+	T findRoot(std::vector<T>& parent, T index) {
+		while (parent[index] != index) {
+			parent[index] = parent[parent[index]];
+			index = parent[index];
+		}
+		return index;
+	}
+
+	template <typename T>
+	void unite(std::vector<T>& parent, T a, T b) {
+		a = findRoot(parent, a);
+		b = findRoot(parent, b);
+		if (a != b) {
+			parent[std::max(a, b)] = std::min(a, b);
+		}
+	}
+}
+
+ZoneLabeler::ZoneLabeler() :
+	generation(0),
+	cachedGeneration(0) {
+	std::fill(cachedArea, cachedArea + 5, -1);
+}
+
+ZoneLabeler::~ZoneLabeler() {
+	////
+}
+
+void ZoneLabeler::invalidate(int x, int y, int z) {
+	sectors[getSectorKey(x >> ZONE_SECTOR_BITS, y >> ZONE_SECTOR_BITS, z)].dirty = true;
+	++generation;
+}
+
+void ZoneLabeler::clear() {
+	sectors.clear();
+	++generation;
+}
+
+void ZoneLabeler::build(BaseMap& map, int sector_x, int sector_y, int z, Sector& sector) {
+	sector.dirty = false;
+	sector.components.clear();
+
+	const int base_x = sector_x << ZONE_SECTOR_BITS;
+	const int base_y = sector_y << ZONE_SECTOR_BITS;
+
+	// One union-find forest per zone id, cells without the zone stay empty
+	std::map<uint16_t, std::vector<uint16_t>> forests;
+	for (int leaf_y = 0; leaf_y < ZONE_SECTOR_SIZE; leaf_y += 4) {
+		for (int leaf_x = 0; leaf_x < ZONE_SECTOR_SIZE; leaf_x += 4) {
+			QTreeNode* leaf = map.getLeaf(base_x + leaf_x, base_y + leaf_y);
+			if (!leaf) {
+				continue;
+			}
+			for (int y = leaf_y; y < leaf_y + 4; ++y) {
+				for (int x = leaf_x; x < leaf_x + 4; ++x) {
+					TileLocation* location = leaf->getTile(x, y, z);
+					const Tile* tile = location ? location->get() : nullptr;
+					if (!tile) {
+						continue;
+					}
+					for (uint16_t zoneId : tile->getZoneIds()) {
+						std::vector<uint16_t>& parent = forests[zoneId];
+						if (parent.empty()) {
+							parent.assign(ZONE_SECTOR_SIZE * ZONE_SECTOR_SIZE, ZONE_NO_CELL);
+						}
+						const uint16_t cell = (y << ZONE_SECTOR_BITS) | x;
+						parent[cell] = cell;
+					}
+				}
+			}
+		}
+	}
+
+	for (auto& forest : forests) {
+		std::vector<uint16_t>& parent = forest.second;
+		for (uint16_t cell = 0; cell < parent.size(); ++cell) {
+			if (parent[cell] == ZONE_NO_CELL) {
+				continue;
+			}
+			if ((cell & (ZONE_SECTOR_SIZE - 1)) != 0 && parent[cell - 1] != ZONE_NO_CELL) {
+				unite<uint16_t>(parent, cell, cell - 1);
+			}
+			if (cell >= ZONE_SECTOR_SIZE && parent[cell - ZONE_SECTOR_SIZE] != ZONE_NO_CELL) {
+				unite<uint16_t>(parent, cell, cell - ZONE_SECTOR_SIZE);
+			}
+		}
+
+		std::map<uint16_t, size_t> components;
+		for (uint16_t cell = 0; cell < parent.size(); ++cell) {
+			if (parent[cell] == ZONE_NO_CELL) {
+				continue;
+			}
+			const uint16_t root = findRoot(parent, cell);
+			auto it = components.find(root);
+			if (it == components.end()) {
+				it = components.emplace(root, sector.components.size()).first;
+				sector.components.push_back(Component());
+				sector.components.back().zoneId = forest.first;
+			}
+			sector.components[it->second].cells.push_back(cell);
+		}
+	}
+}
+
+const std::vector<ZoneLabel>& ZoneLabeler::getLabels(BaseMap& map, int start_x, int start_y, int end_x, int end_y, int z) {
+	const int area[5] = {
+		std::max(0, start_x) >> ZONE_SECTOR_BITS,
+		std::max(0, start_y) >> ZONE_SECTOR_BITS,
+		std::max(0, end_x) >> ZONE_SECTOR_BITS,
+		std::max(0, end_y) >> ZONE_SECTOR_BITS,
+		z
+	};
+	if (cachedGeneration == generation && std::equal(area, area + 5, cachedArea)) {
+		return labels;
+	}
+	cachedGeneration = generation;
+	std::copy(area, area + 5, cachedArea);
+	labels.clear();
+
+	// Areas of every sector in view, areas touching across sector borders
+	// are joined through the cells on the borders
+	struct Piece {
+		const Component* component;
+		int base_x, base_y;
+	};
+	std::vector<Piece> pieces;
+	std::unordered_map<uint64_t, uint32_t> borders;
+
+	for (int sector_y = area[1]; sector_y <= area[3]; ++sector_y) {
+		for (int sector_x = area[0]; sector_x <= area[2]; ++sector_x) {
+			auto it = sectors.find(getSectorKey(sector_x, sector_y, z));
+			if (it == sectors.end()) {
+				continue;
+			}
+
+			Sector& sector = it->second;
+			if (sector.dirty) {
+				build(map, sector_x, sector_y, z, sector);
+			}
+			if (sector.components.empty()) {
+				sectors.erase(it);
+				continue;
+			}
+
+			const int base_x = sector_x << ZONE_SECTOR_BITS;
+			const int base_y = sector_y << ZONE_SECTOR_BITS;
+			for (const Component& component : sector.components) {
+				for (uint16_t cell : component.cells) {
+					const int x = cell & (ZONE_SECTOR_SIZE - 1);
+					const int y = cell >> ZONE_SECTOR_BITS;
+					if (x == 0 || y == 0 || x == ZONE_SECTOR_SIZE - 1 || y == ZONE_SECTOR_SIZE - 1) {
+						borders.emplace(getCellKey(component.zoneId, base_x + x, base_y + y), pieces.size());
+					}
+				}
+				pieces.push_back({ &component, base_x, base_y });
+			}
+		}
+	}
+
+	std::vector<uint32_t> parent(pieces.size());
+	for (uint32_t i = 0; i < parent.size(); ++i) {
+		parent[i] = i;
+	}
+	for (const auto& border : borders) {
+		const uint64_t key = border.first;
+		const int x = key & 0xFFFFF;
+		const int y = (key >> 20) & 0xFFFFF;
+		const uint16_t zoneId = key >> 40;
+		auto east = borders.find(getCellKey(zoneId, x + 1, y));
+		if (east != borders.end()) {
+			unite(parent, border.second, east->second);
+		}
+		auto south = borders.find(getCellKey(zoneId, x, y + 1));
+		if (south != borders.end()) {
+			unite(parent, border.second, south->second);
+		}
+	}
+
+	// Every joined area is labeled at its tile closest to the centroid
+	std::map<uint32_t, std::vector<uint32_t>> groups;
+	for (uint32_t i = 0; i < pieces.size(); ++i) {
+		groups[findRoot(parent, i)].push_back(i);
+	}
+	for (const auto& group : groups) {
+		double sum_x = 0, sum_y = 0, count = 0;
+		for (uint32_t index : group.second) {
+			const Piece& piece = pieces[index];
+			for (uint16_t cell : piece.component->cells) {
+				sum_x += piece.base_x + (cell & (ZONE_SECTOR_SIZE - 1));
+				sum_y += piece.base_y + (cell >> ZONE_SECTOR_BITS);
+			}
+			count += piece.component->cells.size();
+		}
+		const double center_x = sum_x / count;
+		const double center_y = sum_y / count;
+
+		double best = std::numeric_limits<double>::max();
+		ZoneLabel label;
+		label.zoneId = pieces[group.second.front()].component->zoneId;
+		for (uint32_t index : group.second) {
+			const Piece& piece = pieces[index];
+			for (uint16_t cell : piece.component->cells) {
+				const int x = piece.base_x + (cell & (ZONE_SECTOR_SIZE - 1));
+				const int y = piece.base_y + (cell >> ZONE_SECTOR_BITS);
+				const double distance = (x - center_x) * (x - center_x) + (y - center_y) * (y - center_y);
+				if (distance < best) {
+					best = distance;
+					label.position = Position(x, y, z);
+				}
+			}
+		}
+		labels.push_back(label);
+	}
+	return labels;
+}
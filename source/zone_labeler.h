@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_ZONE_LABELER_H_
+#define RME_ZONE_LABELER_H_
+
+#include "position.h"
+
+#include <unordered_map>
+
+class BaseMap;
+
+struct ZoneLabel {
+	uint16_t zoneId;
+	Position position; // tile closest to the center of the zone area
+};
+
+// Connected areas of every zone id, used to place the zone tooltips.
+// Areas are labeled per 64x64 sector with a union-find and kept until a
+// tile of that sector changes its zones. The labels of a view merge the
+// areas of the sectors it touches and are reused until something changes.
+class ZoneLabeler {
+public:
+	ZoneLabeler();
+	~ZoneLabeler();
+
+	// The zones of the tile at the position changed
+	void invalidate(int x, int y, int z);
+	void clear();
+
+	const std::vector<ZoneLabel>& getLabels(BaseMap& map, int start_x, int start_y, int end_x, int end_y, int z);
+
+private:
+	struct Component {
+		uint16_t zoneId;
+		std::vector<uint16_t> cells; // y * size + x inside the sector
+	};
+
+	struct Sector {
+		Sector() :
+			dirty(true) { }
+		bool dirty;
+		std::vector<Component> components;
+	};
+
+	void build(BaseMap& map, int sector_x, int sector_y, int z, Sector& sector);
+
+	std::unordered_map<uint64_t, Sector> sectors;
+	uint64_t generation;
+
+	// The last request, answered again while nothing changed
+	uint64_t cachedGeneration;
+	int cachedArea[5];
+	std::vector<ZoneLabel> labels;
+};
+
+#endif